@@ -0,0 +1,964 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include "adapter/linux/usb_ehci_sim.h"
+#include "adapter/linux/usb_linux.h"
+#include "config/usb_config.h"
+#include "adapter/os/usb_os.h"
+#include "core/include/specs/usb_specs.h"
+#include "core/include/host/controller/ehci/usbh_ehci_reg.h"
+#include "core/include/host/controller/ehci/usbh_ehci_xfer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*******************************************************************************
+ * Macro operate
+ ******************************************************************************/
+/* \brief 性能寄存器长度，操作寄存器紧跟其后*/
+#define __SIM_CAP_LENGTH      0x20
+/* \brief 寄存器窗口大小*/
+#define __SIM_REG_SIZE        0x100
+/* \brief 端口复位持续时间（纳秒）*/
+#define __SIM_PORT_RESET_NS   (10 * 1000000ULL)
+/* \brief 遍历调度链表的最大节点数，防止链表成环*/
+#define __SIM_WALK_MAX        4096
+/* \brief 一次异步遍历中一个 QH 最多完成的 qTD 数量*/
+#define __SIM_QH_QTD_MAX      8
+/* \brief qTD 最大数据长度（5 个 4K 页）*/
+#define __SIM_XFER_BUF_SIZE   (5 * 0x1000)
+
+/* \brief 描述符地址转指针*/
+#define __SIM_PTR(addr)       ((void *)(uintptr_t)((addr) & ~0x1Fu))
+
+/*******************************************************************************
+ * Statement
+ ******************************************************************************/
+/* \brief EHCI 控制器模型结构体*/
+struct usb_ehci_sim {
+    uint8_t                   reg_win[__SIM_REG_SIZE] __attribute__((aligned(32)));  /* 寄存器窗口*/
+    pthread_mutex_t           lock;                            /* 模型互斥锁*/
+    pthread_t                 tid;                             /* 模型线程*/
+    volatile int              is_exit;                         /* 线程退出标志*/
+    struct usb_ehci_sim_cfg   cfg;                             /* 模型配置*/
+
+    uint32_t                  cmd;                             /* 命令寄存器*/
+    uint32_t                  sts;                             /* 状态寄存器*/
+    uint32_t                  intr;                            /* 中断使能寄存器*/
+    uint32_t                  frindex;                         /* 帧索引寄存器*/
+    uint32_t                  ctrlds;                          /* 高 32 位地址寄存器*/
+    uint32_t                  periodic;                        /* 周期帧列表基地址*/
+    uint32_t                  async;                           /* 异步调度基地址*/
+    uint32_t                  ttsts;
+    uint32_t                  cfg_flag;                        /* 配置标志寄存器*/
+    uint32_t                  mode;                            /* 模式寄存器*/
+    uint32_t                  portsc[USB_EHCI_SIM_PORT_MAX];   /* 端口状态和控制寄存器*/
+    uint64_t                  reset_end[USB_EHCI_SIM_PORT_MAX];/* 端口复位结束时间*/
+    struct usb_ehci_sim_dev  *p_dev[USB_EHCI_SIM_PORT_MAX];    /* 端口上的虚拟设备*/
+
+    uint32_t                  int_pending;                     /* 等待中断阈值到达的中断状态*/
+    uint32_t                  itc_cnt;                         /* 距上次中断的微帧数*/
+
+    void                    (*p_fn_irq)(void *p_arg);          /* 中断函数*/
+    void                     *p_irq_arg;                       /* 中断函数参数*/
+    struct usb_ehci_sim_stat  stat;                            /* 统计*/
+    uint8_t                   xfer_buf[__SIM_XFER_BUF_SIZE];   /* 数据中转缓存*/
+};
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+/**
+ * \brief 获取当前时间（纳秒）
+ */
+static uint64_t __ns_get(void){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/**
+ * \brief 描述符读写，和驱动线程共享内存
+ */
+static uint32_t __hw_rd(uint32_t *p_hw){
+    return __atomic_load_n(p_hw, __ATOMIC_ACQUIRE);
+}
+
+static void __hw_wr(uint32_t *p_hw, uint32_t val){
+    __atomic_store_n(p_hw, val, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief 获取周期帧列表大小
+ */
+static uint32_t __frame_list_size_get(struct usb_ehci_sim *p_sim){
+    if (p_sim->cfg.frame_list_prog == USB_FALSE) {
+        return 1024;
+    }
+    return 1024 >> ((p_sim->cmd >> 2) & 0x3);
+}
+
+/**
+ * \brief 更新端口复位状态，复位结束后使能有设备的端口
+ */
+static void __port_reset_update(struct usb_ehci_sim *p_sim, int port){
+    struct usb_ehci_sim_dev *p_dev = p_sim->p_dev[port];
+
+    if (!(p_sim->portsc[port] & __REG_PORTSC_RESET) || (__ns_get() < p_sim->reset_end[port])) {
+        return;
+    }
+
+    p_sim->portsc[port] &= ~(__REG_PORTSC_RESET | __REG_PORTSC_PSPD);
+    if (p_dev && (p_sim->portsc[port] & __REG_PORTSC_CONNECT)) {
+        p_dev->addr      = 0;
+        p_dev->addr_new  = 0;
+        p_sim->portsc[port] |= __REG_PORTSC_PE;
+        if (p_dev->speed == USB_SPEED_HIGH) {
+            p_sim->portsc[port] |= __REG_PORTSC_PS_HS;
+        } else if (p_dev->speed == USB_SPEED_LOW) {
+            p_sim->portsc[port] |= __REG_PORTSC_PS_LS;
+        } else {
+            p_sim->portsc[port] |= __REG_PORTSC_PS_FS;
+        }
+    }
+}
+
+/**
+ * \brief 寄存器读回调
+ */
+static uint32_t __reg_read(void *p_arg, uint32_t offset){
+    struct usb_ehci_sim *p_sim = (struct usb_ehci_sim *)p_arg;
+    uint32_t             val   = 0;
+    int                  port;
+
+    pthread_mutex_lock(&p_sim->lock);
+    if (offset < __SIM_CAP_LENGTH) {
+        switch (offset) {
+        case __CAP_REG_LENGTH:
+            val = __SIM_CAP_LENGTH | (0x0100 << 16);
+            break;
+        case __CAP_REG_HCS:
+            val = p_sim->cfg.n_ports | (1 << 4);
+            break;
+        case __CAP_REG_HCC:
+            val = (p_sim->cfg.frame_list_prog ? (1 << 1) : 0) | (1 << 7);
+            break;
+        default:
+            break;
+        }
+        pthread_mutex_unlock(&p_sim->lock);
+        return val;
+    }
+
+    offset -= __SIM_CAP_LENGTH;
+    switch (offset) {
+    case __OPT_REG_CMD:
+        val = p_sim->cmd;
+        break;
+    case __OPT_REG_STS:
+        val = p_sim->sts & 0x3F;
+        if (!(p_sim->cmd & __REG_CMD_RUN)) {
+            val |= __REG_STS_HALT;
+        }
+        if (p_sim->cmd & __REG_CMD_ASE) {
+            val |= __REG_STS_ASS;
+        }
+        if (p_sim->cmd & __REG_CMD_PSE) {
+            val |= __REG_STS_PSS;
+        }
+        break;
+    case __OPT_REG_INTR:   val = p_sim->intr;     break;
+    case __OPT_REG_FDIX:   val = p_sim->frindex;  break;
+    case __OPT_REG_CTRL:   val = p_sim->ctrlds;   break;
+    case __OPT_REG_PERIOD: val = p_sim->periodic; break;
+    case __OPT_REG_ASYNC:  val = p_sim->async;    break;
+    case __OPT_REG_TTSTS:  val = p_sim->ttsts;    break;
+    case __OPT_REG_CFG:    val = p_sim->cfg_flag; break;
+    case __OPT_REG_MODE:   val = p_sim->mode;     break;
+    default:
+        if ((offset >= __OPT_REG_PSC0) && (offset < __OPT_REG_PSC0 + (p_sim->cfg.n_ports << 2))) {
+            port = (offset - __OPT_REG_PSC0) >> 2;
+            __port_reset_update(p_sim, port);
+            val = p_sim->portsc[port];
+        }
+        break;
+    }
+    pthread_mutex_unlock(&p_sim->lock);
+
+    return val;
+}
+
+/**
+ * \brief 复位控制器
+ */
+static void __hc_reset(struct usb_ehci_sim *p_sim){
+    p_sim->cmd         = 8 << 16;
+    p_sim->sts         = 0;
+    p_sim->intr        = 0;
+    p_sim->frindex     = 0;
+    p_sim->periodic    = 0;
+    p_sim->async       = 0;
+    p_sim->cfg_flag    = 0;
+    p_sim->int_pending = 0;
+    p_sim->itc_cnt     = 0;
+}
+
+/**
+ * \brief 寄存器写回调
+ */
+static void __reg_write(void *p_arg, uint32_t offset, uint32_t val){
+    struct usb_ehci_sim *p_sim = (struct usb_ehci_sim *)p_arg;
+    uint32_t             tmp;
+    int                  port;
+
+    if (offset < __SIM_CAP_LENGTH) {
+        return;
+    }
+
+    pthread_mutex_lock(&p_sim->lock);
+    offset -= __SIM_CAP_LENGTH;
+    switch (offset) {
+    case __OPT_REG_CMD:
+        if (val & __REG_CMD_RESET) {
+            __hc_reset(p_sim);
+            val &= ~__REG_CMD_RESET;
+        }
+        p_sim->cmd = val;
+        break;
+    case __OPT_REG_STS:
+        /* 写 1 清除*/
+        p_sim->sts &= ~(val & 0x3F);
+        break;
+    case __OPT_REG_INTR:   p_sim->intr     = val & 0x3F; break;
+    case __OPT_REG_FDIX:   p_sim->frindex  = val & 0x3FFF; break;
+    case __OPT_REG_CTRL:   p_sim->ctrlds   = val; break;
+    case __OPT_REG_PERIOD: p_sim->periodic = val & ~0xFFFu; break;
+    case __OPT_REG_ASYNC:  p_sim->async    = val & ~0x1Fu; break;
+    case __OPT_REG_TTSTS:  p_sim->ttsts    = val; break;
+    case __OPT_REG_CFG:    p_sim->cfg_flag = val & 1; break;
+    case __OPT_REG_MODE:   p_sim->mode     = val; break;
+    default:
+        if ((offset >= __OPT_REG_PSC0) && (offset < __OPT_REG_PSC0 + (p_sim->cfg.n_ports << 2))) {
+            port = (offset - __OPT_REG_PSC0) >> 2;
+            tmp  = p_sim->portsc[port];
+            /* 变化位写 1 清除*/
+            tmp &= ~(val & (__REG_PORTSC_CSC | __REG_PORTSC_PEC | __REG_PORTSC_OCC));
+            /* 端口使能位只能由软件清除*/
+            if (!(val & __REG_PORTSC_PE)) {
+                tmp &= ~__REG_PORTSC_PE;
+            }
+            /* 可写位*/
+            tmp &= ~(__REG_PORTSC_WKOC_E | __REG_PORTSC_WKDISC_E | __REG_PORTSC_WKCONN_E |
+                     (3 << 14) | __REG_PORTSC_PP | __REG_PORTSC_SUSPEND | __REG_PORTSC_RESUME);
+            tmp |= val & (__REG_PORTSC_WKOC_E | __REG_PORTSC_WKDISC_E | __REG_PORTSC_WKCONN_E |
+                          (3 << 14) | __REG_PORTSC_PP | __REG_PORTSC_SUSPEND | __REG_PORTSC_RESUME);
+            /* 开始端口复位，由模型在复位时间到后自动清除*/
+            if ((val & __REG_PORTSC_RESET) && !(tmp & __REG_PORTSC_RESET)) {
+                tmp &= ~__REG_PORTSC_PE;
+                tmp |= __REG_PORTSC_RESET;
+                p_sim->reset_end[port] = __ns_get() + __SIM_PORT_RESET_NS;
+            }
+            p_sim->portsc[port] = tmp;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&p_sim->lock);
+}
+
+/**
+ * \brief 通过地址查找已使能的虚拟设备
+ */
+static struct usb_ehci_sim_dev *__dev_find(struct usb_ehci_sim *p_sim, uint8_t addr){
+    int i;
+
+    for (i = 0; i < p_sim->cfg.n_ports; i++) {
+        if ((p_sim->p_dev[i] != NULL) &&
+                (p_sim->portsc[i] & __REG_PORTSC_PE) &&
+                (p_sim->p_dev[i]->addr == addr)) {
+            return p_sim->p_dev[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief 数据在描述符缓冲页和中转缓存之间拷贝
+ *
+ * \param[in] p_pages 缓冲页指针数组（第 0 页带页内偏移）
+ * \param[in] n_pages 缓冲页数量
+ * \param[in] p_buf   中转缓存
+ * \param[in] len     拷贝长度
+ * \param[in] to_mem  USB_TRUE 为中转缓存到描述符缓冲区
+ */
+static void __buf_copy(uint32_t   *p_pages,
+                       int         n_pages,
+                       uint8_t    *p_buf,
+                       uint32_t    len,
+                       usb_bool_t  to_mem){
+    uint32_t pos = __hw_rd(&p_pages[0]) & 0xFFF;
+    uint32_t page, chunk;
+    uint8_t *p_mem;
+
+    while (len > 0) {
+        page = pos >> 12;
+        if (page >= (uint32_t)n_pages) {
+            break;
+        }
+        p_mem = (uint8_t *)(uintptr_t)((__hw_rd(&p_pages[page]) & ~0xFFFu) + (pos & 0xFFF));
+        chunk = 0x1000 - (pos & 0xFFF);
+        if (chunk > len) {
+            chunk = len;
+        }
+        if (to_mem) {
+            memcpy(p_mem, p_buf, chunk);
+        } else {
+            memcpy(p_buf, p_mem, chunk);
+        }
+        p_buf += chunk;
+        pos   += chunk;
+        len   -= chunk;
+    }
+}
+
+/**
+ * \brief 调用虚拟设备完成一次事务
+ */
+static int __dev_xfer(struct usb_ehci_sim     *p_sim,
+                      struct usb_ehci_sim_dev *p_dev,
+                      uint8_t                  ep,
+                      uint8_t                  pid,
+                      uint32_t                 len){
+    struct usb_ctrlreq *p_setup = (struct usb_ctrlreq *)p_sim->xfer_buf;
+    int                 ret;
+
+    if (p_dev == NULL) {
+        return -USB_ENODEV;
+    }
+
+    ret = p_dev->p_fn_xfer(p_dev, ep, pid, p_sim->xfer_buf, len);
+    if (ret < 0) {
+        if (ret == -USB_EAGAIN) {
+            p_sim->stat.naks++;
+        }
+        return ret;
+    }
+    if (ret > (int)len) {
+        ret = len;
+    }
+
+    if (ep == 0) {
+        if (pid == USB_EHCI_SIM_PID_SETUP) {
+            /* 记录 SET_ADDRESS 请求，状态阶段完成后生效*/
+            p_dev->addr_new = 0;
+            if ((p_setup->request_type == 0) && (p_setup->request == USB_REQ_SET_ADDRESS)) {
+                p_dev->addr_new = (uint8_t)(USB_CPU_TO_LE16(p_setup->value) | 0x80);
+            }
+        } else if ((len == 0) && (p_dev->addr_new & 0x80)) {
+            p_dev->addr     = p_dev->addr_new & 0x7F;
+            p_dev->addr_new = 0;
+        }
+    }
+    p_sim->stat.bytes += ret;
+
+    return ret;
+}
+
+/**
+ * \brief 执行一个激活的 qTD
+ *
+ * \retval 完成返回 USB_OK，设备 NAK 返回 -USB_EAGAIN
+ */
+static int __qtd_exec(struct usb_ehci_sim     *p_sim,
+                      struct usb_ehci_sim_dev *p_dev,
+                      struct usbh_ehci_qh     *p_qh,
+                      struct usbh_ehci_qtd    *p_qtd,
+                      uint32_t                *p_token){
+    uint32_t token = *p_token;
+    uint32_t info1 = __hw_rd(&p_qh->hw_info1);
+    uint32_t len   = __QTD_LENGTH(token);
+    uint8_t  pid   = __QTD_PID(token);
+    uint8_t  ep    = (info1 >> 8) & 0xF;
+    int      ret;
+
+    if (len > __SIM_XFER_BUF_SIZE) {
+        len = __SIM_XFER_BUF_SIZE;
+    }
+    if (pid != USB_EHCI_SIM_PID_IN) {
+        __buf_copy(p_qtd->hw_buf, 5, p_sim->xfer_buf, len, USB_FALSE);
+    }
+
+    ret = __dev_xfer(p_sim, p_dev, ep, pid, len);
+    if (ret == -USB_EAGAIN) {
+        return ret;
+    }
+
+    token &= ~__QTD_STS_ACTIVE;
+    if (ret == -USB_EPIPE) {
+        token |= __QTD_STS_HALT;
+        p_sim->int_pending |= __REG_STS_ERR;
+    } else if (ret < 0) {
+        token &= ~(3 << 10);
+        token |= __QTD_STS_HALT | __QTD_STS_XACT;
+        p_sim->int_pending |= __REG_STS_ERR;
+    } else {
+        if (pid == USB_EHCI_SIM_PID_IN) {
+            __buf_copy(p_qtd->hw_buf, 5, p_sim->xfer_buf, ret, USB_TRUE);
+        } else {
+            ret = len;
+        }
+        /* 剩余长度*/
+        token = (token & ~(0x7FFFu << 16)) | ((__QTD_LENGTH(token) - ret) << 16);
+    }
+    if (token & __QTD_IOC) {
+        p_sim->int_pending |= __REG_STS_INT;
+    }
+    p_sim->stat.qtds++;
+
+    *p_token = token;
+
+    return USB_OK;
+}
+
+/**
+ * \brief 处理一个 QH 上的 qTD 链表
+ *
+ * \param[in] p_sim       模型
+ * \param[in] p_qh        QH
+ * \param[in] is_periodic 是否是周期调度，周期调度一次只执行一个 qTD
+ *
+ * \retval 有 qTD 被执行返回 USB_TRUE
+ */
+static usb_bool_t __qh_process(struct usb_ehci_sim *p_sim,
+                               struct usbh_ehci_qh *p_qh,
+                               usb_bool_t           is_periodic){
+    struct usb_ehci_sim_dev *p_dev = NULL;
+    struct usbh_ehci_qtd    *p_qtd = NULL;
+    uint32_t                 next, cur, token;
+    int                      n_done = 0, n_walk = 0, ret;
+
+    p_dev = __dev_find(p_sim, __hw_rd(&p_qh->hw_info1) & 0x7F);
+    next  = __hw_rd(&p_qh->hw_next_qtd);
+    cur   = __hw_rd(&p_qh->hw_cur_qtd);
+
+    while (!(next & 1) && (n_walk++ < __SIM_WALK_MAX)) {
+        p_qtd = __SIM_PTR(next);
+        token = __hw_rd(&p_qtd->hw_token);
+
+        if (!(token & __QTD_STS_ACTIVE)) {
+            /* 停止的 qTD 会阻塞队列，直到软件把它移除*/
+            if (token & __QTD_STS_HALT) {
+                break;
+            }
+            /* 短包后跳到 Alternate Next qTD，队列停在这里直到软件处理*/
+            if (((uintptr_t)p_qtd == (uintptr_t)__SIM_PTR(cur)) &&
+                    IS_SHORT_READ(token) && !(__hw_rd(&p_qtd->hw_alt_next) & 1)) {
+                break;
+            }
+            next = __hw_rd(&p_qtd->hw_next);
+            continue;
+        }
+
+        ret = __qtd_exec(p_sim, p_dev, p_qh, p_qtd, &token);
+        if (ret != USB_OK) {
+            break;
+        }
+        __hw_wr(&p_qh->hw_cur_qtd, (uint32_t)(uintptr_t)p_qtd);
+        __hw_wr(&p_qh->hw_token, token);
+        __hw_wr(&p_qtd->hw_token, token);
+        n_done++;
+
+        if ((token & __QTD_STS_HALT) ||
+                (IS_SHORT_READ(token) && !(__hw_rd(&p_qtd->hw_alt_next) & 1))) {
+            break;
+        }
+        if ((is_periodic == USB_TRUE) || (n_done >= __SIM_QH_QTD_MAX)) {
+            break;
+        }
+        next = __hw_rd(&p_qtd->hw_next);
+    }
+
+    return (n_done > 0) ? USB_TRUE : USB_FALSE;
+}
+
+/**
+ * \brief 遍历异步调度 QH 环
+ */
+static usb_bool_t __async_run(struct usb_ehci_sim *p_sim){
+    struct usbh_ehci_qh *p_head = __SIM_PTR(p_sim->async);
+    struct usbh_ehci_qh *p_qh   = p_head;
+    uint32_t             next;
+    usb_bool_t           is_work = USB_FALSE;
+    int                  n_walk  = 0;
+
+    if (p_head == NULL) {
+        return USB_FALSE;
+    }
+
+    do {
+        if (__qh_process(p_sim, p_qh, USB_FALSE) == USB_TRUE) {
+            is_work = USB_TRUE;
+        }
+        next = __hw_rd(&p_qh->hw_next);
+        if ((next & 1) || ((next & (3 << 1)) != __Q_TYPE_QH)) {
+            break;
+        }
+        p_qh = __SIM_PTR(next);
+    } while ((p_qh != p_head) && (n_walk++ < __SIM_WALK_MAX));
+
+    return is_work;
+}
+
+/**
+ * \brief 执行一个 iTD 微帧事务
+ */
+static void __itd_exec(struct usb_ehci_sim *p_sim, struct usbh_ehci_itd *p_itd, uint8_t u_frame){
+    struct usb_ehci_sim_dev *p_dev = NULL;
+    uint32_t                 trans, pages[2];
+    uint32_t                 buf0  = __hw_rd(&p_itd->hw_bufp[0]);
+    uint32_t                 buf1  = __hw_rd(&p_itd->hw_bufp[1]);
+    uint8_t                  pg, pid;
+    uint32_t                 len;
+    int                      ret;
+
+    trans = __hw_rd(&p_itd->hw_transaction[u_frame]);
+    if (!(trans & EHCI_ITD_ACTIVE)) {
+        return;
+    }
+
+    pg       = (trans >> 12) & 0x7;
+    len      = EHCI_ITD_LENGTH(trans);
+    pid      = (buf1 & (1 << 11)) ? USB_EHCI_SIM_PID_IN : USB_EHCI_SIM_PID_OUT;
+    pages[0] = (__hw_rd(&p_itd->hw_bufp[pg]) & ~0xFFFu) | (trans & 0xFFF);
+    pages[1] = (pg < 6) ? __hw_rd(&p_itd->hw_bufp[pg + 1]) : 0;
+    p_dev    = __dev_find(p_sim, buf0 & 0x7F);
+
+    if (pid == USB_EHCI_SIM_PID_OUT) {
+        __buf_copy(pages, 2, p_sim->xfer_buf, len, USB_FALSE);
+    }
+    ret = __dev_xfer(p_sim, p_dev, (buf0 >> 8) & 0xF, pid, len);
+
+    trans &= ~EHCI_ITD_ACTIVE;
+    if (ret == -USB_EAGAIN) {
+        /* 等时传输没有重试，当作没有数据*/
+        ret = 0;
+    }
+    if (ret < 0) {
+        trans |= EHCI_ITD_XACTERR;
+        p_sim->int_pending |= __REG_STS_ERR;
+    } else if (pid == USB_EHCI_SIM_PID_IN) {
+        __buf_copy(pages, 2, p_sim->xfer_buf, ret, USB_TRUE);
+        trans = (trans & ~(0xFFFu << 16)) | ((uint32_t)ret << 16);
+    }
+    if (trans & EHCI_ITD_IOC) {
+        p_sim->int_pending |= __REG_STS_INT;
+    }
+    __hw_wr(&p_itd->hw_transaction[u_frame], trans);
+    p_sim->stat.itds++;
+}
+
+/**
+ * \brief 执行一个 siTD
+ */
+static void __sitd_exec(struct usb_ehci_sim *p_sim, struct usbh_ehci_sitd *p_sitd, uint8_t u_frame){
+    struct usb_ehci_sim_dev *p_dev = NULL;
+    uint32_t                 ep_info = __hw_rd(&p_sitd->hw_full_speed_ep);
+    uint32_t                 results = __hw_rd(&p_sitd->hw_results);
+    uint8_t                  pid;
+    uint32_t                 len;
+    int                      ret;
+
+    if (!(__hw_rd(&p_sitd->hw_u_frame) & (1 << u_frame)) || !(results & EHCI_SITD_STS_ACTIVE)) {
+        return;
+    }
+
+    len   = EHCI_SITD_LENGTH(results);
+    pid   = (ep_info & (1u << 31)) ? USB_EHCI_SIM_PID_IN : USB_EHCI_SIM_PID_OUT;
+    p_dev = __dev_find(p_sim, ep_info & 0x7F);
+
+    if (pid == USB_EHCI_SIM_PID_OUT) {
+        __buf_copy(p_sitd->hw_buf, 2, p_sim->xfer_buf, len, USB_FALSE);
+    }
+    ret = __dev_xfer(p_sim, p_dev, (ep_info >> 8) & 0xF, pid, len);
+
+    results &= ~EHCI_SITD_STS_ACTIVE;
+    if (ret == -USB_EAGAIN) {
+        ret = 0;
+    }
+    if (ret < 0) {
+        results |= EHCI_SITD_STS_XACT;
+        p_sim->int_pending |= __REG_STS_ERR;
+    } else {
+        if (pid == USB_EHCI_SIM_PID_IN) {
+            __buf_copy(p_sitd->hw_buf, 2, p_sim->xfer_buf, ret, USB_TRUE);
+        } else {
+            ret = len;
+        }
+        results = (results & ~(0x3FFu << 16)) | ((len - ret) << 16);
+    }
+    if (results & EHCI_SITD_IOC) {
+        p_sim->int_pending |= __REG_STS_INT;
+    }
+    __hw_wr(&p_sitd->hw_results, results);
+    p_sim->stat.sitds++;
+}
+
+/**
+ * \brief 遍历当前微帧的周期调度
+ */
+static usb_bool_t __periodic_run(struct usb_ehci_sim *p_sim){
+    uint32_t            *p_list  = (uint32_t *)(uintptr_t)p_sim->periodic;
+    uint32_t             frame   = (p_sim->frindex >> 3) & (__frame_list_size_get(p_sim) - 1);
+    uint8_t              u_frame = p_sim->frindex & 0x7;
+    uint32_t             next;
+    usb_bool_t           is_work = USB_FALSE;
+    int                  n_walk  = 0;
+    struct usbh_ehci_qh *p_qh    = NULL;
+
+    if (p_list == NULL) {
+        return USB_FALSE;
+    }
+
+    next = __hw_rd(&p_list[frame]);
+    while (!(next & 1) && (n_walk++ < __SIM_WALK_MAX)) {
+        switch (next & (3 << 1)) {
+        case __Q_TYPE_ITD:
+            __itd_exec(p_sim, __SIM_PTR(next), u_frame);
+            next = __hw_rd(&((struct usbh_ehci_itd *)__SIM_PTR(next))->hw_next);
+            break;
+        case __Q_TYPE_SITD:
+            __sitd_exec(p_sim, __SIM_PTR(next), u_frame);
+            next = __hw_rd(&((struct usbh_ehci_sitd *)__SIM_PTR(next))->hw_next);
+            break;
+        case __Q_TYPE_QH:
+            p_qh = __SIM_PTR(next);
+            if (__hw_rd(&p_qh->hw_info2) & (1 << u_frame)) {
+                if (__qh_process(p_sim, p_qh, USB_TRUE) == USB_TRUE) {
+                    is_work = USB_TRUE;
+                }
+            }
+            next = __hw_rd(&p_qh->hw_next);
+            break;
+        default:
+            /* 所有数据结构的第一个字都是水平链接指针*/
+            next = __hw_rd((uint32_t *)__SIM_PTR(next));
+            break;
+        }
+    }
+    return is_work;
+}
+
+/**
+ * \brief 运行一个微帧
+ *
+ * \retval 是否有数据结构被处理
+ */
+static usb_bool_t __uframe_run(struct usb_ehci_sim *p_sim){
+    usb_bool_t is_work = USB_FALSE;
+    uint32_t   itc;
+
+    p_sim->frindex = (p_sim->frindex + 1) & 0x3FFF;
+    if ((p_sim->frindex & ((__frame_list_size_get(p_sim) << 3) - 1)) == 0) {
+        p_sim->sts |= __REG_STS_FLR;
+    }
+
+    if (p_sim->cmd & __REG_CMD_PSE) {
+        is_work |= __periodic_run(p_sim);
+    }
+    if (p_sim->cmd & __REG_CMD_ASE) {
+        is_work |= __async_run(p_sim);
+    }
+    /* 异步推进门铃：一次完整的异步遍历之后应答*/
+    if (p_sim->cmd & __REG_CMD_IAAD) {
+        p_sim->cmd &= ~__REG_CMD_IAAD;
+        p_sim->sts |= __REG_STS_IAA;
+    }
+
+    /* 中断阈值*/
+    itc = (p_sim->cmd >> 16) & 0xFF;
+    if (itc == 0) {
+        itc = 1;
+    }
+    if (++p_sim->itc_cnt >= itc) {
+        p_sim->itc_cnt      = 0;
+        p_sim->sts         |= p_sim->int_pending;
+        p_sim->int_pending  = 0;
+    }
+    p_sim->stat.uframes++;
+
+    return is_work;
+}
+
+/**
+ * \brief 模型线程
+ */
+static void *__sim_thread(void *p_arg){
+    struct usb_ehci_sim *p_sim = (struct usb_ehci_sim *)p_arg;
+    struct timespec      ts_next, ts_idle = {0, 1000000};
+    usb_bool_t           is_run, is_work, is_irq;
+    uint64_t             t_start;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts_next);
+
+    while (!p_sim->is_exit) {
+        is_work = USB_FALSE;
+
+        pthread_mutex_lock(&p_sim->lock);
+        is_run = (p_sim->cmd & __REG_CMD_RUN) ? USB_TRUE : USB_FALSE;
+        if (is_run) {
+            t_start = __ns_get();
+            is_work = __uframe_run(p_sim);
+            p_sim->stat.busy_ns += __ns_get() - t_start;
+        }
+        is_irq = ((p_sim->sts & p_sim->intr) && p_sim->p_fn_irq) ? USB_TRUE : USB_FALSE;
+        if (is_irq) {
+            p_sim->stat.irqs++;
+        }
+        pthread_mutex_unlock(&p_sim->lock);
+
+        /* 中断函数会访问寄存器，不能持有模型锁*/
+        if (is_irq) {
+            p_sim->p_fn_irq(p_sim->p_irq_arg);
+        }
+
+        if (is_run == USB_FALSE) {
+            nanosleep(&ts_idle, NULL);
+            clock_gettime(CLOCK_MONOTONIC, &ts_next);
+        } else if (p_sim->cfg.uframe_ns) {
+            ts_next.tv_nsec += p_sim->cfg.uframe_ns;
+            while (ts_next.tv_nsec >= (long)NSEC_PER_SEC) {
+                ts_next.tv_sec++;
+                ts_next.tv_nsec -= (long)NSEC_PER_SEC;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts_next, NULL);
+        } else if (is_work == USB_FALSE) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief 创建 EHCI 控制器模型
+ *
+ * \param[in]  p_cfg 模型配置
+ * \param[out] p_sim 返回创建的模型
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_create(struct usb_ehci_sim_cfg *p_cfg, struct usb_ehci_sim **p_sim){
+    struct usb_ehci_sim *p_sim_tmp = NULL;
+    int                  ret;
+
+    if ((p_cfg == NULL) || (p_sim == NULL)) {
+        return -USB_EINVAL;
+    }
+    if ((p_cfg->n_ports == 0) || (p_cfg->n_ports > USB_EHCI_SIM_PORT_MAX)) {
+        return -USB_EILLEGAL;
+    }
+    /* 描述符地址按 32 位保存*/
+    if (sizeof(void *) != sizeof(uint32_t)) {
+        __USB_ERR_INFO("ehci sim need 32 bits address\r\n");
+        return -USB_ENOTSUP;
+    }
+
+    p_sim_tmp = calloc(1, sizeof(struct usb_ehci_sim));
+    if (p_sim_tmp == NULL) {
+        return -USB_ENOMEM;
+    }
+
+    p_sim_tmp->cfg = *p_cfg;
+    pthread_mutex_init(&p_sim_tmp->lock, NULL);
+    __hc_reset(p_sim_tmp);
+
+    ret = usb_linux_reg_win_add(p_sim_tmp->reg_win,
+                                __SIM_REG_SIZE,
+                                __reg_read,
+                                __reg_write,
+                                p_sim_tmp);
+    if (ret != USB_OK) {
+        goto __failed;
+    }
+
+    if (pthread_create(&p_sim_tmp->tid, NULL, __sim_thread, p_sim_tmp) != 0) {
+        usb_linux_reg_win_del(p_sim_tmp->reg_win);
+        ret = -USB_EPERM;
+        goto __failed;
+    }
+
+    *p_sim = p_sim_tmp;
+
+    return USB_OK;
+__failed:
+    pthread_mutex_destroy(&p_sim_tmp->lock);
+    free(p_sim_tmp);
+
+    return ret;
+}
+
+/**
+ * \brief 销毁 EHCI 控制器模型
+ *
+ * \param[in] p_sim 要销毁的模型
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_destroy(struct usb_ehci_sim *p_sim){
+    if (p_sim == NULL) {
+        return -USB_EINVAL;
+    }
+
+    p_sim->is_exit = 1;
+    pthread_join(p_sim->tid, NULL);
+
+    usb_linux_reg_win_del(p_sim->reg_win);
+    pthread_mutex_destroy(&p_sim->lock);
+    free(p_sim);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 获取模型的寄存器基地址
+ *
+ * \param[in] p_sim 模型
+ *
+ * \retval 寄存器基地址
+ */
+uint32_t usb_ehci_sim_reg_base_get(struct usb_ehci_sim *p_sim){
+    if (p_sim == NULL) {
+        return 0;
+    }
+    return (uint32_t)(uintptr_t)p_sim->reg_win;
+}
+
+/**
+ * \brief 连接模型中断函数
+ *
+ * \param[in] p_sim    模型
+ * \param[in] p_fn_irq 中断函数
+ * \param[in] p_arg    中断函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_irq_connect(struct usb_ehci_sim *p_sim,
+                             void               (*p_fn_irq)(void *p_arg),
+                             void                *p_arg){
+    if (p_sim == NULL) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_lock(&p_sim->lock);
+    p_sim->p_fn_irq  = p_fn_irq;
+    p_sim->p_irq_arg = p_arg;
+    pthread_mutex_unlock(&p_sim->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 在根集线器端口上插入一个虚拟设备
+ *
+ * \param[in] p_sim    模型
+ * \param[in] port_num 端口号（从 0 开始）
+ * \param[in] p_dev    虚拟设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_dev_attach(struct usb_ehci_sim     *p_sim,
+                            uint8_t                  port_num,
+                            struct usb_ehci_sim_dev *p_dev){
+    if ((p_sim == NULL) || (p_dev == NULL) || (p_dev->p_fn_xfer == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (port_num >= p_sim->cfg.n_ports) {
+        return -USB_EILLEGAL;
+    }
+
+    pthread_mutex_lock(&p_sim->lock);
+    if (p_sim->p_dev[port_num] != NULL) {
+        pthread_mutex_unlock(&p_sim->lock);
+        return -USB_EBUSY;
+    }
+    p_dev->addr     = 0;
+    p_dev->addr_new = 0;
+
+    p_sim->p_dev[port_num]   = p_dev;
+    p_sim->portsc[port_num] |= __REG_PORTSC_CONNECT | __REG_PORTSC_CSC;
+    p_sim->sts              |= __REG_STS_PCD;
+    pthread_mutex_unlock(&p_sim->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 从根集线器端口上拔出虚拟设备
+ *
+ * \param[in] p_sim    模型
+ * \param[in] port_num 端口号（从 0 开始）
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_dev_detach(struct usb_ehci_sim *p_sim, uint8_t port_num){
+    if (p_sim == NULL) {
+        return -USB_EINVAL;
+    }
+    if (port_num >= p_sim->cfg.n_ports) {
+        return -USB_EILLEGAL;
+    }
+
+    pthread_mutex_lock(&p_sim->lock);
+    if (p_sim->p_dev[port_num] == NULL) {
+        pthread_mutex_unlock(&p_sim->lock);
+        return -USB_ENODEV;
+    }
+    p_sim->p_dev[port_num]   = NULL;
+    p_sim->portsc[port_num] &= ~(__REG_PORTSC_CONNECT | __REG_PORTSC_PE | __REG_PORTSC_PSPD);
+    p_sim->portsc[port_num] |= __REG_PORTSC_CSC | __REG_PORTSC_PEC;
+    p_sim->sts              |= __REG_STS_PCD;
+    pthread_mutex_unlock(&p_sim->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 获取模型统计
+ *
+ * \param[in]  p_sim  模型
+ * \param[out] p_stat 返回的统计
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_stat_get(struct usb_ehci_sim *p_sim, struct usb_ehci_sim_stat *p_stat){
+    if ((p_sim == NULL) || (p_stat == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_lock(&p_sim->lock);
+    *p_stat = p_sim->stat;
+    pthread_mutex_unlock(&p_sim->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 清除模型统计
+ *
+ * \param[in] p_sim 模型
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_stat_clr(struct usb_ehci_sim *p_sim){
+    if (p_sim == NULL) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_lock(&p_sim->lock);
+    memset(&p_sim->stat, 0, sizeof(struct usb_ehci_sim_stat));
+    pthread_mutex_unlock(&p_sim->lock);
+
+    return USB_OK;
+}
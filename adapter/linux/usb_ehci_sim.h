@@ -0,0 +1,159 @@
+#ifndef __USB_EHCI_SIM_H
+#define __USB_EHCI_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus  */
+#include "common/err/usb_err.h"
+#include "common/usb_common.h"
+
+/*
+ * 用户态 EHCI 控制器模型
+ *
+ * 模型提供一块虚拟的 EHCI 寄存器（通过 usb_linux_reg_win_add() 挂到 usb_reg_readl()/
+ * usb_reg_writel() 上），由一个 pthread 线程按微帧推进：遍历 usbh_ehci_xfer.c 建立的
+ * 异步 QH 环和周期帧列表，把 qTD/iTD/siTD 交给挂在根集线器端口上的虚拟设备完成，
+ * 然后按中断阈值调用注册的中断函数（一般是 usbh_ehci_irq_handle()）。
+ *
+ * 用法：
+ *     usb_ehci_sim_create(&cfg, &p_sim);
+ *     usb_ehci_sim_irq_connect(p_sim, __ehci_irq, &p_ehci);
+ *     usbh_ehci_create(p_hc, usb_ehci_sim_reg_base_get(p_sim), ...);
+ *     usb_ehci_sim_dev_attach(p_sim, 0, &my_dev);
+ */
+
+/* \brief 虚拟设备 PID */
+#define USB_EHCI_SIM_PID_OUT     0
+#define USB_EHCI_SIM_PID_IN      1
+#define USB_EHCI_SIM_PID_SETUP   2
+
+/* \brief 模型最大端口数量*/
+#define USB_EHCI_SIM_PORT_MAX    8
+
+/* \brief EHCI 控制器模型*/
+struct usb_ehci_sim;
+
+/**
+ * \brief 虚拟设备结构体
+ *
+ * p_fn_xfer 在模型线程中调用，ep_addr 为端点号（不含方向），pid 为 USB_EHCI_SIM_PID_*，
+ * 返回值：
+ *     >= 0          实际传输的字节数（输入传输小于 len 即为短包）
+ *     -USB_EAGAIN   NAK，这一微帧不完成，稍后重试
+ *     -USB_EPIPE    STALL，描述符被停止
+ *     其他负数      事务错误
+ *
+ * 标准 SET_ADDRESS 请求由模型在状态阶段完成后更新 addr，设备不需要处理。
+ */
+struct usb_ehci_sim_dev {
+    uint8_t    speed;                          /* 设备速度，USB_SPEED_* */
+    uint8_t    addr;                           /* 设备地址，由模型维护*/
+    int      (*p_fn_xfer)(struct usb_ehci_sim_dev *p_dev,
+                          uint8_t                  ep_addr,
+                          uint8_t                  pid,
+                          uint8_t                 *p_buf,
+                          uint32_t                 len);
+    void      *p_arg;                          /* 设备私有数据*/
+    uint8_t    addr_new;                       /* 模型内部使用，待生效的地址*/
+};
+
+/* \brief 模型配置结构体*/
+struct usb_ehci_sim_cfg {
+    uint8_t    n_ports;                        /* 根集线器端口数量*/
+    uint32_t   uframe_ns;                      /* 一个微帧的实际时长，0 为不限速全速运行*/
+    usb_bool_t frame_list_prog;                /* 周期帧列表大小是否可编程*/
+};
+
+/* \brief 模型统计结构体*/
+struct usb_ehci_sim_stat {
+    uint64_t   uframes;                        /* 运行的微帧数量*/
+    uint64_t   irqs;                           /* 产生的中断次数*/
+    uint64_t   qtds;                           /* 完成的 qTD 数量*/
+    uint64_t   itds;                           /* 完成的 iTD 事务数量*/
+    uint64_t   sitds;                          /* 完成的 siTD 数量*/
+    uint64_t   naks;                           /* NAK 次数*/
+    uint64_t   bytes;                          /* 传输的字节数*/
+    uint64_t   busy_ns;                        /* 调度遍历消耗的时间（纳秒）*/
+};
+
+/**
+ * \brief 创建 EHCI 控制器模型
+ *
+ * \param[in]  p_cfg 模型配置
+ * \param[out] p_sim 返回创建的模型
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_create(struct usb_ehci_sim_cfg *p_cfg, struct usb_ehci_sim **p_sim);
+/**
+ * \brief 销毁 EHCI 控制器模型
+ *
+ * \param[in] p_sim 要销毁的模型
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_destroy(struct usb_ehci_sim *p_sim);
+/**
+ * \brief 获取模型的寄存器基地址，用于 usbh_ehci_create() 的 reg_base 参数
+ *
+ * \param[in] p_sim 模型
+ *
+ * \retval 寄存器基地址
+ */
+uint32_t usb_ehci_sim_reg_base_get(struct usb_ehci_sim *p_sim);
+/**
+ * \brief 连接模型中断函数
+ *
+ * \param[in] p_sim    模型
+ * \param[in] p_fn_irq 中断函数
+ * \param[in] p_arg    中断函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_irq_connect(struct usb_ehci_sim *p_sim,
+                             void               (*p_fn_irq)(void *p_arg),
+                             void                *p_arg);
+/**
+ * \brief 在根集线器端口上插入一个虚拟设备
+ *
+ * \param[in] p_sim    模型
+ * \param[in] port_num 端口号（从 0 开始）
+ * \param[in] p_dev    虚拟设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_dev_attach(struct usb_ehci_sim     *p_sim,
+                            uint8_t                  port_num,
+                            struct usb_ehci_sim_dev *p_dev);
+/**
+ * \brief 从根集线器端口上拔出虚拟设备
+ *
+ * \param[in] p_sim    模型
+ * \param[in] port_num 端口号（从 0 开始）
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_dev_detach(struct usb_ehci_sim *p_sim, uint8_t port_num);
+/**
+ * \brief 获取模型统计
+ *
+ * \param[in]  p_sim  模型
+ * \param[out] p_stat 返回的统计
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_stat_get(struct usb_ehci_sim *p_sim, struct usb_ehci_sim_stat *p_stat);
+/**
+ * \brief 清除模型统计
+ *
+ * \param[in] p_sim 模型
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_ehci_sim_stat_clr(struct usb_ehci_sim *p_sim);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus  */
+
+#endif /* __USB_EHCI_SIM_H */
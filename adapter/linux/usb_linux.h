@@ -0,0 +1,56 @@
+#ifndef __USB_LINUX_H
+#define __USB_LINUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus  */
+#include "common/err/usb_err.h"
+#include "common/usb_common.h"
+
+/*
+ * Linux 用户态适配层
+ *
+ * 用 pthread 实现 adapter/os，用 libc 实现 adapter/mem、adapter/delay、adapter/timespec
+ * 和 adapter/reg，覆盖各适配文件里的弱符号，使协议栈可以在 Linux 主机上运行。
+ *
+ * 协议栈把描述符地址当作 32 位地址使用，所以需要以 32 位方式编译（例如 gcc -m32）。
+ */
+
+/* \brief 最大寄存器窗口数量*/
+#define USB_LINUX_REG_WIN_MAX    4
+
+/* \brief 寄存器窗口读写回调*/
+typedef uint32_t (*usb_linux_reg_read_t)(void *p_arg, uint32_t offset);
+typedef void     (*usb_linux_reg_write_t)(void *p_arg, uint32_t offset, uint32_t val);
+
+/**
+ * \brief 注册一个寄存器窗口，落在窗口内的 usb_reg_readl()/usb_reg_writel() 访问
+ *        会转交给回调函数处理，窗口外的访问按普通内存读写
+ *
+ * \param[in] p_base    窗口起始地址
+ * \param[in] size      窗口大小
+ * \param[in] p_fn_read 读回调函数
+ * \param[in] p_fn_write 写回调函数
+ * \param[in] p_arg     回调函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_linux_reg_win_add(void                  *p_base,
+                          uint32_t               size,
+                          usb_linux_reg_read_t   p_fn_read,
+                          usb_linux_reg_write_t  p_fn_write,
+                          void                  *p_arg);
+/**
+ * \brief 删除一个寄存器窗口
+ *
+ * \param[in] p_base 窗口起始地址
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_linux_reg_win_del(void *p_base);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus  */
+
+#endif /* __USB_LINUX_H */
@@ -0,0 +1,588 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include "adapter/linux/usb_linux.h"
+#include "adapter/os/usb_os.h"
+#include "adapter/mem/usb_mem.h"
+#include "adapter/delay/usb_delay.h"
+#include "adapter/timespec/usb_timespec.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/*******************************************************************************
+ * Statement
+ ******************************************************************************/
+/* \brief Linux 任务结构体*/
+struct usb_linux_task {
+    pthread_t            tid;                    /* 线程 ID */
+    char                 name[USB_NAME_LEN];     /* 任务名字*/
+    void               (*p_fn)(void *p_arg);     /* 任务函数*/
+    void                *p_arg;                  /* 任务函数参数*/
+    usb_bool_t           is_start;               /* 是否已经启动*/
+};
+
+/* \brief Linux 信号量结构体*/
+struct usb_linux_sem {
+    pthread_mutex_t      lock;                   /* 互斥锁*/
+    pthread_cond_t       cond;                   /* 条件变量*/
+    uint32_t             count;                  /* 信号量计数*/
+};
+
+/* \brief Linux 寄存器窗口结构体*/
+struct usb_linux_reg_win {
+    uintptr_t              base;                 /* 窗口起始地址*/
+    uint32_t               size;                 /* 窗口大小*/
+    usb_linux_reg_read_t   p_fn_read;            /* 读回调函数*/
+    usb_linux_reg_write_t  p_fn_write;           /* 写回调函数*/
+    void                  *p_arg;                /* 回调函数参数*/
+};
+
+/*******************************************************************************
+ * Global
+ ******************************************************************************/
+static struct usb_linux_reg_win __g_reg_win[USB_LINUX_REG_WIN_MAX];
+static pthread_mutex_t          __g_reg_win_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+/**
+ * \brief 把相对超时时间（毫秒）转换为绝对时间
+ */
+static void __abs_time_get(clockid_t clk, int timeout, struct timespec *p_ts){
+    clock_gettime(clk, p_ts);
+
+    p_ts->tv_sec  += timeout / 1000;
+    p_ts->tv_nsec += (long)(timeout % 1000) * 1000000L;
+    if (p_ts->tv_nsec >= (long)NSEC_PER_SEC) {
+        p_ts->tv_sec++;
+        p_ts->tv_nsec -= (long)NSEC_PER_SEC;
+    }
+}
+
+/**
+ * \brief 任务入口函数
+ */
+static void *__task_entry(void *p_arg){
+    struct usb_linux_task *p_task = (struct usb_linux_task *)p_arg;
+
+    p_task->p_fn(p_task->p_arg);
+
+    return NULL;
+}
+
+/**
+ * \brief 创建任务
+ *
+ * \param[in] p_name 任务名字
+ * \param[in] prio   任务优先级（Linux 下忽略）
+ * \param[in] stk_s  任务栈大小
+ * \param[in] p_fn   任务函数
+ * \param[in] p_arg  任务函数参数
+ *
+ * \retval 成功返回创建的那任务句柄
+ */
+usb_task_handle_t usb_task_create(const char  *p_name,
+                                  int          prio,
+                                  size_t       stk_s,
+                                  void       (*p_fn)(void *p_arg),
+                                  void        *p_arg){
+    struct usb_linux_task *p_task = NULL;
+
+    if (p_fn == NULL) {
+        return NULL;
+    }
+
+    p_task = calloc(1, sizeof(struct usb_linux_task));
+    if (p_task == NULL) {
+        return NULL;
+    }
+
+    if (p_name) {
+        strncpy(p_task->name, p_name, USB_NAME_LEN - 1);
+    }
+    p_task->p_fn  = p_fn;
+    p_task->p_arg = p_arg;
+
+    return p_task;
+}
+
+/**
+ * \brief 删除任务
+ *
+ * \param[in] p_task 要删除的任务句柄
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_task_delete(usb_task_handle_t p_tsk){
+    struct usb_linux_task *p_task = (struct usb_linux_task *)p_tsk;
+
+    if (p_task == NULL) {
+        return -USB_EINVAL;
+    }
+
+    if (p_task->is_start == USB_TRUE) {
+        /* 任务删除自己*/
+        if (pthread_equal(p_task->tid, pthread_self())) {
+            pthread_detach(p_task->tid);
+            free(p_task);
+            pthread_exit(NULL);
+        }
+        pthread_cancel(p_task->tid);
+        pthread_join(p_task->tid, NULL);
+    }
+    free(p_task);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 启动任务
+ *
+ * \param[in] p_task 要启动的任务句柄
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_task_startup(usb_task_handle_t p_tsk){
+    struct usb_linux_task *p_task = (struct usb_linux_task *)p_tsk;
+
+    if (p_task == NULL) {
+        return -USB_EINVAL;
+    }
+    if (p_task->is_start == USB_TRUE) {
+        return USB_OK;
+    }
+
+    if (pthread_create(&p_task->tid, NULL, __task_entry, p_task) != 0) {
+        return -USB_EPERM;
+    }
+    p_task->is_start = USB_TRUE;
+
+    return USB_OK;
+}
+
+/**
+ * \brief 挂起任务，pthread 不支持
+ */
+int usb_task_suspend(usb_task_handle_t p_tsk){
+    return -USB_ENOTSUP;
+}
+
+/**
+ * \brief 恢复任务，pthread 不支持
+ */
+int usb_task_resume(usb_task_handle_t p_tsk){
+    return -USB_ENOTSUP;
+}
+
+/**
+ * \brief 创建信号量
+ *
+ * \retval 成功返回创建的信号量句柄
+ */
+usb_sem_handle_t usb_sem_create(void){
+    struct usb_linux_sem *p_sem = NULL;
+    pthread_condattr_t    attr;
+
+    p_sem = calloc(1, sizeof(struct usb_linux_sem));
+    if (p_sem == NULL) {
+        return NULL;
+    }
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&p_sem->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&p_sem->lock, NULL);
+
+    return p_sem;
+}
+
+/**
+ * \brief 删除信号量
+ *
+ * \param[in] p_sem 要删除的信号量句柄
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_sem_delete(usb_sem_handle_t p_sem){
+    struct usb_linux_sem *p_sem_tmp = (struct usb_linux_sem *)p_sem;
+
+    if (p_sem_tmp == NULL) {
+        return -USB_EINVAL;
+    }
+
+    pthread_cond_destroy(&p_sem_tmp->cond);
+    pthread_mutex_destroy(&p_sem_tmp->lock);
+    free(p_sem_tmp);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 等待信号量
+ *
+ * \param[in] p_sem   要等待的信号量句柄
+ * \param[in] timeout 等待超时时间（毫秒）
+ *
+ * \retval 成功返回 USB_OK，超时返回 -USB_ETIME
+ */
+int usb_sem_take(usb_sem_handle_t p_sem,
+                 int              timeout){
+    struct usb_linux_sem *p_sem_tmp = (struct usb_linux_sem *)p_sem;
+    struct timespec       ts;
+    int                   ret       = USB_OK;
+
+    if (p_sem_tmp == NULL) {
+        return -USB_EINVAL;
+    }
+
+    if (timeout > 0) {
+        __abs_time_get(CLOCK_MONOTONIC, timeout, &ts);
+    }
+
+    pthread_mutex_lock(&p_sem_tmp->lock);
+    while (p_sem_tmp->count == 0) {
+        if (timeout == USB_NO_WAIT) {
+            ret = -USB_EAGAIN;
+            break;
+        } else if (timeout == USB_WAIT_FOREVER) {
+            pthread_cond_wait(&p_sem_tmp->cond, &p_sem_tmp->lock);
+        } else if (pthread_cond_timedwait(&p_sem_tmp->cond, &p_sem_tmp->lock, &ts) == ETIMEDOUT) {
+            if (p_sem_tmp->count == 0) {
+                ret = -USB_ETIME;
+            }
+            break;
+        }
+    }
+    if (ret == USB_OK) {
+        p_sem_tmp->count--;
+    }
+    pthread_mutex_unlock(&p_sem_tmp->lock);
+
+    return ret;
+}
+
+/**
+ * \brief 释放信号量
+ *
+ * \param[in] p_sem 要释放的信号量句柄
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_sem_give(usb_sem_handle_t p_sem){
+    struct usb_linux_sem *p_sem_tmp = (struct usb_linux_sem *)p_sem;
+
+    if (p_sem_tmp == NULL) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_lock(&p_sem_tmp->lock);
+    p_sem_tmp->count++;
+    pthread_cond_signal(&p_sem_tmp->cond);
+    pthread_mutex_unlock(&p_sem_tmp->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 创建互斥锁（可重入）
+ *
+ * \retval 成功返回创建的互斥锁句柄
+ */
+usb_mutex_handle_t usb_mutex_create(void){
+    pthread_mutex_t     *p_mutex = NULL;
+    pthread_mutexattr_t  attr;
+
+    p_mutex = calloc(1, sizeof(pthread_mutex_t));
+    if (p_mutex == NULL) {
+        return NULL;
+    }
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(p_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    return p_mutex;
+}
+
+/**
+ * \brief 删除互斥锁
+ *
+ * \param[in] p_mutex 要删除的互斥锁句柄
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_mutex_delete(usb_mutex_handle_t p_mutex){
+    if (p_mutex == NULL) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_destroy((pthread_mutex_t *)p_mutex);
+    free(p_mutex);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 互斥锁上锁
+ *
+ * \param[in] p_mutex 互斥锁句柄
+ * \param[in] timeout 等待上锁超时时间（毫秒）
+ *
+ * \retval 成功返回 USB_OK，超时返回 -USB_ETIME
+ */
+int usb_mutex_lock(usb_mutex_handle_t p_mutex,
+                   int                timeout){
+    struct timespec ts;
+    int             ret;
+
+    if (p_mutex == NULL) {
+        return -USB_EINVAL;
+    }
+
+    if (timeout == USB_WAIT_FOREVER) {
+        ret = pthread_mutex_lock((pthread_mutex_t *)p_mutex);
+    } else if (timeout == USB_NO_WAIT) {
+        ret = pthread_mutex_trylock((pthread_mutex_t *)p_mutex);
+    } else {
+        __abs_time_get(CLOCK_REALTIME, timeout, &ts);
+        ret = pthread_mutex_timedlock((pthread_mutex_t *)p_mutex, &ts);
+    }
+
+    if (ret == 0) {
+        return USB_OK;
+    } else if ((ret == ETIMEDOUT) || (ret == EBUSY)) {
+        return -USB_ETIME;
+    }
+    return -USB_EPERM;
+}
+
+/**
+ * \brief 互斥锁解锁
+ *
+ * \param[in] p_mutex 互斥锁句柄
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_mutex_unlock(usb_mutex_handle_t p_mutex){
+    if (p_mutex == NULL) {
+        return -USB_EINVAL;
+    }
+
+    if (pthread_mutex_unlock((pthread_mutex_t *)p_mutex) != 0) {
+        return -USB_EPERM;
+    }
+    return USB_OK;
+}
+
+/**
+ * \brief 分配 USB 使用的对齐的内存
+ */
+void *usb_mem_align_alloc(size_t size, size_t align){
+    void *p_mem = NULL;
+
+    if (align < sizeof(void *)) {
+        align = sizeof(void *);
+    }
+    if (posix_memalign(&p_mem, align, size) != 0) {
+        return NULL;
+    }
+    return p_mem;
+}
+
+/**
+ * \brief 分配 USB 使用的内存
+ */
+void *usb_mem_alloc(size_t size){
+    return malloc(size);
+}
+
+/**
+ * \brief 释放 USB 使用的内存
+ */
+void usb_mem_free(void *p){
+    free(p);
+}
+
+/**
+ * \brief 申请 DMA 内存对齐
+ */
+void *usb_cache_dma_align(size_t size, size_t align){
+    return usb_mem_align_alloc(size, align);
+}
+
+/**
+ * \brief 释放 DMA 内存
+ */
+int usb_cache_dma_free(void *p, uint32_t size){
+    free(p);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 数据收发前 DMA 映射操作，用户态内存一致，直接返回原地址
+ */
+void *usb_dma_map(void *p_mem, size_t size, uint8_t dir){
+    return p_mem;
+}
+
+/**
+ * \brief 数据收发完成后 DMA 取消映射操作
+ */
+void *usb_dma_unmap(void *p_dma, size_t size, uint8_t dir){
+    return p_dma;
+}
+
+/**
+ * \brief USB 延时毫秒函数适配
+ */
+void usb_mdelay(uint32_t ms){
+    struct timespec ts;
+
+    ts.tv_sec  = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while ((nanosleep(&ts, &ts) != 0) && (errno == EINTR));
+}
+
+/**
+ * \brief 获取当前时间戳
+ */
+int usb_timespec_get(struct usb_timespec *p_ts){
+    struct timespec ts;
+
+    if (p_ts == NULL) {
+        return -USB_EINVAL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    p_ts->ts_sec  = ts.tv_sec;
+    p_ts->ts_nsec = ts.tv_nsec;
+
+    return USB_OK;
+}
+
+/**
+ * \brief 通过纳秒获取时间戳
+ */
+struct usb_timespec usb_ns_to_timespec(const int64_t nsec){
+    struct usb_timespec ts;
+
+    ts.ts_sec  = (long)(nsec / (int64_t)NSEC_PER_SEC);
+    ts.ts_nsec = (long)(nsec % (int64_t)NSEC_PER_SEC);
+    if (ts.ts_nsec < 0) {
+        ts.ts_sec--;
+        ts.ts_nsec += (long)NSEC_PER_SEC;
+    }
+    return ts;
+}
+
+/**
+ * \brief 查找地址所在的寄存器窗口
+ */
+static struct usb_linux_reg_win *__reg_win_find(uintptr_t addr){
+    int i;
+
+    for (i = 0; i < USB_LINUX_REG_WIN_MAX; i++) {
+        if ((__g_reg_win[i].size != 0) &&
+                (addr >= __g_reg_win[i].base) &&
+                (addr < __g_reg_win[i].base + __g_reg_win[i].size)) {
+            return &__g_reg_win[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief 注册一个寄存器窗口
+ *
+ * \param[in] p_base     窗口起始地址
+ * \param[in] size       窗口大小
+ * \param[in] p_fn_read  读回调函数
+ * \param[in] p_fn_write 写回调函数
+ * \param[in] p_arg      回调函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_linux_reg_win_add(void                  *p_base,
+                          uint32_t               size,
+                          usb_linux_reg_read_t   p_fn_read,
+                          usb_linux_reg_write_t  p_fn_write,
+                          void                  *p_arg){
+    int i, ret = -USB_ENOMEM;
+
+    if ((p_base == NULL) || (size == 0) || (p_fn_read == NULL) || (p_fn_write == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_lock(&__g_reg_win_lock);
+    for (i = 0; i < USB_LINUX_REG_WIN_MAX; i++) {
+        if (__g_reg_win[i].size == 0) {
+            __g_reg_win[i].base       = (uintptr_t)p_base;
+            __g_reg_win[i].p_fn_read  = p_fn_read;
+            __g_reg_win[i].p_fn_write = p_fn_write;
+            __g_reg_win[i].p_arg      = p_arg;
+            __g_reg_win[i].size       = size;
+            ret = USB_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&__g_reg_win_lock);
+
+    return ret;
+}
+
+/**
+ * \brief 删除一个寄存器窗口
+ *
+ * \param[in] p_base 窗口起始地址
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_linux_reg_win_del(void *p_base){
+    int i, ret = -USB_ENODEV;
+
+    pthread_mutex_lock(&__g_reg_win_lock);
+    for (i = 0; i < USB_LINUX_REG_WIN_MAX; i++) {
+        if ((__g_reg_win[i].size != 0) && (__g_reg_win[i].base == (uintptr_t)p_base)) {
+            memset(&__g_reg_win[i], 0, sizeof(struct usb_linux_reg_win));
+            ret = USB_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&__g_reg_win_lock);
+
+    return ret;
+}
+
+/**
+ * \brief 32位寄存器写函数，窗口内的访问交给回调函数，其余按内存写
+ */
+void usb_reg_writel(uint32_t val, volatile void *p_addr){
+    struct usb_linux_reg_win *p_win = __reg_win_find((uintptr_t)p_addr);
+
+    if (p_win != NULL) {
+        p_win->p_fn_write(p_win->p_arg, (uint32_t)((uintptr_t)p_addr - p_win->base), val);
+        return;
+    }
+    /* 描述符可能正在被控制器模型线程访问，保证写入顺序*/
+    __atomic_store_n((volatile uint32_t *)p_addr, val, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief 32位寄存器读函数，窗口内的访问交给回调函数，其余按内存读
+ */
+uint32_t usb_reg_readl(volatile void *p_addr){
+    struct usb_linux_reg_win *p_win = __reg_win_find((uintptr_t)p_addr);
+
+    if (p_win != NULL) {
+        return p_win->p_fn_read(p_win->p_arg, (uint32_t)((uintptr_t)p_addr - p_win->base));
+    }
+    return __atomic_load_n((volatile uint32_t *)p_addr, __ATOMIC_ACQUIRE);
+}
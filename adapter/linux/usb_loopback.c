@@ -0,0 +1,754 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include "adapter/linux/usb_loopback.h"
+#include "config/usb_config.h"
+#include "adapter/os/usb_os.h"
+#include "core/include/specs/usb_specs.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Macro operate
+ ******************************************************************************/
+/* \brief 通过端点地址获取回环端点*/
+#define __LB_EP_GET(p_lb, ep_addr)  \
+            (&(p_lb)->ep[((ep_addr) & USB_DIR_IN) ? 1 : 0][(ep_addr) & 0x0F])
+
+/*******************************************************************************
+ * Statement
+ ******************************************************************************/
+/* \brief 回环端点结构体*/
+struct __lb_ep {
+    struct usbd_ep    *p_hw;                                   /* 从机协议栈端点*/
+    struct usbd_trans *p_queue[USB_LOOPBACK_QUEUE_SIZE];       /* 从机请求队列*/
+    uint8_t            head;                                   /* 队首位置*/
+    uint8_t            n_trans;                                /* 队列中的请求数量*/
+    uint32_t           trans_pos;                              /* 队首请求已传输的长度*/
+    uint8_t           *p_stage;                                /* 输入暂存缓存*/
+    uint32_t           stage_len;                              /* 暂存的数据长度*/
+    uint32_t           out_pos;                                /* 当前主机输出事务已接收的长度*/
+    usb_bool_t         is_enable;                              /* 是否使能*/
+    usb_bool_t         is_halt;                                /* 是否停止*/
+};
+
+/* \brief 回环控制器结构体*/
+struct usb_loopback {
+    struct usb_loopback_cfg   cfg;                             /* 回环控制器配置*/
+    struct usb_dc            *p_dc;                            /* USB 从机控制器*/
+    struct usb_ehci_sim_dev   sim_dev;                         /* 挂到模型上的虚拟设备*/
+    pthread_mutex_t           lock;                            /* 回环控制器互斥锁*/
+    struct __lb_ep            ep[2][USB_LOOPBACK_EP_NUM];      /* 端点，0 为输出，1 为输入*/
+    usb_bool_t                is_attach;                       /* 是否已经插入模型*/
+    uint8_t                   addr;                            /* 上一次 SETUP 时的设备地址*/
+    struct usb_loopback_stat  stat;                            /* 统计*/
+};
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+/**
+ * \brief 获取端点队首请求
+ */
+static struct usbd_trans *__ep_trans_head(struct __lb_ep *p_ep){
+    if (p_ep->n_trans == 0) {
+        return NULL;
+    }
+    return p_ep->p_queue[p_ep->head];
+}
+
+/**
+ * \brief 弹出端点队首请求
+ */
+static void __ep_trans_pop(struct __lb_ep *p_ep){
+    p_ep->head      = (p_ep->head + 1) % USB_LOOPBACK_QUEUE_SIZE;
+    p_ep->n_trans  -= 1;
+    p_ep->trans_pos = 0;
+}
+
+/**
+ * \brief 清空端点请求队列
+ *
+ * \param[in]  p_ep     回环端点
+ * \param[out] p_trans  返回被清掉的请求（可以为 NULL）
+ *
+ * \retval 被清掉的请求数量
+ */
+static int __ep_flush(struct __lb_ep *p_ep, struct usbd_trans **p_trans){
+    int n = 0;
+
+    while (p_ep->n_trans) {
+        p_ep->p_queue[p_ep->head]->status = -USB_ECANCEL;
+        if (p_trans) {
+            p_trans[n] = p_ep->p_queue[p_ep->head];
+        }
+        n++;
+        __ep_trans_pop(p_ep);
+    }
+    p_ep->head      = 0;
+    p_ep->stage_len = 0;
+    p_ep->out_pos   = 0;
+
+    return n;
+}
+
+/**
+ * \brief 清空端点请求队列并通知从机协议栈，端点 0 的请求由协议栈自己管理，不通知
+ */
+static void __ep_flush_notify(struct usb_loopback *p_lb, struct __lb_ep *p_ep){
+    struct usbd_trans *p_trans[USB_LOOPBACK_QUEUE_SIZE];
+    int                i, n;
+
+    pthread_mutex_lock(&p_lb->lock);
+    n = __ep_flush(p_ep, p_trans);
+    pthread_mutex_unlock(&p_lb->lock);
+
+    if ((p_ep->p_hw == NULL) || ((p_ep->p_hw->ep_addr & 0x0F) == 0)) {
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        usb_dc_trans_complete(p_trans[i], -USB_ECANCEL, 0);
+    }
+}
+
+/**
+ * \brief 完成端点队首请求，调用前持有锁，完成回调里可能会再提交请求，所以回调期间释放锁
+ */
+static void __ep_trans_done(struct usb_loopback *p_lb, struct __lb_ep *p_ep, uint32_t act_len){
+    struct usbd_trans *p_trans = __ep_trans_head(p_ep);
+
+    __ep_trans_pop(p_ep);
+    p_lb->stat.trans++;
+
+    pthread_mutex_unlock(&p_lb->lock);
+    usb_dc_trans_complete(p_trans, USB_OK, act_len);
+    pthread_mutex_lock(&p_lb->lock);
+}
+
+/**
+ * \brief 通知从机协议栈总线复位和链路速度
+ */
+static void __lb_bus_reset(struct usb_loopback *p_lb){
+    int ret;
+
+    ret = usb_dc_bus_reset_handle(p_lb->p_dc);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
+    }
+    usb_dc_speed_update(p_lb->p_dc, p_lb->cfg.speed);
+}
+
+/**
+ * \brief SETUP 事务处理
+ */
+static int __lb_setup(struct usb_loopback *p_lb, uint8_t *p_buf, uint32_t len){
+    struct usb_ctrlreq setup;
+    usb_bool_t         is_reset;
+    int                ret;
+
+    if (len < sizeof(struct usb_ctrlreq)) {
+        return -USB_EILLEGAL;
+    }
+    memcpy(&setup, p_buf, sizeof(struct usb_ctrlreq));
+
+    pthread_mutex_lock(&p_lb->lock);
+    p_lb->stat.setups++;
+    /* 地址回到 0 说明主机重新复位了端口*/
+    is_reset   = ((p_lb->sim_dev.addr == 0) && (p_lb->addr != 0)) ? USB_TRUE : USB_FALSE;
+    p_lb->addr = p_lb->sim_dev.addr;
+    /* 新的 SETUP 终止上一次控制传输*/
+    __ep_flush(&p_lb->ep[0][0], NULL);
+    __ep_flush(&p_lb->ep[1][0], NULL);
+    p_lb->ep[0][0].is_halt = USB_FALSE;
+    p_lb->ep[1][0].is_halt = USB_FALSE;
+    pthread_mutex_unlock(&p_lb->lock);
+
+    if (is_reset) {
+        __lb_bus_reset(p_lb);
+    }
+
+    ret = usb_dc_setup_handle(p_lb->p_dc, &setup);
+    if (ret != USB_OK) {
+        /* 请求不支持，数据和状态阶段回 STALL*/
+        pthread_mutex_lock(&p_lb->lock);
+        p_lb->ep[0][0].is_halt = USB_TRUE;
+        p_lb->ep[1][0].is_halt = USB_TRUE;
+        pthread_mutex_unlock(&p_lb->lock);
+    }
+    /* SETUP 总是被应答*/
+    return len;
+}
+
+/**
+ * \brief 输入事务处理，把从机请求的数据拼到暂存缓存里，主机缓存满或者遇到短包才完成
+ */
+static int __lb_in(struct usb_loopback *p_lb, struct __lb_ep *p_ep, uint8_t *p_buf, uint32_t len){
+    struct usbd_trans *p_trans;
+    usb_bool_t         is_iso   = (p_ep->p_hw->cur_type == USB_EP_TYPE_ISO) ? USB_TRUE : USB_FALSE;
+    usb_bool_t         is_done  = USB_FALSE;
+    usb_bool_t         is_short;
+    uint16_t           mps      = p_ep->p_hw->cur_mps;
+    uint32_t           n;
+    int                ret;
+
+    if (len > USB_LOOPBACK_BUF_SIZE) {
+        len = USB_LOOPBACK_BUF_SIZE;
+    }
+
+    while (is_done == USB_FALSE) {
+        p_trans = __ep_trans_head(p_ep);
+        if (p_trans == NULL) {
+            break;
+        }
+        n = p_trans->len - p_ep->trans_pos;
+        if (n > len - p_ep->stage_len) {
+            n = len - p_ep->stage_len;
+        }
+        if (n) {
+            memcpy(p_ep->p_stage + p_ep->stage_len, p_trans->p_buf + p_ep->trans_pos, n);
+        }
+        p_ep->stage_len += n;
+        p_ep->trans_pos += n;
+
+        if (p_ep->trans_pos < p_trans->len) {
+            /* 主机缓存已满，请求剩下的数据留给下一次事务*/
+            break;
+        }
+        is_short = ((p_trans->len == 0) ||
+                    (mps == 0) ||
+                    (p_trans->len % mps) ||
+                    (p_trans->flag & USBD_ZERO_PACKET)) ? USB_TRUE : USB_FALSE;
+
+        __ep_trans_done(p_lb, p_ep, p_trans->len);
+
+        if (is_short || is_iso || (p_ep->stage_len == len)) {
+            is_done = USB_TRUE;
+        }
+    }
+
+    if ((is_done == USB_FALSE) && ((p_ep->stage_len < len) || (len == 0))) {
+        if (is_iso == USB_FALSE) {
+            p_lb->stat.naks++;
+            return -USB_EAGAIN;
+        }
+        if (p_ep->stage_len == 0) {
+            p_lb->stat.iso_miss++;
+        }
+    }
+
+    memcpy(p_buf, p_ep->p_stage, p_ep->stage_len);
+    ret             = p_ep->stage_len;
+    p_ep->stage_len = 0;
+
+    p_lb->stat.bytes_in += ret;
+
+    return ret;
+}
+
+/**
+ * \brief 输出事务处理，主机数据依次填进从机请求，请求填满或者主机发来短包时完成
+ */
+static int __lb_out(struct usb_loopback *p_lb, struct __lb_ep *p_ep, uint8_t *p_buf, uint32_t len){
+    struct usbd_trans *p_trans;
+    usb_bool_t         is_iso = (p_ep->p_hw->cur_type == USB_EP_TYPE_ISO) ? USB_TRUE : USB_FALSE;
+    uint16_t           mps    = p_ep->p_hw->cur_mps;
+    usb_bool_t         is_short;
+    uint32_t           n;
+
+    /* 主机的最后一个包是否是短包*/
+    is_short = ((len == 0) || (mps == 0) || (len % mps)) ? USB_TRUE : USB_FALSE;
+
+    if (len == 0) {
+        p_trans = __ep_trans_head(p_ep);
+        if (p_trans == NULL) {
+            if (is_iso) {
+                p_lb->stat.iso_miss++;
+                return 0;
+            }
+            p_lb->stat.naks++;
+            return -USB_EAGAIN;
+        }
+        __ep_trans_done(p_lb, p_ep, p_ep->trans_pos);
+
+        return 0;
+    }
+
+    while (p_ep->out_pos < len) {
+        p_trans = __ep_trans_head(p_ep);
+        if (p_trans == NULL) {
+            break;
+        }
+        n = p_trans->len - p_ep->trans_pos;
+        if (n > len - p_ep->out_pos) {
+            n = len - p_ep->out_pos;
+        }
+        memcpy(p_trans->p_buf + p_ep->trans_pos, p_buf + p_ep->out_pos, n);
+        p_ep->out_pos   += n;
+        p_ep->trans_pos += n;
+
+        if ((p_ep->trans_pos == p_trans->len) ||
+                ((p_ep->out_pos == len) && (is_short || is_iso))) {
+            __ep_trans_done(p_lb, p_ep, p_ep->trans_pos);
+        }
+    }
+
+    if (p_ep->out_pos < len) {
+        if (is_iso == USB_FALSE) {
+            /* 已经接收的部分记下来，主机重试时跳过*/
+            p_lb->stat.naks++;
+            return -USB_EAGAIN;
+        }
+        p_lb->stat.iso_miss++;
+    }
+    p_ep->out_pos = 0;
+
+    p_lb->stat.bytes_out += len;
+
+    return len;
+}
+
+/**
+ * \brief 模型事务回调
+ */
+static int __lb_dev_xfer(struct usb_ehci_sim_dev *p_dev,
+                         uint8_t                  ep_addr,
+                         uint8_t                  pid,
+                         uint8_t                 *p_buf,
+                         uint32_t                 len){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_dev->p_arg;
+    struct __lb_ep      *p_ep = NULL;
+    int                  ret;
+
+    if (ep_addr >= USB_LOOPBACK_EP_NUM) {
+        return -USB_EILLEGAL;
+    }
+
+    if (pid == USB_EHCI_SIM_PID_SETUP) {
+        if (ep_addr != 0) {
+            return -USB_EILLEGAL;
+        }
+        return __lb_setup(p_lb, p_buf, len);
+    }
+
+    p_ep = &p_lb->ep[(pid == USB_EHCI_SIM_PID_IN) ? 1 : 0][ep_addr];
+
+    pthread_mutex_lock(&p_lb->lock);
+    if ((p_ep->is_enable == USB_FALSE) || (p_ep->p_hw == NULL) || (p_ep->is_halt)) {
+        p_lb->stat.stalls++;
+        ret = -USB_EPIPE;
+    } else if (pid == USB_EHCI_SIM_PID_IN) {
+        ret = __lb_in(p_lb, p_ep, p_buf, len);
+    } else {
+        ret = __lb_out(p_lb, p_ep, p_buf, len);
+    }
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return ret;
+}
+
+/**
+ * \brief 控制器复位
+ */
+static void __lb_reset(void *p_drv_arg){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    int                  i;
+
+    for (i = 0; i < USB_LOOPBACK_EP_NUM; i++) {
+        __ep_flush_notify(p_lb, &p_lb->ep[0][i]);
+        __ep_flush_notify(p_lb, &p_lb->ep[1][i]);
+    }
+}
+
+/**
+ * \brief 控制器启动
+ */
+static int __lb_run(void *p_drv_arg){
+    return USB_OK;
+}
+
+/**
+ * \brief 上拉或断开，对应插入或拔出模型端口
+ */
+static int __lb_pullup(void *p_drv_arg, usb_bool_t is_on){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    int                  ret;
+
+    if (is_on == p_lb->is_attach) {
+        return USB_OK;
+    }
+
+    if (is_on) {
+        __lb_bus_reset(p_lb);
+
+        p_lb->addr = 0;
+        ret = usb_ehci_sim_dev_attach(p_lb->cfg.p_sim, p_lb->cfg.port_num, &p_lb->sim_dev);
+    } else {
+        ret = usb_ehci_sim_dev_detach(p_lb->cfg.p_sim, p_lb->cfg.port_num);
+        if (ret == USB_OK) {
+            usb_dc_disconnect_handle(p_lb->p_dc);
+        }
+    }
+    if (ret == USB_OK) {
+        p_lb->is_attach = is_on;
+    }
+    return ret;
+}
+
+/**
+ * \brief 控制器停止
+ */
+static int __lb_stop(void *p_drv_arg){
+    return __lb_pullup(p_drv_arg, USB_FALSE);
+}
+
+/**
+ * \brief 传输请求
+ */
+static int __lb_xfer_req(void *p_drv_arg, struct usbd_trans *p_trans){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    struct __lb_ep      *p_ep = __LB_EP_GET(p_lb, p_trans->p_hw->ep_addr);
+    int                  ret  = USB_OK;
+
+    pthread_mutex_lock(&p_lb->lock);
+    if (p_ep->is_enable == USB_FALSE) {
+        ret = -USB_EPERM;
+    } else if (p_ep->n_trans == USB_LOOPBACK_QUEUE_SIZE) {
+        ret = -USB_EBUSY;
+    } else {
+        p_ep->p_queue[(p_ep->head + p_ep->n_trans) % USB_LOOPBACK_QUEUE_SIZE] = p_trans;
+        p_ep->n_trans++;
+    }
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return ret;
+}
+
+/**
+ * \brief 传输请求取消，请求直接移出队列，不调用完成回调
+ */
+static int __lb_xfer_cancel(void *p_drv_arg, struct usbd_trans *p_trans){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    struct __lb_ep      *p_ep = __LB_EP_GET(p_lb, p_trans->p_hw->ep_addr);
+    int                  i, idx, next;
+
+    pthread_mutex_lock(&p_lb->lock);
+    for (i = 0; i < p_ep->n_trans; i++) {
+        idx = (p_ep->head + i) % USB_LOOPBACK_QUEUE_SIZE;
+        if (p_ep->p_queue[idx] == p_trans) {
+            break;
+        }
+    }
+    if (i == p_ep->n_trans) {
+        pthread_mutex_unlock(&p_lb->lock);
+        return -USB_ENODEV;
+    }
+    if (i == 0) {
+        p_ep->trans_pos = 0;
+        p_ep->stage_len = 0;
+        p_ep->out_pos   = 0;
+    }
+    /* 后面的请求往前移*/
+    for (; i < p_ep->n_trans - 1; i++) {
+        idx  = (p_ep->head + i) % USB_LOOPBACK_QUEUE_SIZE;
+        next = (idx + 1) % USB_LOOPBACK_QUEUE_SIZE;
+        p_ep->p_queue[idx] = p_ep->p_queue[next];
+    }
+    p_ep->n_trans--;
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 端点使能
+ */
+static int __lb_ep_enable(void *p_drv_arg, struct usbd_ep *p_hw){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    struct __lb_ep      *p_ep = __LB_EP_GET(p_lb, p_hw->ep_addr);
+
+    if ((p_hw->ep_addr & USB_DIR_IN) && (p_ep->p_stage == NULL)) {
+        return -USB_ENOTSUP;
+    }
+
+    pthread_mutex_lock(&p_lb->lock);
+    p_ep->p_hw      = p_hw;
+    p_ep->is_enable = USB_TRUE;
+    p_ep->is_halt   = USB_FALSE;
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 端点禁能
+ */
+static int __lb_ep_disable(void *p_drv_arg, struct usbd_ep *p_hw){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    struct __lb_ep      *p_ep = __LB_EP_GET(p_lb, p_hw->ep_addr);
+
+    pthread_mutex_lock(&p_lb->lock);
+    p_ep->is_enable = USB_FALSE;
+    pthread_mutex_unlock(&p_lb->lock);
+
+    __ep_flush_notify(p_lb, p_ep);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 端点停止设置
+ */
+static int __lb_ep_halt_set(void *p_drv_arg, struct usbd_ep *p_hw, usb_bool_t is_set){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    struct __lb_ep      *p_ep = __LB_EP_GET(p_lb, p_hw->ep_addr);
+
+    pthread_mutex_lock(&p_lb->lock);
+    p_ep->is_halt = is_set;
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 端点复位，端点保持使能
+ */
+static int __lb_ep_reset(void *p_drv_arg, struct usbd_ep *p_hw){
+    struct usb_loopback *p_lb = (struct usb_loopback *)p_drv_arg;
+    struct __lb_ep      *p_ep = __LB_EP_GET(p_lb, p_hw->ep_addr);
+
+    __ep_flush_notify(p_lb, p_ep);
+
+    pthread_mutex_lock(&p_lb->lock);
+    p_ep->is_halt = USB_FALSE;
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 设置设备地址，地址由模型在状态阶段后更新
+ */
+static int __lb_addr_set(void *p_drv_arg, uint8_t addr){
+    return USB_OK;
+}
+
+/**
+ * \brief 设置配置
+ */
+static int __lb_config_set(void *p_drv_arg, usb_bool_t is_set){
+    return USB_OK;
+}
+
+/* \brief 回环从机控制器驱动函数集*/
+static struct usb_dc_drv __g_lb_drv = {
+        .p_fn_reset       = __lb_reset,
+        .p_fn_run         = __lb_run,
+        .p_fn_stop        = __lb_stop,
+        .p_fn_xfer_req    = __lb_xfer_req,
+        .p_fn_xfer_cancel = __lb_xfer_cancel,
+        .p_fn_ep_enable   = __lb_ep_enable,
+        .p_fn_ep_disable  = __lb_ep_disable,
+        .p_fn_ep_halt_set = __lb_ep_halt_set,
+        .p_fn_ep_reset    = __lb_ep_reset,
+        .p_fn_addr_set    = __lb_addr_set,
+        .p_fn_config_set  = __lb_config_set,
+        .p_fn_wakeup      = NULL,
+        .p_fn_pullup      = __lb_pullup,
+};
+
+/**
+ * \brief 释放回环控制器内存
+ */
+static void __lb_free(struct usb_loopback *p_lb){
+    int i;
+
+    for (i = 0; i < USB_LOOPBACK_EP_NUM; i++) {
+        if (p_lb->ep[1][i].p_stage) {
+            free(p_lb->ep[1][i].p_stage);
+        }
+    }
+    pthread_mutex_destroy(&p_lb->lock);
+    free(p_lb);
+}
+
+/**
+ * \brief 创建回环从机控制器
+ *
+ * \param[in]  p_cfg 回环控制器配置
+ * \param[out] p_lb  返回创建的回环控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_create(struct usb_loopback_cfg *p_cfg, struct usb_loopback **p_lb){
+    struct usb_loopback *p_lb_tmp = NULL;
+    uint16_t             mps_limt = USBD_EP_MPS_NO_LIMT;
+    uint16_t             ep0_mps  = USBD_EP0_MAX_PKT_SIZE;
+    int                  i, ret;
+
+    if ((p_cfg == NULL) || (p_lb == NULL) || (p_cfg->p_sim == NULL)) {
+        return -USB_EINVAL;
+    }
+    if ((p_cfg->speed != USB_SPEED_LOW) &&
+            (p_cfg->speed != USB_SPEED_FULL) &&
+            (p_cfg->speed != USB_SPEED_HIGH)) {
+        return -USB_EILLEGAL;
+    }
+    if (p_cfg->n_eps >= USB_LOOPBACK_EP_NUM) {
+        return -USB_EILLEGAL;
+    }
+    if (p_cfg->speed == USB_SPEED_LOW) {
+        mps_limt = 8;
+        ep0_mps  = 8;
+    }
+
+    p_lb_tmp = calloc(1, sizeof(struct usb_loopback));
+    if (p_lb_tmp == NULL) {
+        return -USB_ENOMEM;
+    }
+
+    p_lb_tmp->cfg               = *p_cfg;
+    p_lb_tmp->sim_dev.speed     = p_cfg->speed;
+    p_lb_tmp->sim_dev.p_fn_xfer = __lb_dev_xfer;
+    p_lb_tmp->sim_dev.p_arg     = p_lb_tmp;
+    pthread_mutex_init(&p_lb_tmp->lock, NULL);
+
+    for (i = 0; i <= p_cfg->n_eps; i++) {
+        p_lb_tmp->ep[1][i].p_stage = malloc(USB_LOOPBACK_BUF_SIZE);
+        if (p_lb_tmp->ep[1][i].p_stage == NULL) {
+            __lb_free(p_lb_tmp);
+            return -USB_ENOMEM;
+        }
+    }
+
+    ret = usb_dc_create(p_cfg->dc_idx,
+                        USBD_EP0_REQ_BUF_SIZE,
+                       &__g_lb_drv,
+                        p_lb_tmp,
+                       &p_lb_tmp->p_dc);
+    if (ret != USB_OK) {
+        __lb_free(p_lb_tmp);
+        return ret;
+    }
+    p_lb_tmp->p_dc->device_is_hs = (p_cfg->speed == USB_SPEED_HIGH) ? 1 : 0;
+
+    /* 注册端点*/
+    ret = usb_dc_ep_register(p_lb_tmp->p_dc, USB_DIR_OUT, USBD_EP_SUPPORT_CTRL, ep0_mps);
+    if (ret != USB_OK) {
+        goto __failed;
+    }
+    ret = usb_dc_ep_register(p_lb_tmp->p_dc, USB_DIR_IN, USBD_EP_SUPPORT_CTRL, ep0_mps);
+    if (ret != USB_OK) {
+        goto __failed;
+    }
+    for (i = 1; i <= p_cfg->n_eps; i++) {
+        ret = usb_dc_ep_register(p_lb_tmp->p_dc,
+                                 USB_DIR_OUT | i,
+                                 USBD_EP_SUPPORT_ISO | USBD_EP_SUPPORT_BULK | USBD_EP_SUPPORT_INT,
+                                 mps_limt);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+        ret = usb_dc_ep_register(p_lb_tmp->p_dc,
+                                 USB_DIR_IN | i,
+                                 USBD_EP_SUPPORT_ISO | USBD_EP_SUPPORT_BULK | USBD_EP_SUPPORT_INT,
+                                 mps_limt);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+    }
+
+    *p_lb = p_lb_tmp;
+
+    return USB_OK;
+__failed:
+    usb_dc_destroy(p_lb_tmp->p_dc);
+    __lb_free(p_lb_tmp);
+
+    return ret;
+}
+
+/**
+ * \brief 销毁回环从机控制器
+ *
+ * \param[in] p_lb 要销毁的回环控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_destroy(struct usb_loopback *p_lb){
+    int ret;
+
+    if (p_lb == NULL) {
+        return -USB_EINVAL;
+    }
+
+    ret = __lb_pullup(p_lb, USB_FALSE);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    __lb_reset(p_lb);
+
+    ret = usb_dc_destroy(p_lb->p_dc);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    __lb_free(p_lb);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 获取回环控制器对应的 USB 从机控制器
+ *
+ * \param[in]  p_lb 回环控制器
+ * \param[out] p_dc 返回的 USB 从机控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_dc_get(struct usb_loopback *p_lb, struct usb_dc **p_dc){
+    if ((p_lb == NULL) || (p_dc == NULL)) {
+        return -USB_EINVAL;
+    }
+    *p_dc = p_lb->p_dc;
+
+    return USB_OK;
+}
+
+/**
+ * \brief 获取回环控制器统计
+ *
+ * \param[in]  p_lb   回环控制器
+ * \param[out] p_stat 返回的统计
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_stat_get(struct usb_loopback *p_lb, struct usb_loopback_stat *p_stat){
+    if ((p_lb == NULL) || (p_stat == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_lock(&p_lb->lock);
+    *p_stat = p_lb->stat;
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return USB_OK;
+}
+
+/**
+ * \brief 清除回环控制器统计
+ *
+ * \param[in] p_lb 回环控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_stat_clr(struct usb_loopback *p_lb){
+    if (p_lb == NULL) {
+        return -USB_EINVAL;
+    }
+
+    pthread_mutex_lock(&p_lb->lock);
+    memset(&p_lb->stat, 0, sizeof(struct usb_loopback_stat));
+    pthread_mutex_unlock(&p_lb->lock);
+
+    return USB_OK;
+}
@@ -0,0 +1,113 @@
+#ifndef __USB_LOOPBACK_H
+#define __USB_LOOPBACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus  */
+#include "common/err/usb_err.h"
+#include "common/usb_common.h"
+#include "adapter/linux/usb_ehci_sim.h"
+#include "core/include/device/core/usbd.h"
+
+/*
+ * 用户态回环从机控制器
+ *
+ * 回环控制器实现了一套 struct usb_dc_drv 从机控制器驱动，同时把自己作为虚拟设备插到
+ * EHCI 控制器模型（usb_ehci_sim）的根集线器端口上。主机协议栈通过 usbh_ehci 提交的
+ * 传输请求包，由模型线程逐个事务交给回环控制器，再和从机协议栈提交的 usbd_trans
+ * 匹配完成，这样主机和从机两套协议栈可以在同一个进程里背靠背运行：
+ *
+ *     控制传输   SETUP 交给 usb_dc_setup_handle()，数据/状态阶段匹配端点 0 的请求
+ *     批量/中断 没有从机请求时回 NAK，端点停止时回 STALL
+ *     等时传输   没有从机请求时输入返回空包，输出数据丢弃，不回 NAK
+ *
+ * 链路速度由 cfg.speed 决定，从机协议栈在上拉时收到总线复位和速度更新。
+ *
+ * 用法：
+ *     usb_ehci_sim_create(&sim_cfg, &p_sim);
+ *     ...创建主机 EHCI 控制器...
+ *     lb_cfg.p_sim = p_sim;
+ *     usb_loopback_create(&lb_cfg, &p_lb);
+ *     usb_loopback_dc_get(p_lb, &p_dc);
+ *     ...在 p_dc 上创建从机设备（例如 usbd_ms），usb_dc_start(p_dc)...
+ */
+
+/* \brief 每个方向的端点数量（包括端点 0）*/
+#define USB_LOOPBACK_EP_NUM       16
+/* \brief 每个端点可以挂起的从机请求数量*/
+#define USB_LOOPBACK_QUEUE_SIZE   8
+/* \brief 输入端点暂存缓存大小，和模型的 qTD 最大长度一致*/
+#define USB_LOOPBACK_BUF_SIZE     (5 * 0x1000)
+
+/* \brief 回环控制器*/
+struct usb_loopback;
+
+/* \brief 回环控制器配置结构体*/
+struct usb_loopback_cfg {
+    uint8_t              dc_idx;               /* 从机控制器索引*/
+    uint8_t              speed;                /* 链路速度，USB_SPEED_LOW/FULL/HIGH*/
+    uint8_t              n_eps;                /* 除端点 0 外每个方向注册的端点数量*/
+    struct usb_ehci_sim *p_sim;                /* 连接的 EHCI 控制器模型*/
+    uint8_t              port_num;             /* 连接的根集线器端口号（从 0 开始）*/
+};
+
+/* \brief 回环控制器统计结构体*/
+struct usb_loopback_stat {
+    uint64_t   setups;                         /* SETUP 包数量*/
+    uint64_t   trans;                          /* 完成的从机请求数量*/
+    uint64_t   bytes_in;                       /* 输入方向字节数*/
+    uint64_t   bytes_out;                      /* 输出方向字节数*/
+    uint64_t   naks;                           /* NAK 次数*/
+    uint64_t   stalls;                         /* STALL 次数*/
+    uint64_t   iso_miss;                       /* 没有从机请求的等时事务数量*/
+};
+
+/**
+ * \brief 创建回环从机控制器
+ *
+ * \param[in]  p_cfg 回环控制器配置
+ * \param[out] p_lb  返回创建的回环控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_create(struct usb_loopback_cfg *p_cfg, struct usb_loopback **p_lb);
+/**
+ * \brief 销毁回环从机控制器
+ *
+ * \param[in] p_lb 要销毁的回环控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_destroy(struct usb_loopback *p_lb);
+/**
+ * \brief 获取回环控制器对应的 USB 从机控制器
+ *
+ * \param[in]  p_lb 回环控制器
+ * \param[out] p_dc 返回的 USB 从机控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_dc_get(struct usb_loopback *p_lb, struct usb_dc **p_dc);
+/**
+ * \brief 获取回环控制器统计
+ *
+ * \param[in]  p_lb   回环控制器
+ * \param[out] p_stat 返回的统计
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_stat_get(struct usb_loopback *p_lb, struct usb_loopback_stat *p_stat);
+/**
+ * \brief 清除回环控制器统计
+ *
+ * \param[in] p_lb 回环控制器
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_loopback_stat_clr(struct usb_loopback *p_lb);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus  */
+
+#endif /* __USB_LOOPBACK_H */
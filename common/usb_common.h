@@ -103,6 +103,21 @@ typedef int             usb_refcnt;
 #define prefetch(x) (void)0
 #endif
 
+/**
+ * \brief 获取/释放语义的 32 位原子读写，用于单生产者/单消费者之间传递索引
+ *
+ * 写端先写数据再用 USB_STORE_RELEASE 更新索引，读端用 USB_LOAD_ACQUIRE 读到索引后
+ * 才能看到对应的数据
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define USB_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define USB_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+/* 其他编译器按单核处理，只保证不被编译器优化*/
+#define USB_LOAD_ACQUIRE(p)        (*(volatile uint32_t *)(p))
+#define USB_STORE_RELEASE(p, v)    (*(volatile uint32_t *)(p) = (v))
+#endif
+
 /* \brief 检查一个字节里有多少个1*/
 #define usb_hweight8(w)         \
      ((unsigned int)         \
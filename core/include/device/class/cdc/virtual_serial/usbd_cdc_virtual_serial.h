@@ -9,6 +9,22 @@ extern "C" {
 #include "core/include/device/core/usbd.h"
 
 #define USBD_VS_RB_SIZE 2048
+/* \brief 默认的输出传输事务数量*/
+#define USBD_VS_TRANS_NUM      4
+/* \brief 每个输出传输事务的缓存大小*/
+#define USBD_VS_TRANS_SIZE     512
+#if USB_OS_EN
+/* \brief 互斥锁超时时间*/
+#define USBD_VS_MUTEX_TIMEOUT  5000
+#endif
+
+struct usbd_cdc_vs_port;
+
+/* \brief USB 从机虚拟串口输出传输事务结构体*/
+struct usbd_cdc_vs_trans {
+    struct usbd_trans           trans;            /* USB 传输事务*/
+    struct usbd_cdc_vs_port    *p_port;           /* 所属端口*/
+};
 
 /* \brief USB 从机虚拟串口端口结构体*/
 struct usbd_cdc_vs_port {
@@ -24,7 +40,15 @@ struct usbd_cdc_vs_port {
     usb_bool_t                  is_setup;         /* 是否设置*/
     usb_bool_t                  is_start;         /* 是否启动*/
     struct usb_ringbuf         *p_rb;             /* 环形缓冲区*/
-    struct usbd_trans           trans;            /* USB 传输事务*/
+#if USB_OS_EN
+    usb_mutex_handle_t          p_lock;           /* 保护暂停的传输事务*/
+#endif
+    struct usbd_cdc_vs_trans   *p_trans;          /* 输出传输事务数组*/
+    uint8_t                     n_trans;          /* 输出传输事务数量*/
+    struct usbd_cdc_vs_trans  **p_park;           /* 暂停的传输事务队列，按完成顺序排列*/
+    uint8_t                     park_head;        /* 暂停队列头*/
+    uint8_t                     n_parked;         /* 环形缓冲区空间不足而暂停提交的传输事务数量*/
+    uint32_t                    n_nak;            /* 应用读取太慢而暂停传输事务的次数*/
 };
 
 /* \brief USB 从机虚拟串口结构体 */
@@ -67,6 +91,21 @@ int usbd_cdc_vs_destroy(struct usbd_cdc_vs *p_vs);
  * \retval 设置返回 USB_TRUE，否则返回 USB_FALSE
  */
 usb_bool_t usbd_cdc_vs_port_is_setup(struct usbd_cdc_vs *p_vs, uint8_t port_num);
+/**
+ * \brief USB 从机虚拟串口设备端口设置输出传输事务数量
+ *
+ *        在端口启动前调用，默认为 USBD_VS_TRANS_NUM。传输事务完成时如果环形缓冲区放不下数据，
+ *        传输事务暂停不再提交，所有传输事务都暂停后主机收到 NAK，直到应用读走数据。
+ *
+ * \param[in] p_vs     USB 从机虚拟串口设备
+ * \param[in] port_num 端口号
+ * \param[in] n_trans  输出传输事务数量
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_cdc_vs_port_trans_num_set(struct usbd_cdc_vs *p_vs,
+                                   uint8_t             port_num,
+                                   uint8_t             n_trans);
 /**
  * \brief USB 从机虚拟串口设备端口启动
  *
@@ -39,6 +39,20 @@ struct usbd_ms_lu {
     void                          *p_usr_data;  /* 用户私有数据*/
 };
 
+/* \brief 异步块请求结构体*/
+struct usbd_ms_blk_req {
+    struct usbd_ms                  *p_ms;        /* 所属的 USB 从机大容量存储设备*/
+    struct usbd_ms_lu               *p_lu;        /* 操作的逻辑单元*/
+    uint8_t                         *p_buf;       /* 数据缓存*/
+    uint32_t                         blk_num;     /* 起始块号*/
+    uint32_t                         n_blks;      /* 块数量*/
+    uint32_t                         blks_act;    /* 实际完成的块数量，后端完成时填写*/
+    int                              status;      /* 完成状态，后端完成时填写*/
+    volatile usb_bool_t              is_done;     /* 是否完成*/
+    volatile usb_bool_t              is_pend;     /* 是否已提交给后端还没有完成*/
+    void                            *p_usr_priv;  /* 后端私有数据*/
+};
+
 /* \brief 操作函数集*/
 struct usbd_ms_opts {
     int (*p_fn_blk_read)(struct usbd_ms_lu *p_lu,
@@ -51,6 +65,10 @@ struct usbd_ms_opts {
                           uint32_t           blk_num,
                           uint32_t           n_blks,
                           uint32_t          *p_blks_act);
+    /* 可选的异步块读写提交函数，只提交请求不等待完成，后端完成后调用 usbd_ms_blk_req_done 通知。
+     * 设置了并且通过 usbd_ms_blk_req_num_set 配置了异步块请求数量时，优先于同步函数使用*/
+    int (*p_fn_blk_read_submit)(struct usbd_ms_blk_req *p_req);
+    int (*p_fn_blk_write_submit)(struct usbd_ms_blk_req *p_req);
 };
 
 /* \brief USB 从机大容量存储设备结构体 */
@@ -58,10 +76,20 @@ struct usbd_ms {
     uint8_t                          n_lu;             /* 逻辑单元个数 */
     uint8_t                          cfg_num;          /* 配置编号*/
     uint8_t                         *p_buf;            /* 传输缓存*/
+    uint8_t                         *p_buf_db;         /* 双缓存的第二个传输缓存，和 p_buf 轮流使用*/
     uint32_t                         buf_size;         /* 缓存大小 */
     struct usbd_dev                 *p_dc_dev;         /* USB 从机设备结构体*/
 #if USB_OS_EN
     usb_mutex_handle_t               p_lock;
+    usb_sem_handle_t                 p_trans_sem;      /* 数据阶段异步传输完成信号量*/
+#else
+    volatile usb_bool_t              is_trans_done;    /* 数据阶段异步传输完成标志*/
+#endif
+    struct usbd_trans                trans;            /* 数据阶段异步传输请求*/
+    struct usbd_ms_blk_req          *p_reqs;           /* 异步块请求数组*/
+    uint8_t                          n_reqs;           /* 最多同时未完成的异步块请求数量*/
+#if USB_OS_EN
+    usb_sem_handle_t                 p_req_sem;        /* 异步块请求完成信号量*/
 #endif
     struct usbd_pipe                *p_data_in;        /* 数据输入管道*/
     struct usbd_pipe                *p_data_out;       /* 数据输出管道*/
@@ -197,6 +225,81 @@ int usbd_ms_write(struct usbd_ms *p_ms,
                   uint32_t        len,
                   int             timeout,
                   uint32_t       *p_act_len);
+/**
+ * \brief USB 从机大容量存储设备设置异步块请求数量
+ *
+ *        每个异步块请求有自己的 buf_size 大小的数据缓存，只有设置了用户操作函数集的异步提交函数，
+ *        读写命令才会使用异步块请求。
+ *
+ * \param[in] p_ms   USB 从机大容量存储设备
+ * \param[in] n_reqs 最多同时未完成的异步块请求数量，为 0 则不使用异步块请求
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_ms_blk_req_num_set(struct usbd_ms *p_ms, uint8_t n_reqs);
+/**
+ * \brief USB 从机大容量存储设备异步块请求完成通知，由后端调用，可以在中断中调用
+ *
+ * \param[in] p_req    完成的异步块请求
+ * \param[in] status   完成状态
+ * \param[in] blks_act 实际完成的块数量
+ */
+void usbd_ms_blk_req_done(struct usbd_ms_blk_req *p_req, int status, uint32_t blks_act);
+/**
+ * \brief USB 从机大容量存储设备提交异步块请求
+ *
+ * \param[in] p_ms     USB 从机大容量存储设备
+ * \param[in] p_req    要提交的异步块请求
+ * \param[in] is_write 是否是写请求
+ * \param[in] blk_num  起始块号
+ * \param[in] n_blks   块数量
+ *
+ * \retval 成功返回 USB_OK，请求还在后端没有完成返回 -USB_EBUSY
+ */
+int usbd_ms_blk_req_submit(struct usbd_ms         *p_ms,
+                           struct usbd_ms_blk_req *p_req,
+                           usb_bool_t              is_write,
+                           uint32_t                blk_num,
+                           uint32_t                n_blks);
+/**
+ * \brief USB 从机大容量存储设备等待异步块请求完成
+ *
+ * \param[in] p_ms    USB 从机大容量存储设备
+ * \param[in] p_req   要等待的异步块请求
+ * \param[in] timeout 等待超时时间
+ *
+ * \retval 成功返回 USB_OK，失败返回后端上报的完成状态或者等待错误，
+ *         等待超时后请求仍然属于后端，后端完成前不能再提交
+ */
+int usbd_ms_blk_req_wait(struct usbd_ms         *p_ms,
+                         struct usbd_ms_blk_req *p_req,
+                         int                     timeout);
+/**
+ * \brief USB 大容量存储设备启动数据阶段异步传输
+ *
+ * \param[in] p_ms  USB 从机大容量存储设备
+ * \param[in] dir   传输方向，USB_DIR_IN 发送给主机，USB_DIR_OUT 从主机接收
+ * \param[in] p_buf 数据缓存（p_buf 或 p_buf_db）
+ * \param[in] len   数据长度（不可超过 USB 从机大容量存储设备 buf_size）
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_ms_trans_start(struct usbd_ms *p_ms,
+                        uint8_t         dir,
+                        uint8_t        *p_buf,
+                        uint32_t        len);
+/**
+ * \brief USB 大容量存储设备等待数据阶段异步传输完成
+ *
+ * \param[in]  p_ms      USB 从机大容量存储设备
+ * \param[in]  timeout   等待超时时间，超时会取消传输
+ * \param[out] p_act_len 返回实际传输的数据长度
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_ms_trans_wait(struct usbd_ms *p_ms,
+                       int             timeout,
+                       uint32_t       *p_act_len);
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus  */
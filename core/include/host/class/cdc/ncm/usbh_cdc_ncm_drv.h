@@ -0,0 +1,144 @@
+#ifndef __USBH_CDC_NCM_DRV_H
+#define __USBH_CDC_NCM_DRV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus  */
+#include "common/list/usb_list.h"
+#include "common/refcnt/usb_refcnt.h"
+#include "core/include/host/core/usbh.h"
+#include "core/include/host/core/usbh_dev.h"
+#include "core/include/specs/usb_cdc_specs.h"
+#include "core/include/host/class/net/usbh_net.h"
+#include <string.h>
+#include <stdio.h>
+
+/* \brief 接收 NTB 最大大小，设备支持的更大时用这个值协商*/
+#define USBH_NCM_NTB_RX_SIZE_MAX    16384
+/* \brief 发送 NTB 最大大小，设备支持的更大时用这个值*/
+#define USBH_NCM_NTB_TX_SIZE_MAX    16384
+/* \brief NTB 最小大小(CDC NCM 规范 3.3.2)*/
+#define USBH_NCM_NTB_SIZE_MIN       2048
+/* \brief 一个发送 NTB 最多积累的数据报数量*/
+#define USBH_NCM_TX_DGRAM_MAX       32
+/* \brief 默认的发送积累超时时间(微秒)*/
+#define USBH_NCM_TX_TIMEOUT_DEF     400
+
+/* \brief USB 主机 NCM 设备私有数据*/
+struct usbh_ncm_priv {
+    struct usb_cdc_ncm_ntb_parameters ntb_param;                         /* 设备 NTB 参数*/
+    struct usb_cdc_ncm_desc          *p_ncm_desc;                        /* NCM 功能描述符*/
+    uint8_t                           ntb_format;                        /* 使用的 NTB 格式*/
+    uint32_t                          rx_max;                            /* 接收 NTB 大小*/
+    uint32_t                          tx_max;                            /* 发送 NTB 大小*/
+    uint16_t                          tx_modulus;                        /* 发送数据报对齐除数*/
+    uint16_t                          tx_remainder;                      /* 发送数据报对齐余数*/
+    uint16_t                          tx_ndp_align;                      /* 发送 NDP 对齐*/
+    uint16_t                          tx_dgram_max;                      /* 一个发送 NTB 最多的数据报数量*/
+    uint8_t                          *p_tx_ntb;                          /* 发送 NTB 缓存*/
+    uint32_t                          tx_ntb_len;                        /* 发送 NTB 已使用的长度*/
+    uint16_t                          tx_seq;                            /* 发送 NTB 序列号*/
+    uint16_t                          tx_n_dgram;                        /* 发送 NTB 已积累的数据报数量*/
+    uint32_t                          tx_dgram_idx[USBH_NCM_TX_DGRAM_MAX]; /* 数据报偏移*/
+    uint32_t                          tx_dgram_len[USBH_NCM_TX_DGRAM_MAX]; /* 数据报长度*/
+};
+
+/**
+ * \brief USB 主机 NCM 设备探测函数
+ *
+ * \param[in] p_usb_fun USB 接口功能结构体
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_probe(struct usbh_function *p_usb_fun);
+/**
+ * \brief USB 主机 NCM 设备创建函数
+ *
+ * \param[in] p_usb_fun USB 接口功能结构体
+ * \param[in] p_name    USB 主机 NCM 设备名字
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_create(struct usbh_function *p_usb_fun, char *p_name);
+/**
+ * \brief  USB 主机 NCM 设备销毁函数
+ *
+ * \param[in] p_usb_fun USB 接口功能结构体
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_destroy(struct usbh_function *p_usb_fun);
+/**
+ * \brief USB 主机 NCM 设备打开函数
+ *
+ * \param[in]  p_handle  打开句柄
+ * \param[in]  flag      打开标志，本接口支持两种打开方式：
+ *                       USBH_DEV_OPEN_BY_NAME 是通过名字打开设备
+ *                       USBH_DEV_OPEN_BY_UFUN 是通过 USB 功能结构体打开设备
+ * \param[out] p_net_ret 成功返回 USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_open(void             *p_handle,
+                  uint8_t           flag,
+                  struct usbh_net **p_net_ret);
+/**
+ * \brief USB 主机 NCM 设备关闭函数
+ *
+ * \param[in] p_net USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_close(struct usbh_net *p_net);
+/**
+ * \brief USB 主机 NCM 设备启动函数
+ *
+ * \param[in] p_net USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_start(struct usbh_net *p_net);
+/**
+ * \brief USB 主机 NCM 设备停止函数
+ *
+ * \param[in] p_net USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_stop(struct usbh_net *p_net);
+/**
+ * \brief USB 主机 NCM 设备写函数，帧先积累到发送 NTB 中，NTB 满、达到最大数据报数量
+ *        或者积累超时(在 usbh_net_process() 中检查)后才发送
+ *
+ * \param[in] p_net   USB 主机网络设备
+ * \param[in] p_buf   写缓存
+ * \param[in] buf_len 写缓存长度
+ *
+ * \retval 成功返回实际写的长度
+ */
+int usbh_ncm_write(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len);
+/**
+ * \brief USB 主机 NCM 设备读函数
+ *
+ * \param[in] p_net   USB 主机网络设备
+ * \param[in] p_buf   读缓存
+ * \param[in] buf_len 读缓存长度
+ *
+ * \retval 成功返回读到的数据长度
+ */
+int usbh_ncm_read(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len);
+/**
+ * \brief USB 主机 NCM 设备获取协商后的 NTB 大小
+ *
+ * \param[in]  p_net   USB 主机网络设备
+ * \param[out] p_rx_max 返回的接收 NTB 大小
+ * \param[out] p_tx_max 返回的发送 NTB 大小
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_ntb_size_get(struct usbh_net *p_net, uint32_t *p_rx_max, uint32_t *p_tx_max);
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus  */
+
+#endif /* __USBH_CDC_NCM_DRV_H */
@@ -44,5 +44,21 @@ int usbh_serial_ch341_init(struct usbh_serial *p_userial);
  * \retval 成功返回 USB_OK
  */
 int usbh_serial_ch341_deinit(struct usbh_serial *p_userial);
+/**
+ * \brief USB 转串口 ch341 芯片停止接收，取消读请求包并释放读缓存
+ *
+ * \param[in] p_userial USB 转串口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_serial_ch341_rx_stop(struct usbh_serial *p_userial);
+/**
+ * \brief USB 转串口 ch341 芯片启动接收，重新分配读缓存并提交读请求包
+ *
+ * \param[in] p_userial USB 转串口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_serial_ch341_rx_start(struct usbh_serial *p_userial);
 
 #endif
@@ -90,8 +90,7 @@ struct usbh_serial_pipe {
 /* \brief USB 主机转串口接收管道结构体 */
 struct usbh_serial_rx_pipe {
     struct usbh_serial_pipe pipe;
-    uint32_t                data_pos;          /* 数据位置*/
-    uint32_t                rd_pos;            /* 已读位置*/
+    struct usb_ringbuf      rb;                /* 接收环形缓冲区，使用管道缓存*/
 };
 
 /* \brief USB 主机转串口发送管道结构体 */
@@ -118,6 +117,8 @@ struct usbh_serial_drv_info {
     char *p_drv_name;
     int (*p_fn_init)(struct usbh_serial *p_userial);
     int (*p_fn_deinit)(struct usbh_serial *p_userial);
+    int (*p_fn_rx_stop)(struct usbh_serial *p_userial);
+    int (*p_fn_rx_start)(struct usbh_serial *p_userial);
 };
 
 /* \brief USB 主机转串口端口操作函数集 */
@@ -152,6 +153,7 @@ struct usbh_serial {
     struct usbh_serial_port      *p_ports;             /* 端口结构体*/
     struct usbh_serial_port_opts *p_opts;              /* 操作函数集*/
     usb_bool_t                    is_removed;          /* 移除状态*/
+    usb_bool_t                    is_rx_run;           /* 接收传输请求包是否在传输*/
 #if USB_OS_EN
     usb_mutex_handle_t            p_lock;
 #endif
@@ -431,7 +433,7 @@ int usbh_serial_port_buf_size_get(struct usbh_serial_port *p_port,
  * \param[in] pipe_dir 管道方向
  * \param[in] buf_size 缓存大小
  *
- * \retval 成功返回 USB_OK
+ * \retval 成功返回 USB_OK，设置接收缓存时会先停止设备的接收，缓存里没读的数据会被丢弃
  */
 int usbh_serial_port_buf_size_set(struct usbh_serial_port *p_port,
                                   uint8_t                  pipe_dir,
@@ -9,7 +9,7 @@ extern "C" {
 #include "core/include/usb_lib.h"
 #include "adapter/usb_adapter.h"
 #include "common/usb_common.h"
-#include "utils/list/usb_list.h"
+#include "common/list/usb_list.h"
 
 #if USB_OS_EN
 #define UHID_LOCK_TIMEOUT            5000
@@ -17,6 +17,12 @@ extern "C" {
 
 /* \brief USB 人脸接口设备传输超时时间*/
 #define UHID_XFER_TIMEOUT            5000
+/* \brief 默认的输入传输请求包数量*/
+#define UHID_TRP_NUM_DEFAULT         4
+/* \brief 输入传输请求包最大数量*/
+#define UHID_TRP_NUM_MAX             32
+/* \brief 停止时等待输入传输请求包返回的超时时间(毫秒)*/
+#define UHID_STOP_TIMEOUT            5000
 
 /* \brief USB 人体接口设备类描述类型 */
 #define HID_DT_HID                  (USB_REQ_TYPE_CLASS | 0x01)
@@ -168,6 +174,26 @@ struct usbh_hid_collection {
 	uint32_t level;
 };
 
+struct usbh_hid;
+
+/* \brief USB 主机人体接口设备输入报告回调函数，在传输完成上下文中调用，不能阻塞*/
+typedef void (*usbh_hid_report_cb_t)(struct usbh_hid     *p_hid,
+                                     uint8_t             *p_report,
+                                     uint32_t             len,
+                                     struct usb_timespec *p_ts,
+                                     void                *p_arg);
+
+/* \brief USB 主机人体接口设备输入报告统计结构体*/
+struct usbh_hid_stat {
+    uint32_t n_reports;                  /* 收到的报告数量*/
+    uint32_t n_lost;                     /* 报告队列满丢掉的报告数量*/
+    uint32_t n_errors;                   /* 传输出错的次数*/
+    uint32_t cb_max_us;                  /* 回调函数最长执行时间（微秒）*/
+    uint32_t latency_max_us;             /* 报告从到达到被读走的最大延时（微秒）*/
+    uint64_t latency_sum_us;             /* 报告从到达到被读走的延时总和（微秒）*/
+    uint32_t n_latency;                  /* 延时统计的报告数量*/
+};
+
 /* \brief USB 主机人体接口设备*/
 struct usbh_hid {
     struct usbh_function       *p_usb_fun;               /* 相关的功能接口*/
@@ -188,8 +214,20 @@ struct usbh_hid {
     uint32_t                    application_max;         /* 应用数量 */
     struct usbh_hid_report_enum report_enum[HID_REPORT_TYPES];
     int                         ref_cnt;                 /* 引用计数*/
-    uint8_t                    *p_buf_in;                /* 输入缓存 */
-    struct usbh_trp            *p_trp_in;                /* 输入传输请求包*/
+    uint8_t                    *p_buf_in;                /* 输入缓存，每个传输请求包一段 */
+    struct usbh_trp            *p_trp_in;                /* 输入传输请求包数组*/
+    uint8_t                     n_trp_in;                /* 输入传输请求包数量*/
+    volatile usb_bool_t         trp_act[UHID_TRP_NUM_MAX];/* 输入传输请求包是否还在传输(回调返回前不能释放)*/
+    uint32_t                    in_size;                 /* 输入报告最大长度*/
+    usb_bool_t                  is_started;              /* 是否已经启动*/
+    usbh_hid_report_cb_t        p_fn_report_cb;          /* 输入报告回调函数*/
+    void                       *p_report_arg;            /* 输入报告回调函数参数*/
+    struct usb_ringbuf         *p_report_rb;             /* 输入报告队列*/
+    uint32_t                    report_qlen;             /* 输入报告队列长度（报告个数）*/
+#if USB_OS_EN
+    usb_sem_handle_t            p_report_sem;            /* 输入报告信号量*/
+#endif
+    struct usbh_hid_stat        stat;                    /* 输入报告统计*/
     struct usb_list_node        node;                    /* 设备节点*/
     usb_bool_t                  is_removed;              /* 移除标志*/
 };
@@ -323,14 +361,78 @@ int usbh_hid_close(struct usbh_hid *p_hid);
  */
 int usbh_hid_start(struct usbh_hid *p_hid);
 /**
- * \brief 停止 USB 人体接口设备
+ * \brief 停止 USB 人体接口设备，等待所有输入传输请求包返回
  *
  * \param[in] p_hid 要停止的 USB 人体接口设备
  *
- * \retval 成功返回 USB_OK
+ * \retval 成功返回 USB_OK，请求包没有按时返回返回 -USB_ETIME
  */
 int usbh_hid_stop(struct usbh_hid *p_hid);
 
+/**
+ * \brief 设置 USB 人体接口设备输入传输请求包数量，要在启动前设置
+ *
+ * \param[in] p_hid  USB 人体接口设备
+ * \param[in] n_trps 传输请求包数量（1~UHID_TRP_NUM_MAX），轮询间隔越短需要越多
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_trp_num_set(struct usbh_hid *p_hid, uint8_t n_trps);
+/**
+ * \brief 设置 USB 人体接口设备输入报告队列长度，要在启动前设置
+ *
+ * \param[in] p_hid USB 人体接口设备
+ * \param[in] qlen  能缓存的报告个数，为 0 则不使用队列
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_report_queue_set(struct usbh_hid *p_hid, uint32_t qlen);
+/**
+ * \brief 设置 USB 人体接口设备输入报告回调函数
+ *
+ * \param[in] p_hid     USB 人体接口设备
+ * \param[in] p_fn_cb   回调函数，为 NULL 则取消回调
+ * \param[in] p_arg     回调函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_report_cb_set(struct usbh_hid      *p_hid,
+                           usbh_hid_report_cb_t  p_fn_cb,
+                           void                 *p_arg);
+/**
+ * \brief 从 USB 人体接口设备输入报告队列读一个报告
+ *
+ * \param[in]  p_hid     USB 人体接口设备
+ * \param[in]  p_buf     报告缓存
+ * \param[in]  buf_size  缓存大小，比报告小时报告被截断
+ * \param[out] p_act_len 返回报告长度
+ * \param[in]  timeout   等待超时时间（毫秒），USB_NO_WAIT 不等待，USB_WAIT_FOREVER 一直等待
+ *
+ * \retval 成功返回 USB_OK，超时返回 -USB_ETIME
+ */
+int usbh_hid_report_read(struct usbh_hid *p_hid,
+                         uint8_t         *p_buf,
+                         uint32_t         buf_size,
+                         uint32_t        *p_act_len,
+                         int              timeout);
+/**
+ * \brief 获取 USB 人体接口设备输入报告统计
+ *
+ * \param[in]  p_hid  USB 人体接口设备
+ * \param[out] p_stat 返回的统计
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_stat_get(struct usbh_hid *p_hid, struct usbh_hid_stat *p_stat);
+/**
+ * \brief 清除 USB 人体接口设备输入报告统计
+ *
+ * \param[in] p_hid USB 人体接口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_stat_clr(struct usbh_hid *p_hid);
+
 /**
  * \brief 初始化 USB 人体接口设备库
  *
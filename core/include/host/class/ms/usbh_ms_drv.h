@@ -16,6 +16,15 @@ extern "C" {
 #define UMS_LOCK_TIMEOUT             5000
 #endif
 
+/* \brief UAS 默认命令队列深度*/
+#define USBH_MS_UAS_QDEPTH_DEF       16
+/* \brief UAS 最大命令队列深度*/
+#define USBH_MS_UAS_QDEPTH_MAX       32
+/* \brief BBB 异步请求池大小*/
+#define USBH_MS_BBB_REQ_MAX          16
+/* \brief 单个读写命令最大传输字节数(主机限制)，更大的同步读写会拆分成多个命令*/
+#define USBH_MS_XFER_SIZE_MAX        (32 * 1024 * 1024)
+
 ///* \brief USB 大容量存储设备设备类型*/
 //#define USBH_MS_SC_RBC               0x01    /* flash 设备*/
 //#define USBH_MS_SC_8020              0x02    /* CD's DVD's*/
@@ -43,8 +52,10 @@ struct usbh_ms_lu {
     struct usbh_ms   *p_ms;                   /* 相关的大容量存储设备*/
     char              name[USB_NAME_LEN];     /* 逻辑单元名字*/
     uint8_t           lun_num;                /* 逻辑单元号*/
-    uint32_t          n_blks;                 /* 块数量*/
+    uint64_t          n_blks;                 /* 块数量*/
     uint32_t          blk_size;               /* 块大小*/
+    uint32_t          max_blks;               /* 单个读写命令最大块数量*/
+    usb_bool_t        is_rw16;                /* 是否使用 READ(16)/WRITE(16)*/
     usb_bool_t        is_wp;                  /* 是否有写保护*/
     void             *p_buf;                  /* 数据缓存*/
     uint32_t          buf_size;               /* 数据缓存大小*/
@@ -52,21 +63,133 @@ struct usbh_ms_lu {
     void             *p_usr_priv;             /* 用户私有数据*/
 };
 
+#if USB_OS_EN
+/* \brief USB 主机 UAS 命令*/
+struct usbh_ms_uas_cmd {
+    struct usbh_ms     *p_ms;               /* 相关的大容量存储设备*/
+    uint16_t            tag;                /* 命令标签*/
+    usb_bool_t          is_used;            /* 命令是否被占用*/
+    usb_bool_t          is_sense_done;      /* 是否已经收到感知/响应 IU*/
+    usb_bool_t          is_data_pend;       /* 数据传输请求包是否在传输中*/
+    usb_bool_t          is_abort;           /* 是否正在中止(不再提交数据传输)*/
+    usb_bool_t          is_quarantine;      /* 标签是否被隔离(中止失败，复位完成前不能再用)*/
+    uint8_t             dir;                /* 数据方向*/
+    uint8_t             sta;                /* SCSI 状态*/
+    int                 status;             /* 命令完成状态*/
+    uint32_t            act_len;            /* 实际数据长度*/
+    void               *p_data;             /* 数据缓存*/
+    uint32_t            data_len;           /* 数据长度*/
+    struct usbh_trp     trp_cmd;            /* 命令传输请求包*/
+    struct usbh_trp     trp_data;           /* 数据传输请求包*/
+    void               *p_cmd_iu;           /* 命令 IU 缓存*/
+    usb_sem_handle_t    p_done;             /* 命令完成信号量*/
+};
+
+/* \brief USB 主机 UAS 状态传输请求包，状态 IU 不一定属于提交它的命令，靠标签找到命令*/
+struct usbh_ms_uas_sta {
+    struct usbh_ms_uas *p_uas;              /* 所属 UAS 传输*/
+    struct usbh_trp     trp;                /* 状态传输请求包*/
+    void               *p_iu;               /* 状态 IU 缓存*/
+    usb_bool_t          is_pend;            /* 是否已提交*/
+};
+
+/* \brief USB 主机 UAS 传输*/
+struct usbh_ms_uas {
+    struct usbh_endpoint   *p_ep_cmd;       /* 命令端点*/
+    struct usbh_endpoint   *p_ep_sta;       /* 状态端点*/
+    struct usbh_endpoint   *p_ep_data_in;   /* 数据输入端点*/
+    struct usbh_endpoint   *p_ep_data_out;  /* 数据输出端点*/
+    uint8_t                 alt_num;        /* UAS 备用设置号*/
+    uint8_t                 qdepth;         /* 命令队列深度*/
+    uint8_t                 n_cmds;         /* 在传输的命令数量*/
+    usb_mutex_handle_t      p_lock;         /* 命令表互斥锁*/
+    usb_sem_handle_t        p_cmd_free;     /* 命令释放信号量*/
+    usb_bool_t              is_reset;       /* 是否正在复位*/
+    usb_mutex_handle_t      p_tmf_lock;     /* 任务管理互斥锁，同一时间只有一个任务管理功能*/
+    usb_sem_handle_t        p_tmf_done;     /* 任务管理响应信号量*/
+    void                   *p_tmf_iu;       /* 任务管理 IU 缓存*/
+    usb_bool_t              is_tmf_pend;    /* 是否在等待任务管理响应 IU*/
+    uint8_t                 tmf_resp;       /* 任务管理响应码*/
+    struct usbh_ms         *p_ms;           /* 相关的大容量存储设备*/
+    struct usbh_ms_uas_cmd  cmds[USBH_MS_UAS_QDEPTH_MAX];
+    struct usbh_ms_uas_sta  stas[USBH_MS_UAS_QDEPTH_MAX];
+};
+#endif
+
+/* \brief BBB 异步请求*/
+struct usbh_ms_bbb_req {
+    struct usbh_ms_lu    *p_lu;                     /* 逻辑单元*/
+    uint8_t               cmd[16];                  /* 命令*/
+    uint8_t               cmd_len;                  /* 命令长度*/
+    uint8_t               dir;                      /* 数据方向*/
+    void                 *p_data;                   /* 数据缓存*/
+    uint32_t              data_len;                 /* 数据长度*/
+    uint32_t              act_len;                  /* 实际数据长度*/
+    int                   status;                   /* 请求状态*/
+    void                (*p_fn_done)(void *p_arg, int ret); /* 完成回调函数*/
+    void                 *p_arg;                    /* 完成回调函数参数*/
+    struct usb_list_node  node;                     /* 请求节点*/
+};
+
+/* \brief BBB 命令槽，数据阶段结束后下一个命令的命令块包就可以排在这个命令的
+ *        命令状态包后面，所以最多两个命令同时在传输*/
+struct usbh_ms_bbb_slot {
+    struct usbh_ms         *p_ms;                   /* 相关的大容量存储设备*/
+    struct usbh_ms_bbb_req *p_req;                  /* 当前请求*/
+    uint8_t                 state;                  /* 命令槽状态*/
+    uint8_t                 n_trps;                 /* 在传输的请求包数量*/
+    uint32_t                tag;                    /* 命令块包标签*/
+    void                   *p_cbw;                  /* 命令块包*/
+    void                   *p_csw;                  /* 命令状态包*/
+    struct usbh_trp         trp_cbw;                /* 命令块包传输请求包*/
+    struct usbh_trp         trp_data;               /* 数据传输请求包*/
+    struct usbh_trp         trp_csw;                /* 命令状态包传输请求包*/
+};
+
+/* \brief BBB 异步传输引擎*/
+struct usbh_ms_bbb {
+#if USB_OS_EN
+    usb_mutex_handle_t       p_lock;                /* 引擎互斥锁(只保护状态，不跨传输持有)*/
+    usb_sem_handle_t         p_idle;                /* 引擎空闲信号量*/
+#endif
+    void                    *p_job;                 /* 错误恢复工作*/
+    usb_bool_t               is_recover;            /* 是否在错误恢复中*/
+    uint8_t                  n_sync;                /* 同步传输数量(不为 0 时引擎不启动新命令)*/
+    struct usb_list_head     req_free;              /* 空闲请求链表*/
+    struct usb_list_head     req_pend;              /* 等待传输的请求链表*/
+    struct usbh_ms_bbb_slot  slots[2];              /* 命令槽*/
+    struct usbh_ms_bbb_req   reqs[USBH_MS_BBB_REQ_MAX];
+};
+
 /* \brief 子类操作函数集*/
 struct usbh_ms_sclass {
     uint8_t     id;
     int       (*p_fn_init)(struct usbh_ms_lu *p_lun);
 
     int       (*p_fn_read)(struct usbh_ms_lu *p_lun,
-                           uint32_t           blk_num,
+                           uint64_t           blk_num,
                            uint32_t           n_blks,
                            void              *p_buf);
 
     int       (*p_fn_write)(struct usbh_ms_lu *p_lun,
-                            uint32_t           blk_num,
+                            uint64_t           blk_num,
                             uint32_t           n_blks,
                             void              *p_buf);
 
+    int       (*p_fn_read_async)(struct usbh_ms_lu *p_lun,
+                                 uint64_t           blk_num,
+                                 uint32_t           n_blks,
+                                 void              *p_buf,
+                                 void             (*p_fn_done)(void *p_arg, int ret),
+                                 void              *p_arg);
+
+    int       (*p_fn_write_async)(struct usbh_ms_lu *p_lun,
+                                  uint64_t           blk_num,
+                                  uint32_t           n_blks,
+                                  void              *p_buf,
+                                  void             (*p_fn_done)(void *p_arg, int ret),
+                                  void              *p_arg);
+
 };
 
 /* \brief USB 主机大容量存储设备*/
@@ -89,6 +212,10 @@ struct usbh_ms {
     usb_bool_t              is_removed;          /* 移除标志*/
     void                   *p_cbw;               /* 命令块包*/
     void                   *p_csw;               /* 命令状态包*/
+#if USB_OS_EN
+    struct usbh_ms_uas     *p_uas;               /* UAS 传输(为 NULL 则使用 BBB 传输)*/
+#endif
+    struct usbh_ms_bbb     *p_bbb;               /* BBB 异步传输引擎*/
 };
 
 ///**
@@ -171,13 +298,14 @@ int usbh_ms_close(struct usbh_ms *p_ms);
  *
  * \param[in] p_lun   逻辑单元结构体
  * \param[in] blk_num 起始块编号
- * \param[in] n_blks  块数量
+ * \param[in] n_blks  块数量(超过单个命令最大块数量时拆分成多个命令，总字节数不能超过
+ *                    INT_MAX，否则返回 -USB_ESIZE)
  * \param[in] p_buf   数据缓存(为 NULL 则用逻辑分区的缓存)
  *
  * \retval 成功返回实际读写成功的字节数
  */
 int usbh_ms_blk_write(struct usbh_ms_lu *p_lu,
-                      uint32_t           blk_num,
+                      uint64_t           blk_num,
                       uint32_t           n_blks,
                       void              *p_buf);
 /**
@@ -185,15 +313,54 @@ int usbh_ms_blk_write(struct usbh_ms_lu *p_lu,
  *
  * \param[in] p_lun   逻辑单元结构体
  * \param[in] blk_num 起始块编号
- * \param[in] n_blks  块数量
+ * \param[in] n_blks  块数量(超过单个命令最大块数量时拆分成多个命令，总字节数不能超过
+ *                    INT_MAX，否则返回 -USB_ESIZE)
  * \param[in] p_buf   数据缓存(为NULL则用逻辑分区的缓存)
  *
  * \retval 成功返回实际读写成功的字节数
  */
 int usbh_ms_blk_read(struct usbh_ms_lu *p_lu,
-                     uint32_t           blk_num,
+                     uint64_t           blk_num,
                      uint32_t           n_blks,
                      void              *p_buf);
+/**
+ * \brief USB 大容量存储设备异步块读函数，命令排队后马上返回，读完成后调用完成回调函数
+ *        (在传输完成回调的上下文中，回调函数里不能做同步传输)，只支持 BBB 传输
+ *
+ * \param[in] p_lu      逻辑单元结构体
+ * \param[in] blk_num   起始块编号
+ * \param[in] n_blks    块数量(不能超过单个命令最大块数量)
+ * \param[in] p_buf     数据缓存(请求完成前不能释放)
+ * \param[in] p_fn_done 完成回调函数，ret 成功为读到的字节数，失败为错误码
+ * \param[in] p_arg     完成回调函数参数
+ *
+ * \retval 成功排队返回 USB_OK，请求池满返回 -USB_EAGAIN
+ */
+int usbh_ms_blk_read_async(struct usbh_ms_lu *p_lu,
+                           uint64_t           blk_num,
+                           uint32_t           n_blks,
+                           void              *p_buf,
+                           void             (*p_fn_done)(void *p_arg, int ret),
+                           void              *p_arg);
+/**
+ * \brief USB 大容量存储设备异步块写函数，命令排队后马上返回，写完成后调用完成回调函数
+ *        (在传输完成回调的上下文中，回调函数里不能做同步传输)，只支持 BBB 传输
+ *
+ * \param[in] p_lu      逻辑单元结构体
+ * \param[in] blk_num   起始块编号
+ * \param[in] n_blks    块数量(不能超过单个命令最大块数量)
+ * \param[in] p_buf     数据缓存(请求完成前不能释放)
+ * \param[in] p_fn_done 完成回调函数，ret 成功为写入的字节数，失败为错误码
+ * \param[in] p_arg     完成回调函数参数
+ *
+ * \retval 成功排队返回 USB_OK，请求池满返回 -USB_EAGAIN
+ */
+int usbh_ms_blk_write_async(struct usbh_ms_lu *p_lu,
+                            uint64_t           blk_num,
+                            uint32_t           n_blks,
+                            void              *p_buf,
+                            void             (*p_fn_done)(void *p_arg, int ret),
+                            void              *p_arg);
 /**
  * \brief 获取 USB 大容量存储设备支持的最大逻辑单元数量
  *
@@ -322,6 +489,24 @@ int usbh_ms_lu_usrdata_set(struct usbh_ms_lu *p_lu, void *p_usr_priv);
  * \retval 成功返回 USB_OK
  */
 int usbh_ms_lu_usrdata_get(struct usbh_ms_lu *p_lu, void **p_usr_priv);
+/**
+ * \brief 设置 USB 大容量存储设备 UAS 命令队列深度，设备使用 BBB 传输时不支持
+ *
+ * \param[in] p_ms   USB 大容量存储设备结构体
+ * \param[in] qdepth 命令队列深度(1 ~ USBH_MS_UAS_QDEPTH_MAX)
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ms_uas_qdepth_set(struct usbh_ms *p_ms, uint8_t qdepth);
+/**
+ * \brief 获取 USB 大容量存储设备 UAS 命令队列深度
+ *
+ * \param[in]  p_ms     USB 大容量存储设备结构体
+ * \param[out] p_qdepth 返回的命令队列深度，BBB 传输返回 1
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ms_uas_qdepth_get(struct usbh_ms *p_ms, uint8_t *p_qdepth);
 /**
  * \brief 获取 USB 大容量存储设备逻辑单元块大小
  *
@@ -339,7 +524,16 @@ int usbh_ms_lu_blk_size_get(struct usbh_ms_lu *p_lu, uint32_t *p_blk_size);
  *
  * \retval 成功返回 USB_OK
  */
-int usbh_ms_lu_nblks_get(struct usbh_ms_lu *p_lu, uint32_t *p_nblk);
+int usbh_ms_lu_nblks_get(struct usbh_ms_lu *p_lu, uint64_t *p_nblk);
+/**
+ * \brief 获取 USB 大容量存储设备逻辑单元单个读写命令最大块数量
+ *
+ * \param[in]  p_lu       逻辑单元结构体
+ * \param[out] p_max_blks 返回的最大块数量
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ms_lu_max_blks_get(struct usbh_ms_lu *p_lu, uint32_t *p_max_blks);
 
 /**
  * \brief 获取当前存在的 USB 大容量存储设备数量
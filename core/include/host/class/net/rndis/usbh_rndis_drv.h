@@ -12,9 +12,16 @@ extern "C" {
 #define RNDIS_CONTROL_BUF_SIZE              1025
 /* \brief 控制传输之前轮询状态*/
 #define RNDIS_DRIVER_DATA_POLL_STATUS       1
+/* \brief 主机一次接收传输的最大大小，告诉设备可以把多个包放在一次传输里*/
+#define RNDIS_RX_TRANSFER_SIZE              16384
+/* \brief 主机一次发送传输的最大大小，设备支持的更大时用这个值*/
+#define RNDIS_TX_TRANSFER_SIZE              16384
+/* \brief 默认的发送积累超时时间(微秒)*/
+#define RNDIS_TX_TIMEOUT_DEF                400
 
 /* \brief RNDIS 消息定义*/
 #define RNDIS_MSG_COMPLETION                0x80000000
+#define RNDIS_MSG_PACKET                    0x00000001
 #define RNDIS_MSG_INIT                      0x00000002
 #define RNDIS_MSG_HALT                      0x00000003
 #define RNDIS_MSG_QUERY                     0x00000004
@@ -172,6 +179,16 @@ struct rndis_indicate {
     uint32_t message;
 } __attribute__ ((packed));
 
+/* \brief USB 主机 RNDIS 设备私有数据*/
+struct usbh_rndis_priv {
+    uint32_t            tx_max;          /* 一次发送传输的最大大小*/
+    uint32_t            tx_pkts_max;     /* 一次发送传输最多的包数量*/
+    uint32_t            tx_align;        /* 发送包对齐*/
+    uint8_t            *p_tx_buf;        /* 发送缓存*/
+    uint32_t            tx_len;          /* 发送缓存已使用的长度*/
+    uint32_t            tx_n_pkts;       /* 发送缓存已积累的包数量*/
+};
+
 /**
  * \brief USB 主机 RNDIS 设备探测函数
  *
@@ -18,6 +18,14 @@ extern "C" {
 #endif
 
 #define USB_NET_HWADDR_MAX_LEN             6
+/* \brief 接收完成队列最大长度(2 的幂)，同时限制接收传输请求包的数量*/
+#define USB_NET_RX_TRP_MAX                 64
+/* \brief 可以同时借给用户的接收帧数量*/
+#define USB_NET_RX_FRAME_MAX               64
+/* \brief 发送传输请求包池最大大小(2 的幂)，即同时在传输的最大发送请求包数量*/
+#define USB_NET_TX_TRP_MAX                 16
+/* \brief 停止发送时等待取消的发送请求包完成的超时时间(毫秒)*/
+#define USB_NET_TX_STOP_TIMEOUT            1000
 
 #define USB_NET_FRAMING_RN                 0x0008          /* RNDIS batches, plus huge header */
 #define USB_NET_NO_SETINTF                 0x0010          /* 设备不能设置接口*/
@@ -71,22 +79,28 @@ struct usbh_cdc_state {
 struct usbh_net_trp_hdr {
     struct usb_list_head trp_free;
     struct usb_list_head trp_start;
+    struct usb_list_head trp_lent;       /* 作为接收帧借给用户的请求包*/
     uint32_t             n_trp_start;
     uint32_t             n_trp_total;
 };
 
+struct usbh_net_trp;
+
+/* \brief USB 主机网络接收帧结构体 */
+struct usbh_net_rx_frame {
+    uint8_t             *p_data;         /* 帧数据，指向接收传输请求包的缓存*/
+    uint32_t             len;            /* 帧长度*/
+    struct usbh_net_trp *p_net_trp;      /* 所属的接收传输请求包*/
+    struct usb_list_node node;
+};
+
 /* \brief USB 主机网络传输请求包结构体 */
 struct usbh_net_trp {
     struct usbh_trp      trp;
     struct usb_list_node node;
-};
-
-/* \brief USB 主机网络接收缓存结构体 */
-struct usbh_net_rx_buf {
-    uint8_t  *p_buf;
-    uint32_t  buf_size;
-    uint32_t  data_pos;          /* 数据位置*/
-    uint32_t  rd_pos;            /* 已读位置*/
+    uint32_t             rx_pos[2];      /* 接收修正解析位置，由驱动使用*/
+    uint32_t             n_lent;         /* 借给用户的帧数量*/
+    usb_bool_t           is_parsed;      /* 是否已经解析完并移出接收完成队列*/
 };
 
 struct usbh_net;
@@ -120,8 +134,24 @@ struct usbh_net_drv_info {
     int                 (*p_fn_early_init)(struct usbh_net *p_net);
     void                (*p_fn_indication)(struct usbh_net *p_net, void *p_ind, uint32_t ind_len);
 
-    int                 (*p_fn_rx_fixup)(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len);
-    uint8_t            *(*p_fn_tx_fixup)(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len);
+    /* 接收修正，从一次接收传输中取出下一个帧，p_pos 是解析位置(初始为 0)，
+     * 成功返回 USB_OK，没有更多的帧返回 -USB_END */
+    int                 (*p_fn_rx_fixup)(struct usbh_net          *p_net,
+                                         uint8_t                  *p_buf,
+                                         uint32_t                  buf_len,
+                                         uint32_t                 *p_pos,
+                                         struct usbh_net_rx_frame *p_frame);
+    /* 发送修正，p_tx_len 返回非 0 时需要马上发送 p_tx_buf，
+     * 帧已经放入返回 USB_OK，帧需要在发送 p_tx_buf 后重新放入返回 -USB_EAGAIN */
+    int                 (*p_fn_tx_fixup)(struct usbh_net  *p_net,
+                                         uint8_t          *p_buf,
+                                         uint32_t          buf_len,
+                                         uint8_t         **p_tx_buf,
+                                         uint32_t         *p_tx_len);
+    /* 发送冲刷，结束当前积累的数据并取出待发送数据，积累超时由网络核心判断*/
+    int                 (*p_fn_tx_flush)(struct usbh_net  *p_net,
+                                         uint8_t         **p_tx_buf,
+                                         uint32_t         *p_tx_len);
 //#define FLAG_FRAMING_NC 0x0001      /* guard against device dropouts */
 //#define FLAG_FRAMING_GL 0x0002      /* genelink batches packets */
 //#define FLAG_FRAMING_Z  0x0004      /* zaurus adds a trailer */
@@ -153,6 +183,10 @@ struct usbh_net {
     struct usbh_interface          *p_intf;
     uint32_t                        dev_type;                /* 设备类型*/
     void                           *p_lock;
+#if USB_OS_EN
+    usb_mutex_handle_t              p_tx_lock;               /* 发送互斥锁*/
+#endif
+    void                           *p_drv_priv;              /* 驱动私有数据*/
     usb_bool_t                      is_removed;
     uint16_t                        hard_header_len;
     uint16_t                        rx_qlen, tx_qlen;        /* 发送/接收队列长度*/
@@ -167,12 +201,27 @@ struct usbh_net {
     uint32_t                        hard_mtu;                /* 硬件最大传输单元，计数任何额外的帧*/
     uint32_t                        xid;
     uint32_t                        trans_start;             /* 记录传输启动时间*/
-    struct usbh_net_rx_buf          rx_buf;
+    usb_bool_t                      is_started;              /* 是否已经启动*/
+    struct usb_ringbuf              rx_done_rb;              /* 接收完成队列*/
+    struct usbh_net_trp            *p_rx_done[USB_NET_RX_TRP_MAX]; /* 接收完成队列缓存*/
+    struct usbh_net_rx_frame        rx_frames[USB_NET_RX_FRAME_MAX]; /* 接收帧*/
+    struct usb_list_head            rx_frame_free;           /* 空闲的接收帧*/
+    struct usbh_net_rx_frame       *p_rx_frame_pend;         /* 读缓存不够时保留的帧*/
     struct usbh_endpoint           *p_ep_in;
     struct usbh_endpoint           *p_ep_out;
     struct usbh_endpoint           *p_ep_status;             /* 状态端点*/
     struct usbh_trp                 trp_int;                 /* 中断传输请求包*/
-    struct usbh_trp                 trp_tx;
+    uint32_t                        tx_trp_size;             /* 发送传输请求包缓存大小*/
+    struct usbh_net_trp_hdr         tx_trp_hdr;              /* 发送传输请求包池*/
+    usb_bool_t                      is_tx_run;               /* 发送是否已经启动*/
+    struct usb_ringbuf              tx_done_rb;              /* 发送完成队列*/
+    struct usbh_net_trp            *p_tx_done[USB_NET_TX_TRP_MAX]; /* 发送完成队列缓存*/
+    usb_bool_t                      is_tx_full;              /* 发送窗口已满，等待发送就绪通知*/
+    uint32_t                        tx_timeout;              /* 发送积累超时时间(微秒)，0 为不积累*/
+    usb_bool_t                      is_tx_pend;              /* 驱动中有积累的待发送数据*/
+    struct usb_timespec             tx_first_ts;             /* 积累的第一个帧放入的时间*/
+    void                          (*p_fn_tx_ready)(void *p_arg); /* 发送就绪回调函数*/
+    void                           *p_tx_ready_arg;          /* 发送就绪回调函数参数*/
     unsigned long                   data[5];
     struct usb_timespec             trans_start_ts;
     struct usbh_net_trp_hdr         rx_trp_hdr;
@@ -300,23 +349,76 @@ int usbh_net_stop(struct usbh_net *p_net);
  * \param[in] p_buf   写缓存
  * \param[in] buf_len 写缓存长度
  *
- * \retval 成功返回实际写的长度
+ * \retval 成功返回实际写的长度(帧已经拷贝，写缓存可以马上重用)，发送窗口已满返回
+ *         -USB_EAGAIN，有发送请求包完成后调用发送就绪回调函数
  */
 int usbh_net_write(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len);
 /**
- * \brief USB 主机网络设备读函数
+ * \brief USB 主机网络设备设置发送就绪回调函数，usbh_net_write() 返回 -USB_EAGAIN 后，
+ *        有发送请求包完成时调用(在传输完成回调的上下文中)
+ *
+ * \param[in] p_net         USB 主机网络设备
+ * \param[in] p_fn_tx_ready 发送就绪回调函数
+ * \param[in] p_arg         回调函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_tx_ready_cb_set(struct usbh_net *p_net,
+                             void           (*p_fn_tx_ready)(void *p_arg),
+                             void            *p_arg);
+/**
+ * \brief USB 主机网络设备设置发送积累超时时间，只对积累多个帧的驱动(NCM/RNDIS)有效
+ *
+ * \param[in] p_net      USB 主机网络设备
+ * \param[in] timeout_us 超时时间(微秒)，0 为不积累，每个帧单独发送
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_tx_timeout_set(struct usbh_net *p_net, uint32_t timeout_us);
+/**
+ * \brief USB 主机网络设备获取发送积累超时时间
+ *
+ * \param[in]  p_net        USB 主机网络设备
+ * \param[out] p_timeout_us 返回的超时时间(微秒)
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_tx_timeout_get(struct usbh_net *p_net, uint32_t *p_timeout_us);
+/**
+ * \brief USB 主机网络设备读函数，每次读一个完整的帧
  *
  * \param[in] p_net   USB 主机网络设备
  * \param[in] p_buf   读缓存
  * \param[in] buf_len 读缓存长度
  *
- * \retval 成功返回读到的长度
+ * \retval 成功返回读到的帧长度，没有帧返回 0，读缓存小于帧长度返回 -USB_ESIZE(帧保留在队列中)
  */
 int usbh_net_read(struct usbh_net *p_net,
                   uint8_t         *p_buf,
                   uint32_t         buf_len);
 /**
- * \brief USB 主机网络设备接收缓存大小获取
+ * \brief USB 主机网络设备获取一个接收帧，不拷贝数据，用完后必须调用
+ *        usbh_net_rx_frame_put() 归还
+ *
+ * \param[in]  p_net   USB 主机网络设备
+ * \param[out] p_frame 返回的接收帧
+ *
+ * \retval 成功返回 USB_OK，没有接收帧返回 -USB_EAGAIN
+ */
+int usbh_net_rx_frame_get(struct usbh_net           *p_net,
+                          struct usbh_net_rx_frame **p_frame);
+/**
+ * \brief USB 主机网络设备归还接收帧，帧缓存重新用于接收
+ *
+ * \param[in] p_net   USB 主机网络设备
+ * \param[in] p_frame 要归还的接收帧
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_rx_frame_put(struct usbh_net          *p_net,
+                          struct usbh_net_rx_frame *p_frame);
+/**
+ * \brief USB 主机网络设备接收缓存大小获取，即每个接收帧缓存的大小
  *
  * \param[in]  p_net  USB 主机网络设备
  * \param[out] p_size 返回的缓存大小
@@ -325,7 +427,8 @@ int usbh_net_read(struct usbh_net *p_net,
  */
 int usbh_net_rx_buf_size_get(struct usbh_net *p_net, uint32_t *p_size);
 /**
- * \brief USB 主机网络设备接收缓存大小获取
+ * \brief USB 主机网络设备接收缓存大小设置，即每个接收帧缓存的大小，
+ *        只能在设备停止时设置，且不能小于硬件最大传输单元
  *
  * \param[in] p_net USB 主机网络设备
  * \param[in] size  要设置的缓存大小
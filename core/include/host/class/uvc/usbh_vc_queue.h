@@ -11,6 +11,10 @@ extern "C" {
 
 /* \brief 每个 USB 请求包的最大包数量*/
 #define UVC_MAX_PACKETS              32
+/* \brief 批量端点每个 USB 请求包的最大包数量，一个负载可以跨多个请求包*/
+#define UVC_MAX_BULK_PACKETS         256
+/* \brief 批量端点同时提交的 USB 请求包的最少数量*/
+#define UVC_BULK_TRP_NUM             8
 
 #define UVC_QUEUE_DISCONNECTED      (1 << 0)
 #define UVC_QUEUE_DROP_CORRUPTED    (1 << 1)
@@ -35,6 +39,7 @@ struct uvc_timeval {
 struct usbh_vc_queue {
 #if USB_OS_EN
     usb_mutex_handle_t   p_lock;       /* 保护队列*/
+    usb_sem_handle_t     p_done_sem;   /* 已完成帧信号量，每完成一帧释放一次*/
 #endif
     usb_bool_t           is_used;      /* 是否被使用*/
 
@@ -42,7 +47,10 @@ struct usbh_vc_queue {
     uint32_t             n_bufs_used;  /* 缓存使用的个数*/
 
     uint32_t             n_bufs_total; /* 被分配/使用的缓存的数量*/
-    struct usb_list_head irqqueue;     /* 中断队列链表*/
+    struct usb_list_head irqqueue;     /* 中断队列链表，驱动可填充的缓存*/
+    struct usb_list_head done_list;    /* 已完成帧链表，等待用户取出*/
+    struct usb_list_head user_list;    /* 用户持有的缓存链表*/
+    uint32_t             n_dropped;    /* 丢弃的帧数量*/
 };
 
 /* \brief USB 视频类缓存结构体 */
@@ -56,11 +64,22 @@ struct usbh_vc_buffer {
     void                *p_mem;       /* 缓存指针*/
     uint32_t             length;      /* 缓存长度*/
     uint32_t             bytes_used;  /* 缓存已填充字节数*/
-    uint8_t              is_used;     /* 是否被使用标志*/
+    uint8_t              is_used;     /* 是否被用户持有标志*/
+    uint32_t             sequence;    /* 帧序列号*/
 
     uint32_t             pts;
 };
 
+/* \brief USB 视频类帧结构体，出队时由驱动填充，用完后原样入队交还驱动*/
+struct usbh_vc_frame {
+    void                *p_mem;       /* 帧数据(直接指向驱动缓存，不做拷贝)*/
+    uint32_t             bytes_used;  /* 帧数据长度*/
+    uint32_t             sequence;    /* 帧序列号，不连续表示中间有帧丢失*/
+    uint32_t             n_dropped;   /* 数据流启动以来丢弃的帧数量*/
+    struct uvc_timeval   timeval;     /* 时间戳*/
+    void                *p_priv;      /* 驱动私有数据(缓存句柄)*/
+};
+
 /**
  * \brief 获取可用的缓存队列
  *
@@ -93,6 +112,38 @@ int usbh_vc_queue_buf_alloc(struct usbh_vc_queue *p_queue,
  * \retval 成功返回 UBS_OK
  */
 int usbh_vc_queue_buf_free(struct usbh_vc_queue *p_queue);
+/**
+ * \brief USB 视频类队列取出一个已完成的缓存
+ *
+ * \param[in]  p_queue USB 视频类设备缓存队列
+ * \param[out] p_buf   返回取出的缓存
+ * \param[in]  timeout 等待超时时间(毫秒)，USB_NO_WAIT 不等待，USB_WAIT_FOREVER 一直等待
+ *
+ * \retval 成功返回 USB_OK，没有已完成的缓存返回 -USB_EAGAIN，等待超时返回 -USB_ETIME
+ */
+int usbh_vc_queue_buf_dequeue(struct usbh_vc_queue   *p_queue,
+                              struct usbh_vc_buffer **p_buf,
+                              int                     timeout);
+/**
+ * \brief USB 视频类队列交还用户持有的缓存
+ *
+ * \param[in] p_queue USB 视频类设备缓存队列
+ * \param[in] p_buf   要交还的缓存
+ *
+ * \retval 成功返回 USB_OK，缓存不是这个队列里用户持有的缓存返回 -USB_EILLEGAL
+ */
+int usbh_vc_queue_buf_queue(struct usbh_vc_queue  *p_queue,
+                            struct usbh_vc_buffer *p_buf);
+/**
+ * \brief USB 视频类队列根据数据地址查找用户持有的缓存
+ *
+ * \param[in] p_queue USB 视频类设备缓存队列
+ * \param[in] p_mem   缓存数据地址
+ *
+ * \retval 成功返回找到的缓存，失败返回 NULL
+ */
+struct usbh_vc_buffer *usbh_vc_queue_user_buf_find(struct usbh_vc_queue *p_queue,
+                                                   void                 *p_mem);
 /**
  * \brief 创建 USB 视频类驱动缓存队列
  *
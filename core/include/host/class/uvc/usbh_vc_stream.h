@@ -424,7 +424,6 @@ struct usbh_vc_stream {
     uint8_t                       opt_status;         /* 操作状态*/
     uint8_t                       open_cnt;           /* 打开次数*/
     void                         *p_queue;            /* 缓存队列*/
-    void                         *p_buf_tmp;          /* 临时缓存*/
 
     /* 编码回调函数*/
     void (*p_fn_decode) (struct usbh_trp       *p_trp,
@@ -624,6 +623,32 @@ int usbh_vc_stream_video_get(struct usbh_vc_stream *p_stream,
  * \retval 成功返回 USB_OK
  */
 int usbh_vc_stream_video_put(struct usbh_vc_stream *p_stream, void* p_buf);
+/**
+ * \brief USB 视频类设备数据流取出一帧视频
+ *
+ *        帧数据直接指向驱动缓存，不做拷贝。用户可以同时持有多帧，用完后必须调用
+ *        usbh_vc_stream_frame_queue 交还，否则驱动没有缓存可填充，后续帧会被丢弃并计入
+ *        丢帧数量。停止数据流后，所有用户持有的帧都失效。
+ *
+ * \param[in]  p_stream USB 视频类数据流
+ * \param[out] p_frame  返回的视频帧
+ * \param[in]  timeout  等待超时时间(毫秒)，USB_NO_WAIT 不等待，USB_WAIT_FOREVER 一直等待
+ *
+ * \retval 成功返回 USB_OK，没有帧返回 -USB_EAGAIN，等待超时返回 -USB_ETIME
+ */
+int usbh_vc_stream_frame_dequeue(struct usbh_vc_stream *p_stream,
+                                 struct usbh_vc_frame  *p_frame,
+                                 int                    timeout);
+/**
+ * \brief USB 视频类设备数据流交还一帧视频
+ *
+ * \param[in] p_stream USB 视频类数据流
+ * \param[in] p_frame  之前通过 usbh_vc_stream_frame_dequeue 取出的视频帧
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_vc_stream_frame_queue(struct usbh_vc_stream *p_stream,
+                               struct usbh_vc_frame  *p_frame);
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus  */
@@ -50,6 +50,16 @@ extern "C" {
 /* \brief 端点每一微帧产生一个事务*/
 #define USBH_EHCI_TUNE_MULT_TT     1
 
+/* \brief 中断阈值(微帧)，USBCMD 只接受 1/2/4/8/16/32/64 */
+#define USBH_EHCI_ITC_MIN          1
+#define USBH_EHCI_ITC_MAX          64
+/* \brief 自适应中断阈值统计窗口(毫秒) */
+#define USBH_EHCI_ITC_WINDOW_MS    1000
+/* \brief 自适应模式下，每秒完成的请求包数超过这个值认为是持续批量负载，提高中断阈值 */
+#define USBH_EHCI_ITC_LOAD_HIGH    2000
+/* \brief 自适应模式下，每秒完成的请求包数低于这个值认为是轻负载，降低中断阈值 */
+#define USBH_EHCI_ITC_LOAD_LOW     500
+
 /* \brief 获取下一个数据结构的类型 */
 #define Q_NEXT_TYPE(data)   ((data) & USB_CPU_TO_LE32(3 << 1))
 
@@ -65,6 +75,17 @@ struct usbh_ehci_mem_cfg {
     uint32_t     nsitds;     /* SITD 数量*/
 };
 
+/* \brief EHCI 中断统计信息*/
+struct usbh_ehci_irq_stat {
+    uint32_t     itc;            /* 当前中断阈值(微帧)*/
+    usb_bool_t   is_adaptive;    /* 是否是自适应模式*/
+    uint32_t     irq_per_sec;    /* 上一个统计窗口每秒中断次数*/
+    uint32_t     done_per_sec;   /* 上一个统计窗口每秒完成的请求包数*/
+    uint32_t     done_per_irq;   /* 上一个统计窗口平均每次中断完成的请求包数*/
+    uint32_t     irq_total;      /* 总中断次数*/
+    uint32_t     done_total;     /* 总完成的请求包数*/
+};
+
 /* \brief EHCI 事务转换器*/
 struct usbh_ehci_tt {
 
@@ -109,10 +130,22 @@ struct usbh_ehci {
     uint32_t                   *p_periodic;            /* 周期帧列表，用来存放数据结构的地址*/
     union usbh_ehci_struct_ptr *p_shadow;              /* 硬件周期表镜像，用来存放周期帧列表中地址对应的数据结构*/
     uint32_t                    frame_list_size;       /* 帧列表大小*/
-    uint8_t                     BdWidth[USBH_EHCI_BANDWIDTH_SIZE];   /* 总线带宽*/
+    uint16_t                   *p_bw_table;            /* 每个微帧已分配的周期带宽(微秒)，大小为帧列表大小 * 8*/
     int                         random;
 
+    uint32_t                    itc;                   /* 当前中断阈值(微帧)*/
+    usb_bool_t                  itc_adaptive;          /* 是否自适应调整中断阈值*/
+    uint32_t                    itc_min;               /* 自适应模式下的最小中断阈值*/
+    uint32_t                    itc_max;               /* 自适应模式下的最大中断阈值*/
+    struct usb_timespec         itc_ts;                /* 当前统计窗口起始时间戳*/
+    uint32_t                    irq_cnt;               /* 当前统计窗口的中断次数*/
+    uint32_t                    done_cnt;              /* 当前统计窗口完成的请求包数*/
+    struct usbh_ehci_irq_stat   irq_stat;              /* 中断统计信息*/
+
     struct usb_list_head        intr_qh_list;          /* 中断 QH */
+    struct usb_list_head        async_active_list;     /* 有未完成 qTD 的异步 QH 集合，异步扫描只访问这些 QH*/
+    struct usb_list_head        intr_active_list;      /* 有未完成 qTD 的中断 QH 集合，中断扫描只访问这些 QH*/
+    struct usb_list_head        trp_batch_list;        /* 一次扫描中完成的请求包，受 EHCI 互斥锁保护*/
     struct usb_list_head        trp_done_list;         /* 完成的请求包列表*/
 #if USB_OS_EN
     usb_mutex_handle_t          p_trp_done_lock;
@@ -162,6 +195,38 @@ int usbh_ehci_create(struct usb_hc           *p_hc,
  * \retval 成功返回 USB_OK
  */
 int usbh_ehci_destory(struct usb_hc *p_hc, struct usbh_ehci *p_ehci);
+/**
+ * \brief 设置 EHCI 中断阈值，会关闭自适应模式
+ *
+ * \param[in] p_ehci EHCI 结构体
+ * \param[in] itc    中断阈值(1~64 微帧)，不是 2 的幂时向下取整
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ehci_itc_set(struct usbh_ehci *p_ehci, uint32_t itc);
+/**
+ * \brief 设置 EHCI 中断阈值自适应模式
+ *
+ * \param[in] p_ehci  EHCI 结构体
+ * \param[in] is_en   是否使能
+ * \param[in] itc_min 最小中断阈值(1~64 微帧)，有周期传输时使用
+ * \param[in] itc_max 最大中断阈值(1~64 微帧)，持续批量负载时的上限
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ehci_itc_adaptive_set(struct usbh_ehci *p_ehci,
+                               usb_bool_t        is_en,
+                               uint32_t          itc_min,
+                               uint32_t          itc_max);
+/**
+ * \brief 获取 EHCI 中断统计信息
+ *
+ * \param[in]  p_ehci EHCI 结构体
+ * \param[out] p_stat 返回的中断统计信息
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ehci_irq_stat_get(struct usbh_ehci *p_ehci, struct usbh_ehci_irq_stat *p_stat);
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus  */
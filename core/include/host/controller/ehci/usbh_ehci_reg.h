@@ -54,6 +54,8 @@
 #define __CAP_HCC_64BIT_ADDR(p)               ((p) & (1))           /* 是否可以使用64位地址*/
 
 /* \brief 命令操作寄存器位操作*/
+#define __REG_CMD_ITC_MASK    (0xFF << 16)          /* 中断阈值控制，位 23:16*/
+#define __REG_CMD_ITC(x)      (((x) & 0xFF) << 16)  /* 中断阈值(微帧)*/
 #define __REG_CMD_PPCEE       (1 << 15)             /* 每一个端口变化事件使能*/
 #define __REG_CMD_PARK        (1 << 11)             /* enable "park" on async qh */
 #define __REG_CMD_PARK_CNT(c) (((c) >> 8) & 3)      /* how many transfers to park for */
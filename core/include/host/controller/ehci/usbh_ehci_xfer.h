@@ -136,6 +136,8 @@ struct usbh_ehci_qh {
     uint8_t                     usecs;          /* 中断端点带宽*/
     uint8_t                     c_usecs;        /* 分割完成带宽*/
     struct usb_list_node        intr_node;      /* 中断包节点*/
+    struct usb_list_node        active_node;    /* 活跃 QH 节点*/
+    usb_bool_t                  is_active;      /* 是否在活跃 QH 集合中(有未完成的 qTD)*/
 
 };
 
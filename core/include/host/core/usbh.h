@@ -28,6 +28,8 @@ extern "C" {
 #define USBH_LIB_MUTEX_TIMEOUT 5000
 /* \brief USB 主机互斥锁超时时间*/
 #define USB_HC_MUTEX_TIMEOUT   5000
+/* \brief USB 主机默认地址(地址 0)互斥锁超时时间，需要覆盖多次端口复位和描述符获取*/
+#define USB_HC_ADDR0_TIMEOUT   20000
 #endif
 
 struct usb_hc;
@@ -69,6 +71,9 @@ struct usbh_hub_basic {
     struct usbh_device  **p_ports;    /* 集线器端口设备*/
     uint8_t              *p_port_sta; /* 端口状态*/
     uint8_t               hub_status; /* 集线器状态*/
+    uint32_t              enum_map;   /* 正在后台枚举的端口位图*/
+    uint32_t              cancel_map; /* 枚举过程中断开的端口位图*/
+    uint32_t              remove_map; /* 枚举取消后等待集线器线程移除设备的端口位图*/
     /* 集线器处理函数*/
     int (*p_fn_hub_handle)(struct usbh_hub_basic *p_hub_basic,
                            struct usbh_hub_evt   *p_hub_evt);
@@ -116,6 +121,10 @@ struct usb_hc_drv {
     /* 请求传输*/
     int (*p_fn_xfer_request)(struct usb_hc   *p_hc,
                              struct usbh_trp *p_trp);
+    /* 批量请求传输(可选)，同一个端点的多个传输请求包，返回已提交的数量*/
+    int (*p_fn_xfer_request_batch)(struct usb_hc    *p_hc,
+                                   struct usbh_trp **p_trps,
+                                   int               n_trps);
     /* 取消传输*/
     int (*p_fn_xfer_cancel)(struct usb_hc   *p_hc,
                             struct usbh_trp *p_trp);
@@ -131,6 +140,8 @@ struct usb_hc_drv {
     /* 获取控制器数据结构体使用情况*/
     int (*p_fn_controller_mem_get)(struct usb_hc *p_hc);
 #endif
+    /* 控制器驱动内部对传输请求/取消加锁，核心层提交时不再持有主机锁*/
+    usb_bool_t is_xfer_locked;
 };
 
 /* \brief USB主机控制器结构体头 */
@@ -149,6 +160,7 @@ struct usb_hc {
     uint8_t               speed;         /* 集线器速度*/
 #if USB_OS_EN
     usb_mutex_handle_t    p_lock;        /* 互斥锁，只用于OS模式*/
+    usb_mutex_handle_t    p_addr0_lock;  /* 默认地址互斥锁，同一时间只允许一个设备处于地址 0 */
 #endif
     struct usb_list_node  node;          /* 当前主机节点*/
     void                 *p_controller;  /* 主机控制器*/
@@ -26,6 +26,36 @@ extern "C" {
 #define USBH_DEV_MUTEX_TIMEOUT 5000
 #endif
 
+/* \brief 同步传输完成对象池保留的最大空闲数量*/
+#define USBH_TRP_SYNC_POOL_MAX 16
+
+/* \brief 描述符缓存条目数量，按最近最少使用淘汰*/
+#define USBH_DEV_DESC_CACHE_MAX   4
+/* \brief 端口路径最大深度(根集线器端口 + 5 级集线器)*/
+#define USBH_DEV_PORT_PATH_MAX    6
+
+/* \brief 默认枚举延时(毫秒)*/
+#define USBH_DEV_RESET_DELAY      100     /* 端口复位后到第一次访问设备*/
+#define USBH_DEV_ADDR_DELAY       10      /* 设置地址后*/
+#define USBH_DEV_RETRY_DELAY      100     /* 枚举失败重试*/
+/* \brief 描述符缓存命中的已知设备的枚举延时(毫秒)，USB2.0 规范 TRSTRCY 10ms，TSETADDR 2ms*/
+#define USBH_DEV_RESET_DELAY_FAST 10
+#define USBH_DEV_ADDR_DELAY_FAST  2
+
+/* \brief 后台枚举工作数量，不支持工作或工作都忙时在集线器事件线程中同步枚举*/
+#define USBH_DEV_ENUM_JOB_MAX     4
+/* \brief 等待后台枚举结束超时时间(毫秒)*/
+#define USBH_DEV_ENUM_WAIT_TIMEOUT 30000
+
+/* \brief 设备兼容标志*/
+#define USBH_DEV_QUIRK_DELAY      (1 << 0)   /* 使用兼容表中的枚举延时*/
+#define USBH_DEV_QUIRK_NO_CACHE   (1 << 1)   /* 不缓存描述符，每次都完整枚举*/
+
+/* \brief 设备字符串类型*/
+#define USBH_DEV_STR_MFT          0          /* 制造商*/
+#define USBH_DEV_STR_PDT          1          /* 产品*/
+#define USBH_DEV_STR_SNUM         2          /* 序列号*/
+
 /* \brief USB设备最大配置数量*/
 #define USBH_CONFIG_MAX       5
 /* \brief USB设备最大接口数量*/
@@ -81,7 +111,7 @@ extern "C" {
 /* \brief 获取设备地址*/
 #define USBH_DEV_ADDR_GET(p_fun)           ((p_fun)->p_usb_dev->addr)
 /* \brief 获取设备产商描述字符串*/
-#define USBH_DEV_PDTSTR_GET(p_fun)         ((p_fun)->p_usb_dev->p_pdt)
+#define USBH_DEV_PDTSTR_GET(p_fun)         (usbh_dev_str_get((p_fun)->p_usb_dev, USBH_DEV_STR_PDT))
 /* \brief 获取设备速度*/
 #define USBH_DEV_SPEED_GET(p_fun)          ((p_fun)->p_usb_dev->speed)
 
@@ -162,6 +192,48 @@ struct usb_dev_match_info {
     uint8_t  intf_protocol;
 };
 
+/* \brief USB 主机同步传输完成对象，每次同步传输独立使用*/
+struct usbh_trp_sync {
+    struct usb_ctrlreq    ctrl;            /* SETUP 包*/
+#if USB_OS_EN
+    usb_sem_handle_t      p_sem;           /* 完成信号量*/
+#endif
+    struct usb_list_node  node;            /* 节点*/
+};
+
+/* \brief USB 设备兼容表项*/
+struct usbh_dev_quirk {
+    uint16_t  vid;                   /* 设备 VID */
+    uint16_t  pid;                   /* 设备 PID */
+    uint32_t  flags;                 /* 兼容标志*/
+    uint16_t  reset_delay;           /* 端口复位后延时(毫秒)*/
+    uint16_t  addr_delay;            /* 设置地址后延时(毫秒)*/
+    uint16_t  retry_delay;           /* 枚举失败重试延时(毫秒)*/
+};
+
+/* \brief USB 设备描述符缓存条目，以端口路径和设备描述符为键*/
+struct usbh_dev_desc_cache {
+    usb_bool_t              is_valid;                         /* 是否有效*/
+    uint8_t                 host_idx;                         /* USB 主机索引*/
+    uint8_t                 path[USBH_DEV_PORT_PATH_MAX];     /* 端口路径，从设备所在端口到根集线器*/
+    uint8_t                 depth;                            /* 端口路径深度*/
+    struct usb_device_desc  dev_desc;                         /* 设备描述符*/
+    uint8_t                *p_cfg_desc;                       /* 完整的配置描述符*/
+    uint16_t                cfg_len;                          /* 配置描述符总长度*/
+    uint16_t                lang_id;                          /* 语言ID*/
+    char                   *p_mft;                            /* 设备制造商*/
+    char                   *p_pdt;                            /* 设备产商*/
+    uint32_t                lru;                              /* 最近一次使用的序号*/
+};
+
+/* \brief USB 设备后台枚举工作*/
+struct usbh_dev_enum_job {
+    void                  *p_job;       /* 工作句柄*/
+    struct usbh_hub_basic *p_hub_basic; /* 所在集线器*/
+    uint8_t                port_num;    /* 集线器端口号*/
+    usb_bool_t             is_busy;     /* 是否正在使用*/
+};
+
 /* \brief USB 主机设备库结构体*/
 struct usbh_dev_lib {
     struct usb_list_head  dev_list;        /* 设备链表*/
@@ -169,7 +241,10 @@ struct usbh_dev_lib {
     usb_mutex_handle_t    p_lock;          /* 互斥锁*/
     usb_mutex_handle_t    p_monitor_lock;  /* 监控器互斥锁*/
     usb_sem_handle_t      p_hub_evt_sem;   /* 集线器事件信号量*/
+    usb_mutex_handle_t    p_sync_lock;     /* 同步传输完成对象池互斥锁*/
 #endif
+    struct usb_list_head  sync_free;       /* 空闲的同步传输完成对象链表*/
+    uint8_t               n_sync_free;     /* 空闲的同步传输完成对象数量*/
     usb_bool_t            is_lib_init;     /* 是否初始化库*/
     usb_bool_t            is_lib_deiniting;/* 是否移除库*/
     struct usb_list_head  monitor_list;    /* 监控器链表*/
@@ -177,6 +252,11 @@ struct usbh_dev_lib {
     uint8_t               n_dev;           /* 当前存在设备的数量*/
     int                   ref_cnt;         /* 引用计数*/
     int                   xfer_time_out;   /* 设备传输超时时间*/
+    uint32_t              desc_cache_lru;  /* 描述符缓存使用序号*/
+    int                   n_quirks;        /* 设备兼容表项数量*/
+    const struct usbh_dev_quirk *p_quirks; /* 设备兼容表*/
+    struct usbh_dev_desc_cache   desc_cache[USBH_DEV_DESC_CACHE_MAX]; /* 描述符缓存*/
+    struct usbh_dev_enum_job     enum_jobs[USBH_DEV_ENUM_JOB_MAX];    /* 后台枚举工作*/
 };
 
 /* \brief USB 集线器事件结构体*/
@@ -207,6 +287,13 @@ struct usb_iso_pkt_desc {
     int       status;     /* 状态*/
 };
 
+/* \brief USB 传输请求包分散/聚集段*/
+struct usbh_trp_sg {
+    void     *p_buf;      /* 段数据缓存*/
+    size_t    len;        /* 段长度*/
+    void     *p_dma;      /* 段映射的DMA内存*/
+};
+
 /* \brief USB 传输请求包*/
 struct usbh_trp {
     struct usbh_endpoint    *p_ep;                    /* 传输请求包相关端点*/
@@ -227,6 +314,8 @@ struct usbh_trp {
     int                      start_frame;             /* 等时起始帧*/
     int                      n_iso_packets;           /* (输入)同步包的数量(add by CYX at 9/17-2019)*/
     struct usb_iso_pkt_desc *p_iso_frame_desc;        /* 等时包描述符(add by CYX at 9/17-2019)*/
+    struct usbh_trp_sg      *p_sg;                    /* 分散/聚集段数组，不为空时 p_data 必须为空，len 为所有段的总长度*/
+    int                      n_sg;                    /* 分散/聚集段数量*/
     struct usb_list_node     node;                    /* 当前USB传输请求包的节点*/
 };
 
@@ -242,6 +331,9 @@ struct usbh_endpoint {
     void                     *p_hw_priv;  /* 端点私有数据域*/
     int                       extra_len;  /* 额外的描述符的长度*/
     uint8_t                  *p_extra;    /* 额外的描述符(例如，特定类描述符或特定产商描述符) */
+#if USB_OS_EN
+    usb_mutex_handle_t        p_lock;     /* 端点提交锁，保护端点使能和传输提交/取消*/
+#endif
 };
 
 /* \brief USB 接口结构体*/
@@ -268,7 +360,6 @@ struct usbh_device {
     struct usb_hc                  *p_hc;        /* USB主机结构体*/
     struct usbh_hub_basic          *p_hub_basic; /* 所属集线器*/
     uint8_t                         port;        /* 所属集线器端口号*/
-    struct usb_ctrlreq             *p_ctrl;      /* 控制请求(SETUP)*/
     char                            name[32];    /* 设备名字*/
     uint8_t                         addr;        /* 设备地址*/
     uint8_t                         status;      /* 设备状态*/
@@ -290,6 +381,10 @@ struct usbh_device {
     char                           *p_snum;      /* 设备序列号*/
     uint16_t                        lang_id;     /* 语言ID*/
     uint32_t                        quirks;      /* 设备兼容*/
+    uint16_t                        reset_delay; /* 端口复位后延时(毫秒)*/
+    uint16_t                        addr_delay;  /* 设置地址后延时(毫秒)*/
+    uint16_t                        retry_delay; /* 枚举失败重试延时(毫秒)*/
+    usb_bool_t                      is_cached;   /* 是否由描述符缓存快速枚举*/
     uint32_t                        dev_type;    /* 设备类型*/
     struct usbh_tt                 *p_tt;        /* 事务转换器(低/全速设备接到高速集线器)*/
     int                             tt_port;     /* 设备在事物转换器集线器的端口号*/
@@ -382,6 +477,15 @@ int usbh_func_drvdata_get(struct usbh_function *p_usb_fun, void **p_drv_data);
  * \retval 成功返回 USB_OK
  */
 int usbh_trp_submit(struct usbh_trp *p_trp);
+/**
+ * \brief USB 主机批量提交传输请求包
+ *
+ * \param[in] p_trps 要提交的传输请求包数组(必须属于同一个端点)
+ * \param[in] n_trps 传输请求包数量
+ *
+ * \retval 成功返回已提交的传输请求包数量，一个都没有提交返回错误码
+ */
+int usbh_trp_submit_batch(struct usbh_trp **p_trps, int n_trps);
 /**
  * \brief USB 主机传输请求包取消
  *
@@ -534,6 +638,28 @@ int usbh_dev_string_get(struct usbh_device *p_usb_dev,
  * \brief USB 主机设备字符串释放
  */
 void usbh_dev_string_put(char *p_string);
+/**
+ * \brief 获取 USB 主机设备的制造商/产品/序列号字符串，第一次使用时才从设备读取
+ *
+ * \param[in] p_usb_dev USB 主机设备
+ * \param[in] type      字符串类型(USBH_DEV_STR_MFT/USBH_DEV_STR_PDT/USBH_DEV_STR_SNUM)
+ *
+ * \retval 成功返回字符串，设备没有这个字符串或者读取失败返回 NULL
+ */
+char *usbh_dev_str_get(struct usbh_device *p_usb_dev, uint8_t type);
+/**
+ * \brief 设置 USB 主机设备兼容表
+ *
+ * \param[in] p_quirks 设备兼容表，调用者保证在使用期间有效
+ * \param[in] n_quirks 设备兼容表项数量
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_dev_quirks_set(const struct usbh_dev_quirk *p_quirks, int n_quirks);
+/**
+ * \brief 清空 USB 主机设备描述符缓存
+ */
+void usbh_dev_desc_cache_flush(void);
 /**
  * \brief USB 主机设备端点复位
  *
@@ -595,6 +721,15 @@ int usbh_basic_hub_dev_connect(struct usbh_hub_basic *p_hub_basic,
  */
 int usbh_basic_hub_dev_disconnect(struct usbh_hub_basic *p_hub_basic,
                                   uint8_t                port_num);
+/**
+ * \brief USB 主机基础集线器等待端口后台枚举结束，集线器释放前调用，不能在枚举工作中调用
+ *
+ * \param[in] p_hub_basic 基本集线器
+ * \param[in] timeout     超时时间(毫秒)
+ *
+ * \retval 成功返回 USB_OK，超时返回 -USB_ETIME
+ */
+int usbh_basic_hub_enum_wait(struct usbh_hub_basic *p_hub_basic, int timeout);
 /**
  * \brief USB 主机基础集线器端口连接检查
  *
@@ -241,4 +241,98 @@ struct usb_cdc_notification {
     uint16_t  length;
 } __attribute__ ((packed));
 
+/* \brief "NCM 功能描述符" CDC NCM 规范 5.2.1 */
+struct usb_cdc_ncm_desc {
+    uint8_t   length;
+    uint8_t   descriptor_type;
+    uint8_t   descriptor_sub_type;
+
+    uint16_t  bcd_ncm_version;
+    uint8_t   network_capabilities;
+} __attribute__ ((packed));
+
+/* \brief NCM 功能描述符网络能力位*/
+#define USB_CDC_NCM_NCAP_ETH_FILTER              (1 << 0)
+#define USB_CDC_NCM_NCAP_NET_ADDRESS             (1 << 1)
+#define USB_CDC_NCM_NCAP_ENCAP_COMMAND           (1 << 2)
+#define USB_CDC_NCM_NCAP_MAX_DATAGRAM_SIZE       (1 << 3)
+#define USB_CDC_NCM_NCAP_CRC_MODE                (1 << 4)
+#define USB_CDC_NCM_NCAP_NTB_INPUT_SIZE          (1 << 5)
+
+/* \brief GET_NTB_PARAMETERS 返回的 NTB 参数结构体 CDC NCM 规范 6.2.1 */
+struct usb_cdc_ncm_ntb_parameters {
+    uint16_t  length;
+    uint16_t  ntb_formats_supported;       /* 支持的 NTB 格式*/
+    uint32_t  ntb_in_max_size;             /* 输入 NTB 最大大小*/
+    uint16_t  ndp_in_divisor;
+    uint16_t  ndp_in_payload_remainder;
+    uint16_t  ndp_in_alignment;
+    uint16_t  padding;
+    uint32_t  ntb_out_max_size;            /* 输出 NTB 最大大小*/
+    uint16_t  ndp_out_divisor;             /* 输出数据报对齐除数*/
+    uint16_t  ndp_out_payload_remainder;   /* 输出数据报对齐余数*/
+    uint16_t  ndp_out_alignment;           /* 输出 NDP 对齐*/
+    uint16_t  ntb_out_max_datagrams;       /* 输出 NTB 最大数据报数量，0 为不限制*/
+} __attribute__ ((packed));
+
+/* \brief NTB 格式*/
+#define USB_CDC_NCM_NTB16_SUPPORTED              (1 << 0)
+#define USB_CDC_NCM_NTB32_SUPPORTED              (1 << 1)
+#define USB_CDC_NCM_NTB16_FORMAT                 0x00
+#define USB_CDC_NCM_NTB32_FORMAT                 0x01
+
+/* \brief NTB 头和 NDP 签名*/
+#define USB_CDC_NCM_NTH16_SIGN                   0x484D434E  /* NCMH */
+#define USB_CDC_NCM_NTH32_SIGN                   0x686D636E  /* ncmh */
+#define USB_CDC_NCM_NDP16_NOCRC_SIGN             0x304D434E  /* NCM0 */
+#define USB_CDC_NCM_NDP32_NOCRC_SIGN             0x306D636E  /* ncm0 */
+
+/* \brief 16 位 NTB 头 CDC NCM 规范 3.2.1 */
+struct usb_cdc_ncm_nth16 {
+    uint32_t  signature;
+    uint16_t  header_length;
+    uint16_t  sequence;
+    uint16_t  block_length;
+    uint16_t  ndp_index;
+} __attribute__ ((packed));
+
+/* \brief 32 位 NTB 头 CDC NCM 规范 3.2.2 */
+struct usb_cdc_ncm_nth32 {
+    uint32_t  signature;
+    uint16_t  header_length;
+    uint16_t  sequence;
+    uint32_t  block_length;
+    uint32_t  ndp_index;
+} __attribute__ ((packed));
+
+/* \brief 16 位数据报指针入口*/
+struct usb_cdc_ncm_dpe16 {
+    uint16_t  datagram_index;
+    uint16_t  datagram_length;
+} __attribute__ ((packed));
+
+/* \brief 16 位数据报指针表 CDC NCM 规范 3.3.1 */
+struct usb_cdc_ncm_ndp16 {
+    uint32_t                  signature;
+    uint16_t                  length;
+    uint16_t                  next_ndp_index;
+    struct usb_cdc_ncm_dpe16  dpe16[0];
+} __attribute__ ((packed));
+
+/* \brief 32 位数据报指针入口*/
+struct usb_cdc_ncm_dpe32 {
+    uint32_t  datagram_index;
+    uint32_t  datagram_length;
+} __attribute__ ((packed));
+
+/* \brief 32 位数据报指针表 CDC NCM 规范 3.3.2 */
+struct usb_cdc_ncm_ndp32 {
+    uint32_t                  signature;
+    uint16_t                  length;
+    uint16_t                  reserved6;
+    uint32_t                  next_ndp_index;
+    uint32_t                  reserved12;
+    struct usb_cdc_ncm_dpe32  dpe32[0];
+} __attribute__ ((packed));
+
 #endif
@@ -29,6 +29,98 @@
 #define USB_BBB_REQ_RESET                 0xFF        /* 复位请求*/
 #define USB_BBB_REQ_GET_MLUN              0xFE        /* 最大逻辑单元请求*/
 
+/* \brief UAS(USB Attached SCSI) 管道用途描述符类型*/
+#define USB_UAS_DT_PIPE_USAGE             0x24
+/* \brief UAS 管道 ID*/
+#define USB_UAS_PIPE_ID_CMD               0x01        /* 命令管道(批量输出)*/
+#define USB_UAS_PIPE_ID_STATUS            0x02        /* 状态管道(批量输入)*/
+#define USB_UAS_PIPE_ID_DATA_IN           0x03        /* 数据输入管道*/
+#define USB_UAS_PIPE_ID_DATA_OUT          0x04        /* 数据输出管道*/
+
+/* \brief UAS 信息单元(IU) ID*/
+#define USB_UAS_IU_ID_CMD                 0x01        /* 命令 IU*/
+#define USB_UAS_IU_ID_SENSE               0x03        /* 感知 IU*/
+#define USB_UAS_IU_ID_RESPONSE            0x04        /* 响应 IU*/
+#define USB_UAS_IU_ID_TASK_MGMT           0x05        /* 任务管理 IU*/
+#define USB_UAS_IU_ID_READ_READY          0x06        /* 读就绪 IU*/
+#define USB_UAS_IU_ID_WRITE_READY         0x07        /* 写就绪 IU*/
+
+/* \brief UAS 命令 IU 任务属性*/
+#define USB_UAS_TASK_ATTR_SIMPLE          0x00
+
+/* \brief UAS 任务管理功能*/
+#define USB_UAS_TMF_ABORT_TASK            0x01        /* 中止任务*/
+
+/* \brief UAS 响应 IU 响应码*/
+#define USB_UAS_RC_TMF_COMPLETE           0x00        /* 任务管理功能完成*/
+#define USB_UAS_RC_TMF_SUCCEEDED          0x08        /* 任务管理功能成功*/
+
+/* \brief SCSI 状态(感知 IU 状态域)*/
+#define USB_UAS_STATUS_GOOD               0x00
+#define USB_UAS_STATUS_CHECK_CONDITION    0x02
+#define USB_UAS_STATUS_BUSY               0x08
+#define USB_UAS_STATUS_TASK_SET_FULL      0x28
+
+/* \brief UAS 管道用途描述符 UAS 规范 5.3.3.1*/
+struct usb_uas_pipe_usage_desc {
+    uint8_t  length;
+    uint8_t  descriptor_type;
+    uint8_t  pipe_id;
+    uint8_t  reserved;
+} __attribute__ ((packed));
+
+/* \brief UAS 命令 IU UAS 规范 6.2.2(标签为大端)*/
+struct usb_uas_cmd_iu {
+    uint8_t  iu_id;
+    uint8_t  reserved;
+    uint8_t  tag[2];
+    uint8_t  prio_attr;
+    uint8_t  reserved1;
+    uint8_t  len;
+    uint8_t  reserved2;
+    uint8_t  lun[8];
+    uint8_t  cdb[16];
+} __attribute__ ((packed));
+
+/* \brief UAS 感知 IU UAS 规范 6.2.5*/
+struct usb_uas_sense_iu {
+    uint8_t  iu_id;
+    uint8_t  reserved;
+    uint8_t  tag[2];
+    uint8_t  status_qual[2];
+    uint8_t  status;
+    uint8_t  reserved1[7];
+    uint8_t  len[2];
+    uint8_t  sense[96];
+} __attribute__ ((packed));
+
+/* \brief UAS 响应 IU UAS 规范 6.2.6*/
+struct usb_uas_response_iu {
+    uint8_t  iu_id;
+    uint8_t  reserved;
+    uint8_t  tag[2];
+    uint8_t  add_response_info[3];
+    uint8_t  response_code;
+} __attribute__ ((packed));
+
+/* \brief UAS 任务管理 IU UAS 规范 6.2.7(标签为大端)*/
+struct usb_uas_task_mgmt_iu {
+    uint8_t  iu_id;
+    uint8_t  reserved;
+    uint8_t  tag[2];
+    uint8_t  function;
+    uint8_t  reserved1;
+    uint8_t  task_tag[2];
+    uint8_t  lun[8];
+} __attribute__ ((packed));
+
+/* \brief UAS 读/写就绪 IU UAS 规范 6.2.3/6.2.4*/
+struct usb_uas_ready_iu {
+    uint8_t  iu_id;
+    uint8_t  reserved;
+    uint8_t  tag[2];
+} __attribute__ ((packed));
+
 
 
 
@@ -29,15 +29,19 @@ struct usb_mem_record {
 };
 #endif
 
-/* \brief USB 环形缓冲区结构体*/
+/**
+ * \brief USB 环形缓冲区结构体
+ *
+ * 单生产者/单消费者无锁环形缓冲区，缓存大小为 2 的幂，读写索引自由计数，
+ * 用掩码取缓存位置。写索引只由生产者修改，读索引只由消费者修改
+ */
 struct usb_ringbuf {
-#if USB_OS_EN
-    usb_mutex_handle_t p_lock;          /* 互斥锁*/
-#endif
     uint8_t           *p_buf;
-    uint32_t           buf_size;
-    uint32_t           data_pos;        /* 数据位置*/
-    uint32_t           rd_pos;          /* 已读位置*/
+    uint32_t           buf_size;        /* 缓存大小(2 的幂)*/
+    uint32_t           mask;            /* 缓存位置掩码*/
+    uint32_t           wr_idx;          /* 写索引*/
+    uint32_t           rd_idx;          /* 读索引*/
+    usb_bool_t         is_buf_alloc;    /* 缓存是否由库分配*/
 };
 
 /* \brief USB 基本库结构体*/
@@ -98,11 +102,29 @@ void *usb_lib_dma_align_malloc(struct usb_lib_base *p_lib, size_t size, size_t a
  * \retval 成功返回 USB_OK
  */
 int usb_lib_dma_mfree(struct usb_lib_base *p_lib, void *p_mem, uint32_t size);
+/**
+ * \brief USB 库环形缓冲区大小向上取整到 2 的幂
+ *
+ * \param[in] size 缓存大小
+ *
+ * \retval 返回取整后的大小
+ */
+uint32_t usb_lib_rb_size_round(uint32_t size);
+/**
+ * \brief USB 库环形缓冲区初始化函数(使用外部缓存)
+ *
+ * \param[in] p_rb     要初始化的环形缓冲区
+ * \param[in] p_buf    环形缓冲区缓存
+ * \param[in] buf_size 缓存大小，必须是 2 的幂
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_lib_rb_init(struct usb_ringbuf *p_rb, uint8_t *p_buf, uint32_t buf_size);
 /**
  * \brief USB 库环形缓冲区创建函数
  *
  * \param[in] p_lib    USB 基本库结构体
- * \param[in] buf_size 环形缓冲区缓存大小
+ * \param[in] buf_size 环形缓冲区缓存大小，向上取整到 2 的幂
  *
  * \retval 成功返回 USB 环形缓冲区结构体
  */
@@ -115,7 +137,29 @@ struct usb_ringbuf *usb_lib_rb_create(struct usb_lib_base *p_lib, uint32_t buf_s
  */
 void usb_lib_rb_destroy(struct usb_lib_base *p_lib, struct usb_ringbuf *p_rb);
 /**
- * \brief USB 库环形缓冲区数据放入函数
+ * \brief USB 库环形缓冲区复位函数，调用时生产者和消费者都必须停止
+ *
+ * \param[in] p_rb 环形缓冲区
+ */
+void usb_lib_rb_reset(struct usb_ringbuf *p_rb);
+/**
+ * \brief USB 库环形缓冲区获取数据长度
+ *
+ * \param[in] p_rb 环形缓冲区
+ *
+ * \retval 返回可读的数据长度
+ */
+uint32_t usb_lib_rb_data_len_get(struct usb_ringbuf *p_rb);
+/**
+ * \brief USB 库环形缓冲区获取空闲长度
+ *
+ * \param[in] p_rb 环形缓冲区
+ *
+ * \retval 返回可写的空闲长度
+ */
+uint32_t usb_lib_rb_space_len_get(struct usb_ringbuf *p_rb);
+/**
+ * \brief USB 库环形缓冲区数据放入函数(生产者)
  *
  * \param[in]  p_rb      环形缓冲区
  * \param[in]  p_buf     数据缓存
@@ -129,7 +173,7 @@ int usb_lib_rb_put(struct usb_ringbuf *p_rb,
                    uint32_t            buf_len,
                    uint32_t           *p_act_len);
 /**
- * \brief USB 库环形缓冲区数据获取函数
+ * \brief USB 库环形缓冲区数据获取函数(消费者)
  *
  * \param[in]  p_rb      环形缓冲区
  * \param[in]  p_buf     数据缓存
@@ -142,6 +186,46 @@ int usb_lib_rb_get(struct usb_ringbuf *p_rb,
                    uint8_t            *p_buf,
                    uint32_t            buf_len,
                    uint32_t           *p_act_len);
+/**
+ * \brief USB 库环形缓冲区预留写空间(生产者)，不拷贝数据，
+ *        写完后调用 usb_lib_rb_commit() 提交
+ *
+ * \param[in]  p_rb   环形缓冲区
+ * \param[out] p_data 返回连续空闲空间的地址
+ * \param[out] p_len  返回连续空闲空间的长度
+ *
+ * \retval 成功返回 USB_OK，缓冲区满返回 -USB_EAGAIN
+ */
+int usb_lib_rb_reserve(struct usb_ringbuf *p_rb, uint8_t **p_data, uint32_t *p_len);
+/**
+ * \brief USB 库环形缓冲区提交写入的数据(生产者)
+ *
+ * \param[in] p_rb 环形缓冲区
+ * \param[in] len  写入的长度
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_lib_rb_commit(struct usb_ringbuf *p_rb, uint32_t len);
+/**
+ * \brief USB 库环形缓冲区查看数据(消费者)，不拷贝数据，
+ *        用完后调用 usb_lib_rb_consume() 释放
+ *
+ * \param[in]  p_rb   环形缓冲区
+ * \param[out] p_data 返回连续数据的地址
+ * \param[out] p_len  返回连续数据的长度
+ *
+ * \retval 成功返回 USB_OK，缓冲区空返回 -USB_EAGAIN
+ */
+int usb_lib_rb_peek(struct usb_ringbuf *p_rb, uint8_t **p_data, uint32_t *p_len);
+/**
+ * \brief USB 库环形缓冲区释放已读的数据(消费者)
+ *
+ * \param[in] p_rb 环形缓冲区
+ * \param[in] len  释放的长度
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_lib_rb_consume(struct usb_ringbuf *p_rb, uint32_t len);
 #if USB_OS_EN
 /**
  * \brief USB 库互斥锁创建函数
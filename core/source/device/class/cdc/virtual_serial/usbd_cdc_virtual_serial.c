@@ -257,13 +257,154 @@ static struct usbd_func_opts __g_vs_func_opts = {
     NULL
 };
 
+/**
+ * \brief 锁住端口
+ */
+static int __vs_port_lock(struct usbd_cdc_vs_port *p_port){
+#if USB_OS_EN
+    int ret = usb_mutex_lock(p_port->p_lock, USBD_VS_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief 解锁端口
+ */
+static int __vs_port_unlock(struct usbd_cdc_vs_port *p_port){
+#if USB_OS_EN
+    int ret = usb_mutex_unlock(p_port->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief 提交输出传输事务
+ */
+static int __vs_trans_submit(struct usbd_cdc_vs_trans *p_vs_trans){
+    p_vs_trans->trans.len     = USBD_VS_TRANS_SIZE;
+    p_vs_trans->trans.act_len = 0;
+    p_vs_trans->trans.status  = 0;
+
+    return usbd_dev_trans_async(p_vs_trans->p_port->p_vs->p_dc_dev, &p_vs_trans->trans);
+}
+
+/**
+ * \brief 输出传输事务完成回调函数
+ *
+ *        环形缓冲区放不下数据或者已经有传输事务暂停时(保持数据顺序)，暂停这个传输事务，
+ *        等应用读走数据后再放入环形缓冲区并重新提交。
+ */
 static void __vs_trans_done(void *p_arg){
-    uint32_t                 len_act;
-    struct usbd_cdc_vs_port *p_port = (struct usbd_cdc_vs_port *)p_arg;
+    uint32_t                  len_act;
+    struct usbd_cdc_vs_trans *p_vs_trans = (struct usbd_cdc_vs_trans *)p_arg;
+    struct usbd_cdc_vs_port  *p_port     = p_vs_trans->p_port;
 
-    usb_lib_rb_put(p_port->p_rb, p_port->trans.p_buf, p_port->trans.act_len, &len_act);
+    if (__vs_port_lock(p_port) != USB_OK) {
+        return;
+    }
+    if ((p_port->n_parked == 0) &&
+            (usb_lib_rb_space_len_get(p_port->p_rb) >= p_vs_trans->trans.act_len)) {
+        usb_lib_rb_put(p_port->p_rb, p_vs_trans->trans.p_buf, p_vs_trans->trans.act_len, &len_act);
+    } else {
+        /* 按完成顺序放进暂停队列，完成顺序就是数据顺序*/
+        p_port->p_park[(p_port->park_head + p_port->n_parked) % p_port->n_trans] = p_vs_trans;
+        p_port->n_parked++;
+        p_port->n_nak++;
+
+        __vs_port_unlock(p_port);
+        return;
+    }
+    __vs_port_unlock(p_port);
 
-    usbd_dev_trans_async(p_port->p_vs->p_dc_dev, &p_port->trans);
+    __vs_trans_submit(p_vs_trans);
+}
+
+/**
+ * \brief 把暂停的传输事务的数据放入环形缓冲区并重新提交
+ */
+static void __vs_trans_resume(struct usbd_cdc_vs_port *p_port){
+    struct usbd_cdc_vs_trans *p_vs_trans = NULL;
+    uint32_t                  len_act;
+
+    while (1) {
+        if (__vs_port_lock(p_port) != USB_OK) {
+            return;
+        }
+        p_vs_trans = NULL;
+        if (p_port->n_parked > 0) {
+            p_vs_trans = p_port->p_park[p_port->park_head];
+            if (usb_lib_rb_space_len_get(p_port->p_rb) >= p_vs_trans->trans.act_len) {
+                usb_lib_rb_put(p_port->p_rb, p_vs_trans->trans.p_buf, p_vs_trans->trans.act_len, &len_act);
+
+                p_port->park_head = (p_port->park_head + 1) % p_port->n_trans;
+                p_port->n_parked--;
+            } else {
+                p_vs_trans = NULL;
+            }
+        }
+        __vs_port_unlock(p_port);
+
+        if (p_vs_trans == NULL) {
+            return;
+        }
+        /* 一次只取出一个，重新提交的顺序和暂停的顺序一致*/
+        __vs_trans_submit(p_vs_trans);
+    }
+}
+
+/**
+ * \brief 释放端口输出传输事务
+ */
+static void __vs_trans_free(struct usbd_cdc_vs_port *p_port){
+    uint8_t i;
+
+    if (p_port->p_park) {
+        usb_lib_mfree(&__g_usb_device_lib.lib, p_port->p_park);
+        p_port->p_park = NULL;
+    }
+    if (p_port->p_trans == NULL) {
+        return;
+    }
+    for (i = 0; i < p_port->n_trans; i++) {
+        if (p_port->p_trans[i].trans.p_buf) {
+            usb_lib_mfree(&__g_usb_device_lib.lib, p_port->p_trans[i].trans.p_buf);
+        }
+    }
+    usb_lib_mfree(&__g_usb_device_lib.lib, p_port->p_trans);
+
+    p_port->p_trans = NULL;
+}
+
+/**
+ * \brief 释放端口资源
+ */
+static void __vs_port_release(struct usbd_cdc_vs_port *p_port){
+#if USB_OS_EN
+    int ret;
+#endif
+
+    __vs_trans_free(p_port);
+    if (p_port->p_rb) {
+        usb_lib_rb_destroy(&__g_usb_device_lib.lib, p_port->p_rb);
+    }
+#if USB_OS_EN
+    if (p_port->p_lock) {
+        ret = usb_lib_mutex_destroy(&__g_usb_device_lib.lib, p_port->p_lock);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
+        }
+    }
+#endif
 }
 
 /**
@@ -332,10 +473,21 @@ int usbd_cdc_vs_create(struct usb_dc        *p_dc,
         p_vs->p_port[i].line_control.parity_type = 0;
         p_vs->p_port[i].p_vs                     = p_vs;
 
+        p_vs->p_port[i].n_trans                  = USBD_VS_TRANS_NUM;
+
         p_vs->p_port[i].p_rb = usb_lib_rb_create(&__g_usb_device_lib.lib, USBD_VS_RB_SIZE);
         if (p_vs->p_port[i].p_rb == NULL) {
+            ret = -USB_ENOMEM;
+            goto __failed2;
+        }
+#if USB_OS_EN
+        p_vs->p_port[i].p_lock = usb_lib_mutex_create(&__g_usb_device_lib.lib);
+        if (p_vs->p_port[i].p_lock == NULL) {
+            __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+            ret = -USB_EPERM;
             goto __failed2;
         }
+#endif
 
         __g_cdc_priv_buf[priv_buf_size - 2]   = intf_num;
         __g_cdc_priv_buf[priv_buf_size - 1]   = intf_num + 1;
@@ -401,10 +553,9 @@ __failed2:
     usbd_dev_destroy(p_vs->p_dc_dev);
 __failed1:
     if (p_vs->p_port) {
-        for (i = 0; i < p_vs->n_ports; i++) {
-            if (p_vs->p_port[i].p_rb) {
-                usb_lib_rb_destroy(&__g_usb_device_lib.lib, p_vs->p_port[i].p_rb);
-            }
+        /* 失败的端口还没有计数，也要释放*/
+        for (i = 0; (i <= p_vs->n_ports) && (i < n_ports); i++) {
+            __vs_port_release(&p_vs->p_port[i]);
         }
         usb_lib_mfree(&__g_usb_device_lib.lib, p_vs->p_port);
     }
@@ -434,9 +585,7 @@ int usbd_cdc_vs_destroy(struct usbd_cdc_vs *p_vs){
     }
     if (p_vs->p_port) {
         for (i = 0; i < p_vs->n_ports; i++) {
-            if (p_vs->p_port[i].p_rb) {
-                usb_lib_rb_destroy(&__g_usb_device_lib.lib, p_vs->p_port[i].p_rb);
-            }
+            __vs_port_release(&p_vs->p_port[i]);
         }
         usb_lib_mfree(&__g_usb_device_lib.lib, p_vs->p_port);
     }
@@ -463,6 +612,35 @@ usb_bool_t usbd_cdc_vs_port_is_setup(struct usbd_cdc_vs *p_vs, uint8_t port_num)
     return p_vs->p_port[port_num].is_setup;
 }
 
+/**
+ * \brief USB 从机虚拟串口设备端口设置输出传输事务数量
+ *
+ *        在端口启动前调用，默认为 USBD_VS_TRANS_NUM。传输事务完成时如果环形缓冲区放不下数据，
+ *        传输事务暂停不再提交，所有传输事务都暂停后主机收到 NAK，直到应用读走数据。
+ *
+ * \param[in] p_vs     USB 从机虚拟串口设备
+ * \param[in] port_num 端口号
+ * \param[in] n_trans  输出传输事务数量
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_cdc_vs_port_trans_num_set(struct usbd_cdc_vs *p_vs,
+                                   uint8_t             port_num,
+                                   uint8_t             n_trans){
+    if ((p_vs == NULL) || (n_trans == 0)) {
+        return -USB_EINVAL;
+    }
+    if (port_num > (p_vs->n_ports - 1)) {
+        return -USB_EILLEGAL;
+    }
+    if (p_vs->p_port[port_num].is_start == USB_TRUE) {
+        return -USB_EPERM;
+    }
+    p_vs->p_port[port_num].n_trans = n_trans;
+
+    return USB_OK;
+}
+
 /**
  * \brief USB 从机虚拟串口设备端口启动
  *
@@ -472,7 +650,9 @@ usb_bool_t usbd_cdc_vs_port_is_setup(struct usbd_cdc_vs *p_vs, uint8_t port_num)
  * \retval 成功返回 USB_OK
  */
 int usbd_cdc_vs_port_start(struct usbd_cdc_vs *p_vs, uint8_t port_num){
-    struct usbd_cdc_vs_port *p_port = NULL;
+    struct usbd_cdc_vs_port *p_port  = NULL;
+    struct usbd_trans       *p_trans = NULL;
+    uint8_t                  i;
     int                      ret;
 
     if (p_vs == NULL) {
@@ -486,27 +666,62 @@ int usbd_cdc_vs_port_start(struct usbd_cdc_vs *p_vs, uint8_t port_num){
     if (p_port->is_start == USB_TRUE) {
         return -USB_EPERM;
     }
+    if (p_port->p_data_out == NULL) {
+        return -USB_EILLEGAL;
+    }
 
-    memset(&p_port->trans, 0, sizeof(struct usbd_trans));
+    __vs_trans_free(p_port);
 
-    p_port->trans.p_buf = usb_lib_malloc(&__g_usb_device_lib.lib, 512);
-    if (p_port->trans.p_buf == NULL) {
+    p_port->p_trans = usb_lib_malloc(&__g_usb_device_lib.lib, sizeof(struct usbd_cdc_vs_trans) * p_port->n_trans);
+    if (p_port->p_trans == NULL) {
         return -USB_ENOMEM;
     }
+    memset(p_port->p_trans, 0, sizeof(struct usbd_cdc_vs_trans) * p_port->n_trans);
 
-    p_port->trans.p_hw          = p_vs->p_port[port_num].p_data_out->p_hw;
-    p_port->trans.len           = 512;
-    p_port->trans.flag          = 0;
-    p_port->trans.p_fn_complete = __vs_trans_done;
-    p_port->trans.p_arg         = p_port;
-    p_port->trans.act_len       = 0;
-    p_port->trans.status        = 0;
+    p_port->p_park = usb_lib_malloc(&__g_usb_device_lib.lib, sizeof(struct usbd_cdc_vs_trans *) * p_port->n_trans);
+    if (p_port->p_park == NULL) {
+        __vs_trans_free(p_port);
+        return -USB_ENOMEM;
+    }
+
+    p_port->park_head = 0;
+    p_port->n_parked  = 0;
+    p_port->n_nak     = 0;
 
-    ret = usbd_dev_trans_async(p_vs->p_dc_dev, &p_port->trans);
-    if (ret == USB_OK) {
-        p_port->is_start = USB_TRUE;
+    for (i = 0; i < p_port->n_trans; i++) {
+        p_trans = &p_port->p_trans[i].trans;
+
+        p_trans->p_buf = usb_lib_malloc(&__g_usb_device_lib.lib, USBD_VS_TRANS_SIZE);
+        if (p_trans->p_buf == NULL) {
+            __vs_trans_free(p_port);
+            return -USB_ENOMEM;
+        }
+        p_trans->p_hw             = p_port->p_data_out->p_hw;
+        p_trans->flag             = 0;
+        p_trans->p_fn_complete    = __vs_trans_done;
+        p_trans->p_arg            = &p_port->p_trans[i];
+        p_port->p_trans[i].p_port = p_port;
     }
-    return ret;
+
+    /* 所有输出传输事务一起提交，主机可以连续发送数据*/
+    for (i = 0; i < p_port->n_trans; i++) {
+        ret = __vs_trans_submit(&p_port->p_trans[i]);
+        if (ret != USB_OK) {
+            break;
+        }
+    }
+    if (i == 0) {
+        __vs_trans_free(p_port);
+        return ret;
+    }
+    /* 至少有一个传输事务提交成功，端口就算启动了，少提交的传输事务不影响暂停队列*/
+    if (i < p_port->n_trans) {
+        __USB_ERR_INFO("USB device virtual serial port %d only %d of %d transfers submitted(%d)\r\n",
+                port_num, i, p_port->n_trans, ret);
+    }
+    p_port->is_start = USB_TRUE;
+
+    return USB_OK;
 }
 
 /**
@@ -561,6 +776,7 @@ int usbd_cdc_vs_port_read(struct usbd_cdc_vs  *p_vs,
                           uint32_t             len,
                           uint32_t            *p_act_len){
     struct usbd_cdc_vs_port *p_port = NULL;
+    int                      ret;
 
     if ((p_vs == NULL) || (p_act_len == NULL) || (p_buf == NULL)) {
         return -USB_EINVAL;
@@ -570,7 +786,12 @@ int usbd_cdc_vs_port_read(struct usbd_cdc_vs  *p_vs,
     }
     p_port = &p_vs->p_port[port_num];
 
-    return usb_lib_rb_get(p_port->p_rb, p_buf, len, p_act_len);
+    ret = usb_lib_rb_get(p_port->p_rb, p_buf, len, p_act_len);
+    /* 读走数据后，环形缓冲区有空间了，恢复暂停的传输事务*/
+    if ((ret == USB_OK) && (p_port->n_parked > 0)) {
+        __vs_trans_resume(p_port);
+    }
+    return ret;
 }
 
 ///**
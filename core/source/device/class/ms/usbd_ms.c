@@ -65,6 +65,39 @@ static void __ms_max_lun_get_done(void *p_arg){
     p_ms->is_max_lun_get = USB_TRUE;
 }
 
+/**
+ * \brief 数据阶段异步传输完成回调函数
+ */
+static void __ms_trans_done(void *p_arg){
+    struct usbd_ms *p_ms = (struct usbd_ms *)p_arg;
+
+#if USB_OS_EN
+    usb_sem_give(p_ms->p_trans_sem);
+#else
+    p_ms->is_trans_done = USB_TRUE;
+#endif
+}
+
+/**
+ * \brief 释放异步块请求
+ */
+static void __ms_blk_reqs_free(struct usbd_ms *p_ms){
+    uint8_t i;
+
+    if (p_ms->p_reqs == NULL) {
+        return;
+    }
+    for (i = 0; i < p_ms->n_reqs; i++) {
+        if (p_ms->p_reqs[i].p_buf) {
+            usb_lib_mfree(&__g_usb_device_lib.lib, p_ms->p_reqs[i].p_buf);
+        }
+    }
+    usb_lib_mfree(&__g_usb_device_lib.lib, p_ms->p_reqs);
+
+    p_ms->p_reqs = NULL;
+    p_ms->n_reqs = 0;
+}
+
 /**
  * \brief USB 大容量存储设备设置函数
  */
@@ -183,6 +216,13 @@ int usbd_ms_create(struct usb_dc         *p_dc,
     }
     memset(p_ms->p_buf, 0, buf_size);
 
+    /* 读写命令用两个缓存轮流做媒体访问和 USB 传输*/
+    p_ms->p_buf_db = usb_lib_malloc(&__g_usb_device_lib.lib, buf_size);
+    if (p_ms->p_buf_db == NULL) {
+        ret = -USB_ENOMEM;
+        goto __failed1;
+    }
+
 #if USB_OS_EN
     p_ms->p_lock = usb_lib_mutex_create(&__g_usb_device_lib.lib);
     if (p_ms->p_lock == NULL) {
@@ -190,6 +230,18 @@ int usbd_ms_create(struct usb_dc         *p_dc,
         __USB_ERR_TRACE(MutexCreateErr, "\r\n");
         goto __failed1;
     }
+    p_ms->p_trans_sem = usb_lib_sem_create(&__g_usb_device_lib.lib);
+    if (p_ms->p_trans_sem == NULL) {
+        ret = -USB_EPERM;
+        __USB_ERR_TRACE(SemCreateErr, "\r\n");
+        goto __failed1;
+    }
+    p_ms->p_req_sem = usb_lib_sem_create(&__g_usb_device_lib.lib);
+    if (p_ms->p_req_sem == NULL) {
+        ret = -USB_EPERM;
+        __USB_ERR_TRACE(SemCreateErr, "\r\n");
+        goto __failed1;
+    }
 #endif
     usb_list_head_init(&p_ms->lu_list);
     p_ms->buf_size = buf_size;
@@ -249,6 +301,9 @@ __failed1:
     if (p_ms->p_buf) {
         usb_lib_mfree(&__g_usb_device_lib.lib, p_ms->p_buf);
     }
+    if (p_ms->p_buf_db) {
+        usb_lib_mfree(&__g_usb_device_lib.lib, p_ms->p_buf_db);
+    }
 #if USB_OS_EN
     if (p_ms->p_lock) {
         ret_tmp= usb_lib_mutex_destroy(&__g_usb_device_lib.lib, p_ms->p_lock);
@@ -256,6 +311,18 @@ __failed1:
             __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret_tmp);
         }
     }
+    if (p_ms->p_trans_sem) {
+        ret_tmp = usb_lib_sem_destroy(&__g_usb_device_lib.lib, p_ms->p_trans_sem);
+        if (ret_tmp != USB_OK) {
+            __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret_tmp);
+        }
+    }
+    if (p_ms->p_req_sem) {
+        ret_tmp = usb_lib_sem_destroy(&__g_usb_device_lib.lib, p_ms->p_req_sem);
+        if (ret_tmp != USB_OK) {
+            __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret_tmp);
+        }
+    }
 #endif
     usb_lib_mfree(&__g_usb_device_lib.lib, p_ms);
     return ret;
@@ -306,6 +373,10 @@ int usbd_ms_destroy(struct usbd_ms *p_ms){
     if (p_ms->p_buf) {
         usb_lib_mfree(&__g_usb_device_lib.lib, p_ms->p_buf);
     }
+    if (p_ms->p_buf_db) {
+        usb_lib_mfree(&__g_usb_device_lib.lib, p_ms->p_buf_db);
+    }
+    __ms_blk_reqs_free(p_ms);
 #if USB_OS_EN
     if (p_ms->p_lock) {
         ret= usb_lib_mutex_destroy(&__g_usb_device_lib.lib, p_ms->p_lock);
@@ -314,6 +385,20 @@ int usbd_ms_destroy(struct usbd_ms *p_ms){
             return ret;
         }
     }
+    if (p_ms->p_trans_sem) {
+        ret = usb_lib_sem_destroy(&__g_usb_device_lib.lib, p_ms->p_trans_sem);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret);
+            return ret;
+        }
+    }
+    if (p_ms->p_req_sem) {
+        ret = usb_lib_sem_destroy(&__g_usb_device_lib.lib, p_ms->p_req_sem);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret);
+            return ret;
+        }
+    }
 #endif
     usb_lib_mfree(&__g_usb_device_lib.lib, p_ms);
 
@@ -369,6 +454,186 @@ int usbd_ms_usr_opts_set(struct usbd_ms *p_ms, struct usbd_ms_opts *p_opts){
     return ret;
 }
 
+/**
+ * \brief USB 从机大容量存储设备设置异步块请求数量
+ *
+ *        每个异步块请求有自己的 buf_size 大小的数据缓存，只有设置了用户操作函数集的异步提交函数，
+ *        读写命令才会使用异步块请求。
+ *
+ * \param[in] p_ms   USB 从机大容量存储设备
+ * \param[in] n_reqs 最多同时未完成的异步块请求数量，为 0 则不使用异步块请求
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_ms_blk_req_num_set(struct usbd_ms *p_ms, uint8_t n_reqs){
+    int     ret = USB_OK;
+#if USB_OS_EN
+    int     ret_tmp;
+#endif
+    uint8_t i;
+
+    if (p_ms == NULL) {
+        return -USB_EINVAL;
+    }
+    if (p_ms->is_setup == USB_TRUE) {
+        return -USB_EPERM;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_ms->p_lock, USBD_MS_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    /* 后端还持有的请求不能释放*/
+    for (i = 0; i < p_ms->n_reqs; i++) {
+        if (p_ms->p_reqs[i].is_pend == USB_TRUE) {
+            ret = -USB_EBUSY;
+            goto __exit;
+        }
+    }
+    __ms_blk_reqs_free(p_ms);
+
+    if (n_reqs == 0) {
+        goto __exit;
+    }
+
+    p_ms->p_reqs = usb_lib_malloc(&__g_usb_device_lib.lib, sizeof(struct usbd_ms_blk_req) * n_reqs);
+    if (p_ms->p_reqs == NULL) {
+        ret = -USB_ENOMEM;
+        goto __exit;
+    }
+    memset(p_ms->p_reqs, 0, sizeof(struct usbd_ms_blk_req) * n_reqs);
+    p_ms->n_reqs = n_reqs;
+
+    for (i = 0; i < n_reqs; i++) {
+        p_ms->p_reqs[i].p_ms  = p_ms;
+        p_ms->p_reqs[i].p_buf = usb_lib_malloc(&__g_usb_device_lib.lib, p_ms->buf_size);
+        if (p_ms->p_reqs[i].p_buf == NULL) {
+            __ms_blk_reqs_free(p_ms);
+            ret = -USB_ENOMEM;
+            goto __exit;
+        }
+    }
+__exit:
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_ms->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief USB 从机大容量存储设备异步块请求完成通知，由后端调用，可以在中断中调用
+ *
+ * \param[in] p_req    完成的异步块请求
+ * \param[in] status   完成状态
+ * \param[in] blks_act 实际完成的块数量
+ */
+void usbd_ms_blk_req_done(struct usbd_ms_blk_req *p_req, int status, uint32_t blks_act){
+    if (p_req == NULL) {
+        return;
+    }
+    p_req->status   = status;
+    p_req->blks_act = blks_act;
+    /* 先清除提交标志，等待者醒来后可以马上重新提交*/
+    p_req->is_pend  = USB_FALSE;
+    p_req->is_done  = USB_TRUE;
+#if USB_OS_EN
+    usb_sem_give(p_req->p_ms->p_req_sem);
+#endif
+}
+
+/**
+ * \brief USB 从机大容量存储设备提交异步块请求
+ *
+ * \param[in] p_ms     USB 从机大容量存储设备
+ * \param[in] p_req    要提交的异步块请求
+ * \param[in] is_write 是否是写请求
+ * \param[in] blk_num  起始块号
+ * \param[in] n_blks   块数量
+ *
+ * \retval 成功返回 USB_OK，请求还在后端没有完成返回 -USB_EBUSY
+ */
+int usbd_ms_blk_req_submit(struct usbd_ms         *p_ms,
+                           struct usbd_ms_blk_req *p_req,
+                           usb_bool_t              is_write,
+                           uint32_t                blk_num,
+                           uint32_t                n_blks){
+    int   ret;
+    int (*p_fn_submit)(struct usbd_ms_blk_req *p_req);
+
+    if ((p_ms == NULL) || (p_req == NULL) || (p_ms->p_opts == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    p_fn_submit = is_write ? p_ms->p_opts->p_fn_blk_write_submit : p_ms->p_opts->p_fn_blk_read_submit;
+    if (p_fn_submit == NULL) {
+        return -USB_ENOTSUP;
+    }
+    /* 之前等待超时的请求还在后端，完成前不能再用，否则迟到的完成通知会改掉新请求的结果*/
+    if (p_req->is_pend == USB_TRUE) {
+        return -USB_EBUSY;
+    }
+
+    p_req->p_lu     = p_ms->p_lu_select;
+    p_req->blk_num  = blk_num;
+    p_req->n_blks   = n_blks;
+    p_req->blks_act = 0;
+    p_req->status   = USB_OK;
+    p_req->is_done  = USB_FALSE;
+    p_req->is_pend  = USB_TRUE;
+
+    ret = p_fn_submit(p_req);
+    if (ret != USB_OK) {
+        p_req->is_pend = USB_FALSE;
+    }
+    return ret;
+}
+
+/**
+ * \brief USB 从机大容量存储设备等待异步块请求完成
+ *
+ * \param[in] p_ms    USB 从机大容量存储设备
+ * \param[in] p_req   要等待的异步块请求
+ * \param[in] timeout 等待超时时间
+ *
+ * \retval 成功返回 USB_OK，失败返回后端上报的完成状态或者等待错误，
+ *         等待超时后请求仍然属于后端，后端完成前不能再提交
+ */
+int usbd_ms_blk_req_wait(struct usbd_ms         *p_ms,
+                         struct usbd_ms_blk_req *p_req,
+                         int                     timeout){
+#if USB_OS_EN
+    int ret;
+#endif
+
+    if ((p_ms == NULL) || (p_req == NULL)) {
+        return -USB_EINVAL;
+    }
+    /* 信号量由所有请求共用，醒来后要检查是不是等待的请求完成了*/
+    while (p_req->is_done != USB_TRUE) {
+#if USB_OS_EN
+        ret = usb_sem_take(p_ms->p_req_sem, timeout);
+        if (ret != USB_OK) {
+            return ret;
+        }
+#else
+        if (timeout == 0) {
+            return -USB_ETIME;
+        }
+        if (timeout > 0) {
+            timeout--;
+        }
+        usb_mdelay(1);
+#endif
+    }
+    return p_req->status;
+}
+
 /**
  * \brief USB 从机大容量存储设备添加逻辑单元
  *
@@ -575,3 +840,92 @@ int usbd_ms_write(struct usbd_ms *p_ms,
                                p_act_len);
 }
 
+/**
+ * \brief USB 大容量存储设备启动数据阶段异步传输
+ *
+ * \param[in] p_ms  USB 从机大容量存储设备
+ * \param[in] dir   传输方向，USB_DIR_IN 发送给主机，USB_DIR_OUT 从主机接收
+ * \param[in] p_buf 数据缓存（p_buf 或 p_buf_db）
+ * \param[in] len   数据长度（不可超过 USB 从机大容量存储设备 buf_size）
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_ms_trans_start(struct usbd_ms *p_ms,
+                        uint8_t         dir,
+                        uint8_t        *p_buf,
+                        uint32_t        len){
+    struct usbd_pipe *p_pipe = NULL;
+
+    if ((p_ms == NULL) || (p_buf == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (len > p_ms->buf_size) {
+        return -USB_EILLEGAL;
+    }
+
+    p_pipe = (dir == USB_DIR_IN) ? p_ms->p_data_in : p_ms->p_data_out;
+    if (p_pipe == NULL) {
+        return -USB_EILLEGAL;
+    }
+
+    p_ms->trans.p_hw          = p_pipe->p_hw;
+    p_ms->trans.p_buf         = p_buf;
+    p_ms->trans.len           = len;
+    p_ms->trans.flag          = 0;
+    p_ms->trans.p_fn_complete = __ms_trans_done;
+    p_ms->trans.p_arg         = p_ms;
+    p_ms->trans.act_len       = 0;
+    p_ms->trans.status        = 0;
+
+#if USB_OS_EN
+    usb_sem_take(p_ms->p_trans_sem, USB_NO_WAIT);
+#else
+    p_ms->is_trans_done = USB_FALSE;
+#endif
+    return usbd_dev_trans_async(p_ms->p_dc_dev, &p_ms->trans);
+}
+
+/**
+ * \brief USB 大容量存储设备等待数据阶段异步传输完成
+ *
+ * \param[in]  p_ms      USB 从机大容量存储设备
+ * \param[in]  timeout   等待超时时间，超时会取消传输
+ * \param[out] p_act_len 返回实际传输的数据长度
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbd_ms_trans_wait(struct usbd_ms *p_ms,
+                       int             timeout,
+                       uint32_t       *p_act_len){
+    int ret = USB_OK;
+
+    if ((p_ms == NULL) || (p_act_len == NULL)) {
+        return -USB_EINVAL;
+    }
+    *p_act_len = 0;
+#if USB_OS_EN
+    ret = usb_sem_take(p_ms->p_trans_sem, timeout);
+#else
+    while (p_ms->is_trans_done != USB_TRUE) {
+        if (timeout == 0) {
+            ret = -USB_ETIME;
+            break;
+        }
+        if (timeout > 0) {
+            timeout--;
+        }
+        usb_mdelay(1);
+    }
+#endif
+    if (ret != USB_OK) {
+        /* 取消 USB 设备传输*/
+        usb_dc_trans_cancel(p_ms->p_dc_dev->p_dc, &p_ms->trans);
+        return ret;
+    }
+    if (p_ms->trans.status != USB_OK) {
+        return p_ms->trans.status;
+    }
+    *p_act_len = p_ms->trans.act_len;
+
+    return USB_OK;
+}
@@ -291,13 +291,224 @@ static int __capacity_read(struct usbd_ms *p_ms){
     return 8;
 }
 
+/**
+ * \brief 等待所有未完成的异步块请求，不处理结果，超时的请求保持提交状态，后端完成前不会再被使用
+ */
+static void __blk_reqs_drain(struct usbd_ms *p_ms, uint8_t head, uint8_t n_pend){
+    while (n_pend > 0) {
+        usbd_ms_blk_req_wait(p_ms, &p_ms->p_reqs[head], USBD_MS_WAIT_TIMEOUT);
+        head = (head + 1) % p_ms->n_reqs;
+        n_pend--;
+    }
+}
+
+/**
+ * \brief 异步读
+ *
+ *        最多 n_reqs 个块请求同时交给后端，按顺序等待最早的请求完成后通过 USB 发送，
+ *        发送期间后端继续处理其它请求。
+ */
+static int __read_async(struct usbd_ms *p_ms, uint32_t lba){
+    struct usbd_ms_lu      *p_lu    = p_ms->p_lu_select;
+    struct usbd_ms_blk_req *p_req   = NULL;
+    uint32_t                n_blks, n_blks_act, n_blks_sub, lba_sub, blk_rd, tmp, wr_len;
+    uint8_t                 head    = 0;
+    uint8_t                 n_pend  = 0;
+    int                     ret_sub = USB_OK;
+    int                     ret;
+
+    n_blks     = p_ms->info.info.cdlen / p_lu->blk_size;
+    n_blks_act = p_ms->buf_size / p_lu->blk_size;
+    n_blks_sub = n_blks;
+    lba_sub    = lba;
+
+    for (;;) {
+        /* 提交块请求，直到达到最大未完成数量*/
+        while ((n_pend < p_ms->n_reqs) && (n_blks_sub > 0) && (ret_sub == USB_OK)) {
+            tmp = min(n_blks_sub, n_blks_act);
+            tmp = min(tmp, (p_lu->n_blks - lba_sub));
+            if (tmp == 0) {
+                break;
+            }
+            p_req   = &p_ms->p_reqs[(head + n_pend) % p_ms->n_reqs];
+            ret_sub = usbd_ms_blk_req_submit(p_ms, p_req, USB_FALSE, lba_sub, tmp);
+            if (ret_sub != USB_OK) {
+                __USB_ERR_INFO("usb mass storage device read submit failed(%d)\r\n", ret_sub);
+                break;
+            }
+            lba_sub    += tmp;
+            n_blks_sub -= tmp;
+            n_pend++;
+        }
+
+        /* 没有未完成的请求，在当前位置出错*/
+        if (n_pend == 0) {
+            p_lu->lu.lu.sd           = (ret_sub == USB_OK) ? SCSI_SK_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE :
+                                                             SCSI_SK_UNRECOVERED_READ_ERROR;
+            p_lu->lu.lu.sd_info      = lba;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return 0;
+        }
+
+        /* 等待最早的请求完成*/
+        p_req = &p_ms->p_reqs[head];
+        ret   = usbd_ms_blk_req_wait(p_ms, p_req, USBD_MS_WAIT_TIMEOUT);
+        head  = (head + 1) % p_ms->n_reqs;
+        n_pend--;
+
+        blk_rd = (ret == USB_OK) ? min(p_req->blks_act, p_req->n_blks) : 0;
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("usb mass storage device read failed(%d)\r\n", ret);
+        }
+
+        n_blks               -=  blk_rd;
+        lba                  +=  blk_rd;
+        p_ms->info.info.dlen -= (blk_rd * p_lu->blk_size);
+
+        /* 如果有错误产生，上报它和它的位置*/
+        if (blk_rd < p_req->n_blks) {
+            __blk_reqs_drain(p_ms, head, n_pend);
+
+            p_lu->lu.lu.sd           = SCSI_SK_UNRECOVERED_READ_ERROR;
+            p_lu->lu.lu.sd_info      = lba;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return 0;
+        }
+
+        /* 发送数据，发送期间后端继续处理剩下的请求*/
+        ret = usbd_ms_trans_start(p_ms, USB_DIR_IN, p_req->p_buf, blk_rd * p_lu->blk_size);
+        if (ret == USB_OK) {
+            ret = usbd_ms_trans_wait(p_ms, USBD_MS_WAIT_TIMEOUT, &wr_len);
+            if ((ret == USB_OK) && (wr_len != (blk_rd * p_lu->blk_size))) {
+                ret = -USB_EWRITE;
+            }
+        }
+        if (ret != USB_OK) {
+            __blk_reqs_drain(p_ms, head, n_pend);
+            return ret;
+        }
+
+        if (n_blks == 0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief 异步写
+ *
+ *        通过 USB 接收一块数据后马上提交给后端，然后接收下一块数据，最多 n_reqs 个块请求同时交给后端，
+ *        没有空闲请求时按顺序等待最早的请求完成。
+ */
+static int __write_async(struct usbd_ms *p_ms, uint32_t lba){
+    struct usbd_ms_lu      *p_lu   = p_ms->p_lu_select;
+    struct usbd_ms_blk_req *p_req  = NULL;
+    uint32_t                uoff, nout, n_blks, n_blks_act, rd_len;
+    uint8_t                 head   = 0;
+    uint8_t                 n_pend = 0;
+    int                     ret;
+
+    n_blks     = p_ms->info.info.cdlen / p_lu->blk_size;
+    n_blks_act = p_ms->buf_size / p_lu->blk_size;
+    uoff       = lba;
+
+    while ((n_blks > 0) || (n_pend > 0)) {
+        /* 没有空闲请求或者数据都已接收，等待最早的请求完成*/
+        if ((n_pend == p_ms->n_reqs) || (n_blks == 0)) {
+            p_req = &p_ms->p_reqs[head];
+            ret   = usbd_ms_blk_req_wait(p_ms, p_req, USBD_MS_WAIT_TIMEOUT);
+            head  = (head + 1) % p_ms->n_reqs;
+            n_pend--;
+
+            if ((ret != USB_OK) || (p_req->blks_act != p_req->n_blks)) {
+                __blk_reqs_drain(p_ms, head, n_pend);
+
+                __USB_ERR_INFO("usb mass storage device write failed(%d)\r\n", ret);
+                p_lu->lu.lu.sd           = SCSI_SK_WRITE_ERROR;
+                p_lu->lu.lu.sd_info      = p_req->blk_num;
+                p_lu->lu.lu.is_inf_valid = USB_TRUE;
+                p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+                return -USB_EWRITE;
+            }
+            p_ms->info.info.dlen -= (p_req->blks_act * p_lu->blk_size);
+            continue;
+        }
+
+        if (uoff >= p_lu->n_blks) {
+            __blk_reqs_drain(p_ms, head, n_pend);
+
+            p_lu->lu.lu.sd           = SCSI_SK_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+            p_lu->lu.lu.sd_info      = uoff;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return -USB_EILLEGAL;
+        }
+
+        /* 接收数据到空闲请求的缓存*/
+        p_req = &p_ms->p_reqs[(head + n_pend) % p_ms->n_reqs];
+        nout  = min(n_blks, n_blks_act);
+
+        /* 之前超时的请求还在后端，不能覆盖它的缓存*/
+        if (p_req->is_pend == USB_TRUE) {
+            __blk_reqs_drain(p_ms, head, n_pend);
+
+            __USB_ERR_INFO("usb mass storage device write request busy\r\n");
+            p_lu->lu.lu.sd           = SCSI_SK_WRITE_ERROR;
+            p_lu->lu.lu.sd_info      = uoff;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return -USB_EBUSY;
+        }
+
+        ret = usbd_ms_trans_start(p_ms, USB_DIR_OUT, p_req->p_buf, nout * p_lu->blk_size);
+        if (ret == USB_OK) {
+            ret = usbd_ms_trans_wait(p_ms, USBD_MS_WAIT_TIMEOUT, &rd_len);
+        }
+        if (ret != USB_OK) {
+            __blk_reqs_drain(p_ms, head, n_pend);
+
+            p_lu->lu.lu.sd           = SCSI_SK_COMMUNICATION_FAILURE;
+            p_lu->lu.lu.sd_info      = uoff;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return ret;
+        } else if (rd_len != (nout * p_lu->blk_size)) {
+            __blk_reqs_drain(p_ms, head, n_pend);
+            return -USB_EREAD;
+        }
+
+        /* 提交给后端写入媒体*/
+        ret = usbd_ms_blk_req_submit(p_ms, p_req, USB_TRUE, uoff, nout);
+        if (ret != USB_OK) {
+            __blk_reqs_drain(p_ms, head, n_pend);
+
+            __USB_ERR_INFO("usb mass storage device write submit failed(%d)\r\n", ret);
+            p_lu->lu.lu.sd           = SCSI_SK_WRITE_ERROR;
+            p_lu->lu.lu.sd_info      = uoff;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return ret;
+        }
+        uoff   += nout;
+        n_blks -= nout;
+        n_pend++;
+    }
+    return 0;
+}
+
 /**
  * \brief 读
  */
 static int __read(struct usbd_ms *p_ms){
-    uint32_t  lba, n_blks, n_blks_act, blk_rd, tmp;
-    uint32_t  wr_len;
-    int       ret;
+    uint32_t    lba, n_blks, n_blks_act, blk_rd, tmp, wr_len;
+    uint32_t    len       = 0;
+    uint8_t    *p_bufs[2] = {p_ms->p_buf, p_ms->p_buf_db};
+    int         cur       = 0;
+    usb_bool_t  is_busy   = USB_FALSE;
+    int         ret;
 
     /* get the starting LBA and check it */
     if (p_ms->info.info.cb[0] == SCSI_CMD_READ_6) {
@@ -325,11 +536,17 @@ static int __read(struct usbd_ms *p_ms){
         return -USB_EILLEGAL;
     }
 
+    /* 后端支持异步读*/
+    if ((p_ms->n_reqs > 0) && (p_ms->p_opts->p_fn_blk_read_submit != NULL)) {
+        return __read_async(p_ms, lba);
+    }
+
     /* 要读的块数*/
     n_blks     = p_ms->info.info.cdlen / p_ms->p_lu_select->blk_size;
     /* 实际要读的块数*/
     n_blks_act = p_ms->buf_size / p_ms->p_lu_select->blk_size;
 
+    /* 两个缓存轮流使用，媒体读下一块数据的同时，USB 发送上一块数据*/
     for (;;) {
         tmp = min(n_blks, n_blks_act);
         /* 检查要读的块数量有没有超过最大数量*/
@@ -341,11 +558,11 @@ static int __read(struct usbd_ms *p_ms){
             p_ms->p_lu_select->lu.lu.sd_info      = lba;
             p_ms->p_lu_select->lu.lu.is_inf_valid = USB_TRUE;
             p_ms->info.info.sta                   = USB_BBB_CSW_STA_FAIL;
-            return 0;
+            break;
         }
 
         /* 从媒体中读取数据*/
-        ret = p_ms->p_opts->p_fn_blk_read(p_ms->p_lu_select, p_ms->p_buf, lba, tmp, &blk_rd);
+        ret = p_ms->p_opts->p_fn_blk_read(p_ms->p_lu_select, p_bufs[cur], lba, tmp, &blk_rd);
         if (ret != USB_OK) {
             blk_rd = 0;
             __USB_ERR_INFO("usb mass storage device read failed(%d)\r\n", ret);
@@ -355,6 +572,18 @@ static int __read(struct usbd_ms *p_ms){
         lba                  +=  blk_rd;
         p_ms->info.info.dlen -= (blk_rd * p_ms->p_lu_select->blk_size);
 
+        /* 等待上一块数据发送完成*/
+        if (is_busy == USB_TRUE) {
+            is_busy = USB_FALSE;
+
+            ret = usbd_ms_trans_wait(p_ms, USBD_MS_WAIT_TIMEOUT, &wr_len);
+            if (ret != USB_OK) {
+                return ret;
+            } else if (wr_len != len) {
+                return -USB_EWRITE;
+            }
+        }
+
         /* 如果有错误产生，上报它和它的位置*/
         if (blk_rd < tmp) {
             p_ms->p_lu_select->lu.lu.sd           = SCSI_SK_UNRECOVERED_READ_ERROR;
@@ -364,21 +593,29 @@ static int __read(struct usbd_ms *p_ms){
             return 0;
         }
 
-        ret = usbd_ms_write(p_ms,
-                            blk_rd * p_ms->p_lu_select->blk_size,
-                            USBD_MS_WAIT_TIMEOUT,
-                           &wr_len);
-
+        len = blk_rd * p_ms->p_lu_select->blk_size;
+        ret = usbd_ms_trans_start(p_ms, USB_DIR_IN, p_bufs[cur], len);
         if (ret != USB_OK) {
             return ret;
-        } else if (wr_len != (blk_rd * p_ms->p_lu_select->blk_size)) {
-            return -USB_EWRITE;
         }
+        is_busy = USB_TRUE;
+        cur    ^= 1;
+
         if (n_blks == 0) {
             break;
         }
     };
 
+    /* 等待最后一块数据发送完成*/
+    if (is_busy == USB_TRUE) {
+        ret = usbd_ms_trans_wait(p_ms, USBD_MS_WAIT_TIMEOUT, &wr_len);
+        if (ret != USB_OK) {
+            return ret;
+        } else if (wr_len != len) {
+            return -USB_EWRITE;
+        }
+    }
+
     return 0;
 }
 
@@ -424,10 +661,14 @@ static int __read10(struct usbd_ms *p_ms){
  * \brief 写
  */
 static int __write(struct usbd_ms *p_ms){
-    struct usbd_ms_lu *p_lu = p_ms->p_lu_select;
+    struct usbd_ms_lu *p_lu         = p_ms->p_lu_select;
     uint32_t           uoff, lba, nout, n_blks, n_blks_act;
     uint32_t           rd_len, blk_wr, blk_wr_ret;
-    int                ret;
+    uint8_t           *p_bufs[2]    = {p_ms->p_buf, p_ms->p_buf_db};
+    int                cur          = 0;
+    usb_bool_t         is_busy      = USB_FALSE;
+    usb_bool_t         is_out_range = USB_FALSE;
+    int                ret, ret_tmp;
 
     /* 只读*/
     if (p_lu->lu.lu.is_rdonly == USB_TRUE) {
@@ -468,24 +709,23 @@ static int __write(struct usbd_ms *p_ms){
         return -USB_EPERM;
     }
 
+    /* 后端支持异步写*/
+    if ((p_ms->n_reqs > 0) && (p_ms->p_opts->p_fn_blk_write_submit != NULL)) {
+        return __write_async(p_ms, lba);
+    }
+
     n_blks     = p_ms->info.info.cdlen / p_lu->blk_size;
     n_blks_act = p_ms->buf_size / p_lu->blk_size;
     uoff       = lba;
 
+    /* 先启动第一块数据的接收，之后两个缓存轮流使用，媒体写这一块数据的同时，USB 接收下一块数据*/
+    nout = min(n_blks, n_blks_act);
+    ret  = usbd_ms_trans_start(p_ms, USB_DIR_OUT, p_bufs[cur], nout * p_lu->blk_size);
+
     while (n_blks > 0) {
-        if (uoff >= p_lu->n_blks) {
-            p_lu->lu.lu.sd           = SCSI_SK_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
-            p_lu->lu.lu.sd_info      = uoff;
-            p_lu->lu.lu.is_inf_valid = USB_TRUE;
-            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
-            return -USB_EILLEGAL;
+        if (ret == USB_OK) {
+            ret = usbd_ms_trans_wait(p_ms, USBD_MS_WAIT_TIMEOUT, &rd_len);
         }
-
-        nout    = min(n_blks, n_blks_act);
-        uoff   += nout;
-        n_blks -= nout;
-
-        ret = usbd_ms_read(p_ms, nout * p_lu->blk_size, USBD_MS_WAIT_TIMEOUT, &rd_len);
         if (ret != USB_OK) {
             p_lu->lu.lu.sd           = SCSI_SK_COMMUNICATION_FAILURE;
             p_lu->lu.lu.sd_info      = lba;
@@ -495,23 +735,52 @@ static int __write(struct usbd_ms *p_ms){
         } else if (rd_len != (nout * p_lu->blk_size)) {
             return -USB_EREAD;
         }
-        blk_wr = nout;
+        blk_wr  = nout;
+        uoff   += nout;
+        n_blks -= nout;
 
-        ret = p_ms->p_opts->p_fn_blk_write(p_lu, p_ms->p_buf, lba, blk_wr, &blk_wr_ret);
-        if (ret != USB_OK) {
-            __USB_ERR_INFO("usb mass storage device write failed(%d)\r\n", ret);
-            return ret;
+        /* 启动下一块数据的接收*/
+        is_busy = USB_FALSE;
+        if (n_blks > 0) {
+            if (uoff >= p_lu->n_blks) {
+                is_out_range = USB_TRUE;
+            } else {
+                nout = min(n_blks, n_blks_act);
+                ret  = usbd_ms_trans_start(p_ms, USB_DIR_OUT, p_bufs[cur ^ 1], nout * p_lu->blk_size);
+                if (ret == USB_OK) {
+                    is_busy = USB_TRUE;
+                }
+            }
         }
-        if (blk_wr_ret != blk_wr) {
-             p_lu->lu.lu.sd           = SCSI_SK_WRITE_ERROR;
-             p_lu->lu.lu.sd_info      = lba;
-             p_lu->lu.lu.is_inf_valid = USB_TRUE;
-             p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
-             return -USB_EWRITE;
+
+        ret_tmp = p_ms->p_opts->p_fn_blk_write(p_lu, p_bufs[cur], lba, blk_wr, &blk_wr_ret);
+        if ((ret_tmp != USB_OK) || (blk_wr_ret != blk_wr)) {
+            /* 等待正在接收的数据，不处理结果*/
+            if (is_busy == USB_TRUE) {
+                usbd_ms_trans_wait(p_ms, USBD_MS_WAIT_TIMEOUT, &rd_len);
+            }
+            if (ret_tmp != USB_OK) {
+                __USB_ERR_INFO("usb mass storage device write failed(%d)\r\n", ret_tmp);
+                return ret_tmp;
+            }
+            p_lu->lu.lu.sd           = SCSI_SK_WRITE_ERROR;
+            p_lu->lu.lu.sd_info      = lba;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return -USB_EWRITE;
         }
 
         lba                  +=  blk_wr_ret;
         p_ms->info.info.dlen -= (blk_wr_ret * p_lu->blk_size);
+        cur                  ^=  1;
+
+        if (is_out_range == USB_TRUE) {
+            p_lu->lu.lu.sd           = SCSI_SK_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+            p_lu->lu.lu.sd_info      = uoff;
+            p_lu->lu.lu.is_inf_valid = USB_TRUE;
+            p_ms->info.info.sta      = USB_BBB_CSW_STA_FAIL;
+            return -USB_EILLEGAL;
+        }
     }
     return 0;
 }
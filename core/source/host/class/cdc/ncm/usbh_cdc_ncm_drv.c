@@ -0,0 +1,733 @@
+/**
+ * \brief NCM(Network Control Model) 网络控制模型
+ */
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include "core/include/host/class/cdc/ncm/usbh_cdc_ncm_drv.h"
+
+/*******************************************************************************
+ * Extern
+ ******************************************************************************/
+extern struct usbh_net_lib __g_usbh_net_lib;
+extern int usbh_net_generic_cdc_bind(struct usbh_net *p_net, struct usbh_interface *p_intf);
+extern int usbh_net_cdc_unbind(struct usbh_net *p_net);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+/**
+ * \brief 计算 NDP 的长度(包括结束入口)
+ */
+static uint32_t __ncm_ndp_len(struct usbh_ncm_priv *p_priv, uint32_t n_dgram){
+    if (p_priv->ntb_format == USB_CDC_NCM_NTB32_FORMAT) {
+        return sizeof(struct usb_cdc_ncm_ndp32) + (n_dgram + 1) * sizeof(struct usb_cdc_ncm_dpe32);
+    }
+    return sizeof(struct usb_cdc_ncm_ndp16) + (n_dgram + 1) * sizeof(struct usb_cdc_ncm_dpe16);
+}
+
+/**
+ * \brief 计算 NTB 头的长度
+ */
+static uint32_t __ncm_nth_len(struct usbh_ncm_priv *p_priv){
+    if (p_priv->ntb_format == USB_CDC_NCM_NTB32_FORMAT) {
+        return sizeof(struct usb_cdc_ncm_nth32);
+    }
+    return sizeof(struct usb_cdc_ncm_nth16);
+}
+
+/**
+ * \brief 计算数据报偏移，满足 偏移 % 除数 == 余数
+ */
+static uint32_t __ncm_dgram_align(struct usbh_ncm_priv *p_priv, uint32_t offset){
+    return offset + (p_priv->tx_modulus + p_priv->tx_remainder -
+                    (offset % p_priv->tx_modulus)) % p_priv->tx_modulus;
+}
+
+/**
+ * \brief 检查发送 NTB 是否还能放入一个数据报
+ */
+static usb_bool_t __ncm_dgram_fit(struct usbh_ncm_priv *p_priv, uint32_t len){
+    uint32_t offset;
+
+    offset = __ncm_dgram_align(p_priv, p_priv->tx_ntb_len) + len;
+    offset = USB_ALIGN(offset, p_priv->tx_ndp_align);
+    /* 预留一个字节用于避免 NTB 长度是最大包大小的整数倍*/
+    offset += __ncm_ndp_len(p_priv, p_priv->tx_n_dgram + 1) + 1;
+
+    return (offset <= p_priv->tx_max);
+}
+
+/**
+ * \brief 完成发送 NTB，填充 NTB 头和 NDP
+ */
+static void __ncm_ntb_finish(struct usbh_net       *p_net,
+                             struct usbh_ncm_priv  *p_priv,
+                             uint8_t              **p_tx_buf,
+                             uint32_t              *p_tx_len){
+    uint32_t  ndp_idx, block_len, i;
+    uint8_t  *p_ntb = p_priv->p_tx_ntb;
+
+    ndp_idx   = USB_ALIGN(p_priv->tx_ntb_len, p_priv->tx_ndp_align);
+    block_len = ndp_idx + __ncm_ndp_len(p_priv, p_priv->tx_n_dgram);
+
+    memset(p_ntb + p_priv->tx_ntb_len, 0, block_len - p_priv->tx_ntb_len);
+
+    /* NCM 不使用零长度包，NTB 长度是最大包大小的整数倍时多加一个字节变成短包*/
+    if (((block_len % p_net->max_packet) == 0) && (block_len < p_priv->tx_max)) {
+        p_ntb[block_len++] = 0;
+    }
+
+    if (p_priv->ntb_format == USB_CDC_NCM_NTB32_FORMAT) {
+        struct usb_cdc_ncm_nth32 *p_nth = (void *)p_ntb;
+        struct usb_cdc_ncm_ndp32 *p_ndp = (void *)(p_ntb + ndp_idx);
+
+        p_nth->signature      = USB_CPU_TO_LE32(USB_CDC_NCM_NTH32_SIGN);
+        p_nth->header_length  = USB_CPU_TO_LE16(sizeof(struct usb_cdc_ncm_nth32));
+        p_nth->sequence       = USB_CPU_TO_LE16(p_priv->tx_seq);
+        p_nth->block_length   = USB_CPU_TO_LE32(block_len);
+        p_nth->ndp_index      = USB_CPU_TO_LE32(ndp_idx);
+
+        p_ndp->signature      = USB_CPU_TO_LE32(USB_CDC_NCM_NDP32_NOCRC_SIGN);
+        p_ndp->length         = USB_CPU_TO_LE16(__ncm_ndp_len(p_priv, p_priv->tx_n_dgram));
+        p_ndp->next_ndp_index = 0;
+        for (i = 0; i < p_priv->tx_n_dgram; i++) {
+            p_ndp->dpe32[i].datagram_index  = USB_CPU_TO_LE32(p_priv->tx_dgram_idx[i]);
+            p_ndp->dpe32[i].datagram_length = USB_CPU_TO_LE32(p_priv->tx_dgram_len[i]);
+        }
+    } else {
+        struct usb_cdc_ncm_nth16 *p_nth = (void *)p_ntb;
+        struct usb_cdc_ncm_ndp16 *p_ndp = (void *)(p_ntb + ndp_idx);
+
+        p_nth->signature      = USB_CPU_TO_LE32(USB_CDC_NCM_NTH16_SIGN);
+        p_nth->header_length  = USB_CPU_TO_LE16(sizeof(struct usb_cdc_ncm_nth16));
+        p_nth->sequence       = USB_CPU_TO_LE16(p_priv->tx_seq);
+        p_nth->block_length   = USB_CPU_TO_LE16(block_len);
+        p_nth->ndp_index      = USB_CPU_TO_LE16(ndp_idx);
+
+        p_ndp->signature      = USB_CPU_TO_LE32(USB_CDC_NCM_NDP16_NOCRC_SIGN);
+        p_ndp->length         = USB_CPU_TO_LE16(__ncm_ndp_len(p_priv, p_priv->tx_n_dgram));
+        p_ndp->next_ndp_index = 0;
+        for (i = 0; i < p_priv->tx_n_dgram; i++) {
+            p_ndp->dpe16[i].datagram_index  = USB_CPU_TO_LE16(p_priv->tx_dgram_idx[i]);
+            p_ndp->dpe16[i].datagram_length = USB_CPU_TO_LE16(p_priv->tx_dgram_len[i]);
+        }
+    }
+
+    p_priv->tx_seq++;
+    p_priv->tx_n_dgram = 0;
+    p_priv->tx_ntb_len = __ncm_nth_len(p_priv);
+
+    *p_tx_buf = p_ntb;
+    *p_tx_len = block_len;
+}
+
+/**
+ * \brief USB 主机 NCM 设备发送修正，把帧积累到发送 NTB 中
+ */
+static int __ncm_tx_fixup(struct usbh_net  *p_net,
+                          uint8_t          *p_buf,
+                          uint32_t          buf_len,
+                          uint8_t         **p_tx_buf,
+                          uint32_t         *p_tx_len){
+    uint32_t              offset;
+    struct usbh_ncm_priv *p_priv = p_net->p_drv_priv;
+
+    if (p_priv == NULL) {
+        return -USB_ENODEV;
+    }
+
+    if (__ncm_dgram_fit(p_priv, buf_len) == USB_FALSE) {
+        /* 空的 NTB 也放不下*/
+        if (p_priv->tx_n_dgram == 0) {
+            return -USB_ESIZE;
+        }
+        /* 先发送已经积累的 NTB，再重新放入这个帧*/
+        __ncm_ntb_finish(p_net, p_priv, p_tx_buf, p_tx_len);
+
+        return -USB_EAGAIN;
+    }
+
+    offset = __ncm_dgram_align(p_priv, p_priv->tx_ntb_len);
+    /* 对齐填充清零*/
+    memset(p_priv->p_tx_ntb + p_priv->tx_ntb_len, 0, offset - p_priv->tx_ntb_len);
+    memcpy(p_priv->p_tx_ntb + offset, p_buf, buf_len);
+
+    p_priv->tx_dgram_idx[p_priv->tx_n_dgram] = offset;
+    p_priv->tx_dgram_len[p_priv->tx_n_dgram] = buf_len;
+    p_priv->tx_n_dgram++;
+    p_priv->tx_ntb_len = offset + buf_len;
+
+    /* 达到最大数据报数量或者不积累，马上发送*/
+    if ((p_priv->tx_n_dgram >= p_priv->tx_dgram_max) || (p_net->tx_timeout == 0)) {
+        __ncm_ntb_finish(p_net, p_priv, p_tx_buf, p_tx_len);
+    } else {
+        *p_tx_len = 0;
+    }
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机 NCM 设备发送冲刷，结束当前积累的 NTB
+ */
+static int __ncm_tx_flush(struct usbh_net  *p_net,
+                          uint8_t         **p_tx_buf,
+                          uint32_t         *p_tx_len){
+    struct usbh_ncm_priv *p_priv = p_net->p_drv_priv;
+
+    *p_tx_len = 0;
+
+    if ((p_priv == NULL) || (p_priv->tx_n_dgram == 0)) {
+        return USB_OK;
+    }
+    __ncm_ntb_finish(p_net, p_priv, p_tx_buf, p_tx_len);
+
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机 NCM 设备接收修正，从接收 NTB 中取出下一个数据报
+ *
+ * p_pos[0] 是当前 NDP 的偏移(0 表示还没有解析 NTB 头)，p_pos[1] 是当前 NDP 的入口索引
+ */
+static int __ncm_rx_fixup(struct usbh_net          *p_net,
+                          uint8_t                  *p_buf,
+                          uint32_t                  buf_len,
+                          uint32_t                 *p_pos,
+                          struct usbh_net_rx_frame *p_frame){
+    uint32_t   block_len, ndp_len, n_dpe, nth_len, ndp_hdr_len;
+    uint32_t   dgram_idx, dgram_len, next_ndp;
+    usb_bool_t is_ntb32;
+
+    if (buf_len < sizeof(struct usb_cdc_ncm_nth16)) {
+        return -USB_END;
+    }
+    is_ntb32 = (USB_CPU_TO_LE32(((struct usb_cdc_ncm_nth16 *)p_buf)->signature) == USB_CDC_NCM_NTH32_SIGN);
+
+    /* 解析 NTB 头*/
+    if (is_ntb32) {
+        struct usb_cdc_ncm_nth32 *p_nth = (void *)p_buf;
+
+        if ((buf_len < sizeof(struct usb_cdc_ncm_nth32)) ||
+                (USB_CPU_TO_LE16(p_nth->header_length) != sizeof(struct usb_cdc_ncm_nth32))) {
+            return -USB_EILLEGAL;
+        }
+        block_len   = USB_CPU_TO_LE32(p_nth->block_length);
+        next_ndp    = USB_CPU_TO_LE32(p_nth->ndp_index);
+        nth_len     = sizeof(struct usb_cdc_ncm_nth32);
+        ndp_hdr_len = sizeof(struct usb_cdc_ncm_ndp32);
+    } else {
+        struct usb_cdc_ncm_nth16 *p_nth = (void *)p_buf;
+
+        if ((USB_CPU_TO_LE32(p_nth->signature) != USB_CDC_NCM_NTH16_SIGN) ||
+                (USB_CPU_TO_LE16(p_nth->header_length) != sizeof(struct usb_cdc_ncm_nth16))) {
+            return -USB_EILLEGAL;
+        }
+        block_len   = USB_CPU_TO_LE16(p_nth->block_length);
+        next_ndp    = USB_CPU_TO_LE16(p_nth->ndp_index);
+        nth_len     = sizeof(struct usb_cdc_ncm_nth16);
+        ndp_hdr_len = sizeof(struct usb_cdc_ncm_ndp16);
+    }
+    /* 块长度为 0 表示 NTB 以短包结束*/
+    if ((block_len == 0) || (block_len > buf_len)) {
+        block_len = buf_len;
+    }
+    if (p_pos[0] == 0) {
+        p_pos[0] = next_ndp;
+        p_pos[1] = 0;
+    }
+
+    while (1) {
+        /* NDP 必须在 NTB 头之后，且不能越界*/
+        if ((p_pos[0] < nth_len) || (block_len < ndp_hdr_len) ||
+                (p_pos[0] > (block_len - ndp_hdr_len))) {
+            return -USB_END;
+        }
+        /* 规范要求 NDP 4 字节对齐，不对齐的偏移按结构体访问会产生非对齐访问*/
+        if ((p_pos[0] & 3) != 0) {
+            __USB_ERR_INFO("USB host NCM NDP index %d unaligned\r\n", p_pos[0]);
+            return -USB_EILLEGAL;
+        }
+        if (is_ntb32) {
+            struct usb_cdc_ncm_ndp32 *p_ndp = (void *)(p_buf + p_pos[0]);
+
+            ndp_len  = USB_CPU_TO_LE16(p_ndp->length);
+            next_ndp = USB_CPU_TO_LE32(p_ndp->next_ndp_index);
+            if (USB_CPU_TO_LE32(p_ndp->signature) != USB_CDC_NCM_NDP32_NOCRC_SIGN) {
+                return -USB_EILLEGAL;
+            }
+        } else {
+            struct usb_cdc_ncm_ndp16 *p_ndp = (void *)(p_buf + p_pos[0]);
+
+            ndp_len  = USB_CPU_TO_LE16(p_ndp->length);
+            next_ndp = USB_CPU_TO_LE16(p_ndp->next_ndp_index);
+            if (USB_CPU_TO_LE32(p_ndp->signature) != USB_CDC_NCM_NDP16_NOCRC_SIGN) {
+                return -USB_EILLEGAL;
+            }
+        }
+        if ((ndp_len < ndp_hdr_len) || ((p_pos[0] + ndp_len) > block_len)) {
+            return -USB_EILLEGAL;
+        }
+        n_dpe = (ndp_len - ndp_hdr_len) /
+                (is_ntb32 ? sizeof(struct usb_cdc_ncm_dpe32) : sizeof(struct usb_cdc_ncm_dpe16));
+
+        while (p_pos[1] < n_dpe) {
+            if (is_ntb32) {
+                struct usb_cdc_ncm_ndp32 *p_ndp = (void *)(p_buf + p_pos[0]);
+
+                dgram_idx = USB_CPU_TO_LE32(p_ndp->dpe32[p_pos[1]].datagram_index);
+                dgram_len = USB_CPU_TO_LE32(p_ndp->dpe32[p_pos[1]].datagram_length);
+            } else {
+                struct usb_cdc_ncm_ndp16 *p_ndp = (void *)(p_buf + p_pos[0]);
+
+                dgram_idx = USB_CPU_TO_LE16(p_ndp->dpe16[p_pos[1]].datagram_index);
+                dgram_len = USB_CPU_TO_LE16(p_ndp->dpe16[p_pos[1]].datagram_length);
+            }
+            /* 结束入口*/
+            if ((dgram_idx == 0) || (dgram_len == 0)) {
+                break;
+            }
+            p_pos[1]++;
+
+            /* 越界的数据报丢弃*/
+            if ((dgram_idx > block_len) || (dgram_len > (block_len - dgram_idx))) {
+                __USB_ERR_INFO("USB host NCM bad datagram %d, %d\r\n", dgram_idx, dgram_len);
+                continue;
+            }
+            p_frame->p_data = p_buf + dgram_idx;
+            p_frame->len    = dgram_len;
+
+            return USB_OK;
+        }
+        /* 下一个 NDP 只能往后，防止循环*/
+        if (next_ndp <= p_pos[0]) {
+            return -USB_END;
+        }
+        p_pos[0] = next_ndp;
+        p_pos[1] = 0;
+    }
+}
+
+/**
+ * \brief USB 主机 NCM 设备获取 NCM 功能描述符
+ */
+static struct usb_cdc_ncm_desc *__ncm_desc_find(struct usbh_interface *p_intf){
+    uint8_t *p_buf = p_intf->p_extra;
+    int      len   = p_intf->extra_len;
+
+    while (len > 3) {
+        if ((p_buf[1] == (USB_REQ_TYPE_CLASS | USB_DT_INTERFACE)) &&
+                (p_buf[2] == USB_CDC_NCM_TYPE) &&
+                (p_buf[0] >= sizeof(struct usb_cdc_ncm_desc))) {
+            return (void *)p_buf;
+        }
+        if (p_buf[0] == 0) {
+            break;
+        }
+        len   -= p_buf[0];
+        p_buf += p_buf[0];
+    }
+    return NULL;
+}
+
+/**
+ * \brief USB 主机 NCM 设备协商 NTB 参数
+ */
+static int __ncm_ntb_setup(struct usbh_net *p_net, struct usbh_ncm_priv *p_priv){
+    int                    ret;
+    uint8_t                intf_num;
+    uint32_t               rx_max, tx_max;
+    uint32_t               input_size[2];
+    struct usbh_cdc_state *p_state = (void *)&p_net->data;
+
+    intf_num = USBH_INTF_NUM_GET(p_state->p_control);
+
+    /* 获取 NTB 参数*/
+    ret = usbh_ctrl_trp_sync_xfer(&p_net->p_usb_fun->p_usb_dev->ep0,
+                                   USB_DIR_IN | USB_REQ_TYPE_CLASS | USB_REQ_TAG_INTERFACE,
+                                   USB_CDC_GET_NTB_PARAMETERS,
+                                   0,
+                                   intf_num,
+                                   sizeof(struct usb_cdc_ncm_ntb_parameters),
+                                  &p_priv->ntb_param,
+                                   5000,
+                                   0);
+    if (ret < (int)sizeof(struct usb_cdc_ncm_ntb_parameters)) {
+        __USB_ERR_INFO("USB host NCM NTB parameters get failed(%d)\r\n", ret);
+        return ret < 0 ? ret : -USB_EILLEGAL;
+    }
+
+    rx_max = USB_CPU_TO_LE32(p_priv->ntb_param.ntb_in_max_size);
+    tx_max = USB_CPU_TO_LE32(p_priv->ntb_param.ntb_out_max_size);
+
+    p_priv->rx_max = rx_max > USBH_NCM_NTB_RX_SIZE_MAX ? USBH_NCM_NTB_RX_SIZE_MAX : rx_max;
+    p_priv->tx_max = tx_max > USBH_NCM_NTB_TX_SIZE_MAX ? USBH_NCM_NTB_TX_SIZE_MAX : tx_max;
+    if ((p_priv->rx_max < USBH_NCM_NTB_SIZE_MIN) || (p_priv->tx_max < USBH_NCM_NTB_SIZE_MIN)) {
+        __USB_ERR_INFO("USB host NCM NTB size %d/%d illegal\r\n", rx_max, tx_max);
+        return -USB_EILLEGAL;
+    }
+
+    /* NTB16 最大只能 64K，超过时需要设备支持 NTB32*/
+    p_priv->ntb_format = USB_CDC_NCM_NTB16_FORMAT;
+    if ((p_priv->rx_max > 0xFFFF) || (p_priv->tx_max > 0xFFFF)) {
+        if (USB_CPU_TO_LE16(p_priv->ntb_param.ntb_formats_supported) & USB_CDC_NCM_NTB32_SUPPORTED) {
+            p_priv->ntb_format = USB_CDC_NCM_NTB32_FORMAT;
+        } else {
+            p_priv->rx_max = p_priv->rx_max > 0xFFFF ? 0xFFFF : p_priv->rx_max;
+            p_priv->tx_max = p_priv->tx_max > 0xFFFF ? 0xFFFF : p_priv->tx_max;
+        }
+    }
+
+    /* 发送对齐参数，不合法时用规范默认值*/
+    p_priv->tx_modulus   = USB_CPU_TO_LE16(p_priv->ntb_param.ndp_out_divisor);
+    p_priv->tx_remainder = USB_CPU_TO_LE16(p_priv->ntb_param.ndp_out_payload_remainder);
+    p_priv->tx_ndp_align = USB_CPU_TO_LE16(p_priv->ntb_param.ndp_out_alignment);
+    if ((p_priv->tx_modulus < 4) || (p_priv->tx_modulus > (p_priv->tx_max / 4))) {
+        p_priv->tx_modulus = 4;
+    }
+    if (p_priv->tx_remainder >= p_priv->tx_modulus) {
+        p_priv->tx_remainder = 0;
+    }
+    if ((p_priv->tx_ndp_align < 4) || (p_priv->tx_ndp_align & (p_priv->tx_ndp_align - 1)) ||
+            (p_priv->tx_ndp_align > (p_priv->tx_max / 4))) {
+        p_priv->tx_ndp_align = 4;
+    }
+    p_priv->tx_dgram_max = USB_CPU_TO_LE16(p_priv->ntb_param.ntb_out_max_datagrams);
+    if ((p_priv->tx_dgram_max == 0) || (p_priv->tx_dgram_max > USBH_NCM_TX_DGRAM_MAX)) {
+        p_priv->tx_dgram_max = USBH_NCM_TX_DGRAM_MAX;
+    }
+
+    /* 设置 NTB 格式*/
+    if (USB_CPU_TO_LE16(p_priv->ntb_param.ntb_formats_supported) & USB_CDC_NCM_NTB32_SUPPORTED) {
+        ret = usbh_ctrl_trp_sync_xfer(&p_net->p_usb_fun->p_usb_dev->ep0,
+                                       USB_REQ_TYPE_CLASS | USB_REQ_TAG_INTERFACE,
+                                       USB_CDC_SET_NTB_FORMAT,
+                                       p_priv->ntb_format,
+                                       intf_num,
+                                       0,
+                                       NULL,
+                                       5000,
+                                       0);
+        if (ret < 0) {
+            __USB_ERR_INFO("USB host NCM NTB format set failed(%d)\r\n", ret);
+            return ret;
+        }
+    }
+
+    /* 设置接收 NTB 大小*/
+    if (p_priv->rx_max != rx_max) {
+        input_size[0] = USB_CPU_TO_LE32(p_priv->rx_max);
+        input_size[1] = 0;
+
+        ret = usbh_ctrl_trp_sync_xfer(&p_net->p_usb_fun->p_usb_dev->ep0,
+                                       USB_REQ_TYPE_CLASS | USB_REQ_TAG_INTERFACE,
+                                       USB_CDC_SET_NTB_INPUT_SIZE,
+                                       0,
+                                       intf_num,
+                                      (p_priv->p_ncm_desc &&
+                                      (p_priv->p_ncm_desc->network_capabilities & USB_CDC_NCM_NCAP_NTB_INPUT_SIZE)) ? 8 : 4,
+                                       input_size,
+                                       5000,
+                                       0);
+        if (ret < 0) {
+            __USB_ERR_INFO("USB host NCM NTB input size set failed(%d)\r\n", ret);
+            return ret;
+        }
+    }
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机 NCM 设备解除绑定
+ */
+static int __ncm_unbind(struct usbh_net *p_net){
+    struct usbh_ncm_priv *p_priv = p_net->p_drv_priv;
+
+    if (p_priv) {
+        if (p_priv->p_tx_ntb) {
+            usb_lib_mfree(&__g_usbh_net_lib.lib, p_priv->p_tx_ntb);
+        }
+        usb_lib_mfree(&__g_usbh_net_lib.lib, p_priv);
+        p_net->p_drv_priv = NULL;
+    }
+    return usbh_net_cdc_unbind(p_net);
+}
+
+/**
+ * \brief USB 主机 NCM 设备绑定
+ */
+static int __ncm_bind(struct usbh_net *p_net){
+    int                    ret;
+    uint8_t                data_intf_num, data_alt = 0;
+    struct usbh_ncm_priv  *p_priv  = NULL;
+    struct usbh_cdc_state *p_state = (void *)&p_net->data;
+
+    ret = usbh_net_generic_cdc_bind(p_net, p_net->p_intf);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    ret = usbh_net_ethernet_addr_get(p_net, p_state->p_ether->mac_address);
+    if (ret != USB_OK) {
+        goto __failed;
+    }
+
+    p_priv = usb_lib_malloc(&__g_usbh_net_lib.lib, sizeof(struct usbh_ncm_priv));
+    if (p_priv == NULL) {
+        ret = -USB_ENOMEM;
+        goto __failed;
+    }
+    memset(p_priv, 0, sizeof(struct usbh_ncm_priv));
+
+    p_net->p_drv_priv  = p_priv;
+    p_priv->p_ncm_desc = __ncm_desc_find(p_state->p_control);
+    p_net->tx_timeout  = USBH_NCM_TX_TIMEOUT_DEF;
+
+    /* 通用绑定已经把数据接口设置成有端点的备用设置*/
+    data_intf_num = USBH_INTF_NUM_GET(p_state->p_data);
+    if (USBH_INTF_NUM_GET(p_net->p_intf) == data_intf_num) {
+        data_alt = USBH_INTF_ALT_NUM_GET(p_net->p_intf);
+    }
+    /* NTB 参数要在数据接口为备用设置 0 时设置，设置备用设置 0 会复位设备的 NTB 参数*/
+    if (data_alt != 0) {
+        ret = usbh_func_intf_set(p_net->p_usb_fun, data_intf_num, 0);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+    }
+
+    ret = __ncm_ntb_setup(p_net, p_priv);
+    if (ret != USB_OK) {
+        goto __failed;
+    }
+
+    if (data_alt != 0) {
+        ret = usbh_func_intf_set(p_net->p_usb_fun, data_intf_num, data_alt);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+    }
+
+    p_priv->p_tx_ntb = usb_lib_malloc(&__g_usbh_net_lib.lib, p_priv->tx_max);
+    if (p_priv->p_tx_ntb == NULL) {
+        ret = -USB_ENOMEM;
+        goto __failed;
+    }
+    p_priv->tx_ntb_len = __ncm_nth_len(p_priv);
+
+    /* 一个接收传输请求包接收一个完整的 NTB*/
+    p_net->rx_trp_size = p_priv->rx_max;
+    /* 一个发送传输请求包发送一个完整的 NTB*/
+    p_net->tx_trp_size = p_priv->tx_max;
+
+    __USB_INFO("USB host NCM NTB%d rx %d tx %d\r\n",
+                p_priv->ntb_format == USB_CDC_NCM_NTB32_FORMAT ? 32 : 16,
+                p_priv->rx_max, p_priv->tx_max);
+
+    return USB_OK;
+__failed:
+    /* 释放私有数据并释放通用绑定声明的数据接口*/
+    __ncm_unbind(p_net);
+
+    return ret;
+}
+
+/**
+ * \brief USB 主机 NCM 设备状态处理函数
+ */
+static void __ncm_status(struct usbh_net *p_net, struct usbh_trp *p_trp){
+    struct usb_cdc_notification *p_event = NULL;
+
+    if (p_trp->act_len < sizeof(struct usb_cdc_notification)) {
+        return;
+    }
+
+    p_event = p_trp->p_data_dma;
+
+    switch (p_event->notification_type) {
+        /* 网络连接*/
+        case USB_CDC_NOTIFY_NETWORK_CONNECTION:
+            usbh_net_link_change(p_net, !!p_event->value, 0);
+            break;
+        /* 发送/接收速率改变*/
+        case USB_CDC_NOTIFY_SPEED_CHANGE:
+            break;
+        default:
+            __USB_ERR_INFO("usb host NCM notification %02x unexpected\r\n", p_event->notification_type);
+            break;
+    }
+}
+
+/* \brief CDC NCM 设备*/
+static const struct usbh_net_drv_info __g_ncm_info = {
+    .p_desc            = "CDC NCM",
+    .flags             =  USB_NET_ETHER | USB_NET_POINTTOPOINT | USB_NET_DRV_FLAG_MULTI_PACKET,
+    .p_fn_bind         =  __ncm_bind,
+    .p_fn_unbind       =  __ncm_unbind,
+    .p_fn_status       =  __ncm_status,
+    .p_fn_rx_fixup     =  __ncm_rx_fixup,
+    .p_fn_tx_fixup     =  __ncm_tx_fixup,
+    .p_fn_tx_flush     =  __ncm_tx_flush,
+    .p_fn_power_manage =  NULL,
+};
+
+/**
+ * \brief USB 主机 NCM 设备探测函数
+ *
+ * \param[in] p_usb_fun USB 接口功能结构体
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_probe(struct usbh_function *p_usb_fun){
+    if ((USBH_FUNC_CLASS_GET(p_usb_fun) == USB_CLASS_COMM) &&
+            (USBH_FUNC_SUBCLASS_GET(p_usb_fun) == USB_CDC_SUBCLASS_NCM) &&
+            (USBH_FUNC_PROTO_GET(p_usb_fun) == 0)) {
+        p_usb_fun->func_type = USBH_FUNC_UNIC;
+        return USB_OK;
+    }
+    return -USB_ENOTSUP;
+}
+
+/**
+ * \brief USB 主机 NCM 设备创建函数
+ *
+ * \param[in] p_usb_fun USB 接口功能结构体
+ * \param[in] p_name    USB 主机 NCM 设备名字
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_create(struct usbh_function *p_usb_fun, char *p_name){
+    int ret;
+
+    if ((p_usb_fun == NULL) || (p_name == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    ret = usbh_ncm_probe(p_usb_fun);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("usb function is not NCM\r\n");
+        return ret;
+    }
+
+    ret = usbh_net_create(p_usb_fun, p_name, &__g_ncm_info);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("usb host net create failed(%d)\r\n", ret);
+    }
+
+    return ret;
+}
+
+/**
+ * \brief  USB 主机 NCM 设备销毁函数
+ *
+ * \param[in] p_usb_fun USB 接口功能结构体
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_destroy(struct usbh_function *p_usb_fun){
+    return usbh_net_destroy(p_usb_fun);
+}
+
+/**
+ * \brief USB 主机 NCM 设备打开函数
+ *
+ * \param[in]  p_handle  打开句柄
+ * \param[in]  flag      打开标志，本接口支持两种打开方式：
+ *                       USBH_DEV_OPEN_BY_NAME 是通过名字打开设备
+ *                       USBH_DEV_OPEN_BY_UFUN 是通过 USB 功能结构体打开设备
+ * \param[out] p_net_ret 成功返回 USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_open(void             *p_handle,
+                  uint8_t           flag,
+                  struct usbh_net **p_net_ret){
+    return usbh_net_open(p_handle, flag, p_net_ret);
+}
+
+/**
+ * \brief USB 主机 NCM 设备关闭函数
+ *
+ * \param[in] p_net USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_close(struct usbh_net *p_net){
+    return usbh_net_close(p_net);
+}
+
+/**
+ * \brief USB 主机 NCM 设备启动函数
+ *
+ * \param[in] p_net USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_start(struct usbh_net *p_net){
+    return usbh_net_start(p_net);
+}
+
+/**
+ * \brief USB 主机 NCM 设备停止函数
+ *
+ * \param[in] p_net USB 主机网络设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_stop(struct usbh_net *p_net){
+    return usbh_net_stop(p_net);
+}
+
+/**
+ * \brief USB 主机 NCM 设备写函数，帧先积累到发送 NTB 中，NTB 满、达到最大数据报数量
+ *        或者积累超时(在 usbh_net_process() 中检查)后才发送
+ *
+ * \param[in] p_net   USB 主机网络设备
+ * \param[in] p_buf   写缓存
+ * \param[in] buf_len 写缓存长度
+ *
+ * \retval 成功返回实际写的长度
+ */
+int usbh_ncm_write(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len){
+    return usbh_net_write(p_net, p_buf, buf_len);
+}
+
+/**
+ * \brief USB 主机 NCM 设备读函数
+ *
+ * \param[in] p_net   USB 主机网络设备
+ * \param[in] p_buf   读缓存
+ * \param[in] buf_len 读缓存长度
+ *
+ * \retval 成功返回读到的数据长度
+ */
+int usbh_ncm_read(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len){
+    return usbh_net_read(p_net, p_buf, buf_len);
+}
+
+/**
+ * \brief USB 主机 NCM 设备获取协商后的 NTB 大小
+ *
+ * \param[in]  p_net   USB 主机网络设备
+ * \param[out] p_rx_max 返回的接收 NTB 大小
+ * \param[out] p_tx_max 返回的发送 NTB 大小
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ncm_ntb_size_get(struct usbh_net *p_net, uint32_t *p_rx_max, uint32_t *p_tx_max){
+    struct usbh_ncm_priv *p_priv = NULL;
+
+    if ((p_net == NULL) || (p_rx_max == NULL) || (p_tx_max == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (p_net->p_drv_info != &__g_ncm_info) {
+        return -USB_ENOTSUP;
+    }
+    p_priv = p_net->p_drv_priv;
+    if (p_priv == NULL) {
+        return -USB_ENODEV;
+    }
+    *p_rx_max = p_priv->rx_max;
+    *p_tx_max = p_priv->tx_max;
+
+    return USB_OK;
+}
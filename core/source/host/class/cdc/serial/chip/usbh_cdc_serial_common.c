@@ -134,6 +134,7 @@ static int __read_trp_deinit(struct usbh_serial_common *p_common){
         }
         if (p_common->p_rd_buf[i]) {
             usbh_serial_mem_free(p_common->p_rd_buf[i]);
+            p_common->p_rd_buf[i] = NULL;
         }
     }
     return USB_OK;
@@ -285,3 +286,37 @@ int usbh_serial_common_deinit(struct usbh_serial *p_userial){
     return USB_OK;
 }
 
+/**
+ * \brief USB 转串口 通用设备停止接收，取消读请求包并释放读缓存
+ *
+ * \param[in] p_userial USB 转串口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_serial_common_rx_stop(struct usbh_serial *p_userial){
+    struct usbh_serial_common *p_common =
+            (struct usbh_serial_common *)USBH_SERIAL_DRV_HANDLE_GET(p_userial);
+
+    if (p_common == NULL) {
+        return -USB_EINVAL;
+    }
+    return __read_trp_deinit(p_common);
+}
+
+/**
+ * \brief USB 转串口 通用设备启动接收，重新分配读缓存并提交读请求包
+ *
+ * \param[in] p_userial USB 转串口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_serial_common_rx_start(struct usbh_serial *p_userial){
+    struct usbh_serial_common *p_common =
+            (struct usbh_serial_common *)USBH_SERIAL_DRV_HANDLE_GET(p_userial);
+
+    if (p_common == NULL) {
+        return -USB_EINVAL;
+    }
+    return __read_trp_init(p_common);
+}
+
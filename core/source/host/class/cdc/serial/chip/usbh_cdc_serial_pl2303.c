@@ -489,6 +489,7 @@ static int __read_trp_deinit(struct usbh_serial_pl2303 *p_pl2303){
         }
         if (p_pl2303->p_rd_buf[i]) {
             usbh_serial_mem_free(p_pl2303->p_rd_buf[i]);
+            p_pl2303->p_rd_buf[i] = NULL;
         }
     }
     return USB_OK;
@@ -644,3 +645,37 @@ int usbh_serial_pl2303_deinit(struct usbh_serial *p_userial){
 
     return USB_OK;
 }
+
+/**
+ * \brief USB 转串口 pl2303 芯片停止接收，取消读请求包并释放读缓存
+ *
+ * \param[in] p_userial USB 转串口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_serial_pl2303_rx_stop(struct usbh_serial *p_userial){
+    struct usbh_serial_pl2303 *p_pl2303 =
+            (struct usbh_serial_pl2303 *)USBH_SERIAL_DRV_HANDLE_GET(p_userial);
+
+    if (p_pl2303 == NULL) {
+        return -USB_EINVAL;
+    }
+    return __read_trp_deinit(p_pl2303);
+}
+
+/**
+ * \brief USB 转串口 pl2303 芯片启动接收，重新分配读缓存并提交读请求包
+ *
+ * \param[in] p_userial USB 转串口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_serial_pl2303_rx_start(struct usbh_serial *p_userial){
+    struct usbh_serial_pl2303 *p_pl2303 =
+            (struct usbh_serial_pl2303 *)USBH_SERIAL_DRV_HANDLE_GET(p_userial);
+
+    if (p_pl2303 == NULL) {
+        return -USB_EINVAL;
+    }
+    return __read_trp_init(p_pl2303);
+}
@@ -13,34 +13,46 @@ static struct usbh_serial_lib __g_userial_lib;
 
 static const struct usbh_serial_drv_info __g_userial_drv_info[] = {
         {
-                .p_drv_name  = "FTDI",
-                .p_fn_init   = usbh_serial_ftdi_init,
-                .p_fn_deinit = usbh_serial_ftdi_deinit,
+                .p_drv_name    = "FTDI",
+                .p_fn_init     = usbh_serial_ftdi_init,
+                .p_fn_deinit   = usbh_serial_ftdi_deinit,
+                .p_fn_rx_stop  = usbh_serial_ftdi_rx_stop,
+                .p_fn_rx_start = usbh_serial_ftdi_rx_start,
         },
         {
-                .p_drv_name  = "CH341",
-                .p_fn_init   = usbh_serial_ch341_init,
-                .p_fn_deinit = usbh_serial_ch341_deinit,
+                .p_drv_name    = "CH341",
+                .p_fn_init     = usbh_serial_ch341_init,
+                .p_fn_deinit   = usbh_serial_ch341_deinit,
+                .p_fn_rx_stop  = usbh_serial_ch341_rx_stop,
+                .p_fn_rx_start = usbh_serial_ch341_rx_start,
         },
         {
-                .p_drv_name  = "CH348",
-                .p_fn_init   = usbh_serial_ch348_init,
-                .p_fn_deinit = usbh_serial_ch348_deinit,
+                .p_drv_name    = "CH348",
+                .p_fn_init     = usbh_serial_ch348_init,
+                .p_fn_deinit   = usbh_serial_ch348_deinit,
+                .p_fn_rx_stop  = usbh_serial_ch348_rx_stop,
+                .p_fn_rx_start = usbh_serial_ch348_rx_start,
         },
         {
-                .p_drv_name  = "PL2303",
-                .p_fn_init   = usbh_serial_pl2303_init,
-                .p_fn_deinit = usbh_serial_pl2303_deinit,
+                .p_drv_name    = "PL2303",
+                .p_fn_init     = usbh_serial_pl2303_init,
+                .p_fn_deinit   = usbh_serial_pl2303_deinit,
+                .p_fn_rx_stop  = usbh_serial_pl2303_rx_stop,
+                .p_fn_rx_start = usbh_serial_pl2303_rx_start,
         },
         {
-                .p_drv_name  = "CP210X",
-                .p_fn_init   = usbh_serial_cp210x_init,
-                .p_fn_deinit = usbh_serial_cp210x_deinit,
+                .p_drv_name    = "CP210X",
+                .p_fn_init     = usbh_serial_cp210x_init,
+                .p_fn_deinit   = usbh_serial_cp210x_deinit,
+                .p_fn_rx_stop  = usbh_serial_cp210x_rx_stop,
+                .p_fn_rx_start = usbh_serial_cp210x_rx_start,
         },
         {
-                .p_drv_name  = "Common",
-                .p_fn_init   = usbh_serial_common_init,
-                .p_fn_deinit = usbh_serial_common_deinit,
+                .p_drv_name    = "Common",
+                .p_fn_init     = usbh_serial_common_init,
+                .p_fn_deinit   = usbh_serial_common_deinit,
+                .p_fn_rx_stop  = usbh_serial_common_rx_stop,
+                .p_fn_rx_start = usbh_serial_common_rx_start,
         },
 };
 
@@ -66,6 +78,8 @@ static int __serial_chip_init(struct usbh_serial *p_userial){
         p_userial->p_drv_info = p_drv_info;
         ret = p_drv_info->p_fn_init(p_userial);
         if (ret == USB_OK) {
+            /* 芯片初始化后接收传输请求包一直在传输，接收完成回调写接收环形缓冲区*/
+            p_userial->is_rx_run = USB_TRUE;
             __USB_INFO("USB host serial \"%s\" init success\r\n", p_drv_info->p_drv_name);
         } else {
             __USB_ERR_INFO("USB host serial \"%s\" init failed(%d)\r\n", p_drv_info->p_drv_name, ret);
@@ -78,10 +92,15 @@ static int __serial_chip_init(struct usbh_serial *p_userial){
  * \brief USB 主机转串口设备芯片反初始化
  */
 static int __serial_chip_deinit(struct usbh_serial *p_userial){
+    int ret = USB_OK;
+
     if (p_userial->p_drv_info) {
-        return p_userial->p_drv_info->p_fn_deinit(p_userial);
+        ret = p_userial->p_drv_info->p_fn_deinit(p_userial);
+        if (ret == USB_OK) {
+            p_userial->is_rx_run = USB_FALSE;
+        }
     }
-    return USB_OK;
+    return ret;
 }
 
 /**
@@ -146,12 +165,15 @@ static int __serial_pipe_buf_size_get(struct usbh_serial_pipe *p_pipe, uint32_t
 }
 
 /**
- * \brief USB 主机转串口管道缓存大小设置
+ * \brief USB 主机转串口管道缓存大小设置，p_rb 不为 NULL 时在锁内用新缓存初始化环形缓冲区
  */
-static int __serial_pipe_buf_size_set(struct usbh_serial_pipe *p_pipe, uint32_t buf_size){
-    int ret;
+static int __serial_pipe_buf_size_set(struct usbh_serial_pipe *p_pipe,
+                                      struct usb_ringbuf      *p_rb,
+                                      uint32_t                 buf_size){
+    int      ret   = USB_OK;
+    uint8_t *p_buf = NULL;
 #if USB_OS_EN
-    int ret_tmp;
+    int      ret_tmp;
 #endif
 
     if (p_pipe->buf_size == buf_size) {
@@ -161,30 +183,82 @@ static int __serial_pipe_buf_size_set(struct usbh_serial_pipe *p_pipe, uint32_t
     if (buf_size < USBH_EP_MPS_GET(p_pipe->p_ep)) {
         buf_size = USBH_EP_MPS_GET(p_pipe->p_ep);
     }
+    /* 先申请新缓存，申请失败时保留原来的缓存*/
+    p_buf = (uint8_t *)usb_lib_malloc(&__g_userial_lib.lib, buf_size);
+    if (p_buf == NULL) {
+        return -USB_ENOMEM;
+    }
+    memset(p_buf, 0, buf_size);
 #if USB_OS_EN
     ret = usb_mutex_lock(p_pipe->p_lock, USERIAL_LOCK_TIMEOUT);
     if (ret != USB_OK) {
         __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        usb_lib_mfree(&__g_userial_lib.lib, p_buf);
         return ret;
     }
 #endif
     if (p_pipe->p_buf) {
         usb_lib_mfree(&__g_userial_lib.lib, p_pipe->p_buf);
     }
-    p_pipe->buf_size = 0;
+    p_pipe->p_buf    = p_buf;
+    p_pipe->buf_size = buf_size;
 
-    /* 为管道输入缓存申请内存空间*/
-    p_pipe->p_buf = (uint8_t *)usb_lib_malloc(&__g_userial_lib.lib, buf_size);
-    if (p_pipe->p_buf == NULL) {
-        ret = -USB_ENOMEM;
-        goto __exit;
+    if (p_rb != NULL) {
+        ret = usb_lib_rb_init(p_rb, p_pipe->p_buf, p_pipe->buf_size);
     }
-    memset(p_pipe->p_buf, 0, buf_size);
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_pipe->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
 
-    p_pipe->buf_size = buf_size;
+/**
+ * \brief USB 主机转串口设备端口接收缓存大小设置，接收完成回调不上锁写环形缓冲区，先停止
+ *        设备的接收传输请求包，替换缓存后再重新启动
+ */
+static int __serial_rx_buf_size_set(struct usbh_serial_port *p_port, uint32_t buf_size){
+    int                 ret, ret_tmp;
+    usb_bool_t          is_rx_run;
+    struct usbh_serial *p_userial = p_port->p_userial;
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_userial->p_lock, USERIAL_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    is_rx_run = p_userial->is_rx_run;
+    if (is_rx_run == USB_TRUE) {
+        ret = p_userial->p_drv_info->p_fn_rx_stop(p_userial);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("USB host serial rx stop failed(%d)\r\n", ret);
+            goto __exit;
+        }
+        p_userial->is_rx_run = USB_FALSE;
+    }
+
+    ret = __serial_pipe_buf_size_set(&p_port->rx_pipe.pipe, &p_port->rx_pipe.rb, buf_size);
+
+    /* 缓存替换失败时原来的缓存还在，也要重新启动接收*/
+    if (is_rx_run == USB_TRUE) {
+        ret_tmp = p_userial->p_drv_info->p_fn_rx_start(p_userial);
+        if (ret_tmp == USB_OK) {
+            p_userial->is_rx_run = USB_TRUE;
+        } else {
+            __USB_ERR_INFO("USB host serial rx start failed(%d)\r\n", ret_tmp);
+            if (ret == USB_OK) {
+                ret = ret_tmp;
+            }
+        }
+    }
 __exit:
 #if USB_OS_EN
-    ret_tmp = usb_mutex_unlock(p_pipe->p_lock);
+    ret_tmp = usb_mutex_unlock(p_userial->p_lock);
     if (ret_tmp != USB_OK) {
         __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
         return ret_tmp;
@@ -705,6 +779,9 @@ int usbh_serial_port_init(struct usbh_serial   *p_userial,
         goto __exit;
     }
 
+    /* 接收缓存作为环形缓冲区，大小必须是 2 的幂*/
+    rx_buf_size = usb_lib_rb_size_round(rx_buf_size);
+
     p_port->rx_pipe.pipe.p_buf = usb_lib_malloc(&__g_userial_lib.lib, rx_buf_size);
     if (p_port->rx_pipe.pipe.p_buf == NULL) {
         ret = -USB_ENOMEM;
@@ -738,6 +815,7 @@ int usbh_serial_port_init(struct usbh_serial   *p_userial,
     p_port->p_userial             = p_userial;
     p_port->rx_pipe.pipe.p_ep     = p_ep_rx;
     p_port->rx_pipe.pipe.buf_size = rx_buf_size;
+    usb_lib_rb_init(&p_port->rx_pipe.rb, p_port->rx_pipe.pipe.p_buf, rx_buf_size);
     p_port->tx_pipe.pipe.p_ep     = p_ep_tx;
     p_port->tx_pipe.pipe.buf_size = tx_buf_size;
     p_port->tx_pipe.time_out      = tx_time_out;
@@ -1040,67 +1118,11 @@ int usbh_serial_port_rx_buf_put(struct usbh_serial_port *p_port,
                                 uint8_t                 *p_buf,
                                 uint32_t                 buf_len,
                                 uint32_t                *p_act_len){
-    int      ret = USB_OK;
-    uint32_t len;
-
     if ((p_port == NULL) || (p_buf == NULL) || (p_act_len == NULL)) {
         return -USB_EINVAL;
     }
-
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_port->rx_pipe.pipe.p_lock, USERIAL_LOCK_TIMEOUT);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
-    }
-#endif
-    if (p_port->rx_pipe.rd_pos > p_port->rx_pipe.data_pos) {
-        if (buf_len > (p_port->rx_pipe.rd_pos - p_port->rx_pipe.data_pos - 1)) {
-            len = p_port->rx_pipe.rd_pos - p_port->rx_pipe.data_pos;
-        } else {
-            len = buf_len;
-        }
-        memcpy(p_port->rx_pipe.pipe.p_buf + p_port->rx_pipe.data_pos, p_buf, len);
-
-        *p_act_len = len;
-    } else {
-        /* 计算可以放入数据的总大小*/
-        len = p_port->rx_pipe.pipe.buf_size + p_port->rx_pipe.rd_pos - p_port->rx_pipe.data_pos - 1;
-
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        /* 回环*/
-        if ((len + p_port->rx_pipe.data_pos) > p_port->rx_pipe.pipe.buf_size) {
-            len = p_port->rx_pipe.pipe.buf_size - p_port->rx_pipe.data_pos;
-        }
-        memcpy(p_port->rx_pipe.pipe.p_buf + p_port->rx_pipe.data_pos, p_buf, len);
-        *p_act_len = len;
-
-        len = buf_len - *p_act_len;
-
-        if (p_port->rx_pipe.rd_pos != 0) {
-            if (len > (p_port->rx_pipe.rd_pos - 1)) {
-                len = p_port->rx_pipe.rd_pos - 1;
-            }
-            memcpy(p_port->rx_pipe.pipe.p_buf, p_buf + *p_act_len, len);
-            *p_act_len += len;
-        }
-    }
-    /* 重新设置写标记*/
-    p_port->rx_pipe.data_pos = (p_port->rx_pipe.data_pos + *p_act_len);
-    /* 到了环形末尾，回到环形头*/
-    if (p_port->rx_pipe.data_pos >= p_port->rx_pipe.pipe.buf_size) {
-        p_port->rx_pipe.data_pos -= p_port->rx_pipe.pipe.buf_size;
-    }
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_port->rx_pipe.pipe.p_lock);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-    }
-#endif
-
-    return ret;
+    /* 在接收完成回调中调用，单生产者，不需要上锁*/
+    return usb_lib_rb_put(&p_port->rx_pipe.rb, p_buf, buf_len, p_act_len);
 }
 
 /**
@@ -1117,59 +1139,10 @@ int usbh_serial_port_rx_buf_get(struct usbh_serial_port *p_port,
                                 uint8_t                 *p_buf,
                                 uint32_t                 buf_len,
                                 uint32_t                *p_act_len){
-    int      ret = USB_OK;
-    uint32_t len;
-
     if ((p_port == NULL) || (p_buf == NULL) || (p_act_len == NULL)) {
         return -USB_EINVAL;
     }
-
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_port->rx_pipe.pipe.p_lock, USERIAL_LOCK_TIMEOUT);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
-    }
-#endif
-    if (p_port->rx_pipe.rd_pos <= p_port->rx_pipe.data_pos) {
-        len = p_port->rx_pipe.data_pos - p_port->rx_pipe.rd_pos;
-
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        memcpy(p_buf, p_port->rx_pipe.pipe.p_buf + p_port->rx_pipe.rd_pos, len);
-        *p_act_len = len;
-    } else {
-        len = p_port->rx_pipe.pipe.buf_size - p_port->rx_pipe.rd_pos;
-
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        memcpy(p_buf, p_port->rx_pipe.pipe.p_buf + p_port->rx_pipe.rd_pos, len);
-        *p_act_len = len;
-
-        len = p_port->rx_pipe.data_pos;
-
-        if (len > (buf_len - *p_act_len)) {
-            len = buf_len - *p_act_len;
-        }
-        if (len > 0) {
-            memcpy(p_buf + *p_act_len, p_port->rx_pipe.pipe.p_buf, len);
-        }
-        *p_act_len += len;
-    }
-    p_port->rx_pipe.rd_pos = p_port->rx_pipe.rd_pos + *p_act_len;
-    if (p_port->rx_pipe.rd_pos >= p_port->rx_pipe.pipe.buf_size) {
-        p_port->rx_pipe.rd_pos -= p_port->rx_pipe.pipe.buf_size;
-    }
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_port->rx_pipe.pipe.p_lock);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-    }
-#endif
-
-    return ret;
+    return usb_lib_rb_get(&p_port->rx_pipe.rb, p_buf, buf_len, p_act_len);
 }
 
 /**
@@ -1238,6 +1211,11 @@ int usbh_serial_port_read(struct usbh_serial_port *p_port,
                           uint8_t                 *p_buf,
                           uint32_t                 buf_len,
                           uint32_t                *p_act_len){
+    int ret = USB_OK;
+#if USB_OS_EN
+    int ret_tmp;
+#endif
+
     if ((p_port == NULL) ||
             (p_buf == NULL) ||
             (buf_len == 0) ||
@@ -1248,7 +1226,23 @@ int usbh_serial_port_read(struct usbh_serial_port *p_port,
         return -USB_ENODEV;
     }
 
-    return usbh_serial_port_rx_buf_get(p_port, p_buf, buf_len, p_act_len);
+#if USB_OS_EN
+    /* 环形缓冲区只支持单消费者，多个读线程要互斥*/
+    ret = usb_mutex_lock(p_port->rx_pipe.pipe.p_lock, USERIAL_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    ret = usbh_serial_port_rx_buf_get(p_port, p_buf, buf_len, p_act_len);
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_port->rx_pipe.pipe.p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
 }
 
 /**
@@ -1373,7 +1367,7 @@ int usbh_serial_port_buf_size_get(struct usbh_serial_port *p_port,
  * \param[in] pipe_dir 管道方向
  * \param[in] buf_size 缓存大小
  *
- * \retval 成功返回 USB_OK
+ * \retval 成功返回 USB_OK，接收传输请求包在传输时设置接收缓存返回 -USB_EPERM
  */
 int usbh_serial_port_buf_size_set(struct usbh_serial_port *p_port,
                                   uint8_t                  pipe_dir,
@@ -1391,15 +1385,15 @@ int usbh_serial_port_buf_size_set(struct usbh_serial_port *p_port,
     buf_size = USB_ROUND_UP(buf_size, 4);
 
     if (pipe_dir & USBH_SERIAL_PIPE_RX) {
-        p_pipe = &p_port->rx_pipe.pipe;
-        ret = __serial_pipe_buf_size_set(p_pipe, buf_size);
+        /* 接收缓存作为环形缓冲区，大小必须是 2 的幂*/
+        ret = __serial_rx_buf_size_set(p_port, usb_lib_rb_size_round(buf_size));
         if (ret != USB_OK) {
             return ret;
         }
     }
     if (pipe_dir & USBH_SERIAL_PIPE_TX) {
         p_pipe = &p_port->tx_pipe.pipe;
-        ret = __serial_pipe_buf_size_set(p_pipe, buf_size);
+        ret = __serial_pipe_buf_size_set(p_pipe, NULL, buf_size);
 
     }
     return ret;
@@ -2,11 +2,25 @@
  * Includes
  ******************************************************************************/
 #include "core/include/host/class/hid/usbh_hid_drv.h"
-#include "core/include/usb_mem.h"
-#include "utils/refcnt/usb_refcnt.h"
+#include "common/refcnt/usb_refcnt.h"
 #include <string.h>
 #include <stdio.h>
 
+/*******************************************************************************
+ * Macro operate
+ ******************************************************************************/
+/* \brief 输入报告队列中一个报告占用的长度*/
+#define __HID_SLOT_SIZE(p_hid)  (sizeof(struct __hid_report_hdr) + (p_hid)->in_size)
+
+/*******************************************************************************
+ * Statement
+ ******************************************************************************/
+/* \brief 输入报告队列中的报告头*/
+struct __hid_report_hdr {
+    uint32_t            len;         /* 报告长度*/
+    struct usb_timespec ts;          /* 报告到达时间*/
+};
+
 /*******************************************************************************
  * Static
  ******************************************************************************/
@@ -23,11 +37,119 @@ extern int usbh_hid_report_parse(struct usbh_hid *p_hid);
 /*******************************************************************************
  * Code
  ******************************************************************************/
+/**
+ * \brief 计算两个时间戳之间的微秒数
+ */
+static uint32_t __hid_us_diff(struct usb_timespec *p_start, struct usb_timespec *p_end){
+    long us;
+
+    us = (p_end->ts_sec - p_start->ts_sec) * 1000000 +
+         (p_end->ts_nsec - p_start->ts_nsec) / 1000;
+    if (us < 0) {
+        return 0;
+    }
+    return (uint32_t)us;
+}
+
+/**
+ * \brief 找到最高的置位位（从 1 开始），0 返回 0
+ */
+static int __hid_fls(uint32_t x){
+    int r = 0;
+
+    while (x) {
+        x >>= 1;
+        r++;
+    }
+    return r;
+}
+
+/**
+ * \brief 输入报告放进报告队列
+ */
+static void __hid_report_queue(struct usbh_hid         *p_hid,
+                               uint8_t                 *p_report,
+                               struct __hid_report_hdr *p_hdr){
+    uint32_t act_len;
+
+    if (usb_lib_rb_space_len_get(p_hid->p_report_rb) < __HID_SLOT_SIZE(p_hid)) {
+        p_hid->stat.n_lost++;
+        return;
+    }
+    /* 传输完成回调是报告队列唯一的生产者，不需要上锁；报告按固定长度存放，读的时候整段取走*/
+    usb_lib_rb_put(p_hid->p_report_rb,
+                  (uint8_t *)p_hdr,
+                   sizeof(struct __hid_report_hdr),
+                  &act_len);
+    usb_lib_rb_put(p_hid->p_report_rb, p_report, p_hid->in_size, &act_len);
+#if USB_OS_EN
+    usb_sem_give(p_hid->p_report_sem);
+#endif
+}
+
 /**
  * \brief USB 人体接口设备输入中断回调函数
  */
 static void __hid_irq_in(void *p_arg){
-    //todo
+    int                      ret;
+    struct usbh_trp         *p_trp = (struct usbh_trp *)p_arg;
+    struct usbh_hid         *p_hid = (struct usbh_hid *)p_trp->p_usr_priv;
+    struct __hid_report_hdr  hdr;
+    struct usb_timespec      ts_end;
+    uint32_t                 cost_us;
+    uint8_t                  idx   = p_trp - p_hid->p_trp_in;
+
+    if ((p_trp->status == -USB_ECANCEL) ||
+            (p_hid->is_removed == USB_TRUE) ||
+            (p_hid->is_started == USB_FALSE)) {
+        goto __stop;
+    }
+
+    switch (p_trp->status) {
+        case USB_OK:
+            if (p_trp->act_len == 0) {
+                break;
+            }
+            usb_timespec_get(&hdr.ts);
+            hdr.len = p_trp->act_len;
+
+            p_hid->stat.n_reports++;
+
+            if (p_hid->p_fn_report_cb) {
+                p_hid->p_fn_report_cb(p_hid, p_trp->p_data, hdr.len, &hdr.ts, p_hid->p_report_arg);
+
+                /* 回调执行期间这个请求包没有在端点上等待，记录最长执行时间*/
+                usb_timespec_get(&ts_end);
+                cost_us = __hid_us_diff(&hdr.ts, &ts_end);
+                if (cost_us > p_hid->stat.cb_max_us) {
+                    p_hid->stat.cb_max_us = cost_us;
+                }
+            }
+            if (p_hid->p_report_rb) {
+                __hid_report_queue(p_hid, p_trp->p_data, &hdr);
+            }
+            break;
+        case -USB_ENODEV:
+            p_hid->stat.n_errors++;
+            goto __stop;
+        default:
+            p_hid->stat.n_errors++;
+            break;
+    }
+    /* 停止标志清除后不再重新提交，在这之前重新提交的由停止函数再次取消*/
+    if (p_hid->is_started == USB_FALSE) {
+        goto __stop;
+    }
+    /* 马上重新提交，保证端点上一直有请求包在等待*/
+    ret = usbh_trp_submit(p_trp);
+    if (ret == USB_OK) {
+        return;
+    }
+    p_hid->stat.n_errors++;
+    __USB_ERR_INFO("human interface device \"%s\" input TRP submit failed(%d)\r\n", p_hid->name, ret);
+__stop:
+    /* 这个请求包不会再有回调，停止函数可以释放它*/
+    p_hid->trp_act[idx] = USB_FALSE;
 }
 
 /**
@@ -76,17 +198,26 @@ static int __hid_class_desc_get(struct usbh_function *p_usb_fun,
     return ret;
 }
 
-static int __hid_max_report_get(struct usbh_hid *p_hid,
-                                uint32_t         type,
-								uint32_t        *p_max){
-	struct hid_report *report;
-	unsigned int size;
-
-//	usb_list_for_each_node(report, &hid->report_enum[type].report_list, list) {
-//		size = ((report->size - 1) >> 3) + 1 + hid->report_enum[type].numbered;
-//		if (*max < size)
-//			*max = size;
-//	}
+/**
+ * \brief 获取某个类型报告的最大长度（字节），编号报告包含报告 ID
+ */
+static void __hid_max_report_get(struct usbh_hid *p_hid,
+                                 uint32_t         type,
+                                 uint32_t        *p_max){
+    struct usb_list_node   *p_node   = NULL;
+    struct usbh_hid_report *p_report = NULL;
+    uint32_t                size;
+
+    usb_list_for_each_node(p_node, &p_hid->report_enum[type].report_list) {
+        p_report = usb_container_of(p_node, struct usbh_hid_report, node);
+        if (p_report->size == 0) {
+            continue;
+        }
+        size = ((p_report->size - 1) >> 3) + 1 + p_hid->report_enum[type].numbered;
+        if (*p_max < size) {
+            *p_max = size;
+        }
+    }
 }
 
 //static int __hid_raw_req(struct usbh_hid *p_hid,
@@ -194,7 +325,7 @@ static int __hid_init(struct usbh_hid      *p_hid,
     struct usbh_interface *p_intf = NULL;
 
     /* 获取第一个接口*/
-    p_intf = usbh_func_first_intf_get(p_usb_fun);
+    p_intf = usbh_func_intf_get(p_usb_fun, p_usb_fun->first_intf_num, 0);
     if (p_intf == NULL) {
         return -USB_ENODEV;
     }
@@ -231,16 +362,110 @@ static int __hid_init(struct usbh_hid      *p_hid,
     }
     /* 分析人体接口设备报告描述符*/
     ret = usbh_hid_report_parse(p_hid);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("human interface device report descriptor parse failed(%d)\r\n", ret);
+        return ret;
+    }
 //    ret = __hid_xfer_init(p_hid);
 //    if (ret != USB_OK) {
 //        goto __failed1;
 //    }
+    p_hid->n_trp_in = UHID_TRP_NUM_DEFAULT;
+#if USB_OS_EN
+    p_hid->p_report_sem = usb_lib_sem_create(&__g_uhid_lib.lib);
+    if (p_hid->p_report_sem == NULL) {
+        __USB_ERR_TRACE(SemCreateErr, "\r\n");
+        return -USB_EPERM;
+    }
+#endif
+    return USB_OK;
+}
+
+/**
+ * \brief 释放 USB 人类接口设备输入传输资源
+ */
+static void __hid_in_free(struct usbh_hid *p_hid){
+    if (p_hid->p_trp_in) {
+        usb_lib_mfree(&__g_uhid_lib.lib, p_hid->p_trp_in);
+        p_hid->p_trp_in = NULL;
+    }
+    if (p_hid->p_buf_in) {
+        usb_lib_mfree(&__g_uhid_lib.lib, p_hid->p_buf_in);
+        p_hid->p_buf_in = NULL;
+    }
+    if (p_hid->p_report_rb) {
+        usb_lib_rb_destroy(&__g_uhid_lib.lib, p_hid->p_report_rb);
+        p_hid->p_report_rb = NULL;
+    }
+#if USB_OS_EN
+    /* 清掉队列里报告对应的信号量计数*/
+    if (p_hid->p_report_sem) {
+        while (usb_sem_take(p_hid->p_report_sem, USB_NO_WAIT) == USB_OK);
+    }
+#endif
+}
+
+/**
+ * \brief 取消所有输入传输请求包并等待它们的回调全部返回，调用前要先清除启动标志
+ */
+static int __hid_in_drain(struct usbh_hid *p_hid){
+    int     time_out = UHID_STOP_TIMEOUT;
+    uint8_t i;
+
+    while (1) {
+        for (i = 0; i < p_hid->n_trp_in; i++) {
+            if (p_hid->trp_act[i] == USB_TRUE) {
+                break;
+            }
+        }
+        if (i == p_hid->n_trp_in) {
+            return USB_OK;
+        }
+        if (time_out <= 0) {
+            __USB_ERR_INFO("human interface device \"%s\" input TRP drain timeout\r\n", p_hid->name);
+            return -USB_ETIME;
+        }
+        /* 回调在清除启动标志前可能刚好重新提交了请求包，要重复取消*/
+        for (; i < p_hid->n_trp_in; i++) {
+            if (p_hid->trp_act[i] == USB_TRUE) {
+                usbh_trp_xfer_cancel(&p_hid->p_trp_in[i]);
+            }
+        }
+        usb_mdelay(10);
+        time_out -= 10;
+    }
 }
 
 /**
  * \brief 反初始化 USB 人类接口设备
  */
 static int __hid_deinit(struct usbh_hid *p_hid){
+#if USB_OS_EN
+    int ret;
+#endif
+
+    __hid_in_free(p_hid);
+
+    if (p_hid->p_report_desc) {
+        usb_lib_mfree(&__g_uhid_lib.lib, p_hid->p_report_desc);
+        p_hid->p_report_desc = NULL;
+    }
+#if USB_OS_EN
+    if (p_hid->p_report_sem) {
+        ret = usb_lib_sem_destroy(&__g_uhid_lib.lib, p_hid->p_report_sem);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret);
+        }
+        p_hid->p_report_sem = NULL;
+    }
+    if (p_hid->p_lock) {
+        ret = usb_lib_mutex_destroy(&__g_uhid_lib.lib, p_hid->p_lock);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
+        }
+        p_hid->p_lock = NULL;
+    }
+#endif
     return USB_OK;
 }
 
@@ -248,7 +473,30 @@ static int __hid_deinit(struct usbh_hid *p_hid){
  * \brief USB 人类接口设备释放函数
  */
 static void __hid_release(int *p_ref){
+    struct usbh_hid    *p_hid     = usb_container_of(p_ref, struct usbh_hid, ref_cnt);
+    struct usbh_device *p_usb_dev = p_hid->p_usb_fun->p_usb_dev;
+    int                 ret;
+
+    ret = usb_lib_dev_del(&__g_uhid_lib.lib, &p_hid->node);
+    if (ret != USB_OK) {
+        return;
+    }
+    /* 停止输入轮询，请求包没有全部返回时不能释放，只能泄漏*/
+    ret = usbh_hid_stop(p_hid);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("human interface device \"%s\" stop failed(%d)\r\n", p_hid->name, ret);
+        return;
+    }
 
+    __hid_deinit(p_hid);
+
+    usb_lib_mfree(&__g_uhid_lib.lib, p_hid);
+
+    /* 释放对 USB 设备的引用*/
+    ret = usbh_dev_ref_put(p_usb_dev);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
+    }
 }
 
 /**
@@ -284,7 +532,7 @@ int usbh_hid_probe(struct usbh_function *p_usb_fun){
     }
 
     /* 获取第一个接口*/
-    p_intf = usbh_func_first_intf_get(p_usb_fun);
+    p_intf = usbh_func_intf_get(p_usb_fun, p_usb_fun->first_intf_num, 0);
     if (p_intf == NULL) {
         return -USB_ENODEV;
     }
@@ -488,7 +736,7 @@ int usbh_hid_destroy(struct usbh_function *p_usb_fun){
     if (p_usb_fun == NULL) {
         return -USB_EINVAL;
     }
-    if (p_usb_fun->func_type != USBH_FUNC_UHUB) {
+    if (p_usb_fun->func_type != USBH_FUNC_UHID) {
         return -USB_EILLEGAL;
     }
 
@@ -543,7 +791,7 @@ int usbh_hid_open(void *p_handle, uint8_t flag, struct usbh_hid **p_hid){
         }
 #endif
         USB_LIB_LIST_FOR_EACH_NODE(p_node, p_node_tmp, &__g_uhid_lib.lib){
-        	p_hid_tmp = usb_list_node_get(p_node, struct usbh_hid, node);
+        	p_hid_tmp = usb_container_of(p_node, struct usbh_hid, node);
             if (strcmp(p_hid_tmp->name, p_name) == 0) {
                 break;
             }
@@ -588,6 +836,50 @@ int usbh_hid_close(struct usbh_hid *p_hid){
     return __hid_ref_put(p_hid);
 }
 
+/**
+ * \brief 分配 USB 人类接口设备输入传输资源
+ */
+static int __hid_in_alloc(struct usbh_hid      *p_hid,
+                          struct usbh_endpoint *p_ep,
+                          int                   interval){
+    uint8_t i;
+
+    p_hid->p_trp_in = usb_lib_malloc(&__g_uhid_lib.lib, sizeof(struct usbh_trp) * p_hid->n_trp_in);
+    if (p_hid->p_trp_in == NULL) {
+        goto __failed;
+    }
+    memset(p_hid->p_trp_in, 0, sizeof(struct usbh_trp) * p_hid->n_trp_in);
+
+    p_hid->p_buf_in = usb_lib_malloc(&__g_uhid_lib.lib, p_hid->buf_size * p_hid->n_trp_in);
+    if (p_hid->p_buf_in == NULL) {
+        goto __failed;
+    }
+    memset(p_hid->p_buf_in, 0, p_hid->buf_size * p_hid->n_trp_in);
+
+    if (p_hid->report_qlen) {
+        p_hid->p_report_rb = usb_lib_rb_create(&__g_uhid_lib.lib,
+                                               p_hid->report_qlen * __HID_SLOT_SIZE(p_hid));
+        if (p_hid->p_report_rb == NULL) {
+            goto __failed;
+        }
+    }
+
+    for (i = 0; i < p_hid->n_trp_in; i++) {
+        p_hid->p_trp_in[i].p_fn_done  = __hid_irq_in;
+        p_hid->p_trp_in[i].p_arg      = &p_hid->p_trp_in[i];
+        p_hid->p_trp_in[i].p_data     = p_hid->p_buf_in + p_hid->buf_size * i;
+        p_hid->p_trp_in[i].interval   = interval;
+        p_hid->p_trp_in[i].p_usr_priv = p_hid;
+        p_hid->p_trp_in[i].p_ep       = p_ep;
+        p_hid->p_trp_in[i].len        = p_hid->in_size;
+    }
+    return USB_OK;
+__failed:
+    __hid_in_free(p_hid);
+
+    return -USB_ENOMEM;
+}
+
 /**
  * \brief 启动 USB 人体接口设备
  *
@@ -596,24 +888,28 @@ int usbh_hid_close(struct usbh_hid *p_hid){
  * \retval 成功返回 USB_OK
  */
 int usbh_hid_start(struct usbh_hid *p_hid){
+    int                    ret         = USB_OK;
     uint8_t                i;
-    uint32_t               in_size   = 0;
-    struct usbh_function  *p_usb_fun = NULL;
-    struct usbh_interface *p_intf    = NULL;
+    uint8_t                interval_in = 0;
+    uint32_t               in_size     = 0;
+    struct usbh_function  *p_usb_fun   = NULL;
+    struct usbh_interface *p_intf      = NULL;
+    struct usbh_endpoint  *p_ep_in     = NULL;
+#if USB_OS_EN
+    int                    ret_tmp;
+#endif
 
     if (p_hid == NULL) {
         return -USB_EINVAL;
     }
-    /* 确保缓存的最小值*/
-    p_hid->buf_size = HID_MIN_BUFFER_SIZE;
-
-    if (p_hid->buf_size > HID_MAX_BUFFER_SIZE) {
-        p_hid->buf_size = HID_MAX_BUFFER_SIZE;
-	}
+    /* 检查是否允许操作*/
+    if (p_hid->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
 
     p_usb_fun = p_hid->p_usb_fun;
     /* 获取第一个接口*/
-    p_intf = usbh_func_first_intf_get(p_usb_fun);
+    p_intf = usbh_func_intf_get(p_usb_fun, p_usb_fun->first_intf_num, 0);
     if (p_intf == NULL) {
         return -USB_ENODEV;
     }
@@ -631,7 +927,7 @@ int usbh_hid_start(struct usbh_hid *p_hid){
 
         if ((p_hid->quirks & HID_QUIRK_FULLSPEED_INTERVAL) &&
                 (USBH_DEV_SPEED_GET(p_usb_fun) == USB_SPEED_HIGH)) {
-			interval = fls(p_ep_desc->interval * 8);
+			interval = __hid_fls(p_ep_desc->interval * 8);
             __USB_INFO("human interface device \"%s\" fixing fullspeed to highspeed interval: %d -> %d\r\n",
                         p_hid->name, p_ep_desc->interval, interval);
 		}
@@ -640,41 +936,373 @@ int usbh_hid_start(struct usbh_hid *p_hid){
 //		if (p_hid->collection->usage == HID_GD_MOUSE && hid_mousepoll_interval > 0)
 //			interval = hid_mousepoll_interval;
         if (USBH_EP_DIR_GET(&p_intf->p_eps[i]) == USB_DIR_IN) {
-            if (p_hid->p_trp_in) {
+            if (p_ep_in) {
                 continue;
             }
-            p_hid->p_trp_in = usb_lib_malloc(&__g_uhid_lib.lib, sizeof(struct usbh_trp));
-            if (p_hid->p_trp_in == NULL) {
-                return -USB_ENOMEM;
-            }
-            memset(p_hid->p_trp_in, 0, sizeof(struct usbh_trp));
-
-            p_hid->p_trp_in->p_fn_done  = __hid_irq_in;
-            p_hid->p_trp_in->p_arg      = p_hid->p_trp_in;
-            p_hid->p_trp_in->p_data     = p_hid->p_buf_in;
-            p_hid->p_trp_in->interval   = interval;
-            p_hid->p_trp_in->p_usr_priv = p_hid;
-            p_hid->p_trp_in->p_ep       = &p_intf->p_eps[i];
-            p_hid->p_trp_in->len        = in_size;
+            p_ep_in     = &p_intf->p_eps[i];
+            interval_in = interval;
         } else {
 
         }
     }
+    if (p_ep_in == NULL) {
+        return -USB_ENOTSUP;
+    }
+
+    /* 输入报告最大长度，报告描述符里没有输入报告则按端点最大包大小*/
+    __hid_max_report_get(p_hid, HID_INPUT_REPORT, &in_size);
+    if (in_size == 0) {
+        in_size = USBH_EP_MPS_GET(p_ep_in);
+    }
+    if (in_size > HID_MAX_BUFFER_SIZE) {
+        in_size = HID_MAX_BUFFER_SIZE;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_hid->p_lock, UHID_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    if (p_hid->is_started == USB_TRUE) {
+        ret = -USB_EPERM;
+        goto __exit;
+    }
+
+    /* 上一次停止时还有请求包没有返回*/
+    if (__hid_in_drain(p_hid) != USB_OK) {
+        ret = -USB_EBUSY;
+        goto __exit;
+    }
+    if ((p_hid->p_trp_in != NULL) && (p_hid->in_size != in_size)) {
+        __hid_in_free(p_hid);
+    }
+    if (p_hid->p_trp_in == NULL) {
+        p_hid->in_size = in_size;
+        /* 确保缓存的最小值*/
+        p_hid->buf_size = in_size;
+        if (p_hid->buf_size < HID_MIN_BUFFER_SIZE) {
+            p_hid->buf_size = HID_MIN_BUFFER_SIZE;
+        }
+
+        ret = __hid_in_alloc(p_hid, p_ep_in, interval_in);
+        if (ret != USB_OK) {
+            goto __exit;
+        }
+    }
 
     if (p_hid->quirks & HID_QUIRK_ALWAYS_POLL) {
 
     }
-    return USB_OK;
+
+    /* 一次提交所有输入请求包，一个请求包在回调里处理时端点上还有其他请求包在等待，报告不会丢*/
+    p_hid->is_started = USB_TRUE;
+    for (i = 0; i < p_hid->n_trp_in; i++) {
+        p_hid->trp_act[i] = USB_TRUE;
+
+        ret = usbh_trp_submit(&p_hid->p_trp_in[i]);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("human interface device \"%s\" input TRP submit failed(%d)\r\n", p_hid->name, ret);
+
+            p_hid->trp_act[i] = USB_FALSE;
+            p_hid->is_started = USB_FALSE;
+            __hid_in_drain(p_hid);
+            break;
+        }
+    }
+__exit:
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_hid->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
 }
 
 /**
- * \brief 停止 USB 人体接口设备
+ * \brief 停止 USB 人体接口设备，等待所有输入传输请求包返回
  *
  * \param[in] p_hid 要停止的 USB 人体接口设备
  *
- * \retval 成功返回 USB_OK
+ * \retval 成功返回 USB_OK，请求包没有按时返回返回 -USB_ETIME
  */
 int usbh_hid_stop(struct usbh_hid *p_hid){
+    int ret = USB_OK;
+#if USB_OS_EN
+    int ret_tmp;
+#endif
+
+    if (p_hid == NULL) {
+        return -USB_EINVAL;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_hid->p_lock, UHID_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    p_hid->is_started = USB_FALSE;
+    /* 等待所有请求包返回，之后回调不会再访问输入缓存和报告队列*/
+    ret = __hid_in_drain(p_hid);
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_hid->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 设置 USB 人体接口设备输入传输请求包数量，要在启动前设置
+ *
+ * \param[in] p_hid  USB 人体接口设备
+ * \param[in] n_trps 传输请求包数量（1~UHID_TRP_NUM_MAX），轮询间隔越短需要越多
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_trp_num_set(struct usbh_hid *p_hid, uint8_t n_trps){
+    int ret = USB_OK;
+
+    if (p_hid == NULL) {
+        return -USB_EINVAL;
+    }
+    if ((n_trps == 0) || (n_trps > UHID_TRP_NUM_MAX)) {
+        return -USB_EILLEGAL;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_hid->p_lock, UHID_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    if (p_hid->is_started == USB_TRUE) {
+        ret = -USB_EPERM;
+    } else if (__hid_in_drain(p_hid) != USB_OK) {
+        /* 上一次停止时还有请求包没有返回，不能释放*/
+        ret = -USB_EBUSY;
+    } else if (n_trps != p_hid->n_trp_in) {
+        /* 下次启动时按新的数量重新分配*/
+        __hid_in_free(p_hid);
+        p_hid->n_trp_in = n_trps;
+    }
+#if USB_OS_EN
+    if (usb_mutex_unlock(p_hid->p_lock) != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "\r\n");
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 设置 USB 人体接口设备输入报告队列长度，要在启动前设置
+ *
+ * \param[in] p_hid USB 人体接口设备
+ * \param[in] qlen  能缓存的报告个数，为 0 则不使用队列
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_report_queue_set(struct usbh_hid *p_hid, uint32_t qlen){
+    int ret = USB_OK;
+
+    if (p_hid == NULL) {
+        return -USB_EINVAL;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_hid->p_lock, UHID_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    if (p_hid->is_started == USB_TRUE) {
+        ret = -USB_EPERM;
+    } else if (__hid_in_drain(p_hid) != USB_OK) {
+        /* 上一次停止时还有请求包没有返回，不能释放*/
+        ret = -USB_EBUSY;
+    } else if (qlen != p_hid->report_qlen) {
+        __hid_in_free(p_hid);
+        p_hid->report_qlen = qlen;
+    }
+#if USB_OS_EN
+    if (usb_mutex_unlock(p_hid->p_lock) != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "\r\n");
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 设置 USB 人体接口设备输入报告回调函数
+ *
+ * \param[in] p_hid     USB 人体接口设备
+ * \param[in] p_fn_cb   回调函数，为 NULL 则取消回调
+ * \param[in] p_arg     回调函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_report_cb_set(struct usbh_hid      *p_hid,
+                           usbh_hid_report_cb_t  p_fn_cb,
+                           void                 *p_arg){
+    int ret = USB_OK;
+
+    if (p_hid == NULL) {
+        return -USB_EINVAL;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_hid->p_lock, UHID_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    p_hid->p_fn_report_cb = NULL;
+    p_hid->p_report_arg   = p_arg;
+    p_hid->p_fn_report_cb = p_fn_cb;
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_hid->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 从 USB 人体接口设备输入报告队列读一个报告
+ *
+ * \param[in]  p_hid     USB 人体接口设备
+ * \param[in]  p_buf     报告缓存
+ * \param[in]  buf_size  缓存大小，比报告小时报告被截断
+ * \param[out] p_act_len 返回报告长度
+ * \param[in]  timeout   等待超时时间（毫秒），USB_NO_WAIT 不等待，USB_WAIT_FOREVER 一直等待
+ *
+ * \retval 成功返回 USB_OK，超时返回 -USB_ETIME
+ */
+int usbh_hid_report_read(struct usbh_hid *p_hid,
+                         uint8_t         *p_buf,
+                         uint32_t         buf_size,
+                         uint32_t        *p_act_len,
+                         int              timeout){
+    int                     ret = USB_OK;
+    uint32_t                len, latency_us;
+    struct __hid_report_hdr hdr;
+    struct usb_timespec     ts;
+#if USB_OS_EN
+    int                     ret_tmp;
+#endif
+
+    if ((p_hid == NULL) || (p_buf == NULL) || (p_act_len == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (p_hid->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+    if (p_hid->p_report_rb == NULL) {
+        return -USB_EPERM;
+    }
+    *p_act_len = 0;
+
+#if USB_OS_EN
+    ret = usb_sem_take(p_hid->p_report_sem, timeout);
+    if (ret != USB_OK) {
+        return ret;
+    }
+#else
+    while (usb_lib_rb_data_len_get(p_hid->p_report_rb) < __HID_SLOT_SIZE(p_hid)) {
+        if (timeout == 0) {
+            return -USB_ETIME;
+        }
+        if (timeout > 0) {
+            timeout--;
+        }
+        usb_mdelay(1);
+    }
+#endif
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_hid->p_lock, UHID_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    /* 队列可能在启动前被重新分配过*/
+    if ((p_hid->p_report_rb == NULL) ||
+            (usb_lib_rb_data_len_get(p_hid->p_report_rb) < __HID_SLOT_SIZE(p_hid))) {
+        ret = -USB_EAGAIN;
+        goto __exit;
+    }
+    usb_lib_rb_get(p_hid->p_report_rb, (uint8_t *)&hdr, sizeof(struct __hid_report_hdr), &len);
+
+    len = hdr.len;
+    if (len > buf_size) {
+        len = buf_size;
+    }
+    usb_lib_rb_get(p_hid->p_report_rb, p_buf, len, &len);
+    usb_lib_rb_consume(p_hid->p_report_rb, p_hid->in_size - len);
+
+    /* 统计报告在队列里等待的时间*/
+    usb_timespec_get(&ts);
+    latency_us = __hid_us_diff(&hdr.ts, &ts);
+    if (latency_us > p_hid->stat.latency_max_us) {
+        p_hid->stat.latency_max_us = latency_us;
+    }
+    p_hid->stat.latency_sum_us += latency_us;
+    p_hid->stat.n_latency++;
+
+    *p_act_len = len;
+__exit:
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_hid->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 获取 USB 人体接口设备输入报告统计
+ *
+ * \param[in]  p_hid  USB 人体接口设备
+ * \param[out] p_stat 返回的统计
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_stat_get(struct usbh_hid *p_hid, struct usbh_hid_stat *p_stat){
+    if ((p_hid == NULL) || (p_stat == NULL)) {
+        return -USB_EINVAL;
+    }
+    *p_stat = p_hid->stat;
+
+    return USB_OK;
+}
+
+/**
+ * \brief 清除 USB 人体接口设备输入报告统计
+ *
+ * \param[in] p_hid USB 人体接口设备
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_hid_stat_clr(struct usbh_hid *p_hid){
+    if (p_hid == NULL) {
+        return -USB_EINVAL;
+    }
+    memset(&p_hid->stat, 0, sizeof(struct usbh_hid_stat));
+
     return USB_OK;
 }
 
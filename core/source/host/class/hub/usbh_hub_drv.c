@@ -504,8 +504,10 @@ static int __hub_handle(struct usbh_hub_basic *p_hub_basic,
                     usb_mdelay(p_hub->hub_basic.pwr_time * 2);
                 }
             }
-            /* 端口的复位状态发生变化，清除集线器端口复位特性*/
-            if (change & HUB_PORT_STAT_C_RESET) {
+            /* 端口的复位状态发生变化，清除集线器端口复位特性，
+             * 端口正在后台枚举时由复位函数自己清除*/
+            if ((change & HUB_PORT_STAT_C_RESET) &&
+                    !(p_hub->hub_basic.enum_map & (1u << (port_num - 1)))) {
                 ret = __HUB_PORT_FEATURE_CLR(p_hub, HUB_PORT_STAT_C_RESET, port_num);
                 if (ret != USB_OK) {
                     return ret;
@@ -669,6 +671,13 @@ static void __hub_release(int *p_ref){
     if (p_hub->hub_basic.hub_status == USBH_HUB_RUNNING) {
         usbh_trp_xfer_cancel(&p_hub->trp);
     }
+    /* 等待端口上的后台枚举结束，超时说明还有工作引用集线器，不能释放*/
+    ret = usbh_basic_hub_enum_wait(&p_hub->hub_basic, USBH_DEV_ENUM_WAIT_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("hub %s release failed(%d)\r\n", p_hub->name, ret);
+        return;
+    }
+
     /* 检查端口上有没有设备没有被移除*/
     for (i = 1; i <= p_hub->hub_basic.n_ports; i++) {
         ret = usbh_basic_hub_dev_disconnect(&p_hub->hub_basic, i);
@@ -14,24 +14,54 @@
 #define __MS_CBW_SIGNATURE        0x43425355
 #define __MS_CSW_SIGNATURE        0x53425355
 
+/* \brief BBB 命令槽状态*/
+#define __BBB_SLOT_IDLE           0         /* 空闲*/
+#define __BBB_SLOT_CMD            1         /* 命令块包/数据在传输*/
+#define __BBB_SLOT_STATUS         2         /* 数据阶段结束，等待命令状态包*/
+
 /*******************************************************************************
  * Extern
  ******************************************************************************/
 extern int usbh_ms_scsi_init(struct usbh_ms_lu *p_lu);
 extern int usbh_ms_scsi_read(struct usbh_ms_lu *p_lu,
-                             uint32_t           blk,
+                             uint64_t           blk,
                              uint32_t           n_blks,
                              void              *p_buf);
 extern int usbh_ms_scsi_write(struct usbh_ms_lu *p_lu,
-                              uint32_t           blk,
+                              uint64_t           blk,
                               uint32_t           n_blks,
                               void              *p_buf);
+extern int usbh_ms_scsi_read_async(struct usbh_ms_lu *p_lu,
+                                   uint64_t           blk,
+                                   uint32_t           n_blks,
+                                   void              *p_buf,
+                                   void             (*p_fn_done)(void *p_arg, int ret),
+                                   void              *p_arg);
+extern int usbh_ms_scsi_write_async(struct usbh_ms_lu *p_lu,
+                                    uint64_t           blk,
+                                    uint32_t           n_blks,
+                                    void              *p_buf,
+                                    void             (*p_fn_done)(void *p_arg, int ret),
+                                    void              *p_arg);
+#if USB_OS_EN
+extern int usbh_ms_uas_intf_find(struct usbh_function   *p_usb_fun,
+                                 struct usbh_interface **p_intf);
+extern int usbh_ms_uas_init(struct usbh_ms *p_ms);
+extern void usbh_ms_uas_deinit(struct usbh_ms *p_ms);
+extern int usbh_ms_uas_transport(struct usbh_ms *p_ms,
+                                 uint8_t         lun_num,
+                                 void           *p_cmd,
+                                 uint8_t         cmd_len,
+                                 void           *p_data,
+                                 uint32_t        data_len,
+                                 uint8_t         dir);
+#endif
 
 /*******************************************************************************
  * Statement
  ******************************************************************************/
 /* \brief 声明一个 USB 大容量存储库结构体*/
-static struct ums_lib __g_ums_lib;
+struct ums_lib __g_ums_lib;
 
 /* \brief CBW(Command Block Wrapper 命令块包)*/
 struct __bulk_only_cbw {
@@ -58,7 +88,9 @@ static struct usbh_ms_sclass __g_sclass[] = {
         USB_MS_SC_SCSI_TRANSPARENT,
         usbh_ms_scsi_init,
         usbh_ms_scsi_read,
-        usbh_ms_scsi_write
+        usbh_ms_scsi_write,
+        usbh_ms_scsi_read_async,
+        usbh_ms_scsi_write_async
     },
     {0}
 };
@@ -89,6 +121,728 @@ static int __bulk_reset(struct usbh_ms *p_ms){
 
 }
 
+/**
+ * \brief BBB 异步传输引擎加锁
+ */
+static int __bbb_lock(struct usbh_ms_bbb *p_bbb){
+#if USB_OS_EN
+    int ret = usb_mutex_lock(p_bbb->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief BBB 异步传输引擎解锁
+ */
+static void __bbb_unlock(struct usbh_ms_bbb *p_bbb){
+#if USB_OS_EN
+    int ret = usb_mutex_unlock(p_bbb->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+}
+
+/**
+ * \brief BBB 检查引擎是否空闲(调用者持有引擎锁)
+ */
+static usb_bool_t __bbb_is_idle(struct usbh_ms_bbb *p_bbb){
+    return ((p_bbb->slots[0].state == __BBB_SLOT_IDLE) &&
+            (p_bbb->slots[1].state == __BBB_SLOT_IDLE) &&
+            (p_bbb->is_recover == USB_FALSE));
+}
+
+/**
+ * \brief BBB 选择下一个可以启动的命令槽(调用者持有引擎锁)
+ *
+ * 一个命令还在命令/数据阶段时不能启动下一个，数据阶段结束后下一个命令的命令块包
+ * 排在前一个命令的命令状态包后面，设备发完命令状态包前会 NAK 这个命令块包
+ */
+static struct usbh_ms_bbb_slot *__bbb_slot_next(struct usbh_ms_bbb *p_bbb){
+    struct usbh_ms_bbb_slot *p_slot = NULL;
+    int                      i;
+
+    if ((p_bbb->is_recover == USB_TRUE) || (p_bbb->n_sync != 0) ||
+            usb_list_head_is_empty(&p_bbb->req_pend)) {
+        return NULL;
+    }
+    for (i = 0; i < 2; i++) {
+        if (p_bbb->slots[i].state == __BBB_SLOT_CMD) {
+            return NULL;
+        }
+        if (p_bbb->slots[i].state == __BBB_SLOT_IDLE) {
+            p_slot = &p_bbb->slots[i];
+        }
+    }
+    if (p_slot == NULL) {
+        return NULL;
+    }
+    p_slot->p_req = usb_container_of(p_bbb->req_pend.p_next, struct usbh_ms_bbb_req, node);
+    usb_list_node_del(&p_slot->p_req->node);
+
+    p_slot->state  = __BBB_SLOT_CMD;
+    p_slot->n_trps = 0;
+
+    return p_slot;
+}
+
+static void __bbb_kick(struct usbh_ms *p_ms);
+
+/**
+ * \brief BBB 命令槽的传输请求包出错，进入错误恢复
+ */
+static void __bbb_slot_err(struct usbh_ms_bbb_slot *p_slot, int status){
+    struct usbh_ms_bbb *p_bbb = p_slot->p_ms->p_bbb;
+
+    /* 取消超时后回来的请求包，请求已经结束，不再恢复*/
+    if (p_slot->p_req == NULL) {
+        return;
+    }
+    /* 错误恢复取消的请求包不算请求出错，恢复后重新传输*/
+    if ((p_slot->p_req->status == USB_OK) && (status != -USB_ECANCEL)) {
+        p_slot->p_req->status = status;
+    }
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    if (p_bbb->is_recover == USB_FALSE) {
+        p_bbb->is_recover = USB_TRUE;
+        /* 错误恢复要做控制传输，不能在完成回调里做*/
+        if (p_bbb->p_job) {
+            usb_job_start(p_bbb->p_job);
+        }
+    }
+    __bbb_unlock(p_bbb);
+}
+
+/**
+ * \brief BBB 完成请求
+ */
+static void __bbb_req_done(struct usbh_ms_bbb *p_bbb, struct usbh_ms_bbb_req *p_req){
+    int ret = (p_req->status == USB_OK) ? (int)p_req->act_len : p_req->status;
+
+    if (p_req->p_fn_done) {
+        p_req->p_fn_done(p_req->p_arg, ret);
+    }
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    usb_list_node_add_tail(&p_req->node, &p_bbb->req_free);
+    __bbb_unlock(p_bbb);
+}
+
+/**
+ * \brief BBB 命令槽一个传输请求包结束
+ */
+static void __bbb_slot_trp_put(struct usbh_ms_bbb_slot *p_slot){
+    struct usbh_ms         *p_ms    = p_slot->p_ms;
+    struct usbh_ms_bbb     *p_bbb   = p_ms->p_bbb;
+    struct usbh_ms_bbb_req *p_req   = NULL;
+    usb_bool_t              is_end  = USB_FALSE;
+#if USB_OS_EN
+    usb_bool_t              is_idle = USB_FALSE;
+#endif
+
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    p_slot->n_trps--;
+    /* 错误恢复中由恢复工作处理请求*/
+    if ((p_slot->n_trps == 0) && (p_bbb->is_recover == USB_FALSE)) {
+        p_req          = p_slot->p_req;
+        p_slot->p_req  = NULL;
+        p_slot->state  = __BBB_SLOT_IDLE;
+        is_end         = USB_TRUE;
+#if USB_OS_EN
+        is_idle        = __bbb_is_idle(p_bbb);
+#endif
+    }
+    __bbb_unlock(p_bbb);
+
+    if (is_end == USB_FALSE) {
+        return;
+    }
+    /* 取消超时的命令槽请求已经结束，只回收命令槽*/
+    if (p_req != NULL) {
+        __bbb_req_done(p_bbb, p_req);
+    }
+#if USB_OS_EN
+    if (is_idle) {
+        usb_sem_give(p_bbb->p_idle);
+    }
+#endif
+    __bbb_kick(p_ms);
+}
+
+/**
+ * \brief BBB 命令槽数据阶段结束，可以启动下一个命令
+ */
+static void __bbb_slot_data_end(struct usbh_ms_bbb_slot *p_slot){
+    struct usbh_ms_bbb *p_bbb = p_slot->p_ms->p_bbb;
+
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    p_slot->state = __BBB_SLOT_STATUS;
+    __bbb_unlock(p_bbb);
+
+    __bbb_kick(p_slot->p_ms);
+}
+
+/**
+ * \brief BBB 命令块包传输完成回调函数
+ */
+static void __bbb_cbw_done(void *p_arg){
+    struct usbh_ms_bbb_slot *p_slot = (struct usbh_ms_bbb_slot *)p_arg;
+
+    if (p_slot->trp_cbw.status != USB_OK) {
+        __bbb_slot_err(p_slot, p_slot->trp_cbw.status);
+    } else if ((p_slot->p_req != NULL) && (p_slot->p_req->data_len == 0)) {
+        __bbb_slot_data_end(p_slot);
+    }
+    __bbb_slot_trp_put(p_slot);
+}
+
+/**
+ * \brief BBB 数据传输完成回调函数
+ */
+static void __bbb_data_done(void *p_arg){
+    struct usbh_ms_bbb_slot *p_slot = (struct usbh_ms_bbb_slot *)p_arg;
+
+    if (p_slot->trp_data.status != USB_OK) {
+        __bbb_slot_err(p_slot, p_slot->trp_data.status);
+    } else if (p_slot->p_req != NULL) {
+        p_slot->p_req->act_len = p_slot->trp_data.act_len;
+        __bbb_slot_data_end(p_slot);
+    }
+    __bbb_slot_trp_put(p_slot);
+}
+
+/**
+ * \brief BBB 命令状态包传输完成回调函数
+ */
+static void __bbb_csw_done(void *p_arg){
+    struct usbh_ms_bbb_slot *p_slot = (struct usbh_ms_bbb_slot *)p_arg;
+    struct __bulk_only_csw  *p_csw  = (struct __bulk_only_csw *)p_slot->p_csw;
+
+    if (p_slot->trp_csw.status != USB_OK) {
+        __bbb_slot_err(p_slot, p_slot->trp_csw.status);
+    } else if ((p_slot->trp_csw.act_len < 13) ||
+            (USB_CPU_TO_LE32(p_csw->sig) != __MS_CSW_SIGNATURE) ||
+            (USB_CPU_TO_LE32(p_csw->tag) != p_slot->tag) ||
+            (p_csw->sta > 0x01)) {
+        /* 命令状态包无效或者相位错误，需要复位恢复*/
+        __bbb_slot_err(p_slot, -USB_EDATA);
+    }
+    __bbb_slot_trp_put(p_slot);
+}
+
+/**
+ * \brief BBB 启动命令槽，命令块包、数据和命令状态包一起提交
+ */
+static void __bbb_slot_start(struct usbh_ms_bbb_slot *p_slot){
+    int                     ret, n_fail;
+    struct usbh_ms         *p_ms   = p_slot->p_ms;
+    struct usbh_ms_bbb_req *p_req  = p_slot->p_req;
+    struct __bulk_only_cbw *p_cbw  = (struct __bulk_only_cbw *)p_slot->p_cbw;
+    struct usbh_trp        *p_trps[2];
+    struct usbh_ms_bbb     *p_bbb  = p_ms->p_bbb;
+
+    p_slot->tag = __tag_get(p_ms);
+
+    /* 填充命令块包*/
+    p_cbw->sig   = USB_CPU_TO_LE32(__MS_CBW_SIGNATURE);
+    p_cbw->tag   = USB_CPU_TO_LE32(p_slot->tag);
+    p_cbw->d_len = USB_CPU_TO_LE32(p_req->data_len);
+    p_cbw->flags = p_req->dir;
+    p_cbw->lun   = p_req->p_lu->lun_num & 0x0F;
+    p_cbw->c_len = p_req->cmd_len;
+    memset(p_cbw->cb, 0, 16);
+    memcpy(p_cbw->cb, p_req->cmd, p_req->cmd_len);
+
+    p_slot->trp_cbw.act_len  = 0;
+    p_slot->trp_cbw.status   = -USB_EINPROGRESS;
+    p_slot->trp_data.p_ep    = (p_req->dir == USB_DIR_IN) ? p_ms->p_ep_in : p_ms->p_ep_out;
+    p_slot->trp_data.p_data  = p_req->p_data;
+    p_slot->trp_data.len     = p_req->data_len;
+    p_slot->trp_data.act_len = 0;
+    p_slot->trp_data.status  = -USB_EINPROGRESS;
+    p_slot->trp_csw.act_len  = 0;
+    p_slot->trp_csw.status   = -USB_EINPROGRESS;
+
+    /* 先算上所有请求包，避免完成回调提前结束命令槽*/
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    p_slot->n_trps = (p_req->data_len != 0) ? 3 : 2;
+    __bbb_unlock(p_bbb);
+
+    n_fail = p_slot->n_trps;
+    if (p_req->data_len == 0) {
+        ret = usbh_trp_submit(&p_slot->trp_cbw);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+        n_fail--;
+        ret = usbh_trp_submit(&p_slot->trp_csw);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+    } else if (p_req->dir == USB_DIR_IN) {
+        ret = usbh_trp_submit(&p_slot->trp_cbw);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+        n_fail--;
+        /* 数据和命令状态包都在输入端点上，一次提交*/
+        p_trps[0] = &p_slot->trp_data;
+        p_trps[1] = &p_slot->trp_csw;
+        ret = usbh_trp_submit_batch(p_trps, 2);
+        if (ret != 2) {
+            n_fail -= (ret > 0) ? ret : 0;
+            ret     = (ret < 0) ? ret : -USB_EAGAIN;
+            goto __failed;
+        }
+    } else {
+        /* 命令块包和数据都在输出端点上，一次提交*/
+        p_trps[0] = &p_slot->trp_cbw;
+        p_trps[1] = &p_slot->trp_data;
+        ret = usbh_trp_submit_batch(p_trps, 2);
+        if (ret != 2) {
+            n_fail -= (ret > 0) ? ret : 0;
+            ret     = (ret < 0) ? ret : -USB_EAGAIN;
+            goto __failed;
+        }
+        n_fail -= 2;
+        ret = usbh_trp_submit(&p_slot->trp_csw);
+        if (ret != USB_OK) {
+            goto __failed;
+        }
+    }
+    return;
+__failed:
+    __USB_ERR_INFO("usb mass storage BBB TRP submit failed(%d)\r\n", ret);
+    /* 没提交的请求包不会有完成回调，在这里结束*/
+    __bbb_slot_err(p_slot, ret);
+    while (n_fail--) {
+        __bbb_slot_trp_put(p_slot);
+    }
+}
+
+/**
+ * \brief BBB 启动等待中的命令
+ */
+static void __bbb_kick(struct usbh_ms *p_ms){
+    struct usbh_ms_bbb      *p_bbb  = p_ms->p_bbb;
+    struct usbh_ms_bbb_slot *p_slot = NULL;
+
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    p_slot = __bbb_slot_next(p_bbb);
+    __bbb_unlock(p_bbb);
+
+    if (p_slot != NULL) {
+        __bbb_slot_start(p_slot);
+    }
+}
+
+/**
+ * \brief BBB 取消请求包超时，结束命令槽里和等待中的所有请求，还没回来的请求包由完成
+ *        回调回收命令槽
+ */
+static void __bbb_abort(struct usbh_ms *p_ms, int status){
+    int                      i;
+    struct usb_list_head     req_list;
+    struct usbh_ms_bbb      *p_bbb  = p_ms->p_bbb;
+    struct usbh_ms_bbb_req  *p_req  = NULL;
+    struct usbh_ms_bbb_slot *p_slot = NULL;
+
+    usb_list_head_init(&req_list);
+
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    for (i = 0; i < 2; i++) {
+        p_slot = &p_bbb->slots[i];
+
+        if (p_slot->state == __BBB_SLOT_IDLE) {
+            continue;
+        }
+        if (p_slot->p_req != NULL) {
+            usb_list_node_add_tail(&p_slot->p_req->node, &req_list);
+            p_slot->p_req = NULL;
+        }
+        if (p_slot->n_trps == 0) {
+            p_slot->state = __BBB_SLOT_IDLE;
+        }
+    }
+    while (!usb_list_head_is_empty(&p_bbb->req_pend)) {
+        p_req = usb_container_of(p_bbb->req_pend.p_next, struct usbh_ms_bbb_req, node);
+        usb_list_node_del(&p_req->node);
+        usb_list_node_add_tail(&p_req->node, &req_list);
+    }
+    p_bbb->is_recover = USB_FALSE;
+    __bbb_unlock(p_bbb);
+
+    while (!usb_list_head_is_empty(&req_list)) {
+        p_req = usb_container_of(req_list.p_next, struct usbh_ms_bbb_req, node);
+        usb_list_node_del(&p_req->node);
+
+        if (p_req->status == USB_OK) {
+            p_req->status = status;
+        }
+        __bbb_req_done(p_bbb, p_req);
+    }
+#if USB_OS_EN
+    usb_sem_give(p_bbb->p_idle);
+#endif
+}
+
+/**
+ * \brief BBB 错误恢复，取消在传输的请求包，复位设备并清除端点停止，出错的请求返回
+ *        错误，没有出错的请求重新排队
+ */
+static void __bbb_recover(struct usbh_ms *p_ms){
+    int                     ret, i, n_trps, retry;
+    struct usbh_ms_bbb     *p_bbb = p_ms->p_bbb;
+    struct usbh_ms_bbb_req *p_req = NULL;
+
+    for (i = 0; i < 2; i++) {
+        struct usbh_ms_bbb_slot *p_slot = &p_bbb->slots[i];
+
+        if (p_slot->state == __BBB_SLOT_IDLE) {
+            continue;
+        }
+        if (p_slot->trp_cbw.status == -USB_EINPROGRESS) {
+            usbh_trp_xfer_cancel(&p_slot->trp_cbw);
+        }
+        /* 之前恢复超时被放弃的命令槽没有请求，只取消还没回来的请求包*/
+        if (((p_slot->p_req == NULL) || (p_slot->p_req->data_len != 0)) &&
+                (p_slot->trp_data.status == -USB_EINPROGRESS)) {
+            usbh_trp_xfer_cancel(&p_slot->trp_data);
+        }
+        if (p_slot->trp_csw.status == -USB_EINPROGRESS) {
+            usbh_trp_xfer_cancel(&p_slot->trp_csw);
+        }
+    }
+    /* 等待取消完成*/
+    retry = 100;
+    do {
+        if (__bbb_lock(p_bbb) != USB_OK) {
+            return;
+        }
+        n_trps = p_bbb->slots[0].n_trps + p_bbb->slots[1].n_trps;
+        __bbb_unlock(p_bbb);
+        if (n_trps != 0) {
+            usb_mdelay(10);
+        }
+    } while ((n_trps != 0) && (--retry));
+
+    if (n_trps != 0) {
+        __USB_ERR_INFO("usb mass storage BBB TRP cancel failed\r\n");
+        /* 不能等待的请求都返回超时，唤醒等待引擎空闲的同步传输*/
+        __bbb_abort(p_ms, -USB_ETIME);
+        return;
+    }
+
+    if (usbh_dev_is_connect(p_ms->p_ep_in->p_usb_dev)) {
+        ret = __bulk_reset(p_ms);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("bulk reset failed(%d)\r\n", ret);
+        }
+        usbh_dev_ep_halt_clr(p_ms->p_ep_in);
+        usbh_dev_ep_halt_clr(p_ms->p_ep_out);
+    }
+
+    /* 先处理新的命令，放回等待链表头后保持原来的顺序*/
+    for (i = 0; i < 2; i++) {
+        struct usbh_ms_bbb_slot *p_slot = &p_bbb->slots[(p_bbb->slots[0].tag < p_bbb->slots[1].tag) ? (1 - i) : i];
+
+        if (p_slot->state == __BBB_SLOT_IDLE) {
+            continue;
+        }
+        p_req         = p_slot->p_req;
+        p_slot->p_req = NULL;
+
+        /* 请求已经被放弃的命令槽，请求包都已经回来，只回收命令槽*/
+        if (p_req == NULL) {
+            p_slot->state = __BBB_SLOT_IDLE;
+            continue;
+        }
+        if (p_req->status != USB_OK) {
+            __bbb_req_done(p_bbb, p_req);
+        } else {
+            p_req->act_len = 0;
+            if (__bbb_lock(p_bbb) == USB_OK) {
+                usb_list_node_add(&p_req->node, &p_bbb->req_pend);
+                __bbb_unlock(p_bbb);
+            }
+        }
+        p_slot->state = __BBB_SLOT_IDLE;
+    }
+
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    p_bbb->is_recover = USB_FALSE;
+    __bbb_unlock(p_bbb);
+#if USB_OS_EN
+    usb_sem_give(p_bbb->p_idle);
+#endif
+    __bbb_kick(p_ms);
+}
+
+/**
+ * \brief BBB 错误恢复工作
+ */
+static void __bbb_recover_job(void *p_arg){
+    __bbb_recover((struct usbh_ms *)p_arg);
+}
+
+/**
+ * \brief BBB 检查是否有等待做的错误恢复(不支持 USB 工作时在调用者线程里做)
+ */
+static void __bbb_recover_chk(struct usbh_ms *p_ms){
+    if ((p_ms->p_bbb->p_job == NULL) && (p_ms->p_bbb->is_recover == USB_TRUE)) {
+        __bbb_recover(p_ms);
+    }
+}
+
+/**
+ * \brief BBB 同步传输开始，等待异步命令传输完成并暂停引擎
+ */
+static int __bbb_sync_enter(struct usbh_ms *p_ms){
+    int                 ret;
+    usb_bool_t          is_idle;
+    struct usbh_ms_bbb *p_bbb = p_ms->p_bbb;
+
+    if (p_bbb == NULL) {
+        return USB_OK;
+    }
+    ret = __bbb_lock(p_bbb);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    p_bbb->n_sync++;
+    __bbb_unlock(p_bbb);
+
+    while (1) {
+        __bbb_recover_chk(p_ms);
+
+        ret = __bbb_lock(p_bbb);
+        if (ret != USB_OK) {
+            break;
+        }
+        is_idle = __bbb_is_idle(p_bbb);
+        __bbb_unlock(p_bbb);
+
+        if (is_idle) {
+            return USB_OK;
+        }
+#if USB_OS_EN
+        ret = usb_sem_take(p_bbb->p_idle, UMS_LOCK_TIMEOUT);
+        if (ret != USB_OK) {
+            break;
+        }
+#else
+        ret = -USB_EBUSY;
+        break;
+#endif
+    }
+    if (__bbb_lock(p_bbb) == USB_OK) {
+        p_bbb->n_sync--;
+        __bbb_unlock(p_bbb);
+    }
+    return ret;
+}
+
+/**
+ * \brief BBB 同步传输结束，恢复引擎
+ */
+static void __bbb_sync_exit(struct usbh_ms *p_ms){
+    struct usbh_ms_bbb *p_bbb = p_ms->p_bbb;
+
+    if (p_bbb == NULL) {
+        return;
+    }
+    if (__bbb_lock(p_bbb) != USB_OK) {
+        return;
+    }
+    p_bbb->n_sync--;
+    __bbb_unlock(p_bbb);
+
+    __bbb_kick(p_ms);
+}
+
+/**
+ * \brief USB 大容量异步块传输，请求排队后马上返回
+ */
+static int __ms_bulk_transport_async(struct usbh_ms_lu *p_lu,
+                                     void              *p_cmd,
+                                     uint8_t            cmd_len,
+                                     void              *p_data,
+                                     uint32_t           data_len,
+                                     uint8_t            dir,
+                                     void             (*p_fn_done)(void *p_arg, int ret),
+                                     void              *p_arg){
+    int                     ret;
+    struct usbh_ms         *p_ms  = p_lu->p_ms;
+    struct usbh_ms_bbb     *p_bbb = p_ms->p_bbb;
+    struct usbh_ms_bbb_req *p_req = NULL;
+
+    if (p_bbb == NULL) {
+        return -USB_ENOTSUP;
+    }
+    if ((cmd_len > 16) || ((data_len != 0) && (p_data == NULL))) {
+        return -USB_EILLEGAL;
+    }
+
+    __bbb_recover_chk(p_ms);
+
+    ret = __bbb_lock(p_bbb);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    if (usb_list_head_is_empty(&p_bbb->req_free)) {
+        ret = -USB_EAGAIN;
+    } else {
+        p_req = usb_container_of(p_bbb->req_free.p_next, struct usbh_ms_bbb_req, node);
+        usb_list_node_del(&p_req->node);
+
+        p_req->p_lu      = p_lu;
+        p_req->cmd_len   = cmd_len;
+        p_req->dir       = dir;
+        p_req->p_data    = p_data;
+        p_req->data_len  = data_len;
+        p_req->act_len   = 0;
+        p_req->status    = USB_OK;
+        p_req->p_fn_done = p_fn_done;
+        p_req->p_arg     = p_arg;
+        memcpy(p_req->cmd, p_cmd, cmd_len);
+
+        usb_list_node_add_tail(&p_req->node, &p_bbb->req_pend);
+    }
+    __bbb_unlock(p_bbb);
+
+    if (ret == USB_OK) {
+        __bbb_kick(p_ms);
+    }
+    return ret;
+}
+
+/**
+ * \brief BBB 异步传输引擎反初始化
+ */
+static void __bbb_deinit(struct usbh_ms *p_ms){
+    int                 i;
+    struct usbh_ms_bbb *p_bbb = p_ms->p_bbb;
+
+    if (p_bbb == NULL) {
+        return;
+    }
+    if (p_bbb->p_job) {
+        usb_job_destory(p_bbb->p_job);
+    }
+    for (i = 0; i < 2; i++) {
+        if (p_bbb->slots[i].p_cbw) {
+            usb_lib_mfree(&__g_ums_lib.lib, p_bbb->slots[i].p_cbw);
+        }
+        if (p_bbb->slots[i].p_csw) {
+            usb_lib_mfree(&__g_ums_lib.lib, p_bbb->slots[i].p_csw);
+        }
+    }
+#if USB_OS_EN
+    if (p_bbb->p_idle) {
+        usb_lib_sem_destroy(&__g_ums_lib.lib, p_bbb->p_idle);
+    }
+    if (p_bbb->p_lock) {
+        usb_lib_mutex_destroy(&__g_ums_lib.lib, p_bbb->p_lock);
+    }
+#endif
+    usb_lib_mfree(&__g_ums_lib.lib, p_bbb);
+
+    p_ms->p_bbb = NULL;
+}
+
+/**
+ * \brief BBB 异步传输引擎初始化
+ */
+static int __bbb_init(struct usbh_ms *p_ms){
+    int                 i;
+    struct usbh_ms_bbb *p_bbb = NULL;
+
+    p_bbb = usb_lib_malloc(&__g_ums_lib.lib, sizeof(struct usbh_ms_bbb));
+    if (p_bbb == NULL) {
+        return -USB_ENOMEM;
+    }
+    memset(p_bbb, 0, sizeof(struct usbh_ms_bbb));
+    p_ms->p_bbb = p_bbb;
+
+#if USB_OS_EN
+    p_bbb->p_lock = usb_lib_mutex_create(&__g_ums_lib.lib);
+    if (p_bbb->p_lock == NULL) {
+        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+        goto __failed;
+    }
+    p_bbb->p_idle = usb_lib_sem_create(&__g_ums_lib.lib);
+    if (p_bbb->p_idle == NULL) {
+        __USB_ERR_TRACE(SemCreateErr, "\r\n");
+        goto __failed;
+    }
+#endif
+    /* 不支持 USB 工作时在下一次调用时做错误恢复*/
+    p_bbb->p_job = usb_job_create(__bbb_recover_job, (void *)p_ms);
+
+    usb_list_head_init(&p_bbb->req_free);
+    usb_list_head_init(&p_bbb->req_pend);
+    for (i = 0; i < USBH_MS_BBB_REQ_MAX; i++) {
+        usb_list_node_add_tail(&p_bbb->reqs[i].node, &p_bbb->req_free);
+    }
+
+    for (i = 0; i < 2; i++) {
+        struct usbh_ms_bbb_slot *p_slot = &p_bbb->slots[i];
+
+        p_slot->p_ms  = p_ms;
+        p_slot->state = __BBB_SLOT_IDLE;
+
+        p_slot->p_cbw = usb_lib_malloc(&__g_ums_lib.lib, sizeof(struct __bulk_only_cbw));
+        if (p_slot->p_cbw == NULL) {
+            goto __failed;
+        }
+        memset(p_slot->p_cbw, 0, sizeof(struct __bulk_only_cbw));
+
+        p_slot->p_csw = usb_lib_malloc(&__g_ums_lib.lib, sizeof(struct __bulk_only_csw));
+        if (p_slot->p_csw == NULL) {
+            goto __failed;
+        }
+
+        p_slot->trp_cbw.p_ep       = p_ms->p_ep_out;
+        p_slot->trp_cbw.p_data     = p_slot->p_cbw;
+        p_slot->trp_cbw.len        = 31;
+        p_slot->trp_cbw.p_fn_done  = __bbb_cbw_done;
+        p_slot->trp_cbw.p_arg      = (void *)p_slot;
+
+        p_slot->trp_data.p_fn_done = __bbb_data_done;
+        p_slot->trp_data.p_arg     = (void *)p_slot;
+
+        p_slot->trp_csw.p_ep       = p_ms->p_ep_in;
+        p_slot->trp_csw.p_data     = p_slot->p_csw;
+        p_slot->trp_csw.len        = 13;
+        p_slot->trp_csw.p_fn_done  = __bbb_csw_done;
+        p_slot->trp_csw.p_arg      = (void *)p_slot;
+    }
+    return USB_OK;
+__failed:
+    __bbb_deinit(p_ms);
+    return -USB_ENOMEM;
+}
+
 /**
  * \brief 初始化大容量存储设备
  */
@@ -174,6 +928,21 @@ static int __ms_init(struct usbh_ms       *p_ms,
         return -USB_EPERM;
     }
 
+#if USB_OS_EN
+    /* 设备有 UAS 备用设置时使用 UAS 传输，失败则回退到 BBB 传输*/
+    ret = usbh_ms_uas_init(p_ms);
+    if (ret == USB_OK) {
+        p_ms->pro = USB_MS_PRO_UAS;
+    } else if (ret != -USB_ENOTSUP) {
+        __USB_ERR_INFO("usb mass storage UAS init failed(%d), use bulk-only\r\n", ret);
+    }
+#endif
+    if (p_ms->pro == USB_MS_PRO_BBB) {
+        ret = __bbb_init(p_ms);
+        if (ret != USB_OK) {
+            return ret;
+        }
+    }
     /* 等待上电*/
     usb_mdelay(200);
 
@@ -219,7 +988,10 @@ static int __ms_deinit(struct usbh_ms *p_ms){
 #endif
     uint8_t i;
 
+    __bbb_deinit(p_ms);
 #if USB_OS_EN
+    usbh_ms_uas_deinit(p_ms);
+
     if (p_ms->p_lock) {
         ret = usb_lib_mutex_destroy(&__g_ums_lib.lib, p_ms->p_lock);
         if (ret != USB_OK) {
@@ -615,6 +1387,7 @@ int usbh_ms_transport(struct usbh_ms_lu *p_lu,
                       void              *p_data,
                       uint32_t           data_len,
                       uint8_t            dir){
+    int ret;
 
     /* 支持批量传输*/
     switch (p_lu->p_ms->pro) {
@@ -625,19 +1398,73 @@ int usbh_ms_transport(struct usbh_ms_lu *p_lu,
             return -USB_ENOTSUP;
 
         case USB_MS_PRO_BBB:
-            return __ms_bulk_transport(p_lu->p_ms,
-                                       p_lu->lun_num,
-                                       p_cmd,
-                                       cmd_len,
-                                       p_data,
-                                       data_len,
-                                       dir);
+            /* 等待异步命令传输完成*/
+            ret = __bbb_sync_enter(p_lu->p_ms);
+            if (ret != USB_OK) {
+                return ret;
+            }
+            ret = __ms_bulk_transport(p_lu->p_ms,
+                                      p_lu->lun_num,
+                                      p_cmd,
+                                      cmd_len,
+                                      p_data,
+                                      data_len,
+                                      dir);
+            __bbb_sync_exit(p_lu->p_ms);
+
+            return ret;
+#if USB_OS_EN
+        case USB_MS_PRO_UAS:
+            return usbh_ms_uas_transport(p_lu->p_ms,
+                                         p_lu->lun_num,
+                                         p_cmd,
+                                         cmd_len,
+                                         p_data,
+                                         data_len,
+                                         dir);
+#endif
 
         default:
             return -USB_ENOTSUP;
     }
 }
 
+/**
+ * \brief USB 大容量存储设备异步传输函数，请求排队后马上返回，传输完成后调用完成回调函数
+ *
+ * \param[in] p_lun     逻辑单元结构体
+ * \param[in] p_cmd     相关命令代码
+ * \param[in] cmd_len   命令长度
+ * \param[in] p_data    数据缓存
+ * \param[in] data_len  数据长度
+ * \param[in] dir       数据方向
+ * \param[in] p_fn_done 完成回调函数
+ * \param[in] p_arg     完成回调函数参数
+ *
+ * \retval 成功排队返回 USB_OK
+ */
+int usbh_ms_transport_async(struct usbh_ms_lu *p_lu,
+                            void              *p_cmd,
+                            uint8_t            cmd_len,
+                            void              *p_data,
+                            uint32_t           data_len,
+                            uint8_t            dir,
+                            void             (*p_fn_done)(void *p_arg, int ret),
+                            void              *p_arg){
+    /* 只支持 BBB 传输*/
+    if (p_lu->p_ms->pro != USB_MS_PRO_BBB) {
+        return -USB_ENOTSUP;
+    }
+    return __ms_bulk_transport_async(p_lu,
+                                     p_cmd,
+                                     cmd_len,
+                                     p_data,
+                                     data_len,
+                                     dir,
+                                     p_fn_done,
+                                     p_arg);
+}
+
 /**
  * \brief USB 大容量存储设备块读函数
  *
@@ -649,7 +1476,7 @@ int usbh_ms_transport(struct usbh_ms_lu *p_lu,
  * \retval 成功返回实际读写成功的字节数
  */
 int usbh_ms_blk_read(struct usbh_ms_lu *p_lu,
-                     uint32_t           blk_num,
+                     uint64_t           blk_num,
                      uint32_t           n_blks,
                      void              *p_buf){
     int ret;
@@ -691,7 +1518,7 @@ int usbh_ms_blk_read(struct usbh_ms_lu *p_lu,
  * \retval 成功返回实际读写成功的字节数
  */
 int usbh_ms_blk_write(struct usbh_ms_lu *p_lu,
-                      uint32_t           blk_num,
+                      uint64_t           blk_num,
                       uint32_t           n_blks,
                       void              *p_buf){
     int ret;
@@ -722,6 +1549,84 @@ int usbh_ms_blk_write(struct usbh_ms_lu *p_lu,
     return ret;
 }
 
+/**
+ * \brief USB 大容量存储设备异步块读函数
+ *
+ * \param[in] p_lu      逻辑单元结构体
+ * \param[in] blk_num   起始块编号
+ * \param[in] n_blks    块数量
+ * \param[in] p_buf     数据缓存(请求完成前不能释放)
+ * \param[in] p_fn_done 完成回调函数
+ * \param[in] p_arg     完成回调函数参数
+ *
+ * \retval 成功排队返回 USB_OK，请求池满返回 -USB_EAGAIN
+ */
+int usbh_ms_blk_read_async(struct usbh_ms_lu *p_lu,
+                           uint64_t           blk_num,
+                           uint32_t           n_blks,
+                           void              *p_buf,
+                           void             (*p_fn_done)(void *p_arg, int ret),
+                           void              *p_arg){
+    if ((p_lu == NULL) || (p_buf == NULL) || (p_fn_done == NULL)) {
+        return -USB_EINVAL;
+    }
+    if ((p_lu->p_ms == NULL) || (p_lu->p_ms->p_sclass == NULL)) {
+        return -USB_EILLEGAL;
+    }
+    if (p_lu->p_ms->p_sclass->p_fn_read_async == NULL) {
+        return -USB_ENOTSUP;
+    }
+    if (p_lu->p_ms->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+
+    return p_lu->p_ms->p_sclass->p_fn_read_async(p_lu,
+                                                 blk_num,
+                                                 n_blks,
+                                                 p_buf,
+                                                 p_fn_done,
+                                                 p_arg);
+}
+
+/**
+ * \brief USB 大容量存储设备异步块写函数
+ *
+ * \param[in] p_lu      逻辑单元结构体
+ * \param[in] blk_num   起始块编号
+ * \param[in] n_blks    块数量
+ * \param[in] p_buf     数据缓存(请求完成前不能释放)
+ * \param[in] p_fn_done 完成回调函数
+ * \param[in] p_arg     完成回调函数参数
+ *
+ * \retval 成功排队返回 USB_OK，请求池满返回 -USB_EAGAIN
+ */
+int usbh_ms_blk_write_async(struct usbh_ms_lu *p_lu,
+                            uint64_t           blk_num,
+                            uint32_t           n_blks,
+                            void              *p_buf,
+                            void             (*p_fn_done)(void *p_arg, int ret),
+                            void              *p_arg){
+    if ((p_lu == NULL) || (p_buf == NULL) || (p_fn_done == NULL)) {
+        return -USB_EINVAL;
+    }
+    if ((p_lu->p_ms == NULL) || (p_lu->p_ms->p_sclass == NULL)) {
+        return -USB_EILLEGAL;
+    }
+    if (p_lu->p_ms->p_sclass->p_fn_write_async == NULL) {
+        return -USB_ENOTSUP;
+    }
+    if (p_lu->p_ms->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+
+    return p_lu->p_ms->p_sclass->p_fn_write_async(p_lu,
+                                                  blk_num,
+                                                  n_blks,
+                                                  p_buf,
+                                                  p_fn_done,
+                                                  p_arg);
+}
+
 /**
  * \brief 获取 USB 大容量存储设备支持的最大逻辑单元数量
  *
@@ -1305,7 +2210,7 @@ int usbh_ms_lu_blk_size_get(struct usbh_ms_lu *p_lu, uint32_t *p_blk_size){
  *
  * \retval 成功返回 USB_OK
  */
-int usbh_ms_lu_nblks_get(struct usbh_ms_lu *p_lu, uint32_t *p_nblk){
+int usbh_ms_lu_nblks_get(struct usbh_ms_lu *p_lu, uint64_t *p_nblk){
     int ret = USB_OK;
 
     if ((p_lu == NULL) || (p_nblk == NULL)) {
@@ -1335,6 +2240,105 @@ int usbh_ms_lu_nblks_get(struct usbh_ms_lu *p_lu, uint32_t *p_nblk){
     return ret;
 }
 
+/**
+ * \brief 获取 USB 大容量存储设备逻辑单元单个读写命令最大块数量
+ *
+ * \param[in]  p_lu       逻辑单元结构体
+ * \param[out] p_max_blks 返回的最大块数量
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ms_lu_max_blks_get(struct usbh_ms_lu *p_lu, uint32_t *p_max_blks){
+    int ret = USB_OK;
+
+    if ((p_lu == NULL) || (p_max_blks == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (p_lu->p_ms->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+    if (p_lu->is_init == USB_FALSE) {
+        return -USB_ENOINIT;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_lu->p_ms->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    *p_max_blks = p_lu->max_blks;
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_lu->p_ms->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 设置 USB 大容量存储设备 UAS 命令队列深度，设备使用 BBB 传输时不支持
+ *
+ * \param[in] p_ms   USB 大容量存储设备结构体
+ * \param[in] qdepth 命令队列深度(1 ~ USBH_MS_UAS_QDEPTH_MAX)
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ms_uas_qdepth_set(struct usbh_ms *p_ms, uint8_t qdepth){
+    int ret = -USB_ENOTSUP;
+
+    if ((p_ms == NULL) || (qdepth == 0) || (qdepth > USBH_MS_UAS_QDEPTH_MAX)) {
+        return -USB_EINVAL;
+    }
+    if (p_ms->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+#if USB_OS_EN
+    if (p_ms->p_uas == NULL) {
+        return -USB_ENOTSUP;
+    }
+    ret = usb_mutex_lock(p_ms->p_uas->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+    /* 已经在传输的命令不受影响*/
+    p_ms->p_uas->qdepth = qdepth;
+
+    ret = usb_mutex_unlock(p_ms->p_uas->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 获取 USB 大容量存储设备 UAS 命令队列深度
+ *
+ * \param[in]  p_ms     USB 大容量存储设备结构体
+ * \param[out] p_qdepth 返回的命令队列深度，BBB 传输返回 1
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ms_uas_qdepth_get(struct usbh_ms *p_ms, uint8_t *p_qdepth){
+    if ((p_ms == NULL) || (p_qdepth == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (p_ms->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+    *p_qdepth = 1;
+#if USB_OS_EN
+    if (p_ms->p_uas != NULL) {
+        *p_qdepth = p_ms->p_uas->qdepth;
+    }
+#endif
+    return USB_OK;
+}
+
 /**
  * \brief USB 大容量存储设备探测函数
  */
@@ -1350,6 +2354,7 @@ int usbh_ms_probe(struct usbh_function *p_usb_fun){
     /* 检查协议*/
     proto = USBH_FUNC_PROTO_GET(p_usb_fun);
     if ((proto != USB_MS_PRO_BBB) &&
+            (proto != USB_MS_PRO_UAS) &&
             (proto != USB_MS_PRO_CBI_NCCI) &&
             (proto != USB_MS_PRO_CBI_CCI)) {
         return -USB_ENOTSUP;
@@ -1378,10 +2383,13 @@ int usbh_ms_probe(struct usbh_function *p_usb_fun){
 int usbh_ms_create(struct usbh_function *p_usb_fun,
                    char                 *p_name,
                    uint32_t              lu_buf_size){
-    int             ret_tmp, ret = -USB_ENOTSUP;
-    uint8_t         n_lu         = 0;
-    uint32_t        n_lu_mem     = 0;
-    struct usbh_ms *p_ms         = NULL;
+    int                    ret_tmp, ret = -USB_ENOTSUP;
+    uint8_t                n_lu         = 0;
+    uint32_t               n_lu_mem     = 0;
+    struct usbh_ms        *p_ms         = NULL;
+#if USB_OS_EN
+    struct usbh_interface *p_intf       = NULL;
+#endif
 
     /* 检查 USB 库是否正常*/
     if ((usb_lib_is_init(&__g_ums_lib.lib) == USB_FALSE) ||
@@ -1412,15 +2420,23 @@ int usbh_ms_create(struct usbh_function *p_usb_fun,
         return ret;
     }
 
-    /* 获取最大的逻辑单元数*/
-    ret = __ms_max_lun_get(p_usb_fun, &n_lu);
-    if (ret != USB_OK) {
-        __USB_ERR_INFO("usb mass storage logical unit numeber get failed(%d)\r\n", ret);
-        goto __failed1;
-    } else if (n_lu == 0) {
-        __USB_ERR_INFO("usb mass storage have no logical unit\r\n");
-        ret = -USB_ENODEV;
-        goto __failed1;
+#if USB_OS_EN
+    /* UAS 没有 Bulk-Only 的获取最大逻辑单元请求，只使用逻辑单元 0*/
+    if (usbh_ms_uas_intf_find(p_usb_fun, &p_intf) == USB_OK) {
+        n_lu = 1;
+    }
+#endif
+    if (n_lu == 0) {
+        /* 获取最大的逻辑单元数*/
+        ret = __ms_max_lun_get(p_usb_fun, &n_lu);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("usb mass storage logical unit numeber get failed(%d)\r\n", ret);
+            goto __failed1;
+        } else if (n_lu == 0) {
+            __USB_ERR_INFO("usb mass storage have no logical unit\r\n");
+            ret = -USB_ENODEV;
+            goto __failed1;
+        }
     }
 
     /* 计算要申请的内存*/
@@ -3,6 +3,7 @@
  ******************************************************************************/
 #include "core/include/host/class/ms/usbh_ms_drv.h"
 #include <string.h>
+#include <limits.h>
 
 /*******************************************************************************
  * Macro operate
@@ -16,6 +17,15 @@
 #define __READ_CAPACITY             0x25
 #define __READ_10                   0x28
 #define __WRITE_10                  0x2a
+#define __READ_16                   0x88
+#define __WRITE_16                  0x8a
+#define __SERVICE_ACTION_IN_16      0x9e
+
+/* \brief SERVICE ACTION IN(16) 服务动作*/
+#define __SAI_READ_CAPACITY_16      0x10
+
+/* \brief 重要产品数据页*/
+#define __VPD_BLOCK_LIMITS          0xb0
 
 /*******************************************************************************
  * Extern
@@ -26,6 +36,14 @@ extern int usbh_ms_transport(struct usbh_ms_lu *p_lu,
                              void              *p_data,
                              uint32_t           data_len,
                              uint8_t            dir);
+extern int usbh_ms_transport_async(struct usbh_ms_lu *p_lu,
+                                   void              *p_cmd,
+                                   uint8_t            cmd_len,
+                                   void              *p_data,
+                                   uint32_t           data_len,
+                                   uint8_t            dir,
+                                   void             (*p_fn_done)(void *p_arg, int ret),
+                                   void              *p_arg);
 
 /*******************************************************************************
  * Code
@@ -51,6 +69,30 @@ static int __inquiry(struct usbh_ms_lu *p_lu,
                              USB_DIR_IN);
 }
 
+/**
+ * \brief 查询逻辑单元重要产品数据页
+ */
+static int __inquiry_vpd(struct usbh_ms_lu *p_lu,
+                         uint8_t            page,
+                         void              *p_buf,
+                         uint8_t            len){
+    uint8_t cmd[6];
+
+    memset(cmd, 0, 6);
+
+    cmd[0] = __INQUIRY;
+    cmd[1] = 0x01;
+    cmd[2] = page;
+    cmd[4] = len;
+
+    return usbh_ms_transport(p_lu,
+                             cmd,
+                             6,
+                             p_buf,
+                             len,
+                             USB_DIR_IN);
+}
+
 /**
  * \brief 检查逻辑单元是否准备好
  */
@@ -88,13 +130,54 @@ static int __request_sense(struct usbh_ms_lu *p_lu,
 }
 
 /**
- * \brief 读取逻辑单元容量
+ * \brief 读取逻辑单元容量(16)
+ */
+static int __read_capacity16(struct usbh_ms_lu *p_lu,
+                             uint64_t          *p_nblks,
+                             uint32_t          *p_blk_size){
+    int     ret;
+    uint8_t cmd[16];
+
+    memset(cmd, 0, 16);
+
+    cmd[0]  = __SERVICE_ACTION_IN_16;
+    cmd[1]  = __SAI_READ_CAPACITY_16;
+    cmd[13] = 32;
+
+    ret = usbh_ms_transport(p_lu,
+                            cmd,
+                            16,
+                            p_lu->p_buf,
+                            32,
+                            USB_DIR_IN);
+    if (ret >= 12) {
+        uint8_t *ptr = (uint8_t *)p_lu->p_buf;
+        if (p_nblks) {
+            *p_nblks = 1 + (((uint64_t)ptr[0] << 56) | ((uint64_t)ptr[1] << 48) |
+                            ((uint64_t)ptr[2] << 40) | ((uint64_t)ptr[3] << 32) |
+                            ((uint64_t)ptr[4] << 24) | ((uint64_t)ptr[5] << 16) |
+                            ((uint64_t)ptr[6] << 8)  |  (uint64_t)ptr[7]);
+        }
+        if (p_blk_size) {
+            *p_blk_size = ((uint32_t)ptr[8] << 24) | (ptr[9] << 16) | (ptr[10] << 8) | ptr[11];
+        }
+        ret = USB_OK;
+    } else if (ret >= 0) {
+        ret = -USB_EDATA;
+    }
+
+    return ret;
+}
+
+/**
+ * \brief 读取逻辑单元容量，最后一个块地址超过 32 位时用 READ CAPACITY(16) 读取
  */
 static int __read_capacity(struct usbh_ms_lu *p_lu,
-                           uint32_t          *p_nblks,
+                           uint64_t          *p_nblks,
                            uint32_t          *p_blk_size){
-    int     ret;
-    uint8_t cmd[10];
+    int      ret;
+    uint8_t  cmd[10];
+    uint32_t last_blk;
 
     memset(cmd, 0, 10);
 
@@ -108,11 +191,16 @@ static int __read_capacity(struct usbh_ms_lu *p_lu,
                             USB_DIR_IN);
     if (ret == 8) {
         uint8_t *ptr = (uint8_t *)p_lu->p_buf;
+
+        last_blk = ((uint32_t)ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+        if (last_blk == 0xFFFFFFFF) {
+            return __read_capacity16(p_lu, p_nblks, p_blk_size);
+        }
         if (p_nblks) {
-            *p_nblks = 1 + ((ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3]);
+            *p_nblks = (uint64_t)last_blk + 1;
         }
         if (p_blk_size) {
-            *p_blk_size = (ptr[4] << 24) | (ptr[5] << 16) | (ptr[6] << 8) | ptr[7];
+            *p_blk_size = ((uint32_t)ptr[4] << 24) | (ptr[5] << 16) | (ptr[6] << 8) | ptr[7];
         }
         ret = USB_OK;
     } else if (ret >= 0) {
@@ -122,6 +210,25 @@ static int __read_capacity(struct usbh_ms_lu *p_lu,
     return ret;
 }
 
+/**
+ * \brief 读取逻辑单元块限制页里的最大传输长度(块数量)，0 为设备没有限制
+ */
+static int __max_xfer_len_get(struct usbh_ms_lu *p_lu, uint32_t *p_max_blks){
+    int      ret;
+    uint8_t *ptr = (uint8_t *)p_lu->p_buf;
+
+    *p_max_blks = 0;
+
+    ret = __inquiry_vpd(p_lu, __VPD_BLOCK_LIMITS, p_lu->p_buf, 64);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((ret >= 12) && (ptr[1] == __VPD_BLOCK_LIMITS)) {
+        *p_max_blks = ((uint32_t)ptr[8] << 24) | (ptr[9] << 16) | (ptr[10] << 8) | ptr[11];
+    }
+    return USB_OK;
+}
+
 static int __mode_sense(struct usbh_ms_lu *p_lu,
                         usb_bool_t        *p_is_wp){
 
@@ -158,62 +265,125 @@ static int __mode_sense(struct usbh_ms_lu *p_lu,
     return ret;
 }
 
-static int __read10(struct usbh_ms_lu *p_lu,
-                    uint32_t           blk_num,
-                    uint32_t           n_blks,
-                    void              *p_buf){
-    uint8_t cmd[10];
-
-    memset(cmd, 0, 10);
+/**
+ * \brief 填充读写命令，逻辑单元容量超过 32 位块地址时用 READ(16)/WRITE(16)
+ *
+ * \retval 返回命令长度
+ */
+static uint8_t __rw_cmd_fill(struct usbh_ms_lu *p_lu,
+                             uint8_t           *p_cmd,
+                             usb_bool_t         is_read,
+                             uint64_t           blk_num,
+                             uint32_t           n_blks){
+    if (p_lu->is_rw16 == USB_TRUE) {
+        memset(p_cmd, 0, 16);
+
+        p_cmd[0] = is_read ? __READ_16 : __WRITE_16;
+
+        p_cmd[2]  = (uint8_t)(blk_num >> 56);
+        p_cmd[3]  = (uint8_t)(blk_num >> 48);
+        p_cmd[4]  = (uint8_t)(blk_num >> 40);
+        p_cmd[5]  = (uint8_t)(blk_num >> 32);
+        p_cmd[6]  = (uint8_t)(blk_num >> 24);
+        p_cmd[7]  = (uint8_t)(blk_num >> 16);
+        p_cmd[8]  = (uint8_t)(blk_num >> 8);
+        p_cmd[9]  = (uint8_t)(blk_num >> 0);
+
+        p_cmd[10] = (uint8_t)(n_blks >> 24);
+        p_cmd[11] = (uint8_t)(n_blks >> 16);
+        p_cmd[12] = (uint8_t)(n_blks >> 8);
+        p_cmd[13] = (uint8_t)(n_blks >> 0);
+
+        return 16;
+    }
+    memset(p_cmd, 0, 10);
 
-    cmd[0] = __READ_10;
+    p_cmd[0] = is_read ? __READ_10 : __WRITE_10;
 
-    cmd[2] = (uint8_t)(blk_num >> 24);
-    cmd[3] = (uint8_t)(blk_num >> 16);
-    cmd[4] = (uint8_t)(blk_num >> 8);
-    cmd[5] = (uint8_t)(blk_num >> 0);
+    p_cmd[2] = (uint8_t)(blk_num >> 24);
+    p_cmd[3] = (uint8_t)(blk_num >> 16);
+    p_cmd[4] = (uint8_t)(blk_num >> 8);
+    p_cmd[5] = (uint8_t)(blk_num >> 0);
 
-    cmd[7] = (uint8_t)(n_blks >> 8);
-    cmd[8] = (uint8_t)(n_blks >> 0);
+    p_cmd[7] = (uint8_t)(n_blks >> 8);
+    p_cmd[8] = (uint8_t)(n_blks >> 0);
 
-    return usbh_ms_transport(p_lu,
-                             cmd,
-                             10,
-                             p_buf,
-                             n_blks * p_lu->blk_size,
-                             USB_DIR_IN);
+    return 10;
 }
 
-static int __write10(struct usbh_ms_lu *p_lu,
-                     uint32_t           blk_num,
-                     uint32_t           n_blks,
-                     void              *p_data) {
-    uint8_t  cmd[10];
-
-    memset(cmd, 0, 10);
-    cmd[0] = __WRITE_10;
+/**
+ * \brief 检查读写范围
+ */
+static int __rw_chk(struct usbh_ms_lu *p_lu,
+                    uint64_t           blk_num,
+                    uint32_t           n_blks){
+    if ((p_lu->blk_size == 0) || (p_lu->max_blks == 0)) {
+        return -USB_EILLEGAL;
+    }
+    if ((blk_num >= p_lu->n_blks) || (n_blks > (p_lu->n_blks - blk_num))) {
+        return -USB_EINVAL;
+    }
+    /* 返回值是字节数，总长度不能超过 int 的范围*/
+    if (((uint64_t)n_blks * p_lu->blk_size) > INT_MAX) {
+        return -USB_ESIZE;
+    }
+    return USB_OK;
+}
 
-    cmd[2] = (uint8_t)(blk_num >> 24);
-    cmd[3] = (uint8_t)(blk_num >> 16);
-    cmd[4] = (uint8_t)(blk_num >> 8);
-    cmd[5] = (uint8_t)(blk_num >> 0);
+/**
+ * \brief 块读写，超过单个命令最大块数量时拆分成多个命令
+ */
+static int __blk_rw(struct usbh_ms_lu *p_lu,
+                    usb_bool_t         is_read,
+                    uint64_t           blk_num,
+                    uint32_t           n_blks,
+                    void              *p_buf){
+    int      ret;
+    uint8_t  cmd[16];
+    uint8_t  cmd_len;
+    uint8_t *p_data = (uint8_t *)p_buf;
+    uint32_t n, len;
+    uint32_t act_len = 0;
+
+    ret = __rw_chk(p_lu, blk_num, n_blks);
+    if (ret != USB_OK) {
+        return ret;
+    }
 
-    cmd[7] = (uint8_t)(n_blks >> 8);
-    cmd[8] = (uint8_t)(n_blks >> 0);
+    while (n_blks > 0) {
+        n       = (n_blks > p_lu->max_blks) ? p_lu->max_blks : n_blks;
+        len     = n * p_lu->blk_size;
+        cmd_len = __rw_cmd_fill(p_lu, cmd, is_read, blk_num, n);
+
+        ret = usbh_ms_transport(p_lu,
+                                cmd,
+                                cmd_len,
+                                p_data,
+                                len,
+                                is_read ? USB_DIR_IN : USB_DIR_OUT);
+        if (ret < 0) {
+            /* 已经传输了部分数据则返回已传输的长度*/
+            return (act_len > 0) ? (int)act_len : ret;
+        }
+        act_len += ret;
+        if ((uint32_t)ret < len) {
+            break;
+        }
+        p_data  += len;
+        blk_num += n;
+        n_blks  -= n;
+    }
 
-    return usbh_ms_transport(p_lu,
-                             cmd,
-                             10,
-                             p_data,
-                             n_blks * p_lu->blk_size,
-                             USB_DIR_OUT);
+    return (int)act_len;
 }
 
 /**
  * \brief 初始化 USB大容量存储 SCSI 设备
  */
 int usbh_ms_scsi_init(struct usbh_ms_lu *p_lu){
-    int ret, retry;
+    int      ret, retry;
+    uint8_t  version;
+    uint32_t max_blks;
 
     /* 查询逻辑单元信息*/
     ret = __inquiry(p_lu, p_lu->p_buf, 36);
@@ -221,6 +391,7 @@ int usbh_ms_scsi_init(struct usbh_ms_lu *p_lu){
         __USB_ERR_INFO("scsi inquiry failed(%d)\r\n", ret);
         return ret;
     }
+    version = ((uint8_t *)p_lu->p_buf)[2];
 
     /* 检查逻辑单元是否准备好*/
     ret = __unit_ready(p_lu);
@@ -254,6 +425,22 @@ int usbh_ms_scsi_init(struct usbh_ms_lu *p_lu){
     if (ret < 0) {
         return ret;
     }
+    /* 块地址超过 32 位时用 READ(16)/WRITE(16)*/
+    p_lu->is_rw16  = (p_lu->n_blks > 0xFFFFFFFFull) ? USB_TRUE : USB_FALSE;
+    p_lu->max_blks = (p_lu->is_rw16 == USB_TRUE) ? 0xFFFFFFFF : 0xFFFF;
+    if (p_lu->blk_size != 0) {
+        max_blks = USBH_MS_XFER_SIZE_MAX / p_lu->blk_size;
+        if (max_blks < p_lu->max_blks) {
+            p_lu->max_blks = max_blks;
+        }
+    }
+    /* SPC-3 以上的设备才查询块限制页，老设备可能不支持重要产品数据页*/
+    if (version >= 0x05) {
+        ret = __max_xfer_len_get(p_lu, &max_blks);
+        if ((ret == USB_OK) && (max_blks != 0) && (max_blks < p_lu->max_blks)) {
+            p_lu->max_blks = max_blks;
+        }
+    }
 
     retry = 3;
     do {
@@ -271,19 +458,75 @@ int usbh_ms_scsi_init(struct usbh_ms_lu *p_lu){
  * \brief SCSI读函数
  */
 int usbh_ms_scsi_read (struct usbh_ms_lu *p_lu,
-                       uint32_t           blk_num,
+                       uint64_t           blk_num,
                        uint32_t           n_blks,
                        void              *p_buf) {
-    return __read10(p_lu, blk_num, n_blks, p_buf);
+    return __blk_rw(p_lu, USB_TRUE, blk_num, n_blks, p_buf);
 }
 
 /**
  * \brief SCSI写函数
  */
 int usbh_ms_scsi_write (struct usbh_ms_lu *p_lu,
-                        uint32_t           blk_num,
+                        uint64_t           blk_num,
                         uint32_t           n_blks,
                         void              *p_buf) {
-    return __write10(p_lu, blk_num, n_blks, p_buf);
+    return __blk_rw(p_lu, USB_FALSE, blk_num, n_blks, p_buf);
+}
+
+/**
+ * \brief SCSI 异步读写，不拆分命令
+ */
+static int __blk_rw_async(struct usbh_ms_lu *p_lu,
+                          usb_bool_t         is_read,
+                          uint64_t           blk_num,
+                          uint32_t           n_blks,
+                          void              *p_buf,
+                          void             (*p_fn_done)(void *p_arg, int ret),
+                          void              *p_arg){
+    int     ret;
+    uint8_t cmd[16];
+    uint8_t cmd_len;
+
+    ret = __rw_chk(p_lu, blk_num, n_blks);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    if (n_blks > p_lu->max_blks) {
+        return -USB_EINVAL;
+    }
+    cmd_len = __rw_cmd_fill(p_lu, cmd, is_read, blk_num, n_blks);
+
+    return usbh_ms_transport_async(p_lu,
+                                   cmd,
+                                   cmd_len,
+                                   p_buf,
+                                   n_blks * p_lu->blk_size,
+                                   is_read ? USB_DIR_IN : USB_DIR_OUT,
+                                   p_fn_done,
+                                   p_arg);
 }
 
+/**
+ * \brief SCSI 异步读函数
+ */
+int usbh_ms_scsi_read_async(struct usbh_ms_lu *p_lu,
+                            uint64_t           blk_num,
+                            uint32_t           n_blks,
+                            void              *p_buf,
+                            void             (*p_fn_done)(void *p_arg, int ret),
+                            void              *p_arg){
+    return __blk_rw_async(p_lu, USB_TRUE, blk_num, n_blks, p_buf, p_fn_done, p_arg);
+}
+
+/**
+ * \brief SCSI 异步写函数
+ */
+int usbh_ms_scsi_write_async(struct usbh_ms_lu *p_lu,
+                             uint64_t           blk_num,
+                             uint32_t           n_blks,
+                             void              *p_buf,
+                             void             (*p_fn_done)(void *p_arg, int ret),
+                             void              *p_arg){
+    return __blk_rw_async(p_lu, USB_FALSE, blk_num, n_blks, p_buf, p_fn_done, p_arg);
+}
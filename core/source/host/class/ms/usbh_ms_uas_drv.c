@@ -0,0 +1,973 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include "core/include/host/class/ms/usbh_ms_drv.h"
+#include <string.h>
+
+#if USB_OS_EN
+/*******************************************************************************
+ * Macro operate
+ ******************************************************************************/
+/* \brief UAS 命令超时时间(毫秒)*/
+#define __UAS_CMD_TIMEOUT         5000
+/* \brief UAS 任务管理功能使用的标签，不和命令标签冲突*/
+#define __UAS_TMF_TAG             (USBH_MS_UAS_QDEPTH_MAX + 1)
+
+/*******************************************************************************
+ * Extern
+ ******************************************************************************/
+extern struct ums_lib __g_ums_lib;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+/**
+ * \brief 获取端点的 UAS 管道 ID(端点描述符后面的管道用途描述符)
+ */
+static uint8_t __uas_pipe_id_get(struct usbh_endpoint *p_ep){
+    struct usb_uas_pipe_usage_desc *p_desc = NULL;
+    int                             offs   = 0;
+
+    while ((offs + 2) <= p_ep->extra_len) {
+        p_desc = (struct usb_uas_pipe_usage_desc *)(p_ep->p_extra + offs);
+        if ((p_desc->length < 2) || ((offs + p_desc->length) > p_ep->extra_len)) {
+            break;
+        }
+        if ((p_desc->descriptor_type == USB_UAS_DT_PIPE_USAGE) &&
+                (p_desc->length >= sizeof(struct usb_uas_pipe_usage_desc))) {
+            return p_desc->pipe_id;
+        }
+        offs += p_desc->length;
+    }
+    return 0;
+}
+
+/**
+ * \brief 获取 UAS 接口的 4 个管道端点
+ */
+static int __uas_eps_get(struct usbh_interface *p_intf,
+                         struct usbh_endpoint **p_eps){
+    int i;
+
+    memset(p_eps, 0, sizeof(struct usbh_endpoint *) * 4);
+
+    for (i = 0; i < USBH_INTF_NEP_GET(p_intf); i++) {
+        uint8_t pipe_id = __uas_pipe_id_get(&p_intf->p_eps[i]);
+
+        if (USBH_EP_TYPE_GET(&p_intf->p_eps[i]) != USB_EP_TYPE_BULK) {
+            continue;
+        }
+        if ((pipe_id >= USB_UAS_PIPE_ID_CMD) && (pipe_id <= USB_UAS_PIPE_ID_DATA_OUT) &&
+                (p_eps[pipe_id - 1] == NULL)) {
+            p_eps[pipe_id - 1] = &p_intf->p_eps[i];
+        }
+    }
+    for (i = 0; i < 4; i++) {
+        if (p_eps[i] == NULL) {
+            return -USB_ENOTSUP;
+        }
+    }
+    /* 检查管道方向*/
+    if ((USBH_EP_DIR_GET(p_eps[USB_UAS_PIPE_ID_CMD - 1])      != USB_DIR_OUT) ||
+            (USBH_EP_DIR_GET(p_eps[USB_UAS_PIPE_ID_STATUS - 1])   != USB_DIR_IN) ||
+            (USBH_EP_DIR_GET(p_eps[USB_UAS_PIPE_ID_DATA_IN - 1])  != USB_DIR_IN) ||
+            (USBH_EP_DIR_GET(p_eps[USB_UAS_PIPE_ID_DATA_OUT - 1]) != USB_DIR_OUT)) {
+        return -USB_ENOTSUP;
+    }
+    return USB_OK;
+}
+
+/**
+ * \brief 查找 USB 大容量存储设备的 UAS 备用设置
+ *
+ * \param[in]  p_usb_fun USB 功能结构体
+ * \param[out] p_intf    返回找到的 UAS 接口
+ *
+ * \retval 成功返回 USB_OK，没有可用的 UAS 备用设置返回 -USB_ENOTSUP
+ */
+int usbh_ms_uas_intf_find(struct usbh_function   *p_usb_fun,
+                          struct usbh_interface **p_intf){
+    struct usb_list_node  *p_node     = NULL;
+    struct usb_list_node  *p_node_tmp = NULL;
+    struct usbh_interface *p_intf_tmp = NULL;
+    struct usbh_endpoint  *p_eps[4];
+
+    /* 超高速 UAS 必须使用流(stream)，主机控制器不支持，只使用 BBB 传输*/
+    if (USBH_DEV_SPEED_GET(p_usb_fun) >= USB_SPEED_SUPER) {
+        return -USB_ENOTSUP;
+    }
+
+    usb_list_for_each_node_safe(p_node,
+                                p_node_tmp,
+                               &p_usb_fun->intf_list){
+        p_intf_tmp = usb_container_of(p_node, struct usbh_interface, node);
+
+        if ((USBH_INTF_NUM_GET(p_intf_tmp)       == p_usb_fun->first_intf_num) &&
+                (USBH_INTF_CLASS_GET(p_intf_tmp)     == USB_CLASS_MASS_STORAGE) &&
+                (USBH_INTF_SUB_CLASS_GET(p_intf_tmp) == USB_MS_SC_SCSI_TRANSPARENT) &&
+                (USBH_INTF_PROTO_GET(p_intf_tmp)     == USB_MS_PRO_UAS) &&
+                (__uas_eps_get(p_intf_tmp, p_eps) == USB_OK)) {
+            *p_intf = p_intf_tmp;
+            return USB_OK;
+        }
+    }
+    return -USB_ENOTSUP;
+}
+
+/**
+ * \brief UAS 检查命令是否完成
+ */
+static void __uas_cmd_done_chk(struct usbh_ms_uas_cmd *p_cmd){
+    int ret;
+
+    if ((p_cmd->is_sense_done == USB_TRUE) && (p_cmd->is_data_pend == USB_FALSE)) {
+        ret = usb_sem_give(p_cmd->p_done);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(SemGiveErr, "(%d)\r\n", ret);
+        }
+    }
+}
+
+/**
+ * \brief UAS 通过标签获取在传输的命令
+ */
+static struct usbh_ms_uas_cmd *__uas_cmd_find(struct usbh_ms_uas *p_uas, uint16_t tag){
+    struct usbh_ms_uas_cmd *p_cmd = NULL;
+
+    if ((tag == 0) || (tag > USBH_MS_UAS_QDEPTH_MAX)) {
+        return NULL;
+    }
+    p_cmd = &p_uas->cmds[tag - 1];
+    if ((p_cmd->is_used == USB_FALSE) || (p_cmd->is_sense_done == USB_TRUE)) {
+        return NULL;
+    }
+    return p_cmd;
+}
+
+/**
+ * \brief UAS 设置命令状态阶段完成，返回是否是这次调用完成的
+ */
+static usb_bool_t __uas_cmd_sense_set(struct usbh_ms_uas     *p_uas,
+                                      struct usbh_ms_uas_cmd *p_cmd,
+                                      int                     status){
+    int        ret;
+    usb_bool_t is_set = USB_FALSE;
+
+    ret = usb_mutex_lock(p_uas->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return USB_FALSE;
+    }
+    if (p_cmd->is_sense_done == USB_FALSE) {
+        if (p_cmd->status == USB_OK) {
+            p_cmd->status = status;
+        }
+        p_cmd->is_sense_done = USB_TRUE;
+        is_set               = USB_TRUE;
+    }
+    ret = usb_mutex_unlock(p_uas->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    if (is_set == USB_TRUE) {
+        __uas_cmd_done_chk(p_cmd);
+    }
+    return is_set;
+}
+
+/**
+ * \brief UAS 收到任务管理响应 IU，返回是否有任务管理功能在等待
+ */
+static usb_bool_t __uas_tmf_done(struct usbh_ms_uas *p_uas, uint8_t resp){
+    int        ret;
+    usb_bool_t is_pend;
+
+    ret = usb_mutex_lock(p_uas->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return USB_FALSE;
+    }
+    is_pend = p_uas->is_tmf_pend;
+    if (is_pend == USB_TRUE) {
+        p_uas->tmf_resp    = resp;
+        p_uas->is_tmf_pend = USB_FALSE;
+    }
+    ret = usb_mutex_unlock(p_uas->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    return is_pend;
+}
+
+/**
+ * \brief UAS 归还状态传输请求包
+ */
+static void __uas_sta_put(struct usbh_ms_uas_sta *p_sta){
+    int ret;
+
+    ret = usb_mutex_lock(p_sta->p_uas->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return;
+    }
+    p_sta->is_pend = USB_FALSE;
+
+    ret = usb_mutex_unlock(p_sta->p_uas->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+}
+
+/**
+ * \brief UAS 状态管道出错，所有在传输的命令都不会再收到状态
+ */
+static void __uas_cmds_abort(struct usbh_ms_uas *p_uas, int status){
+    int i;
+
+    for (i = 0; i < USBH_MS_UAS_QDEPTH_MAX; i++) {
+        if (p_uas->cmds[i].is_used == USB_TRUE) {
+            __uas_cmd_sense_set(p_uas, &p_uas->cmds[i], status);
+        }
+    }
+}
+
+/**
+ * \brief UAS 数据传输完成回调函数
+ */
+static void __uas_data_done(void *p_arg){
+    struct usbh_ms_uas_cmd *p_cmd = (struct usbh_ms_uas_cmd *)p_arg;
+
+    if (p_cmd->trp_data.status == USB_OK) {
+        p_cmd->act_len = p_cmd->trp_data.act_len;
+    } else if (p_cmd->status == USB_OK) {
+        p_cmd->status = p_cmd->trp_data.status;
+    }
+    p_cmd->is_data_pend = USB_FALSE;
+
+    __uas_cmd_done_chk(p_cmd);
+}
+
+/**
+ * \brief UAS 提交命令的数据传输请求包(收到读/写就绪 IU 后)
+ */
+static void __uas_data_submit(struct usbh_ms_uas_cmd *p_cmd, uint8_t dir){
+    int                 ret;
+    struct usbh_ms_uas *p_uas = p_cmd->p_ms->p_uas;
+
+    if ((p_cmd->data_len == 0) || (p_cmd->dir != dir) || (p_cmd->is_data_pend == USB_TRUE)) {
+        __USB_ERR_INFO("UAS command tag %d unexpected ready IU\r\n", p_cmd->tag);
+        return;
+    }
+    /* 命令正在中止，设备会丢弃这个任务*/
+    if (p_cmd->is_abort == USB_TRUE) {
+        return;
+    }
+    p_cmd->trp_data.p_ep      = (dir == USB_DIR_IN) ? p_uas->p_ep_data_in : p_uas->p_ep_data_out;
+    p_cmd->trp_data.p_ctrl    = NULL;
+    p_cmd->trp_data.p_data    = p_cmd->p_data;
+    p_cmd->trp_data.len       = p_cmd->data_len;
+    p_cmd->trp_data.p_fn_done = __uas_data_done;
+    p_cmd->trp_data.p_arg     = (void *)p_cmd;
+    p_cmd->trp_data.act_len   = 0;
+    p_cmd->trp_data.status    = -USB_EINPROGRESS;
+    p_cmd->trp_data.flag      = 0;
+
+    p_cmd->is_data_pend = USB_TRUE;
+
+    ret = usbh_trp_submit(&p_cmd->trp_data);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("UAS data TRP submit failed(%d)\r\n", ret);
+        /* 设备收不到数据不会返回状态，等命令超时*/
+        p_cmd->status       = ret;
+        p_cmd->is_data_pend = USB_FALSE;
+    }
+}
+
+/**
+ * \brief UAS 状态传输完成回调函数
+ */
+static void __uas_sta_done(void *p_arg){
+    int                     ret;
+    struct usbh_ms_uas_sta *p_sta = (struct usbh_ms_uas_sta *)p_arg;
+    struct usbh_ms_uas     *p_uas = p_sta->p_uas;
+    struct usbh_ms_uas_cmd *p_cmd = NULL;
+    uint8_t                *p_iu  = (uint8_t *)p_sta->p_iu;
+    uint16_t                tag;
+
+    if (p_sta->trp.status != USB_OK) {
+        __uas_sta_put(p_sta);
+
+        if (p_sta->trp.status != -USB_ECANCEL) {
+            __USB_ERR_INFO("UAS status TRP failed(%d)\r\n", p_sta->trp.status);
+            __uas_cmds_abort(p_uas, p_sta->trp.status);
+        }
+        return;
+    }
+    if (p_sta->trp.act_len < sizeof(struct usb_uas_ready_iu)) {
+        __USB_ERR_INFO("UAS status IU length %d illegal\r\n", p_sta->trp.act_len);
+        goto __resubmit;
+    }
+
+    tag   = (p_iu[2] << 8) | p_iu[3];
+    if (tag == __UAS_TMF_TAG) {
+        if ((p_iu[0] == USB_UAS_IU_ID_RESPONSE) &&
+                (__uas_tmf_done(p_uas, ((struct usb_uas_response_iu *)p_iu)->response_code) == USB_TRUE)) {
+            __uas_sta_put(p_sta);
+            usb_sem_give(p_uas->p_tmf_done);
+            return;
+        }
+        __USB_ERR_INFO("UAS task management IU 0x%x unexpected\r\n", p_iu[0]);
+        goto __resubmit;
+    }
+    p_cmd = __uas_cmd_find(p_uas, tag);
+    if (p_cmd == NULL) {
+        __USB_ERR_INFO("UAS status IU 0x%x unknown tag %d\r\n", p_iu[0], tag);
+        goto __resubmit;
+    }
+
+    switch (p_iu[0]) {
+        case USB_UAS_IU_ID_READ_READY:
+            __uas_data_submit(p_cmd, USB_DIR_IN);
+            goto __resubmit;
+        case USB_UAS_IU_ID_WRITE_READY:
+            __uas_data_submit(p_cmd, USB_DIR_OUT);
+            goto __resubmit;
+        case USB_UAS_IU_ID_SENSE:
+            p_cmd->sta = ((struct usb_uas_sense_iu *)p_iu)->status;
+            break;
+        case USB_UAS_IU_ID_RESPONSE:
+            __USB_ERR_INFO("UAS command tag %d response code 0x%x\r\n", tag,
+                    ((struct usb_uas_response_iu *)p_iu)->response_code);
+            if (p_cmd->status == USB_OK) {
+                p_cmd->status = -USB_EPROTO;
+            }
+            break;
+        default:
+            __USB_ERR_INFO("UAS status IU 0x%x unknown\r\n", p_iu[0]);
+            goto __resubmit;
+    }
+    /* 命令的最后一个 IU，状态传输请求包用完了*/
+    __uas_sta_put(p_sta);
+
+    __uas_cmd_sense_set(p_uas, p_cmd, USB_OK);
+    return;
+__resubmit:
+    /* 这个状态传输请求包还要等后面的 IU*/
+    p_sta->trp.act_len = 0;
+    p_sta->trp.status  = -USB_EINPROGRESS;
+
+    ret = usbh_trp_submit(&p_sta->trp);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("UAS status TRP submit failed(%d)\r\n", ret);
+        __uas_sta_put(p_sta);
+        __uas_cmds_abort(p_uas, ret);
+    }
+}
+
+/**
+ * \brief UAS 命令传输完成回调函数
+ */
+static void __uas_cmd_done(void *p_arg){
+    struct usbh_ms_uas_cmd *p_cmd = (struct usbh_ms_uas_cmd *)p_arg;
+
+    /* 命令正在中止，由中止流程完成命令*/
+    if (p_cmd->is_abort == USB_TRUE) {
+        return;
+    }
+    /* 命令没有送达，设备不会返回状态*/
+    if (p_cmd->trp_cmd.status != USB_OK) {
+        __uas_cmd_sense_set(p_cmd->p_ms->p_uas, p_cmd, p_cmd->trp_cmd.status);
+    }
+}
+
+/**
+ * \brief UAS 提交一个空闲的状态传输请求包，每个命令提交一个，收到命令的感知/响应 IU 后归还
+ */
+static int __uas_sta_submit(struct usbh_ms_uas *p_uas){
+    int                     ret, i;
+    struct usbh_ms_uas_sta *p_sta = NULL;
+
+    ret = usb_mutex_lock(p_uas->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+    for (i = 0; i < USBH_MS_UAS_QDEPTH_MAX; i++) {
+        if (p_uas->stas[i].is_pend == USB_FALSE) {
+            p_sta          = &p_uas->stas[i];
+            p_sta->is_pend = USB_TRUE;
+            break;
+        }
+    }
+    ret = usb_mutex_unlock(p_uas->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+    if (p_sta == NULL) {
+        return -USB_EBUSY;
+    }
+
+    p_sta->trp.act_len = 0;
+    p_sta->trp.status  = -USB_EINPROGRESS;
+
+    ret = usbh_trp_submit(&p_sta->trp);
+    if (ret != USB_OK) {
+        __uas_sta_put(p_sta);
+    }
+    return ret;
+}
+
+/**
+ * \brief UAS 取消一个已提交的状态传输请求包(命令没有完成，不会再有它的 IU)
+ */
+static void __uas_sta_cancel(struct usbh_ms_uas *p_uas){
+    int i;
+
+    for (i = USBH_MS_UAS_QDEPTH_MAX - 1; i >= 0; i--) {
+        if (p_uas->stas[i].is_pend == USB_TRUE) {
+            usbh_trp_xfer_cancel(&p_uas->stas[i].trp);
+            return;
+        }
+    }
+}
+
+/**
+ * \brief UAS 获取一个空闲的命令，命令队列满时等待
+ */
+static int __uas_cmd_get(struct usbh_ms_uas *p_uas, struct usbh_ms_uas_cmd **p_cmd_ret){
+    int                     ret, ret_tmp, i;
+    struct usbh_ms_uas_cmd *p_cmd = NULL;
+
+    while (1) {
+        ret = usb_mutex_lock(p_uas->p_lock, UMS_LOCK_TIMEOUT);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+            return ret;
+        }
+        for (i = 0; i < p_uas->qdepth; i++) {
+            if (p_uas->cmds[i].is_used == USB_FALSE) {
+                p_cmd          = &p_uas->cmds[i];
+                p_cmd->is_used = USB_TRUE;
+                p_uas->n_cmds++;
+                break;
+            }
+        }
+        ret_tmp = usb_mutex_unlock(p_uas->p_lock);
+        if (ret_tmp != USB_OK) {
+            __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+            return ret_tmp;
+        }
+        if (p_cmd != NULL) {
+            /* 信号量只记一次释放，还有空闲命令时唤醒下一个等待者*/
+            if (p_uas->n_cmds < p_uas->qdepth) {
+                usb_sem_give(p_uas->p_cmd_free);
+            }
+            *p_cmd_ret = p_cmd;
+            return USB_OK;
+        }
+        /* 命令队列已满，等待有命令完成*/
+        ret = usb_sem_take(p_uas->p_cmd_free, __UAS_CMD_TIMEOUT);
+        if (ret != USB_OK) {
+            return ret;
+        }
+    }
+}
+
+/**
+ * \brief UAS 释放命令
+ */
+static void __uas_cmd_put(struct usbh_ms_uas *p_uas, struct usbh_ms_uas_cmd *p_cmd){
+    int ret;
+
+    ret = usb_mutex_lock(p_uas->p_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return;
+    }
+    p_cmd->is_used = USB_FALSE;
+    p_uas->n_cmds--;
+
+    ret = usb_mutex_unlock(p_uas->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    usb_sem_give(p_uas->p_cmd_free);
+}
+
+/**
+ * \brief UAS 发送任务管理 IU 并等待设备的响应 IU
+ */
+static int __uas_tmf_send(struct usbh_ms_uas     *p_uas,
+                          struct usbh_ms_uas_cmd *p_cmd,
+                          uint8_t                 function){
+    int                          ret, ret_tmp;
+    usb_bool_t                   is_pend;
+    struct usb_uas_task_mgmt_iu *p_iu = (struct usb_uas_task_mgmt_iu *)p_uas->p_tmf_iu;
+
+    ret = usb_mutex_lock(p_uas->p_tmf_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+    memset(p_iu, 0, sizeof(struct usb_uas_task_mgmt_iu));
+    p_iu->iu_id       = USB_UAS_IU_ID_TASK_MGMT;
+    p_iu->tag[0]      = (uint8_t)(__UAS_TMF_TAG >> 8);
+    p_iu->tag[1]      = (uint8_t)(__UAS_TMF_TAG);
+    p_iu->function    = function;
+    p_iu->task_tag[0] = (uint8_t)(p_cmd->tag >> 8);
+    p_iu->task_tag[1] = (uint8_t)(p_cmd->tag);
+    memcpy(p_iu->lun, ((struct usb_uas_cmd_iu *)p_cmd->p_cmd_iu)->lun, sizeof(p_iu->lun));
+
+    /* 清除上一次留下的响应信号*/
+    usb_sem_take(p_uas->p_tmf_done, USB_NO_WAIT);
+    p_uas->tmf_resp    = 0xFF;
+    p_uas->is_tmf_pend = USB_TRUE;
+
+    /* 响应 IU 从状态管道返回，先提交一个状态传输请求包*/
+    ret = __uas_sta_submit(p_uas);
+    if (ret != USB_OK) {
+        p_uas->is_tmf_pend = USB_FALSE;
+        goto __exit;
+    }
+    ret = usbh_trp_sync_xfer(p_uas->p_ep_cmd,
+                             NULL,
+                             p_iu,
+                             sizeof(struct usb_uas_task_mgmt_iu),
+                             __UAS_CMD_TIMEOUT,
+                             0);
+    if (ret >= 0) {
+        ret = usb_sem_take(p_uas->p_tmf_done, __UAS_CMD_TIMEOUT);
+    }
+    if (ret < 0) {
+        is_pend = __uas_tmf_done(p_uas, 0xFF);
+        /* 没有收到响应 IU，多出来的状态传输请求包要取消*/
+        if (is_pend == USB_TRUE) {
+            __uas_sta_cancel(p_uas);
+            goto __exit;
+        }
+    }
+    if ((p_uas->tmf_resp != USB_UAS_RC_TMF_COMPLETE) &&
+            (p_uas->tmf_resp != USB_UAS_RC_TMF_SUCCEEDED)) {
+        __USB_ERR_INFO("UAS task management 0x%x tag %d response code 0x%x\r\n",
+                function, p_cmd->tag, p_uas->tmf_resp);
+        ret = -USB_EPROTO;
+    } else {
+        ret = USB_OK;
+    }
+__exit:
+    ret_tmp = usb_mutex_unlock(p_uas->p_tmf_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+    return ret;
+}
+
+/**
+ * \brief UAS 命令超时，取消命令的传输请求包并让设备中止任务
+ */
+static int __uas_cmd_abort(struct usbh_ms_uas *p_uas, struct usbh_ms_uas_cmd *p_cmd){
+    int ret;
+
+    /* 不再为这个命令提交数据传输请求包*/
+    p_cmd->is_abort = USB_TRUE;
+
+    usbh_trp_xfer_cancel(&p_cmd->trp_cmd);
+    if (p_cmd->is_data_pend == USB_TRUE) {
+        usbh_trp_xfer_cancel(&p_cmd->trp_data);
+    }
+    /* 设备回了响应 IU 后不会再使用这个标签*/
+    ret = __uas_tmf_send(p_uas, p_cmd, USB_UAS_TMF_ABORT_TASK);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    /* 任务已经丢弃，命令的状态传输请求包不会再收到 IU*/
+    if (__uas_cmd_sense_set(p_uas, p_cmd, -USB_ETIME) == USB_TRUE) {
+        __uas_sta_cancel(p_uas);
+    }
+    /* 等待数据传输请求包取消完成*/
+    return usb_sem_take(p_cmd->p_done, __UAS_CMD_TIMEOUT);
+}
+
+/**
+ * \brief UAS 检查所有的传输请求包是否都已经返回
+ */
+static usb_bool_t __uas_is_idle(struct usbh_ms_uas *p_uas){
+    int i;
+
+    for (i = 0; i < USBH_MS_UAS_QDEPTH_MAX; i++) {
+        if (p_uas->stas[i].is_pend == USB_TRUE) {
+            return USB_FALSE;
+        }
+        if ((p_uas->cmds[i].is_used == USB_TRUE) &&
+                ((p_uas->cmds[i].is_data_pend == USB_TRUE) ||
+                 (p_uas->cmds[i].trp_cmd.status == -USB_EINPROGRESS))) {
+            return USB_FALSE;
+        }
+    }
+    return USB_TRUE;
+}
+
+/**
+ * \brief UAS 复位，中止任务失败时取消所有的传输请求包，重新设置备用设置让设备丢弃所有任务，
+ *        成功后释放被隔离的标签
+ */
+static int __uas_reset(struct usbh_ms_uas *p_uas){
+    int                   ret, ret_tmp, i;
+    int                   time_out  = __UAS_CMD_TIMEOUT;
+    struct usbh_function *p_usb_fun = p_uas->p_ms->p_usb_fun;
+
+    ret = usb_mutex_lock(p_uas->p_tmf_lock, UMS_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+    p_uas->is_reset = USB_TRUE;
+
+    for (i = 0; i < USBH_MS_UAS_QDEPTH_MAX; i++) {
+        struct usbh_ms_uas_cmd *p_cmd = &p_uas->cmds[i];
+
+        if (p_cmd->is_used == USB_TRUE) {
+            p_cmd->is_abort = USB_TRUE;
+
+            usbh_trp_xfer_cancel(&p_cmd->trp_cmd);
+            if (p_cmd->is_data_pend == USB_TRUE) {
+                usbh_trp_xfer_cancel(&p_cmd->trp_data);
+            }
+        }
+        if (p_uas->stas[i].is_pend == USB_TRUE) {
+            usbh_trp_xfer_cancel(&p_uas->stas[i].trp);
+        }
+    }
+    /* 等待所有的传输请求包返回*/
+    while (__uas_is_idle(p_uas) == USB_FALSE) {
+        if (time_out-- <= 0) {
+            ret = -USB_ETIME;
+            goto __exit;
+        }
+        usb_mdelay(1);
+    }
+    /* 所有的命令都不会再收到 IU*/
+    __uas_cmds_abort(p_uas, -USB_ECANCEL);
+
+    ret = usbh_func_intf_set(p_usb_fun, p_usb_fun->first_intf_num, 0);
+    if (ret == USB_OK) {
+        ret = usbh_func_intf_set(p_usb_fun, p_usb_fun->first_intf_num, p_uas->alt_num);
+    }
+    if (ret != USB_OK) {
+        goto __exit;
+    }
+    /* 设备已经丢弃所有任务，释放被隔离的标签*/
+    for (i = 0; i < USBH_MS_UAS_QDEPTH_MAX; i++) {
+        if ((p_uas->cmds[i].is_used == USB_TRUE) &&
+                (p_uas->cmds[i].is_quarantine == USB_TRUE)) {
+            p_uas->cmds[i].is_quarantine = USB_FALSE;
+            __uas_cmd_put(p_uas, &p_uas->cmds[i]);
+        }
+    }
+__exit:
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("UAS reset failed(%d)\r\n", ret);
+    }
+    p_uas->is_reset = USB_FALSE;
+
+    ret_tmp = usb_mutex_unlock(p_uas->p_tmf_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+    return ret;
+}
+
+/**
+ * \brief UAS 传输，多个线程可以同时有命令在传输，不需要大容量存储设备锁
+ *
+ * \param[in] p_ms     USB 大容量存储设备结构体
+ * \param[in] lun_num  逻辑单元号
+ * \param[in] p_cmd    相关命令
+ * \param[in] cmd_len  命令长度
+ * \param[in] p_data   数据缓存
+ * \param[in] data_len 数据长度
+ * \param[in] dir      数据方向
+ *
+ * \retval 成功返回发送/接收数据的长度
+ */
+int usbh_ms_uas_transport(struct usbh_ms *p_ms,
+                          uint8_t         lun_num,
+                          void           *p_cmd,
+                          uint8_t         cmd_len,
+                          void           *p_data,
+                          uint32_t        data_len,
+                          uint8_t         dir){
+    int                     ret, ret_tmp;
+    struct usbh_ms_uas     *p_uas    = p_ms->p_uas;
+    struct usbh_ms_uas_cmd *p_uas_cmd = NULL;
+    struct usb_uas_cmd_iu  *p_iu      = NULL;
+
+    if (cmd_len > 16) {
+        return -USB_EILLEGAL;
+    }
+    /* 正在复位，上层稍后重试*/
+    if (p_uas->is_reset == USB_TRUE) {
+        return -USB_EBUSY;
+    }
+
+    ret = __uas_cmd_get(p_uas, &p_uas_cmd);
+    if (ret != USB_OK) {
+        return ret;
+    }
+
+    /* 填充命令 IU*/
+    p_iu = (struct usb_uas_cmd_iu *)p_uas_cmd->p_cmd_iu;
+    memset(p_iu, 0, sizeof(struct usb_uas_cmd_iu));
+    p_iu->iu_id     = USB_UAS_IU_ID_CMD;
+    p_iu->tag[0]    = (uint8_t)(p_uas_cmd->tag >> 8);
+    p_iu->tag[1]    = (uint8_t)(p_uas_cmd->tag);
+    p_iu->prio_attr = USB_UAS_TASK_ATTR_SIMPLE;
+    p_iu->lun[1]    = lun_num;
+    memcpy(p_iu->cdb, p_cmd, cmd_len);
+
+    p_uas_cmd->dir           = dir;
+    p_uas_cmd->p_data        = p_data;
+    p_uas_cmd->data_len      = (p_data == NULL) ? 0 : data_len;
+    p_uas_cmd->act_len       = 0;
+    p_uas_cmd->sta           = USB_UAS_STATUS_GOOD;
+    p_uas_cmd->status        = USB_OK;
+    p_uas_cmd->is_data_pend  = USB_FALSE;
+    p_uas_cmd->is_sense_done = USB_FALSE;
+    p_uas_cmd->is_abort      = USB_FALSE;
+    p_uas_cmd->is_quarantine = USB_FALSE;
+    p_uas_cmd->trp_data.status = USB_OK;
+
+    /* 清除上一个命令留下的完成信号*/
+    usb_sem_take(p_uas_cmd->p_done, USB_NO_WAIT);
+
+    /* 先提交状态传输请求包，设备可能马上返回就绪 IU*/
+    ret = __uas_sta_submit(p_uas);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("UAS status TRP submit failed(%d)\r\n", ret);
+        goto __exit;
+    }
+
+    p_uas_cmd->trp_cmd.act_len = 0;
+    p_uas_cmd->trp_cmd.status  = -USB_EINPROGRESS;
+
+    ret = usbh_trp_submit(&p_uas_cmd->trp_cmd);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("UAS command TRP submit failed(%d)\r\n", ret);
+        __uas_sta_cancel(p_uas);
+        goto __exit;
+    }
+
+    ret = usb_sem_take(p_uas_cmd->p_done, __UAS_CMD_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("UAS command 0x%x tag %d timeout(%d)\r\n",
+                ((uint8_t *)p_cmd)[0], p_uas_cmd->tag, ret);
+        ret_tmp = __uas_cmd_abort(p_uas, p_uas_cmd);
+        if (ret_tmp != USB_OK) {
+            __USB_ERR_INFO("UAS command tag %d abort failed(%d)\r\n", p_uas_cmd->tag, ret_tmp);
+            /* 设备可能还在使用这个标签，隔离标签直到复位完成*/
+            p_uas_cmd->is_quarantine = USB_TRUE;
+            __uas_reset(p_uas);
+            return ret;
+        }
+        goto __exit;
+    }
+
+    if (p_uas_cmd->status != USB_OK) {
+        ret = p_uas_cmd->status;
+        /* 命令没有送达，多出来的状态传输请求包要取消*/
+        if (p_uas_cmd->trp_cmd.status != USB_OK) {
+            __uas_sta_cancel(p_uas);
+        }
+        if (p_uas_cmd->trp_data.status == -USB_EPIPE) {
+            usbh_dev_ep_halt_clr(p_uas_cmd->trp_data.p_ep);
+        }
+        goto __exit;
+    }
+
+    switch (p_uas_cmd->sta) {
+        /* 与 BBB 传输一致，检查条件状态由上层通过请求感知命令处理*/
+        case USB_UAS_STATUS_GOOD:
+        case USB_UAS_STATUS_CHECK_CONDITION:
+            ret = p_uas_cmd->act_len;
+            break;
+        case USB_UAS_STATUS_BUSY:
+        case USB_UAS_STATUS_TASK_SET_FULL:
+            ret = -USB_EBUSY;
+            break;
+        default:
+            ret = -USB_EDATA;
+            break;
+    }
+__exit:
+    __uas_cmd_put(p_uas, p_uas_cmd);
+
+    return ret;
+}
+
+/**
+ * \brief UAS 传输反初始化
+ *
+ * \param[in] p_ms USB 大容量存储设备结构体
+ */
+void usbh_ms_uas_deinit(struct usbh_ms *p_ms){
+    int                 i;
+    struct usbh_ms_uas *p_uas = p_ms->p_uas;
+
+    if (p_uas == NULL) {
+        return;
+    }
+
+    for (i = 0; i < USBH_MS_UAS_QDEPTH_MAX; i++) {
+        if (p_uas->stas[i].is_pend == USB_TRUE) {
+            usbh_trp_xfer_cancel(&p_uas->stas[i].trp);
+        }
+        if (p_uas->stas[i].p_iu) {
+            usb_lib_mfree(&__g_ums_lib.lib, p_uas->stas[i].p_iu);
+        }
+        if (p_uas->cmds[i].p_cmd_iu) {
+            usb_lib_mfree(&__g_ums_lib.lib, p_uas->cmds[i].p_cmd_iu);
+        }
+        if (p_uas->cmds[i].p_done) {
+            usb_lib_sem_destroy(&__g_ums_lib.lib, p_uas->cmds[i].p_done);
+        }
+    }
+    if (p_uas->p_cmd_free) {
+        usb_lib_sem_destroy(&__g_ums_lib.lib, p_uas->p_cmd_free);
+    }
+    if (p_uas->p_tmf_iu) {
+        usb_lib_mfree(&__g_ums_lib.lib, p_uas->p_tmf_iu);
+    }
+    if (p_uas->p_tmf_done) {
+        usb_lib_sem_destroy(&__g_ums_lib.lib, p_uas->p_tmf_done);
+    }
+    if (p_uas->p_tmf_lock) {
+        usb_lib_mutex_destroy(&__g_ums_lib.lib, p_uas->p_tmf_lock);
+    }
+    if (p_uas->p_lock) {
+        usb_lib_mutex_destroy(&__g_ums_lib.lib, p_uas->p_lock);
+    }
+    usb_lib_mfree(&__g_ums_lib.lib, p_uas);
+
+    p_ms->p_uas = NULL;
+}
+
+/**
+ * \brief UAS 传输初始化，选择 UAS 备用设置并分配命令和状态传输请求包
+ *
+ * \param[in] p_ms USB 大容量存储设备结构体
+ *
+ * \retval 成功返回 USB_OK，设备不支持 UAS 返回 -USB_ENOTSUP
+ */
+int usbh_ms_uas_init(struct usbh_ms *p_ms){
+    int                    ret, i;
+    struct usbh_interface *p_intf = NULL;
+    struct usbh_endpoint  *p_eps[4];
+    struct usbh_ms_uas    *p_uas  = NULL;
+
+    ret = usbh_ms_uas_intf_find(p_ms->p_usb_fun, &p_intf);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    __uas_eps_get(p_intf, p_eps);
+
+    p_uas = usb_lib_malloc(&__g_ums_lib.lib, sizeof(struct usbh_ms_uas));
+    if (p_uas == NULL) {
+        return -USB_ENOMEM;
+    }
+    memset(p_uas, 0, sizeof(struct usbh_ms_uas));
+    p_ms->p_uas = p_uas;
+
+    p_uas->p_ms          = p_ms;
+    p_uas->alt_num       = USBH_INTF_ALT_NUM_GET(p_intf);
+    p_uas->qdepth        = USBH_MS_UAS_QDEPTH_DEF;
+    p_uas->p_ep_cmd      = p_eps[USB_UAS_PIPE_ID_CMD - 1];
+    p_uas->p_ep_sta      = p_eps[USB_UAS_PIPE_ID_STATUS - 1];
+    p_uas->p_ep_data_in  = p_eps[USB_UAS_PIPE_ID_DATA_IN - 1];
+    p_uas->p_ep_data_out = p_eps[USB_UAS_PIPE_ID_DATA_OUT - 1];
+
+    p_uas->p_lock = usb_lib_mutex_create(&__g_ums_lib.lib);
+    if (p_uas->p_lock == NULL) {
+        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+        ret = -USB_EPERM;
+        goto __failed;
+    }
+    p_uas->p_cmd_free = usb_lib_sem_create(&__g_ums_lib.lib);
+    if (p_uas->p_cmd_free == NULL) {
+        __USB_ERR_TRACE(SemCreateErr, "\r\n");
+        ret = -USB_EPERM;
+        goto __failed;
+    }
+    p_uas->p_tmf_lock = usb_lib_mutex_create(&__g_ums_lib.lib);
+    if (p_uas->p_tmf_lock == NULL) {
+        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+        ret = -USB_EPERM;
+        goto __failed;
+    }
+    p_uas->p_tmf_done = usb_lib_sem_create(&__g_ums_lib.lib);
+    if (p_uas->p_tmf_done == NULL) {
+        __USB_ERR_TRACE(SemCreateErr, "\r\n");
+        ret = -USB_EPERM;
+        goto __failed;
+    }
+    p_uas->p_tmf_iu = usb_lib_malloc(&__g_ums_lib.lib, sizeof(struct usb_uas_task_mgmt_iu));
+    if (p_uas->p_tmf_iu == NULL) {
+        ret = -USB_ENOMEM;
+        goto __failed;
+    }
+
+    for (i = 0; i < USBH_MS_UAS_QDEPTH_MAX; i++) {
+        struct usbh_ms_uas_cmd *p_cmd = &p_uas->cmds[i];
+        struct usbh_ms_uas_sta *p_sta = &p_uas->stas[i];
+
+        p_cmd->p_ms = p_ms;
+        /* 标签 0 保留*/
+        p_cmd->tag  = i + 1;
+
+        p_cmd->p_done = usb_lib_sem_create(&__g_ums_lib.lib);
+        if (p_cmd->p_done == NULL) {
+            __USB_ERR_TRACE(SemCreateErr, "\r\n");
+            ret = -USB_EPERM;
+            goto __failed;
+        }
+        p_cmd->p_cmd_iu = usb_lib_malloc(&__g_ums_lib.lib, sizeof(struct usb_uas_cmd_iu));
+        if (p_cmd->p_cmd_iu == NULL) {
+            ret = -USB_ENOMEM;
+            goto __failed;
+        }
+        p_cmd->trp_cmd.p_ep      = p_uas->p_ep_cmd;
+        p_cmd->trp_cmd.p_data    = p_cmd->p_cmd_iu;
+        p_cmd->trp_cmd.len       = sizeof(struct usb_uas_cmd_iu);
+        p_cmd->trp_cmd.p_fn_done = __uas_cmd_done;
+        p_cmd->trp_cmd.p_arg     = (void *)p_cmd;
+
+        p_sta->p_uas = p_uas;
+        p_sta->p_iu  = usb_lib_malloc(&__g_ums_lib.lib, sizeof(struct usb_uas_sense_iu));
+        if (p_sta->p_iu == NULL) {
+            ret = -USB_ENOMEM;
+            goto __failed;
+        }
+        p_sta->trp.p_ep      = p_uas->p_ep_sta;
+        p_sta->trp.p_data    = p_sta->p_iu;
+        p_sta->trp.len       = sizeof(struct usb_uas_sense_iu);
+        p_sta->trp.p_fn_done = __uas_sta_done;
+        p_sta->trp.p_arg     = (void *)p_sta;
+    }
+
+    /* 切换到 UAS 备用设置*/
+    ret = usbh_func_intf_set(p_ms->p_usb_fun, USBH_INTF_NUM_GET(p_intf), p_uas->alt_num);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("UAS alternate setting %d set failed(%d)\r\n", p_uas->alt_num, ret);
+        goto __failed;
+    }
+
+    __USB_INFO("USB mass storage use UAS, queue depth %d\r\n", p_uas->qdepth);
+
+    return USB_OK;
+__failed:
+    usbh_ms_uas_deinit(p_ms);
+    return ret;
+}
+#endif
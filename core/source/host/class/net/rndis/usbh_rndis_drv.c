@@ -23,16 +23,18 @@ static void __rndis_msg_indicate(struct usbh_net       *p_net,
                                  struct rndis_indicate *p_msg,
                                  uint32_t               msg_len){
     if (p_net->p_drv_info->p_fn_indication) {
-        p_net->p_drv_info->p_fn_indication(p_net, p_net, msg_len);
+        p_net->p_drv_info->p_fn_indication(p_net, p_msg, msg_len);
     } else {
         uint32_t status = USB_CPU_TO_LE32(p_msg->status);
 
         switch (status) {
             case RNDIS_STATUS_MEDIA_CONNECT:
                 __USB_INFO("USB host net RNDIS device media connect\r\n");
+                usbh_net_link_change(p_net, USB_TRUE, USB_FALSE);
                 break;
             case RNDIS_STATUS_MEDIA_DISCONNECT:
                 __USB_INFO("USB host net RNDIS device media disconnect\r\n");
+                usbh_net_link_change(p_net, USB_FALSE, USB_FALSE);
                 break;
             default:
                 __USB_INFO("USB host net RNDIS device indication: 0x%08x\r\n", status);
@@ -236,7 +238,9 @@ int usbh_rndis_generic_bind(struct usbh_net *p_net, uint32_t flags){
     uint8_t                  *p_bp;
     struct usbh_interface    *p_intf = p_net->p_intf;
     uint32_t                  tmp, phym_unspec;
+    uint32_t                  tx_max, tx_pkts_max, tx_align;
     uint32_t                 *p_phym = NULL;
+    struct usbh_rndis_priv   *p_priv = NULL;
 
     u.p_buf = usb_lib_malloc(&__g_usbh_net_lib.lib, RNDIS_CONTROL_BUF_SIZE);
     if (u.p_buf == NULL) {
@@ -261,6 +265,10 @@ int usbh_rndis_generic_bind(struct usbh_net *p_net, uint32_t flags){
     p_net->max_packet           = USBH_EP_MPS_GET(p_net->p_ep_out);
     p_net->rx_trp_size          = p_net->hard_mtu + (p_net->max_packet + 1);
     p_net->rx_trp_size         &= ~(p_net->max_packet - 1);
+    /* 接收缓存足够大，设备可以把多个包放在一次传输里*/
+    if (p_net->rx_trp_size < RNDIS_RX_TRANSFER_SIZE) {
+        p_net->rx_trp_size = RNDIS_RX_TRANSFER_SIZE;
+    }
     u.p_init->max_transfer_size = USB_CPU_TO_LE32(p_net->rx_trp_size);
 
     ret = __rndis_cmd(p_net, u.p_header, RNDIS_CONTROL_BUF_SIZE);
@@ -282,6 +290,16 @@ int usbh_rndis_generic_bind(struct usbh_net *p_net, uint32_t flags){
         p_net->mtu      = p_net->hard_mtu - p_net->hard_header_len;
     }
 
+    /* 发送积累参数*/
+    tx_max      = tmp > RNDIS_TX_TRANSFER_SIZE ? RNDIS_TX_TRANSFER_SIZE : tmp;
+    tx_max      = tx_max < p_net->hard_mtu ? p_net->hard_mtu : tx_max;
+    tx_pkts_max = USB_CPU_TO_LE32(u.p_init_c->max_packets_per_message);
+    if (tx_pkts_max == 0) {
+        tx_pkts_max = 1;
+    }
+    tx_align    = USB_CPU_TO_LE32(u.p_init_c->packet_alignment);
+    tx_align    = tx_align > 7 ? 1 : (1 << tx_align);
+
     __USB_INFO("USB host net RNDIS device hard mtu %d (%d from dev), "
                "rx buflen %d, align %d\r\n",p_net->hard_mtu, tmp,
                 p_net->rx_trp_size, 1 << USB_CPU_TO_LE32(u.p_init_c->packet_alignment));
@@ -341,6 +359,29 @@ int usbh_rndis_generic_bind(struct usbh_net *p_net, uint32_t flags){
         goto __failed2;
     }
 
+    p_priv = usb_lib_malloc(&__g_usbh_net_lib.lib, sizeof(struct usbh_rndis_priv));
+    if (p_priv == NULL) {
+        ret = -USB_ENOMEM;
+        goto __failed2;
+    }
+    memset(p_priv, 0, sizeof(struct usbh_rndis_priv));
+
+    /* 多一个字节用于短包填充*/
+    p_priv->p_tx_buf = usb_lib_malloc(&__g_usbh_net_lib.lib, tx_max + 1);
+    if (p_priv->p_tx_buf == NULL) {
+        usb_lib_mfree(&__g_usbh_net_lib.lib, p_priv);
+        ret = -USB_ENOMEM;
+        goto __failed2;
+    }
+    p_priv->tx_max      = tx_max;
+    p_priv->tx_pkts_max = tx_pkts_max;
+    p_priv->tx_align    = tx_align;
+    p_net->tx_timeout   = RNDIS_TX_TIMEOUT_DEF;
+    p_net->p_drv_priv   = p_priv;
+    p_net->tx_trp_size  = tx_max + 1;
+
+    __USB_INFO("USB host net RNDIS device tx max %d, %d packets per transfer\r\n", tx_max, tx_pkts_max);
+
     usb_lib_mfree(&__g_usbh_net_lib.lib, u.p_buf);
 
     return USB_OK;
@@ -367,7 +408,14 @@ static int __rndis_bind(struct usbh_net *p_net){
  * \brief USB 主机 RNDIS 设备解除绑定
  */
 static int __rndis_unbind(struct usbh_net *p_net){
-    struct rndis_halt halt;
+    struct rndis_halt       halt;
+    struct usbh_rndis_priv *p_priv = p_net->p_drv_priv;
+
+    if (p_priv) {
+        usb_lib_mfree(&__g_usbh_net_lib.lib, p_priv->p_tx_buf);
+        usb_lib_mfree(&__g_usbh_net_lib.lib, p_priv);
+        p_net->p_drv_priv = NULL;
+    }
 
     memset(&halt, 0, sizeof(struct rndis_halt));
     halt.msg_type = USB_CPU_TO_LE32(RNDIS_MSG_HALT);
@@ -381,26 +429,173 @@ static int __rndis_unbind(struct usbh_net *p_net){
  * \brief USB 主机  RNDIS 设备状态通知
  */
 void __rndis_status(struct usbh_net *p_net, struct usbh_trp *p_trp){
+    struct usb_cdc_notification *p_event = NULL;
+
+    if (p_trp->act_len < sizeof(struct usb_cdc_notification)) {
+        return;
+    }
+
+    p_event = p_trp->p_data_dma;
 
+    switch (p_event->notification_type) {
+        /* 控制响应在 __rndis_cmd() 里轮询读取*/
+        case USB_CDC_NOTIFY_RESPONSE_AVAILABLE:
+            break;
+        default:
+            __USB_ERR_INFO("USB host net RNDIS device notification %02x unexpected\r\n",
+                            p_event->notification_type);
+            break;
+    }
 }
 
-static uint8_t *__rndis_tx_fixup(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len){
-    return NULL;
+/**
+ * \brief USB 主机 RNDIS 设备完成发送缓存，返回要发送的数据
+ */
+static void __rndis_tx_finish(struct usbh_net         *p_net,
+                              struct usbh_rndis_priv  *p_priv,
+                              uint8_t                **p_tx_buf,
+                              uint32_t                *p_tx_len){
+    uint32_t len = p_priv->tx_len;
+
+    /* 驱动自己积累多个包，长度是最大包大小的整数倍时多加一个字节变成短包，发送缓存
+     * 多分配了一个字节，填满 tx_max 时也能加*/
+    if ((len % p_net->max_packet) == 0) {
+        p_priv->p_tx_buf[len++] = 0;
+    }
+
+    p_priv->tx_len    = 0;
+    p_priv->tx_n_pkts = 0;
+
+    *p_tx_buf = p_priv->p_tx_buf;
+    *p_tx_len = len;
 }
 
-static int __rndis_rx_fixup(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len){
-    return -1;
+/**
+ * \brief USB 主机 RNDIS 设备发送修正，把包封装成 REMOTE_NDIS_PACKET_MSG 并积累到发送缓存中
+ */
+static int __rndis_tx_fixup(struct usbh_net  *p_net,
+                            uint8_t          *p_buf,
+                            uint32_t          buf_len,
+                            uint8_t         **p_tx_buf,
+                            uint32_t         *p_tx_len){
+    uint32_t                msg_len;
+    struct rndis_data_hdr  *p_hdr  = NULL;
+    struct usbh_rndis_priv *p_priv = p_net->p_drv_priv;
+
+    if (p_priv == NULL) {
+        return -USB_ENODEV;
+    }
+
+    msg_len = USB_ALIGN(sizeof(struct rndis_data_hdr) + buf_len, p_priv->tx_align);
+
+    if ((p_priv->tx_len + msg_len) > p_priv->tx_max) {
+        /* 空的发送缓存也放不下*/
+        if (p_priv->tx_n_pkts == 0) {
+            return -USB_ESIZE;
+        }
+        /* 先发送已经积累的包，再重新放入这个包*/
+        __rndis_tx_finish(p_net, p_priv, p_tx_buf, p_tx_len);
+
+        return -USB_EAGAIN;
+    }
+
+    p_hdr = (void *)(p_priv->p_tx_buf + p_priv->tx_len);
+    memset(p_hdr, 0, msg_len);
+
+    p_hdr->msg_type    = USB_CPU_TO_LE32(RNDIS_MSG_PACKET);
+    p_hdr->msg_len     = USB_CPU_TO_LE32(msg_len);
+    /* 偏移从 data_offset 字段开始算*/
+    p_hdr->data_offset = USB_CPU_TO_LE32(sizeof(struct rndis_data_hdr) - 8);
+    p_hdr->data_len    = USB_CPU_TO_LE32(buf_len);
+
+    memcpy((uint8_t *)p_hdr + sizeof(struct rndis_data_hdr), p_buf, buf_len);
+
+    p_priv->tx_len += msg_len;
+    p_priv->tx_n_pkts++;
+
+    /* 达到最大包数量或者不积累，马上发送*/
+    if ((p_priv->tx_n_pkts >= p_priv->tx_pkts_max) || (p_net->tx_timeout == 0)) {
+        __rndis_tx_finish(p_net, p_priv, p_tx_buf, p_tx_len);
+    } else {
+        *p_tx_len = 0;
+    }
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机 RNDIS 设备发送冲刷，结束当前积累的包
+ */
+static int __rndis_tx_flush(struct usbh_net  *p_net,
+                            uint8_t         **p_tx_buf,
+                            uint32_t         *p_tx_len){
+    struct usbh_rndis_priv *p_priv = p_net->p_drv_priv;
+
+    *p_tx_len = 0;
+
+    if ((p_priv == NULL) || (p_priv->tx_n_pkts == 0)) {
+        return USB_OK;
+    }
+    __rndis_tx_finish(p_net, p_priv, p_tx_buf, p_tx_len);
+
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机 RNDIS 设备接收修正，从一次接收传输中原地取出下一个包
+ *
+ * p_pos[0] 是下一个消息在接收缓存中的偏移
+ */
+static int __rndis_rx_fixup(struct usbh_net          *p_net,
+                            uint8_t                  *p_buf,
+                            uint32_t                  buf_len,
+                            uint32_t                 *p_pos,
+                            struct usbh_net_rx_frame *p_frame){
+    uint32_t               msg_type, msg_len, data_offset, data_len;
+    struct rndis_data_hdr *p_hdr = NULL;
+
+    while ((buf_len - p_pos[0]) >= sizeof(struct rndis_data_hdr)) {
+        p_hdr = (void *)(p_buf + p_pos[0]);
+
+        msg_type    = USB_CPU_TO_LE32(p_hdr->msg_type);
+        msg_len     = USB_CPU_TO_LE32(p_hdr->msg_len);
+        data_offset = USB_CPU_TO_LE32(p_hdr->data_offset);
+        data_len    = USB_CPU_TO_LE32(p_hdr->data_len);
+
+        /* 消息长度非法，丢弃剩下的数据*/
+        if ((msg_len < sizeof(struct rndis_data_hdr)) || (msg_len > (buf_len - p_pos[0]))) {
+            __USB_ERR_INFO("USB host net RNDIS bad rndis message %d/%d\r\n", msg_len, buf_len - p_pos[0]);
+            return -USB_EILLEGAL;
+        }
+        p_pos[0] += msg_len;
+
+        if (msg_type != RNDIS_MSG_PACKET) {
+            __USB_ERR_INFO("USB host net RNDIS message %08x unexpected\r\n", msg_type);
+            continue;
+        }
+        /* 偏移从 data_offset 字段开始算*/
+        if ((data_offset > (msg_len - 8)) || (data_len > (msg_len - 8 - data_offset))) {
+            __USB_ERR_INFO("USB host net RNDIS bad packet offset %d len %d\r\n", data_offset, data_len);
+            continue;
+        }
+        p_frame->p_data = (uint8_t *)p_hdr + 8 + data_offset;
+        p_frame->len    = data_len;
+
+        return USB_OK;
+    }
+    return -USB_END;
 }
 
 /* \brief 远程网络驱动接口规范设备*/
 static const struct usbh_net_drv_info  __g_rndis_info = {
     .p_desc        = "RNDIS device",
-    .flags         =  USB_NET_ETHER | USB_NET_POINTTOPOINT | USB_NET_FRAMING_RN | USB_NET_NO_SETINTF,
+    .flags         =  USB_NET_ETHER | USB_NET_POINTTOPOINT | USB_NET_FRAMING_RN | USB_NET_NO_SETINTF |
+                      USB_NET_DRV_FLAG_MULTI_PACKET,
     .p_fn_bind     =  __rndis_bind,
     .p_fn_unbind   =  __rndis_unbind,
     .p_fn_status   =  __rndis_status,
     .p_fn_rx_fixup =  __rndis_rx_fixup,
     .p_fn_tx_fixup =  __rndis_tx_fixup,
+    .p_fn_tx_flush =  __rndis_tx_flush,
 };
 
 /**
@@ -12,6 +12,7 @@ struct usbh_net_lib __g_usbh_net_lib;
 static void __net_rx_trps_deinit(struct usbh_net *p_net);
 static int __net_rx_trps_cancel(struct usbh_net *p_net);
 static int __net_deinit(struct usbh_net *p_net);
+static int __net_tx_flush(struct usbh_net *p_net, usb_bool_t is_force);
 
 /*******************************************************************************
  * Code
@@ -126,15 +127,30 @@ static void __net_max_qlen_update(struct usbh_net *p_net){
     switch (speed) {
         case USB_SPEED_HIGH:
             p_net->rx_qlen = __g_usbh_net_lib.queue_max / p_net->rx_trp_size;
-            p_net->tx_qlen = __g_usbh_net_lib.queue_max  / p_net->hard_mtu;
+            p_net->tx_qlen = __g_usbh_net_lib.queue_max / p_net->tx_trp_size;
             break;
         case USB_SPEED_SUPER:
             p_net->rx_qlen = 5 * __g_usbh_net_lib.queue_max  / p_net->rx_trp_size;
-            p_net->tx_qlen = 5 * __g_usbh_net_lib.queue_max  / p_net->hard_mtu;
+            p_net->tx_qlen = 5 * __g_usbh_net_lib.queue_max  / p_net->tx_trp_size;
            break;
         default:
             p_net->rx_qlen = p_net->tx_qlen = 4;
     }
+    /* 接收完成的请求包都要能放进接收完成队列*/
+    if (p_net->rx_qlen > USB_NET_RX_TRP_MAX) {
+        p_net->rx_qlen = USB_NET_RX_TRP_MAX;
+    }
+    /* 积累多帧的驱动接收缓存很大，至少保证两个接收请求包轮换*/
+    if (p_net->rx_qlen < 2) {
+        p_net->rx_qlen = 2;
+    }
+    /* 发送请求包按 tx_trp_size 预分配缓存，积累多帧的驱动请求包很大，窗口受发送请求包池大小限制*/
+    if (p_net->tx_qlen > USB_NET_TX_TRP_MAX) {
+        p_net->tx_qlen = USB_NET_TX_TRP_MAX;
+    }
+    if (p_net->tx_qlen < 2) {
+        p_net->tx_qlen = 2;
+    }
 }
 
 /**
@@ -386,72 +402,6 @@ static void __net_status_trp_deinit(struct usbh_net *p_net){
     }
 }
 
-/**
- * \brief USB 主机转串口设备端口接收缓存放入数据
- */
-static int __net_rx_buf_put(struct usbh_net *p_net,
-                            uint8_t         *p_buf,
-                            uint32_t         buf_len,
-                            uint32_t        *p_act_len){
-    int      ret = USB_OK;
-    uint32_t len;
-
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_net->p_lock, USB_NET_LOCK_TIMEOUT);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
-    }
-#endif
-    if (p_net->rx_buf.rd_pos > p_net->rx_buf.data_pos) {
-        if (buf_len > (p_net->rx_buf.rd_pos - p_net->rx_buf.data_pos - 1)) {
-            len = p_net->rx_buf.rd_pos - p_net->rx_buf.data_pos;
-        } else {
-            len = buf_len;
-        }
-        memcpy(p_net->rx_buf.p_buf + p_net->rx_buf.data_pos, p_buf, len);
-
-        *p_act_len = len;
-    } else {
-        /* 计算可以放入数据的总大小*/
-        len = p_net->rx_buf.buf_size + p_net->rx_buf.rd_pos - p_net->rx_buf.data_pos - 1;
-
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        /* 回环*/
-        if ((len + p_net->rx_buf.data_pos) > p_net->rx_buf.buf_size) {
-            len = p_net->rx_buf.buf_size - p_net->rx_buf.data_pos;
-        }
-        memcpy(p_net->rx_buf.p_buf + p_net->rx_buf.data_pos, p_buf, len);
-        *p_act_len = len;
-
-        len = buf_len - *p_act_len;
-
-        if (p_net->rx_buf.rd_pos != 0) {
-            if (len > (p_net->rx_buf.rd_pos - 1)) {
-                len = p_net->rx_buf.rd_pos - 1;
-            }
-            memcpy(p_net->rx_buf.p_buf, p_buf + *p_act_len, len);
-            *p_act_len += len;
-        }
-    }
-    /* 重新设置写标记*/
-    p_net->rx_buf.data_pos = (p_net->rx_buf.data_pos + *p_act_len);
-    /* 到了环形末尾，回到环形头*/
-    if (p_net->rx_buf.data_pos >= p_net->rx_buf.buf_size) {
-        p_net->rx_buf.data_pos -= p_net->rx_buf.buf_size;
-    }
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_net->p_lock);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-    }
-#endif
-
-    return ret;
-}
-
 /**
  * \brief USB 主机网络设备接收完成函数
  */
@@ -460,8 +410,7 @@ static void __net_rx_done(void *p_arg){
     struct usbh_net_trp *p_net_trp = (struct usbh_net_trp *)p_arg;
     struct usbh_net     *p_net     = (struct usbh_net *)(p_net_trp->trp.p_usr_priv);
     int                  status    = p_net_trp->trp.status;
-    uint32_t             act_len, data_act_len, event;
-    uint8_t             *p_buf     = NULL;
+    uint32_t             act_len, event;
 
     event = __net_event_get(p_net);
 
@@ -477,9 +426,18 @@ static void __net_rx_done(void *p_arg){
 
     switch (status) {
         case USB_OK:
-            act_len = p_net_trp->trp.act_len;
-            p_buf   = p_net_trp->trp.p_data;
-            __net_rx_buf_put(p_net, p_buf, act_len, &data_act_len);
+            p_net_trp->rx_pos[0]  = 0;
+            p_net_trp->rx_pos[1]  = 0;
+            p_net_trp->n_lent     = 0;
+            p_net_trp->is_parsed  = USB_FALSE;
+            /* 接收完成回调是接收完成队列唯一的生产者，不需要上锁，请求包在帧都归还后再重新提交*/
+            usb_lib_rb_put(&p_net->rx_done_rb,
+                           (uint8_t *)&p_net_trp,
+                           sizeof(struct usbh_net_trp *),
+                           &act_len);
+            if (act_len == sizeof(struct usbh_net_trp *)) {
+                return;
+            }
             break;
         default:
             break;
@@ -556,6 +514,148 @@ static void __net_rx_trp_free(struct usbh_net *p_net, struct usbh_net_trp *p_net
     }
 }
 
+/**
+ * \brief USB 主机网络设备接收完成队列取出一个请求包
+ */
+static struct usbh_net_trp *__net_rx_done_pop(struct usbh_net *p_net, usb_bool_t is_peek){
+    struct usbh_net_trp *p_net_trp = NULL;
+    uint8_t             *p_data    = NULL;
+    uint32_t             len;
+
+    if (usb_lib_rb_peek(&p_net->rx_done_rb, &p_data, &len) != USB_OK) {
+        return NULL;
+    }
+    /* 队列大小是指针大小的整数倍，一个指针不会被回环分开*/
+    memcpy(&p_net_trp, p_data, sizeof(struct usbh_net_trp *));
+    if (is_peek == USB_FALSE) {
+        usb_lib_rb_consume(&p_net->rx_done_rb, sizeof(struct usbh_net_trp *));
+    }
+    return p_net_trp;
+}
+
+/**
+ * \brief USB 主机网络设备回收接收请求包，重新提交(调用者持有设备锁)
+ */
+static void __net_rx_trp_recycle(struct usbh_net *p_net, struct usbh_net_trp *p_net_trp){
+    int ret;
+
+    usb_list_node_del(&p_net_trp->node);
+
+    /* 设备已经停止，直接释放*/
+    if (p_net->is_started == USB_FALSE) {
+        usb_list_node_add_tail(&p_net_trp->node, &p_net->rx_trp_hdr.trp_free);
+        __net_rx_trp_free(p_net, p_net_trp);
+        return;
+    }
+    if ((p_net->is_removed == USB_FALSE) &&
+            !(__net_event_get(p_net) & (USB_NET_EVENT_RX_KILL | USB_NET_EVENT_RX_HALT))) {
+        usb_list_node_add_tail(&p_net_trp->node, &p_net->rx_trp_hdr.trp_start);
+        p_net->rx_trp_hdr.n_trp_start++;
+
+        ret = usbh_trp_submit(&p_net_trp->trp);
+        if (ret == USB_OK) {
+            return;
+        }
+        __USB_ERR_INFO("USB host net TRP submit failed(%d)\r\n", ret);
+
+        usb_list_node_del(&p_net_trp->node);
+        p_net->rx_trp_hdr.n_trp_start--;
+    }
+    usb_list_node_add_tail(&p_net_trp->node, &p_net->rx_trp_hdr.trp_free);
+}
+
+/**
+ * \brief USB 主机网络设备接收请求包解析完，移出接收完成队列(调用者持有设备锁)
+ */
+static void __net_rx_trp_parsed(struct usbh_net *p_net, struct usbh_net_trp *p_net_trp){
+    usb_lib_rb_consume(&p_net->rx_done_rb, sizeof(struct usbh_net_trp *));
+    p_net->rx_trp_hdr.n_trp_start--;
+
+    p_net_trp->is_parsed = USB_TRUE;
+    /* 还有帧借给用户，等帧都归还后再回收*/
+    if (p_net_trp->n_lent != 0) {
+        usb_list_node_del(&p_net_trp->node);
+        usb_list_node_add_tail(&p_net_trp->node, &p_net->rx_trp_hdr.trp_lent);
+    } else {
+        __net_rx_trp_recycle(p_net, p_net_trp);
+    }
+}
+
+/**
+ * \brief USB 主机网络设备接收完成队列清空，未解析的请求包不再重新提交
+ */
+static void __net_rx_done_drain(struct usbh_net *p_net){
+    struct usbh_net_trp *p_net_trp = NULL;
+
+    while ((p_net_trp = __net_rx_done_pop(p_net, USB_TRUE)) != NULL) {
+        __net_rx_trp_parsed(p_net, p_net_trp);
+    }
+}
+
+/**
+ * \brief USB 主机网络设备获取一个接收帧(调用者持有设备锁)
+ */
+static int __net_rx_frame_get(struct usbh_net *p_net, struct usbh_net_rx_frame **p_frame){
+    int                             ret;
+    struct usbh_net_trp            *p_net_trp = NULL;
+    struct usbh_net_rx_frame       *p_rx_frame;
+    const struct usbh_net_drv_info *p_info    = p_net->p_drv_info;
+
+    if (usb_list_head_is_empty(&p_net->rx_frame_free)) {
+        /* 用户借走的帧太多*/
+        return -USB_EAGAIN;
+    }
+    p_rx_frame = usb_container_of(p_net->rx_frame_free.p_next, struct usbh_net_rx_frame, node);
+
+    while ((p_net_trp = __net_rx_done_pop(p_net, USB_TRUE)) != NULL) {
+        if (p_info->p_fn_rx_fixup) {
+            /* 一次接收传输可能有多个帧，由驱动解析*/
+            ret = p_info->p_fn_rx_fixup(p_net,
+                                        p_net_trp->trp.p_data,
+                                        p_net_trp->trp.act_len,
+                                        p_net_trp->rx_pos,
+                                        p_rx_frame);
+            if ((ret != USB_OK) && (ret != -USB_END)) {
+                __USB_ERR_INFO("USB host net RX fixup failed(%d)\r\n", ret);
+            }
+        } else if (p_net_trp->rx_pos[0] == 0) {
+            p_rx_frame->p_data   = p_net_trp->trp.p_data;
+            p_rx_frame->len      = p_net_trp->trp.act_len;
+            p_net_trp->rx_pos[0] = p_net_trp->trp.act_len;
+            ret = USB_OK;
+        } else {
+            ret = -USB_END;
+        }
+
+        if (ret == USB_OK) {
+            usb_list_node_del(&p_rx_frame->node);
+            p_rx_frame->p_net_trp = p_net_trp;
+            p_net_trp->n_lent++;
+
+            *p_frame = p_rx_frame;
+
+            return USB_OK;
+        }
+        __net_rx_trp_parsed(p_net, p_net_trp);
+    }
+    return -USB_EAGAIN;
+}
+
+/**
+ * \brief USB 主机网络设备归还一个接收帧(调用者持有设备锁)
+ */
+static void __net_rx_frame_put(struct usbh_net *p_net, struct usbh_net_rx_frame *p_frame){
+    struct usbh_net_trp *p_net_trp = p_frame->p_net_trp;
+
+    p_frame->p_net_trp = NULL;
+    usb_list_node_add_tail(&p_frame->node, &p_net->rx_frame_free);
+
+    p_net_trp->n_lent--;
+    if ((p_net_trp->n_lent == 0) && (p_net_trp->is_parsed == USB_TRUE)) {
+        __net_rx_trp_recycle(p_net, p_net_trp);
+    }
+}
+
 /**
  * \brief USB 主机网络设备发送传输请求包初始化函数
  */
@@ -670,6 +770,225 @@ static int __net_rx_trps_cancel(struct usbh_net *p_net){
     return USB_OK;
 }
 
+/**
+ * \brief USB 主机网络设备发送完成函数
+ */
+static void __net_tx_done(void *p_arg){
+    struct usbh_net_trp *p_net_trp = (struct usbh_net_trp *)p_arg;
+    struct usbh_net     *p_net     = (struct usbh_net *)(p_net_trp->trp.p_usr_priv);
+    uint32_t             len;
+
+    switch (p_net_trp->trp.status) {
+        case USB_OK:
+        case -USB_ECANCEL:
+            break;
+        case -USB_EPIPE:
+            /* 设置发送停止事件*/
+            __net_event_set(p_net, USB_NET_EVENT_TX_HALT);
+            break;
+        default:
+            __USB_ERR_INFO("USB host net TX failed(%d)\r\n", p_net_trp->trp.status);
+            break;
+    }
+
+    /* 发送完成回调是发送完成队列唯一的生产者，队列能放下池里所有的请求包，请求包在
+     * 下次发送时回收*/
+    usb_lib_rb_put(&p_net->tx_done_rb,
+                   (uint8_t *)&p_net_trp,
+                   sizeof(struct usbh_net_trp *),
+                   &len);
+
+    if (p_net->is_tx_full == USB_TRUE) {
+        p_net->is_tx_full = USB_FALSE;
+
+        if (p_net->p_fn_tx_ready) {
+            p_net->p_fn_tx_ready(p_net->p_tx_ready_arg);
+        }
+    }
+}
+
+/**
+ * \brief USB 主机网络设备发送请求包池初始化(调用者持有发送锁)
+ */
+static int __net_tx_trps_init(struct usbh_net *p_net){
+    uint16_t             i;
+    struct usbh_net_trp *p_net_trp = NULL;
+
+    /* 上次停止时还有没完成的请求包，它们的完成回调还会放入发送完成队列，不能复位*/
+    if (p_net->tx_trp_hdr.n_trp_total == 0) {
+        usb_lib_rb_reset(&p_net->tx_done_rb);
+    }
+    /* 没完成的请求包仍然算在池里，池大小不超过发送完成队列大小*/
+    for (i = p_net->tx_trp_hdr.n_trp_total; i < p_net->tx_qlen; i++) {
+        p_net_trp = usb_lib_malloc(&__g_usbh_net_lib.lib, sizeof(struct usbh_net_trp));
+        if (p_net_trp == NULL) {
+            return -USB_ENOMEM;
+        }
+        memset(p_net_trp, 0, sizeof(struct usbh_net_trp));
+
+        p_net_trp->trp.p_data = usb_lib_malloc(&__g_usbh_net_lib.lib, p_net->tx_trp_size);
+        if (p_net_trp->trp.p_data == NULL) {
+            usb_lib_mfree(&__g_usbh_net_lib.lib, p_net_trp);
+            return -USB_ENOMEM;
+        }
+        p_net_trp->trp.p_ep       = p_net->p_ep_out;
+        p_net_trp->trp.p_fn_done  = __net_tx_done;
+        p_net_trp->trp.p_arg      = (void *)p_net_trp;
+        p_net_trp->trp.p_usr_priv = (void *)p_net;
+
+        usb_list_node_add_tail(&p_net_trp->node, &p_net->tx_trp_hdr.trp_free);
+        p_net->tx_trp_hdr.n_trp_total++;
+    }
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机网络设备回收发送完成的请求包(调用者持有发送锁)
+ */
+static void __net_tx_trps_reclaim(struct usbh_net *p_net){
+    struct usbh_net_trp *p_net_trp = NULL;
+    uint8_t             *p_data    = NULL;
+    uint32_t             len;
+
+    while (usb_lib_rb_peek(&p_net->tx_done_rb, &p_data, &len) == USB_OK) {
+        memcpy(&p_net_trp, p_data, sizeof(struct usbh_net_trp *));
+        usb_lib_rb_consume(&p_net->tx_done_rb, sizeof(struct usbh_net_trp *));
+
+        usb_list_node_del(&p_net_trp->node);
+        usb_list_node_add_tail(&p_net_trp->node, &p_net->tx_trp_hdr.trp_free);
+        p_net->tx_trp_hdr.n_trp_start--;
+    }
+}
+
+/**
+ * \brief USB 主机网络设备取消发送请求包并释放请求包池(调用者持有发送锁)
+ */
+static void __net_tx_trps_deinit(struct usbh_net *p_net){
+    int                   ret;
+    int                   timeout    = USB_NET_TX_STOP_TIMEOUT;
+    uint32_t              n_start    = 0;
+    struct usb_list_node *p_node     = NULL;
+    struct usb_list_node *p_node_tmp = NULL;
+    struct usbh_net_trp  *p_net_trp  = NULL;
+
+    p_net->is_tx_run = USB_FALSE;
+
+    usb_list_for_each_node_safe(p_node,
+                                p_node_tmp,
+                               &p_net->tx_trp_hdr.trp_start){
+        p_net_trp = usb_container_of(p_node, struct usbh_net_trp, node);
+
+        ret = usbh_trp_xfer_cancel(&p_net_trp->trp);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("USB host net device TX TRP cancel failed(%d)\r\n", ret);
+        }
+    }
+    /* 等待取消的请求包完成回调(完成回调不获取发送锁)*/
+    __net_tx_trps_reclaim(p_net);
+    while ((!usb_list_head_is_empty(&p_net->tx_trp_hdr.trp_start)) && (timeout > 0)) {
+        usb_mdelay(1);
+        timeout--;
+        __net_tx_trps_reclaim(p_net);
+    }
+
+    usb_list_for_each_node_safe(p_node,
+                                p_node_tmp,
+                               &p_net->tx_trp_hdr.trp_free){
+        p_net_trp = usb_container_of(p_node, struct usbh_net_trp, node);
+
+        usb_list_node_del(&p_net_trp->node);
+
+        usb_lib_mfree(&__g_usbh_net_lib.lib, p_net_trp->trp.p_data);
+        usb_lib_mfree(&__g_usbh_net_lib.lib, p_net_trp);
+    }
+    /* 超时还没完成的请求包不能释放，留在启动链表上，计数按链表重新计算*/
+    usb_list_for_each_node_safe(p_node,
+                                p_node_tmp,
+                               &p_net->tx_trp_hdr.trp_start){
+        n_start++;
+    }
+    p_net->tx_trp_hdr.n_trp_start = n_start;
+    p_net->tx_trp_hdr.n_trp_total = n_start;
+    if (n_start != 0) {
+        __USB_ERR_INFO("USB host net device %d TX TRP still in progress\r\n", n_start);
+    }
+    p_net->is_tx_full = USB_FALSE;
+}
+
+/**
+ * \brief USB 主机网络设备获取一个空闲的发送请求包(调用者持有发送锁)
+ */
+static struct usbh_net_trp *__net_tx_trp_get(struct usbh_net *p_net){
+    __net_tx_trps_reclaim(p_net);
+
+    if (usb_list_head_is_empty(&p_net->tx_trp_hdr.trp_free)) {
+        /* 发送窗口已满，有请求包完成后通知用户*/
+        p_net->is_tx_full = USB_TRUE;
+        /* 设置标志和完成回调之间可能已经全部完成*/
+        __net_tx_trps_reclaim(p_net);
+        if (usb_list_head_is_empty(&p_net->tx_trp_hdr.trp_free)) {
+            return NULL;
+        }
+        p_net->is_tx_full = USB_FALSE;
+    }
+    return usb_container_of(p_net->tx_trp_hdr.trp_free.p_next, struct usbh_net_trp, node);
+}
+
+/**
+ * \brief USB 主机网络设备启动发送(分配发送请求包池)
+ */
+static int __net_tx_start(struct usbh_net *p_net){
+    int ret;
+#if USB_OS_EN
+    int ret_tmp;
+#endif
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_tx_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    ret = __net_tx_trps_init(p_net);
+    if (ret != USB_OK) {
+        __net_tx_trps_deinit(p_net);
+    } else {
+        p_net->is_tx_run = USB_TRUE;
+    }
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_net->p_tx_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief USB 主机网络设备停止发送(取消在传输的请求包并释放请求包池)
+ */
+static int __net_tx_stop(struct usbh_net *p_net){
+    int ret = USB_OK;
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_tx_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    __net_tx_trps_deinit(p_net);
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_net->p_tx_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+    return ret;
+}
+
 /**
  * \brief USB 网络设备初始化
  */
@@ -678,7 +997,7 @@ static int __net_init(struct usbh_net                *p_net,
                       char                           *p_name,
                       const struct usbh_net_drv_info *p_drv_info){
     struct usbh_interface *p_intf = NULL;
-    int                    ret;
+    int                    ret, i;
 
     usb_refcnt_init(&p_net->ref_cnt);
 #if USB_OS_EN
@@ -687,6 +1006,11 @@ static int __net_init(struct usbh_net                *p_net,
         __USB_ERR_TRACE(MutexCreateErr, "\r\n");
         return -USB_EPERM;
     }
+    p_net->p_tx_lock = usb_lib_mutex_create(&__g_usbh_net_lib.lib);
+    if (p_net->p_tx_lock == NULL) {
+        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+        return -USB_EPERM;
+    }
 #endif
 
     p_intf = usbh_func_intf_get(p_usb_fun, p_usb_fun->first_intf_num, 0);
@@ -705,16 +1029,34 @@ static int __net_init(struct usbh_net                *p_net,
     p_net->hard_header_len = 14;
     p_net->is_removed      = USB_FALSE;
     p_net->p_drv_info      = p_drv_info;
-    p_net->rx_buf.buf_size = 4096;
 
-    p_net->rx_buf.p_buf = usb_lib_malloc(&__g_usbh_net_lib.lib, 4096);
-    if (p_net->rx_buf.p_buf == NULL) {
-        return -USB_ENOMEM;
+    /* 接收完成队列存放接收完成的请求包指针*/
+    ret = usb_lib_rb_init(&p_net->rx_done_rb,
+                          (uint8_t *)p_net->p_rx_done,
+                           sizeof(p_net->p_rx_done));
+    if (ret != USB_OK) {
+        return ret;
+    }
+
+    usb_list_head_init(&p_net->rx_frame_free);
+    for (i = 0; i < USB_NET_RX_FRAME_MAX; i++) {
+        usb_list_node_add_tail(&p_net->rx_frames[i].node, &p_net->rx_frame_free);
     }
-    memset(p_net->rx_buf.p_buf, 0, 4096);
 
     usb_list_head_init(&p_net->rx_trp_hdr.trp_start);
     usb_list_head_init(&p_net->rx_trp_hdr.trp_free);
+    usb_list_head_init(&p_net->rx_trp_hdr.trp_lent);
+
+    /* 发送完成队列存放发送完成的请求包指针*/
+    ret = usb_lib_rb_init(&p_net->tx_done_rb,
+                          (uint8_t *)p_net->p_tx_done,
+                           sizeof(p_net->p_tx_done));
+    if (ret != USB_OK) {
+        return ret;
+    }
+    usb_list_head_init(&p_net->tx_trp_hdr.trp_start);
+    usb_list_head_init(&p_net->tx_trp_hdr.trp_free);
+    usb_list_head_init(&p_net->tx_trp_hdr.trp_lent);
 
     if (p_drv_info->p_fn_bind) {
         ret = p_drv_info->p_fn_bind(p_net);
@@ -758,6 +1100,10 @@ static int __net_init(struct usbh_net                *p_net,
     if (p_net->rx_trp_size == 0) {
         p_net->rx_trp_size = p_net->hard_mtu;
     }
+    /* 多一个字节用于短包填充*/
+    if (p_net->tx_trp_size == 0) {
+        p_net->tx_trp_size = p_net->hard_mtu + 1;
+    }
     /* 获取输出传输请求包最大包大小*/
     p_net->max_packet = USBH_EP_MPS_GET(p_net->p_ep_out);
 
@@ -783,10 +1129,6 @@ static int __net_deinit(struct usbh_net *p_net){
             return ret;
         }
     }
-    if (p_net->rx_buf.p_buf) {
-        usb_lib_mfree(&__g_usbh_net_lib.lib, p_net->rx_buf.p_buf);
-    }
-
 #if USB_OS_EN
     if (p_net->p_lock) {
         ret = usb_lib_mutex_destroy(&__g_usbh_net_lib.lib, p_net->p_lock);
@@ -794,6 +1136,12 @@ static int __net_deinit(struct usbh_net *p_net){
             __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
         }
     }
+    if (p_net->p_tx_lock) {
+        ret = usb_lib_mutex_destroy(&__g_usbh_net_lib.lib, p_net->p_tx_lock);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
+        }
+    }
 #endif
     return ret;
 }
@@ -1057,6 +1405,14 @@ int usbh_net_start(struct usbh_net *p_net){
         __USB_ERR_INFO("USB host net RX TRP init failed(%d)\r\n", ret);
         goto __exit;
     }
+    ret = __net_tx_start(p_net);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("USB host net TX TRP init failed(%d)\r\n", ret);
+        __net_rx_trps_deinit(p_net);
+        goto __exit;
+    }
+    p_net->is_started = USB_TRUE;
+
     ret = __net_rx_trps_submit(p_net);
 __exit:
 #if USB_OS_EN
@@ -1087,6 +1443,9 @@ int usbh_net_stop(struct usbh_net *p_net){
     if (p_net == NULL) {
         return -USB_EINVAL;
     }
+
+    /* 发送驱动积累的数据*/
+    __net_tx_flush(p_net, USB_TRUE);
 #if USB_OS_EN
     ret = usb_mutex_lock(p_net->p_lock, USB_NET_LOCK_TIMEOUT);
     if (ret != USB_OK) {
@@ -1108,6 +1467,15 @@ int usbh_net_stop(struct usbh_net *p_net){
         }
     }
 
+    p_net->is_started = USB_FALSE;
+
+    /* 先取回还在接收完成队列里的请求包，有帧借出的请求包在帧归还时释放*/
+    __net_rx_done_drain(p_net);
+    if (p_net->p_rx_frame_pend) {
+        __net_rx_frame_put(p_net, p_net->p_rx_frame_pend);
+        p_net->p_rx_frame_pend = NULL;
+    }
+
     if (!(p_info->flags & USB_NET_DRV_FLAG_AVOID_UNLINK_TRPS)) {
         ret = __net_rx_trps_cancel(p_net);
         if (ret != USB_OK) {
@@ -1115,6 +1483,8 @@ int usbh_net_stop(struct usbh_net *p_net){
         }
         __net_rx_trps_deinit(p_net);
     }
+    /* 发送窗口里的请求包已经提交，取消后释放发送请求包池*/
+    __net_tx_stop(p_net);
 
     p_net->event_flags = 0;
 
@@ -1132,82 +1502,151 @@ __exit:
 
     return ret;
 }
-#if 1
+
 /**
- * \brief USB 主机网络设备写函数
- *
- * \param[in] p_net   USB 主机网络设备
- * \param[in] p_buf   写缓存
- * \param[in] buf_len 写缓存长度
- *
- * \retval 成功返回实际写的长度
+ * \brief USB 主机网络设备用发送请求包发送一次批量传输(调用者持有发送锁)
  */
-int usbh_net_write(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len){
+static int __net_tx_submit(struct usbh_net     *p_net,
+                           struct usbh_net_trp *p_net_trp,
+                           uint8_t             *p_buf,
+                           uint32_t             len){
     int                             ret;
-    uint32_t                        length, flags = 0;
-    const struct usbh_net_drv_info *p_info        = NULL;
-    uint8_t                        *p_buf_tmp     = NULL;
+    const struct usbh_net_drv_info *p_info = p_net->p_drv_info;
 
-    if ((p_net == NULL) || (p_buf == NULL) || (buf_len == 0)) {
-        return -USB_EINVAL;
-    }
-
-    p_info = p_net->p_drv_info;
-    if (p_info->p_fn_tx_fixup) {
-        p_buf_tmp = p_info->p_fn_tx_fixup(p_net, p_buf, buf_len);
-        if (p_buf_tmp == NULL) {
-            return -USB_EAGAIN;
-        }
+    if (len > p_net->tx_trp_size) {
+        return -USB_ESIZE;
     }
+    memcpy(p_net_trp->trp.p_data, p_buf, len);
 
-    length = buf_len;
+    p_net_trp->trp.flag   = 0;
+    p_net_trp->trp.status = -USB_EINPROGRESS;
 
     /* 不要假设硬件会处理 USB 零数据包
      * 注意：严格一致的 CDC ETHER 设备应该在这里期望 0 长度包，但忽略一个字节包
      * 注意2：CDC-ECM 与 CDC-NCM 在处理 0 长度包/短包上有不同的规范，因此 CDC-NCM 驱动
      * 程序会根据需要自行生成短包*/
-    if (length % p_net->max_packet == 0) {
+    if (len % p_net->max_packet == 0) {
         /* 硬件能处理零长度包*/
         if ((p_info->flags & USB_NET_DRV_FLAG_SEND_ZLP) == 0) {
-            /* 驱动不会积累多数据包*/
-            if ((p_info->flags & USB_NET_DRV_FLAG_MULTI_PACKET) == 0) {
-                //FIXME
+            /* 驱动不会积累多数据包，多发一个字节变成短包*/
+            if (((p_info->flags & USB_NET_DRV_FLAG_MULTI_PACKET) == 0) &&
+                    (len < p_net->tx_trp_size)) {
+                ((uint8_t *)p_net_trp->trp.p_data)[len++] = 0;
             }
         } else {
             /* 用短包结束 USB 批量传输*/
-            flags |= USBH_TRP_ZERO_PACKET;
+            p_net_trp->trp.flag |= USBH_TRP_ZERO_PACKET;
         }
     }
+    p_net_trp->trp.len = len;
+
+    usb_list_node_del(&p_net_trp->node);
+    usb_list_node_add_tail(&p_net_trp->node, &p_net->tx_trp_hdr.trp_start);
+    p_net->tx_trp_hdr.n_trp_start++;
+
+    ret = usbh_trp_submit(&p_net_trp->trp);
+    if (ret != USB_OK) {
+        usb_list_node_del(&p_net_trp->node);
+        usb_list_node_add_tail(&p_net_trp->node, &p_net->tx_trp_hdr.trp_free);
+        p_net->tx_trp_hdr.n_trp_start--;
 
+        __USB_ERR_INFO("USB host net TX TRP submit failed(%d)\r\n", ret);
+        if (ret == -USB_EPIPE) {
+            /* 设置发送停止事件*/
+            __net_event_set(p_net, USB_NET_EVENT_TX_HALT);
+        }
+        return ret;
+    }
     /* 记录传输启动时间*/
     usb_timespec_get(&p_net->trans_start_ts);
 
-    ret = usbh_trp_sync_xfer(p_net->p_ep_out, NULL, p_buf, length, 100, flags);
-    if (ret < 0) {
-        __USB_ERR_INFO("USB host net TX failed(%d)\r\n", ret);
+    return USB_OK;
+}
 
-        /* 设置发送停止事件*/
-        __net_event_set(p_net, USB_NET_EVENT_TX_HALT);
+/**
+ * \brief USB 主机网络设备检查驱动积累的数据是否超时(调用者持有发送锁)
+ */
+static usb_bool_t __net_tx_is_timeout(struct usbh_net *p_net){
+    struct usb_timespec ts;
+    long                elapsed_us;
+
+    usb_timespec_get(&ts);
+
+    /* 超过一秒肯定超时，避免计算溢出*/
+    if ((ts.ts_sec - p_net->tx_first_ts.ts_sec) <= 1) {
+        elapsed_us = (ts.ts_sec - p_net->tx_first_ts.ts_sec) * 1000000 +
+                     (ts.ts_nsec - p_net->tx_first_ts.ts_nsec) / 1000;
+        if ((elapsed_us >= 0) && ((uint32_t)elapsed_us < p_net->tx_timeout)) {
+            return USB_FALSE;
+        }
     }
-    return ret;
+    return USB_TRUE;
 }
-#else
 
 /**
- * \brief USB 主机网络设备发送完成函数
+ * \brief USB 主机网络设备发送修正后更新积累状态(调用者持有发送锁)
  */
-static void __net_tx_done(void *p_arg) {
-    //struct usbh_net *p_net = (struct usbh_net *)p_arg;
-    struct usbh_trp *p_trp = (struct usbh_trp *)p_arg;
-
-    /* 传输成功*/
-    if (p_trp->status != 0) {
-        __USB_ERR_INFO("USB host net device TX failed(%d)\r\n", p_trp->status);
-    } else {
-        usb_lib_mfree(&__g_usbh_net_lib.lib, p_trp);
+static void __net_tx_pend_update(struct usbh_net *p_net, int ret, uint32_t tx_len){
+    /* 驱动结束了一次积累*/
+    if (tx_len != 0) {
+        p_net->is_tx_pend = USB_FALSE;
+    }
+    /* 帧放入了新的积累，记录第一个帧的时间*/
+    if ((ret == USB_OK) && (tx_len == 0) && (p_net->is_tx_pend == USB_FALSE)) {
+        p_net->is_tx_pend = USB_TRUE;
+        usb_timespec_get(&p_net->tx_first_ts);
     }
 }
 
+/**
+ * \brief USB 主机网络设备发送驱动积累的数据，is_force 为 USB_FALSE 时积累超时才发送
+ */
+static int __net_tx_flush(struct usbh_net *p_net, usb_bool_t is_force){
+    int                             ret    = USB_OK;
+#if USB_OS_EN
+    int                             ret_tmp;
+#endif
+    uint8_t                        *p_tx_buf  = NULL;
+    uint32_t                        tx_len    = 0;
+    struct usbh_net_trp            *p_net_trp = NULL;
+    const struct usbh_net_drv_info *p_info    = p_net->p_drv_info;
+
+    if (p_info->p_fn_tx_flush == NULL) {
+        return USB_OK;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_tx_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    if ((p_net->is_tx_pend == USB_FALSE) ||
+            ((is_force == USB_FALSE) && (__net_tx_is_timeout(p_net) == USB_FALSE))) {
+        goto __exit;
+    }
+    /* 没有空闲的发送请求包时下次再冲刷*/
+    if ((p_net->is_tx_run == USB_FALSE) ||
+            ((p_net_trp = __net_tx_trp_get(p_net)) == NULL)) {
+        goto __exit;
+    }
+    ret = p_info->p_fn_tx_flush(p_net, &p_tx_buf, &tx_len);
+    if (ret == USB_OK) {
+        p_net->is_tx_pend = USB_FALSE;
+        if (tx_len != 0) {
+            ret = __net_tx_submit(p_net, p_net_trp, p_tx_buf, tx_len);
+        }
+    }
+__exit:
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_net->p_tx_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
 
 /**
  * \brief USB 主机网络设备写函数
@@ -1216,67 +1655,163 @@ static void __net_tx_done(void *p_arg) {
  * \param[in] p_buf   写缓存
  * \param[in] buf_len 写缓存长度
  *
- * \retval 成功返回 USB_OK
+ * \retval 成功返回实际写的长度(帧已经拷贝，写缓存可以马上重用)，发送窗口已满返回
+ *         -USB_EAGAIN，有发送请求包完成后调用发送就绪回调函数
  */
 int usbh_net_write(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len){
     int                             ret;
-    uint32_t                        length;
-    const struct usbh_net_drv_info *p_info = NULL;
-    struct usbh_trp                *p_trp_tx;
+    int                             ret_tx;
+#if USB_OS_EN
+    int                             ret_tmp;
+#endif
+    uint8_t                        *p_tx_buf  = NULL;
+    uint32_t                        tx_len    = 0;
+    struct usbh_net_trp            *p_net_trp = NULL;
+    const struct usbh_net_drv_info *p_info    = NULL;
 
     if ((p_net == NULL) || (p_buf == NULL) || (buf_len == 0)) {
         return -USB_EINVAL;
     }
 
     p_info = p_net->p_drv_info;
-
-    p_trp_tx = usb_lib_malloc(&__g_usbh_net_lib.lib, sizeof(struct usbh_trp));
-    if (p_trp_tx == NULL) {
-        return -512;
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_tx_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
     }
-    p_trp_tx->p_ep      = p_net->p_ep_out;
-    p_trp_tx->p_fn_done = __net_tx_done;
-    p_trp_tx->p_data    = p_buf;
-    p_trp_tx->p_arg     = p_trp_tx;
-
-    length = buf_len;
-
-    /* 不要假设硬件会处理 USB 零数据包
-     * 注意：严格一致的 CDC ETHER 设备应该在这里期望 0 长度包，但忽略一个字节包
-     * 注意2：CDC-ECM 与 CDC-NCM 在处理 0 长度包/短包上有不同的规范，因此 CDC-NCM 驱动
-     * 程序会根据需要自行生成短包*/
-    if (length % p_net->max_packet == 0) {
-        /* 硬件能处理零长度包*/
-        if ((p_info->flags & USB_NET_DRV_FLAG_SEND_ZLP) == 0) {
-            /* 驱动不会积累多数据包*/
-            if ((p_info->flags & USB_NET_DRV_FLAG_MULTI_PACKET) == 0) {
-                //FIXME
+#endif
+    /* 设备没有启动*/
+    if (p_net->is_tx_run == USB_FALSE) {
+        ret = -USB_EPERM;
+        goto __exit;
+    }
+    do {
+        /* 驱动修正后可能马上要发送，先保证有空闲的发送请求包*/
+        p_net_trp = __net_tx_trp_get(p_net);
+        if (p_net_trp == NULL) {
+            ret = -USB_EAGAIN;
+            break;
+        }
+        if (p_info->p_fn_tx_fixup == NULL) {
+            ret = __net_tx_submit(p_net, p_net_trp, p_buf, buf_len);
+            break;
+        }
+        tx_len = 0;
+        /* 驱动可能把多个帧积累到一次传输里*/
+        ret = p_info->p_fn_tx_fixup(p_net, p_buf, buf_len, &p_tx_buf, &tx_len);
+        if ((ret != USB_OK) && (ret != -USB_EAGAIN)) {
+            break;
+        }
+        __net_tx_pend_update(p_net, ret, tx_len);
+        if (tx_len != 0) {
+            ret_tx = __net_tx_submit(p_net, p_net_trp, p_tx_buf, tx_len);
+            if (ret_tx != USB_OK) {
+                ret = ret_tx;
+                break;
             }
-        } else {
-            /* 用短包结束 USB 批量传输*/
-            p_net->trp_tx.flag |= USBH_TRP_ZERO_PACKET;
+        } else if (ret == -USB_EAGAIN) {
+            break;
         }
+    } while (ret == -USB_EAGAIN);
+
+    if (ret == USB_OK) {
+        ret = buf_len;
+    }
+__exit:
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_net->p_tx_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
     }
-    p_trp_tx->len = length;
+#endif
+    return ret;
+}
 
-    ret = usbh_trp_submit(p_trp_tx);
-    switch (ret) {
-        /* 提交成功*/
-        case USB_OK:
-            /* 记录传输启动时间*/
-            usb_timespec_get(&p_net->trans_start_ts);
-            return USB_OK;
-        case -USB_EPIPE:
-            /* 发送停止事件*/
-            __net_event_set(p_net, USB_NET_EVENT_TX_HALT);
-            break;
-        default:
-            __USB_ERR_INFO("USB host net TX TRP submit failed(%d)\r\n", ret);
-            break;
+/**
+ * \brief USB 主机网络设备设置发送就绪回调函数，usbh_net_write() 返回 -USB_EAGAIN 后，
+ *        有发送请求包完成时调用(在传输完成回调的上下文中)
+ *
+ * \param[in] p_net         USB 主机网络设备
+ * \param[in] p_fn_tx_ready 发送就绪回调函数
+ * \param[in] p_arg         回调函数参数
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_tx_ready_cb_set(struct usbh_net *p_net,
+                             void           (*p_fn_tx_ready)(void *p_arg),
+                             void            *p_arg){
+    int ret = USB_OK;
+
+    if (p_net == NULL) {
+        return -USB_EINVAL;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_tx_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
     }
+#endif
+    p_net->p_tx_ready_arg = p_arg;
+    p_net->p_fn_tx_ready  = p_fn_tx_ready;
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_net->p_tx_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
     return ret;
 }
+
+/**
+ * \brief USB 主机网络设备设置发送积累超时时间，只对积累多个帧的驱动(NCM/RNDIS)有效
+ *
+ * \param[in] p_net      USB 主机网络设备
+ * \param[in] timeout_us 超时时间(微秒)，0 为不积累，每个帧单独发送
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_tx_timeout_set(struct usbh_net *p_net, uint32_t timeout_us){
+    int ret = USB_OK;
+
+    if (p_net == NULL) {
+        return -USB_EINVAL;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_tx_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    p_net->tx_timeout = timeout_us;
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_net->p_tx_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
 #endif
+    return ret;
+}
+
+/**
+ * \brief USB 主机网络设备获取发送积累超时时间
+ *
+ * \param[in]  p_net        USB 主机网络设备
+ * \param[out] p_timeout_us 返回的超时时间(微秒)
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_tx_timeout_get(struct usbh_net *p_net, uint32_t *p_timeout_us){
+    if ((p_net == NULL) || (p_timeout_us == NULL)) {
+        return -USB_EINVAL;
+    }
+    *p_timeout_us = p_net->tx_timeout;
+
+    return USB_OK;
+}
 
 /**
  * \brief USB 主机网络设备读函数
@@ -1290,10 +1825,11 @@ int usbh_net_write(struct usbh_net *p_net, uint8_t *p_buf, uint32_t buf_len){
 int usbh_net_read(struct usbh_net *p_net,
                   uint8_t         *p_buf,
                   uint32_t         buf_len){
+    int                       ret;
 #if USB_OS_EN
-    int      ret;
+    int                       ret_tmp;
 #endif
-    uint32_t len, len_act;
+    struct usbh_net_rx_frame *p_frame = NULL;
 
     if ((p_net == NULL) || (p_buf == NULL)) {
         return -USB_EINVAL;
@@ -1306,50 +1842,121 @@ int usbh_net_read(struct usbh_net *p_net,
         return ret;
     }
 #endif
-    if (p_net->rx_buf.rd_pos <= p_net->rx_buf.data_pos) {
-        len = p_net->rx_buf.data_pos - p_net->rx_buf.rd_pos;
-
-        if (len > buf_len) {
-            len = buf_len;
+    p_frame = p_net->p_rx_frame_pend;
+    if (p_frame == NULL) {
+        ret = __net_rx_frame_get(p_net, &p_frame);
+        if (ret != USB_OK) {
+            ret = 0;
+            goto __exit;
         }
-        memcpy(p_buf, p_net->rx_buf.p_buf + p_net->rx_buf.rd_pos, len);
-        len_act = len;
-    } else {
-        len = p_net->rx_buf.buf_size - p_net->rx_buf.rd_pos;
+    }
+    /* 不截断帧，读缓存不够时保留这个帧*/
+    if (p_frame->len > buf_len) {
+        p_net->p_rx_frame_pend = p_frame;
+        ret = -USB_ESIZE;
+        goto __exit;
+    }
+    p_net->p_rx_frame_pend = NULL;
 
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        memcpy(p_buf, p_net->rx_buf.p_buf + p_net->rx_buf.rd_pos, len);
-        len_act = len;
+    memcpy(p_buf, p_frame->p_data, p_frame->len);
+    ret = p_frame->len;
 
-        len = p_net->rx_buf.data_pos;
+    __net_rx_frame_put(p_net, p_frame);
+__exit:
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_net->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
 
-        if (len > (buf_len - len_act)) {
-            len = buf_len - len_act;
-        }
-        if (len > 0) {
-            memcpy(p_buf + len_act, p_net->rx_buf.p_buf, len);
-        }
-        len_act += len;
+/**
+ * \brief USB 主机网络设备获取一个接收帧，不拷贝数据，用完后必须调用
+ *        usbh_net_rx_frame_put() 归还
+ *
+ * \param[in]  p_net   USB 主机网络设备
+ * \param[out] p_frame 返回的接收帧
+ *
+ * \retval 成功返回 USB_OK，没有接收帧返回 -USB_EAGAIN
+ */
+int usbh_net_rx_frame_get(struct usbh_net           *p_net,
+                          struct usbh_net_rx_frame **p_frame){
+    int ret = USB_OK;
+#if USB_OS_EN
+    int ret_tmp;
+#endif
+
+    if ((p_net == NULL) || (p_frame == NULL)) {
+        return -USB_EINVAL;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
     }
-    p_net->rx_buf.rd_pos = p_net->rx_buf.rd_pos + len_act;
-    if (p_net->rx_buf.rd_pos >= p_net->rx_buf.buf_size) {
-        p_net->rx_buf.rd_pos -= p_net->rx_buf.buf_size;
+#endif
+    /* 先交出读函数保留的帧*/
+    if (p_net->p_rx_frame_pend) {
+        *p_frame = p_net->p_rx_frame_pend;
+        p_net->p_rx_frame_pend = NULL;
+    } else {
+        ret = __net_rx_frame_get(p_net, p_frame);
     }
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_net->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief USB 主机网络设备归还接收帧，帧所在的接收传输请求包的帧都归还后重新用于接收
+ *
+ * \param[in] p_net   USB 主机网络设备
+ * \param[in] p_frame 要归还的接收帧
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_net_rx_frame_put(struct usbh_net          *p_net,
+                          struct usbh_net_rx_frame *p_frame){
+    int ret = USB_OK;
+
+    if ((p_net == NULL) || (p_frame == NULL)) {
+        return -USB_EINVAL;
+    }
+    if ((p_frame < &p_net->rx_frames[0]) ||
+            (p_frame >= &p_net->rx_frames[USB_NET_RX_FRAME_MAX]) ||
+            (p_frame->p_net_trp == NULL)) {
+        return -USB_EILLEGAL;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_net->p_lock, USB_NET_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    __net_rx_frame_put(p_net, p_frame);
 #if USB_OS_EN
     ret = usb_mutex_unlock(p_net->p_lock);
     if (ret != USB_OK) {
         __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-        return ret;
     }
 #endif
-
-    return len_act;
+    return ret;
 }
 
 /**
- * \brief USB 主机网络设备接收缓存大小获取
+ * \brief USB 主机网络设备接收缓存大小获取，即每个接收帧缓存的大小
  *
  * \param[in]  p_net  USB 主机网络设备
  * \param[out] p_size 返回的缓存大小
@@ -1369,7 +1976,7 @@ int usbh_net_rx_buf_size_get(struct usbh_net *p_net, uint32_t *p_size){
         return ret;
     }
 #endif
-    *p_size = p_net->rx_buf.buf_size;
+    *p_size = p_net->rx_trp_size;
 #if USB_OS_EN
     ret = usb_mutex_unlock(p_net->p_lock);
     if (ret != USB_OK) {
@@ -1380,7 +1987,8 @@ int usbh_net_rx_buf_size_get(struct usbh_net *p_net, uint32_t *p_size){
 }
 
 /**
- * \brief USB 主机网络设备接收缓存大小获取
+ * \brief USB 主机网络设备接收缓存大小设置，即每个接收帧缓存的大小，
+ *        只能在设备停止时设置，且不能小于硬件最大传输单元
  *
  * \param[in] p_net USB 主机网络设备
  * \param[in] size  要设置的缓存大小
@@ -1396,6 +2004,9 @@ int usbh_net_rx_buf_size_set(struct usbh_net *p_net, uint32_t size){
     if ((p_net == NULL) || (size == 0)) {
         return -USB_EINVAL;
     }
+    if (size < p_net->hard_mtu) {
+        return -USB_EILLEGAL;
+    }
 #if USB_OS_EN
     ret = usb_mutex_lock(p_net->p_lock, USB_NET_LOCK_TIMEOUT);
     if (ret != USB_OK) {
@@ -1403,18 +2014,12 @@ int usbh_net_rx_buf_size_set(struct usbh_net *p_net, uint32_t size){
         return ret;
     }
 #endif
-    if (p_net->rx_buf.buf_size != size) {
-        if (p_net->rx_buf.p_buf != NULL) {
-            usb_lib_mfree(&__g_usbh_net_lib.lib, p_net->rx_buf.p_buf);
-            p_net->rx_buf.p_buf = usb_lib_malloc(&__g_usbh_net_lib.lib, size);
-            if (p_net->rx_buf.p_buf == NULL) {
-                ret = -USB_ENOMEM;
-                goto __exit;
-            }
-        }
-        p_net->rx_buf.buf_size = size;
+    /* 还有接收请求包(包括借出的帧)时不能修改*/
+    if ((p_net->is_started == USB_TRUE) || (p_net->rx_trp_hdr.n_trp_total != 0)) {
+        ret = -USB_EBUSY;
+    } else {
+        p_net->rx_trp_size = size;
     }
-__exit:
 #if USB_OS_EN
     ret_tmp = usb_mutex_unlock(p_net->p_lock);
     if (ret_tmp != USB_OK) {
@@ -1509,6 +2114,10 @@ int usbh_net_process(struct usbh_net *p_net){
         return -USB_EINVAL;
     }
 
+    /* 驱动积累的数据超时后发送*/
+    if (p_net->is_started) {
+        __net_tx_flush(p_net, USB_FALSE);
+    }
 #if USB_OS_EN
     ret = usb_mutex_lock(p_net->p_lock, USB_NET_LOCK_TIMEOUT);
     if (ret != USB_OK) {
@@ -11,6 +11,50 @@ extern struct usbh_vc_lib __g_uvc_lib;
 /*******************************************************************************
  * Code
  ******************************************************************************/
+/**
+ * \brief 锁住缓存队列
+ */
+static int __queue_lock(struct usbh_vc_queue *p_queue){
+#if USB_OS_EN
+    int ret = usb_mutex_lock(p_queue->p_lock, UVC_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief 解锁缓存队列
+ */
+static int __queue_unlock(struct usbh_vc_queue *p_queue){
+#if USB_OS_EN
+    int ret = usb_mutex_unlock(p_queue->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief 释放缓存链表里的所有缓存
+ */
+static void __queue_list_free(struct usb_list_head *p_list){
+    struct usbh_vc_buffer *p_buf = NULL;
+
+    while (!usb_list_head_is_empty(p_list)) {
+        p_buf = usb_container_of(p_list->p_next, struct usbh_vc_buffer, node);
+        usb_list_node_del(&p_buf->node);
+        usb_lib_mfree(&__g_uvc_lib.lib, p_buf->p_mem);
+        usb_lib_mfree(&__g_uvc_lib.lib, p_buf);
+    }
+}
+
 /**
  * \brief 获取可用的缓存队列
  *
@@ -57,6 +101,12 @@ int usbh_vc_queue_buf_alloc(struct usbh_vc_queue *p_queue,
         return -USB_EINVAL;
     }
 
+    p_queue->n_dropped = 0;
+#if USB_OS_EN
+    /* 清除上一次数据流遗留的信号量计数*/
+    while (usb_sem_take(p_queue->p_done_sem, USB_NO_WAIT) == USB_OK);
+#endif
+
     for (i = 0;i < n_buf; i++) {
     	p_buf = usb_lib_malloc(&__g_uvc_lib.lib, sizeof(struct usbh_vc_buffer));
         if (p_buf == NULL) {
@@ -87,35 +137,163 @@ int usbh_vc_queue_buf_alloc(struct usbh_vc_queue *p_queue,
  * \retval 成功返回 UBS_OK
  */
 int usbh_vc_queue_buf_free(struct usbh_vc_queue *p_queue){
-    struct usbh_vc_buffer *p_buf = NULL;
-    int                    ret   = USB_OK;
+    int ret;
 
     if (p_queue == NULL) {
         return -USB_EINVAL;
     }
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_queue->p_lock, UVC_LOCK_TIMEOUT);
+    ret = __queue_lock(p_queue);
     if (ret != USB_OK) {
-	    __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
         return ret;
     }
+    /* 删除队列缓存，用户持有的缓存也一起释放*/
+    __queue_list_free(&p_queue->irqqueue);
+    __queue_list_free(&p_queue->done_list);
+    __queue_list_free(&p_queue->user_list);
+
+    ret = __queue_unlock(p_queue);
+#if USB_OS_EN
+    /* 唤醒正在等待帧的用户*/
+    usb_sem_give(p_queue->p_done_sem);
 #endif
-    /* 删除队列缓存*/
-    while (!usb_list_head_is_empty(&p_queue->irqqueue)) {
-        p_buf = usb_container_of(p_queue->irqqueue.p_next, struct usbh_vc_buffer, node);
-        usb_list_node_del(&p_buf->node);
-        usb_lib_mfree(&__g_uvc_lib.lib, p_buf->p_mem);
-        usb_lib_mfree(&__g_uvc_lib.lib, p_buf);
+    return ret;
+}
+
+/**
+ * \brief USB 视频类队列取出一个已完成的缓存
+ *
+ * \param[in]  p_queue USB 视频类设备缓存队列
+ * \param[out] p_buf   返回取出的缓存
+ * \param[in]  timeout 等待超时时间(毫秒)，USB_NO_WAIT 不等待，USB_WAIT_FOREVER 一直等待
+ *
+ * \retval 成功返回 USB_OK，没有已完成的缓存返回 -USB_EAGAIN，等待超时返回 -USB_ETIME
+ */
+int usbh_vc_queue_buf_dequeue(struct usbh_vc_queue   *p_queue,
+                              struct usbh_vc_buffer **p_buf,
+                              int                     timeout){
+    struct usbh_vc_buffer *p_buf_tmp = NULL;
+    int                    ret;
+
+    if ((p_queue == NULL) || (p_buf == NULL)) {
+        return -USB_EINVAL;
     }
 #if USB_OS_EN
-    ret = usb_mutex_unlock(p_queue->p_lock);
+    /* 信号量计数和已完成帧数量一致，先等信号量再取帧*/
+    ret = usb_sem_take(p_queue->p_done_sem, timeout);
     if (ret != USB_OK) {
-	    __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+        return (timeout == USB_NO_WAIT) ? -USB_EAGAIN : ret;
     }
 #endif
+    while (1) {
+        ret = __queue_lock(p_queue);
+        if (ret != USB_OK) {
+            return ret;
+        }
+        if (!usb_list_head_is_empty(&p_queue->done_list)) {
+            p_buf_tmp = usb_container_of(p_queue->done_list.p_next, struct usbh_vc_buffer, node);
+            /* 移到用户持有链表*/
+            usb_list_node_move_tail(&p_buf_tmp->node, &p_queue->user_list);
+            p_buf_tmp->is_used = 1;
+        }
+        ret = __queue_unlock(p_queue);
+        if (ret != USB_OK) {
+            return ret;
+        }
+        if (p_buf_tmp != NULL) {
+            *p_buf = p_buf_tmp;
+            return USB_OK;
+        }
+#if USB_OS_EN
+        /* 被缓存释放唤醒，没有帧可取*/
+        return -USB_EAGAIN;
+#else
+        /* 没有操作系统，轮询等待*/
+        if (timeout == USB_NO_WAIT) {
+            return -USB_EAGAIN;
+        }
+        if (timeout > 0) {
+            timeout--;
+            if (timeout == 0) {
+                return -USB_ETIME;
+            }
+        }
+        usb_mdelay(1);
+#endif
+    }
+}
+
+/**
+ * \brief USB 视频类队列交还用户持有的缓存
+ *
+ * \param[in] p_queue USB 视频类设备缓存队列
+ * \param[in] p_buf   要交还的缓存
+ *
+ * \retval 成功返回 USB_OK，缓存不是这个队列里用户持有的缓存返回 -USB_EILLEGAL
+ */
+int usbh_vc_queue_buf_queue(struct usbh_vc_queue  *p_queue,
+                            struct usbh_vc_buffer *p_buf){
+    int                   ret, ret_tmp;
+    struct usb_list_node *p_node = NULL;
+
+    if ((p_queue == NULL) || (p_buf == NULL)) {
+        return -USB_EINVAL;
+    }
+    ret = __queue_lock(p_queue);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    /* 先确认缓存在这个队列的用户链表上再访问，停止数据流后缓存已经释放，其他数据流的
+     * 缓存也不能放进这个队列*/
+    usb_list_for_each_node(p_node, &p_queue->user_list) {
+        if (p_node == &p_buf->node) {
+            break;
+        }
+    }
+    if ((p_node == (struct usb_list_node *)&p_queue->user_list) || (p_buf->is_used == 0)) {
+        ret = -USB_EILLEGAL;
+        goto __exit;
+    }
+    /* 重置缓存状态，放回中断队列链表等待填充*/
+    p_buf->bytes_used = 0;
+    p_buf->error_no   = 0;
+    p_buf->state      = UVC_BUF_STATE_QUEUED;
+    p_buf->is_used    = 0;
+    usb_list_node_move_tail(&p_buf->node, &p_queue->irqqueue);
+__exit:
+    ret_tmp = __queue_unlock(p_queue);
+    if (ret_tmp != USB_OK) {
+        return ret_tmp;
+    }
     return ret;
 }
 
+/**
+ * \brief USB 视频类队列根据数据地址查找用户持有的缓存
+ *
+ * \param[in] p_queue USB 视频类设备缓存队列
+ * \param[in] p_mem   缓存数据地址
+ *
+ * \retval 成功返回找到的缓存，失败返回 NULL
+ */
+struct usbh_vc_buffer *usbh_vc_queue_user_buf_find(struct usbh_vc_queue *p_queue,
+                                                   void                 *p_mem){
+    struct usb_list_node  *p_node = NULL;
+    struct usbh_vc_buffer *p_buf  = NULL;
+
+    if ((p_queue == NULL) || (__queue_lock(p_queue) != USB_OK)) {
+        return NULL;
+    }
+    usb_list_for_each_node(p_node, &p_queue->user_list) {
+        if (usb_container_of(p_node, struct usbh_vc_buffer, node)->p_mem == p_mem) {
+            p_buf = usb_container_of(p_node, struct usbh_vc_buffer, node);
+            break;
+        }
+    }
+    __queue_unlock(p_queue);
+
+    return p_buf;
+}
+
 /**
  * \brief 创建 USB 视频类驱动缓存队列
  *
@@ -148,8 +326,16 @@ int usbh_vc_queue_create(uint8_t                n_stream_max,
         	ret = -USB_EPERM;
             goto __failed;
         }
+    	p_queue_tmp[i].p_done_sem = usb_lib_sem_create(&__g_uvc_lib.lib);
+        if (p_queue_tmp[i].p_done_sem == NULL) {
+        	__USB_ERR_TRACE(SemCreateErr, "\r\n");
+        	ret = -USB_EPERM;
+            goto __failed;
+        }
 #endif
         usb_list_head_init(&p_queue_tmp[i].irqqueue);
+        usb_list_head_init(&p_queue_tmp[i].done_list);
+        usb_list_head_init(&p_queue_tmp[i].user_list);
         p_queue_tmp->flags = UVC_QUEUE_DROP_CORRUPTED;
     }
 
@@ -187,6 +373,13 @@ int usbh_vc_queue_destory(struct usbh_vc_queue *p_queue, uint8_t n_stream_max){
                 return ret;
             }
         }
+        if (p_queue[i].p_done_sem) {
+            ret = usb_lib_sem_destroy(&__g_uvc_lib.lib, p_queue[i].p_done_sem);
+            if (ret != USB_OK) {
+                __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret);
+                return ret;
+            }
+        }
 #endif
     }
     usb_lib_mfree(&__g_uvc_lib.lib, p_queue);
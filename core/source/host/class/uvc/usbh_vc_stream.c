@@ -27,6 +27,11 @@ extern int usbh_vc_video_buf_get(uint32_t             **p_buf,
                                  struct uvc_timeval    *p_timeval);
 extern int usbh_vc_video_buf_put(uint8_t               *p_buf,
                                  struct usbh_vc_stream *p_stream);
+extern int usbh_vc_video_frame_dequeue(struct usbh_vc_stream *p_stream,
+                                       struct usbh_vc_frame  *p_frame,
+                                       int                    timeout);
+extern int usbh_vc_video_frame_queue(struct usbh_vc_stream *p_stream,
+                                     struct usbh_vc_frame  *p_frame);
 
 /*******************************************************************************
  * Static
@@ -1723,6 +1728,55 @@ int usbh_vc_stream_video_put(struct usbh_vc_stream *p_stream, void* p_buf){
     return ret;
 }
 
+/**
+ * \brief USB 视频类设备数据流取出一帧视频
+ *
+ *        帧数据直接指向驱动缓存，不做拷贝。用户可以同时持有多帧，用完后必须调用
+ *        usbh_vc_stream_frame_queue 交还，否则驱动没有缓存可填充，后续帧会被丢弃并计入
+ *        丢帧数量。停止数据流后，所有用户持有的帧都失效。
+ *
+ * \param[in]  p_stream USB 视频类数据流
+ * \param[out] p_frame  返回的视频帧
+ * \param[in]  timeout  等待超时时间(毫秒)，USB_NO_WAIT 不等待，USB_WAIT_FOREVER 一直等待
+ *
+ * \retval 成功返回 USB_OK，没有帧返回 -USB_EAGAIN，等待超时返回 -USB_ETIME
+ */
+int usbh_vc_stream_frame_dequeue(struct usbh_vc_stream *p_stream,
+                                 struct usbh_vc_frame  *p_frame,
+                                 int                    timeout){
+    if ((p_stream == NULL) || (p_frame == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (p_stream->p_vc->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+    /* 不是在启动阶段*/
+    if (p_stream->opt_status != UVC_STREAM_START) {
+        return -USB_EPERM;
+    }
+    /* 等待期间不能持有数据流锁，传输完成回调需要数据流锁来填充缓存*/
+    return usbh_vc_video_frame_dequeue(p_stream, p_frame, timeout);
+}
+
+/**
+ * \brief USB 视频类设备数据流交还一帧视频
+ *
+ * \param[in] p_stream USB 视频类数据流
+ * \param[in] p_frame  之前通过 usbh_vc_stream_frame_dequeue 取出的视频帧
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_vc_stream_frame_queue(struct usbh_vc_stream *p_stream,
+                               struct usbh_vc_frame  *p_frame){
+    if ((p_stream == NULL) || (p_frame == NULL)) {
+        return -USB_EINVAL;
+    }
+    if (p_stream->p_vc->is_removed == USB_TRUE) {
+        return -USB_ENODEV;
+    }
+    return usbh_vc_video_frame_queue(p_stream, p_frame);
+}
+
 /**
  * \brief 取消视频流传输
  */
@@ -1835,7 +1889,6 @@ int usbh_vc_stream_xfer_cancel(struct usbh_vc_stream *p_stream){
  * \brief 释放 USB 摄像头流
  */
 static int __vc_stream_free(struct usbh_vc_stream *p_stream){
-    struct usbh_vc_buffer *p_buf_tmp = NULL;
     struct usbh_vc_queue  *p_queue   = NULL;
     int                    ret;
 
@@ -1860,27 +1913,11 @@ static int __vc_stream_free(struct usbh_vc_stream *p_stream){
     if (p_queue == NULL) {
         goto __queue_end;
     }
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_queue->p_lock, UVC_LOCK_TIMEOUT);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
-    }
-#endif
     /* 释放图片数据缓存*/
-    while (!usb_list_head_is_empty(&p_queue->irqqueue)) {
-        p_buf_tmp = usb_container_of(p_queue->irqqueue.p_next, struct usbh_vc_buffer, node);
-        usb_lib_mfree(&__g_uvc_lib.lib, p_buf_tmp->p_mem);
-        usb_list_node_del(&p_buf_tmp->node);
-        usb_lib_mfree(&__g_uvc_lib.lib, p_buf_tmp);
-    }
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_queue->p_lock);
+    ret = usbh_vc_queue_buf_free(p_queue);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
         return ret;
     }
-#endif
     p_queue->is_used = USB_FALSE;
 
 __queue_end:
@@ -36,6 +36,8 @@ static void __vc_video_buffer_validate(struct usbh_vc_stream *p_stream,
 
 /**
  * \brief 获取缓存队列中下一个可用缓存
+ *
+ *        完成的帧移到已完成帧链表等待用户取出，中断队列链表为空时返回空，解码器会丢弃后续帧并计数。
  */
 static struct usbh_vc_buffer *__vc_queue_next_buffer(struct usbh_vc_queue  *p_queue,
                                                      struct usbh_vc_buffer *p_buf){
@@ -45,6 +47,7 @@ static struct usbh_vc_buffer *__vc_queue_next_buffer(struct usbh_vc_queue  *p_qu
     struct usbh_vc_buffer *p_buf_next = NULL;
 
     if ((p_queue->flags & UVC_QUEUE_DROP_CORRUPTED) && (p_buf->error_no)) {
+        p_queue->n_dropped++;
         p_buf->error_no   = 0;
         p_buf->state      = UVC_BUF_STATE_QUEUED;
         p_buf->bytes_used = 0;
@@ -53,35 +56,35 @@ static struct usbh_vc_buffer *__vc_queue_next_buffer(struct usbh_vc_queue  *p_qu
 
     p_buf->state = p_buf->error_no ? UVC_BUF_STATE_ERROR : UVC_BUF_STATE_DONE;
     if (p_buf->state != UVC_BUF_STATE_DONE) {
+        p_queue->n_dropped++;
         p_buf->error_no   = 0;
         p_buf->state      = UVC_BUF_STATE_QUEUED;
         p_buf->bytes_used = 0;
         return p_buf;
-    } else {
-#if USB_OS_EN
-        ret = usb_mutex_lock(p_queue->p_lock, UVC_LOCK_TIMEOUT);
-        if (ret != USB_OK) {
-            __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-            return NULL;
-        }
-#endif
-        usb_list_node_move_tail(&p_buf->node, &p_queue->irqqueue);
-        if (!usb_list_head_is_empty(&p_queue->irqqueue)) {
-            p_buf_next = usb_container_of(p_queue->irqqueue.p_next, struct usbh_vc_buffer, node);
-        } else {
-            p_buf_next = NULL;
-        }
+    }
 #if USB_OS_EN
-        ret = usb_mutex_unlock(p_queue->p_lock);
-    	if (ret != USB_OK) {
-        	__USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-        	return NULL;
-    	}
+    ret = usb_mutex_lock(p_queue->p_lock, UVC_LOCK_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return NULL;
+    }
 #endif
+    usb_list_node_move_tail(&p_buf->node, &p_queue->done_list);
+    if (!usb_list_head_is_empty(&p_queue->irqqueue)) {
+        p_buf_next = usb_container_of(p_queue->irqqueue.p_next, struct usbh_vc_buffer, node);
+
         p_buf_next->error_no   = 0;
         p_buf_next->bytes_used = 0;
         p_buf_next->state      = UVC_BUF_STATE_QUEUED;
     }
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_queue->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    /* 唤醒等待帧的用户*/
+    usb_sem_give(p_queue->p_done_sem);
+#endif
     return p_buf_next;
 }
 
@@ -461,6 +464,10 @@ static int __vc_video_decode_start(struct usbh_vc_stream *p_stream,
 
     /* 存储有效负载的 FID 位和当缓存是空的则马上返回*/
     if (p_buf == NULL) {
+        /* 新帧开始但是没有可用缓存，这一帧被丢弃*/
+        if ((p_stream->last_fid != fid) && (p_stream->p_queue != NULL)) {
+            ((struct usbh_vc_queue *)p_stream->p_queue)->n_dropped++;
+        }
         p_stream->last_fid = fid;
         return -USB_EDATA;
     }
@@ -491,7 +498,8 @@ static int __vc_video_decode_start(struct usbh_vc_stream *p_stream,
         p_buf->timeval.ts_usec = ts.ts_nsec / 1000L;
 
         /* TODO: 处理PTS和SCR*/
-        p_buf->state = UVC_BUF_STATE_ACTIVE;
+        p_buf->sequence = p_stream->sequence;
+        p_buf->state    = UVC_BUF_STATE_ACTIVE;
     }
     /* 如果我们在下一个新帧的开始处，则将缓冲区标记为已完成。通过检查 EOF 位(与 EOF 位相比，FID 位切换延迟一帧)
      * 可以更好地实现帧尾检测，但有些设备不会在帧尾设置位(最后一个有效负载可能会丢失)。
@@ -638,11 +646,76 @@ static void __vc_video_bulk_encode(struct usbh_trp       *p_trp,
 
 /**
  * \brief USB 视频类视频批量解码
+ *
+ *        批量端点的一个负载可以跨多个传输请求包，只有第一个请求包以负载头开始。负载以短包结束，
+ *        或者在数据量达到 dwMaxPayloadTransferSize 时结束。负载头保存在 bulk.header 里，
+ *        负载结束时再用它处理 EOF 标志。
  */
 static void __vc_video_bulk_decode(struct usbh_trp       *p_trp,
                                    struct usbh_vc_stream *p_stream,
                                    struct usbh_vc_buffer *p_buf){
-//todo
+    uint8_t              *p_mem   = NULL;
+    int                   len, ret;
+    struct usbh_vc_queue *p_queue = NULL;
+
+    /* 获取队列*/
+    p_queue = (struct usbh_vc_queue *)(p_stream->p_queue);
+    if (p_queue == NULL) {
+        return;
+    }
+    /* 不在负载中间的空包，忽略*/
+    if ((p_trp->act_len == 0) && (p_stream->bulk.header_size == 0)) {
+        return;
+    }
+
+    p_mem = p_trp->p_data;
+    len   = p_trp->act_len;
+    p_stream->bulk.payload_size += len;
+
+    /* 新负载的开始，解码负载头*/
+    if ((p_stream->bulk.header_size == 0) && (!p_stream->bulk.skip_payload)) {
+        do {
+            ret = __vc_video_decode_start(p_stream, p_buf, p_mem, len);
+            if (ret == -USB_EAGAIN) {
+                __vc_video_buffer_validate(p_stream, p_buf);
+                p_buf = __vc_queue_next_buffer(p_queue, p_buf);
+            }
+        } while (ret == -USB_EAGAIN);
+
+        /* 负载头错误或者没有可用缓存，丢弃整个负载*/
+        if ((ret < 0) || (p_buf == NULL)) {
+            p_stream->bulk.skip_payload = 1;
+        } else {
+            memcpy(p_stream->bulk.header, p_mem, ret);
+            p_stream->bulk.header_size = ret;
+
+            p_mem += ret;
+            len   -= ret;
+        }
+    }
+
+    /* 解码负载数据，不管是负载的第一个请求包还是后续请求包*/
+    if ((!p_stream->bulk.skip_payload) && (p_buf != NULL)) {
+        __vc_video_data_decode(p_stream, p_buf, p_mem, len);
+    }
+
+    /* 短包或者达到最大负载大小，当前负载结束*/
+    if ((p_trp->act_len < p_trp->len) ||
+            (p_stream->bulk.payload_size >= p_stream->bulk.max_payload_size)) {
+        if ((!p_stream->bulk.skip_payload) && (p_buf != NULL)) {
+            __vc_video_decode_end(p_stream,
+                                  p_buf,
+                                  p_stream->bulk.header,
+                                  p_stream->bulk.payload_size);
+            if (p_buf->state == UVC_BUF_STATE_READY) {
+                __vc_video_buffer_validate(p_stream, p_buf);
+                __vc_queue_next_buffer(p_queue, p_buf);
+            }
+        }
+        p_stream->bulk.header_size  = 0;
+        p_stream->bulk.skip_payload = 0;
+        p_stream->bulk.payload_size = 0;
+    }
 }
 
 /**
@@ -821,6 +894,7 @@ static void __vc_trp_buffers_free(struct usbh_vc_stream *p_stream);
 static int __vc_trp_buffers_alloc(struct usbh_vc_stream *p_stream,
                                   uint32_t               size,
                                   uint32_t               psize,
+                                  uint32_t               max_packets,
                                   uint8_t                n_trp){
     uint32_t n_packets;
     uint32_t i;
@@ -832,12 +906,12 @@ static int __vc_trp_buffers_alloc(struct usbh_vc_stream *p_stream,
     /* 计算数据包的数量。批量端点可能会跨多个多个USB请求块传输UVC负载*/
     /* 以端点最大包大小为倍数，得出需要多少个包*/
     n_packets = USB_DIV_ROUND_UP(size, psize);
-    if (n_packets > UVC_MAX_PACKETS) {
-        n_packets = UVC_MAX_PACKETS;
+    if (n_packets > max_packets) {
+        n_packets = max_packets;
     }
 
     /* 重试分配直到一次成功*/
-    for (; n_packets > 1; n_packets /= 2) {
+    for (; n_packets > 0; n_packets /= 2) {
         for (i = 0; i < n_trp; ++i) {
             p_stream->trp_size = psize * n_packets;
             p_stream->p_trp_buffer[i] = usb_lib_malloc(&__g_uvc_lib.lib, p_stream->trp_size);
@@ -944,17 +1018,10 @@ static void __vc_video_complete(void *p_arg){
         goto __exit;
     }
 #endif
-    for (i = 0; i < p_queue->n_bufs_total; i++) {
-        /* 检查队列的中断队列链表是否为空*/
-        if (!usb_list_head_is_empty(&p_queue->irqqueue)) {
-            /* 获取中断队列链表第一个成员*/
-            p_buf = usb_container_of(p_queue->irqqueue.p_next, struct usbh_vc_buffer, node);
-            /* 如果拿到的缓存被使用中，把它移到队尾*/
-            if (p_buf->is_used == 0) {
-                break;
-            }
-            usb_list_node_move_tail(&p_buf->node, &p_queue->irqqueue);
-        }
+    /* 中断队列链表的第一个缓存就是正在填充的缓存，链表为空说明缓存都在等待用户取出或者被用户持有，
+     * 用空缓存解码，解码器会丢弃数据并计数*/
+    if (!usb_list_head_is_empty(&p_queue->irqqueue)) {
+        p_buf = usb_container_of(p_queue->irqqueue.p_next, struct usbh_vc_buffer, node);
     }
 #if USB_OS_EN
     ret = usb_mutex_unlock(p_queue->p_lock);
@@ -963,20 +1030,9 @@ static void __vc_video_complete(void *p_arg){
         goto __exit;
     }
 #endif
-    if (i == 3) {
-        goto __resubmit;
-    }
-
-    /* 如果拿到的缓存里有完整的图像数据，重置缓存状态*/
-    if (p_buf->state == UVC_BUF_STATE_DONE) {
-        p_buf->bytes_used = 0;
-        p_buf->error_no   = 0;
-        p_buf->state      = UVC_BUF_STATE_IDLE;
-    }
-
     /* 进行数据解码*/
     p_stream->p_fn_decode(p_trp, p_stream, p_buf);
-__resubmit:
+
     /* 再次提交 USB 请求包*/
     for (i = 0; i < 5; i++) {
         ret = usbh_trp_submit(p_trp);
@@ -997,6 +1053,28 @@ __exit:
     return;
 }
 
+/**
+ * \brief 申请传输请求包和传输缓存指针数组
+ */
+static int __vc_trp_array_alloc(struct usbh_vc_stream *p_stream, uint8_t n_trp){
+    if (p_stream->p_trp == NULL) {
+        p_stream->p_trp = usb_lib_malloc(&__g_uvc_lib.lib, sizeof(void *) * n_trp);
+        if (p_stream->p_trp == NULL) {
+            return -USB_ENOMEM;
+        }
+        memset(p_stream->p_trp, 0, sizeof(void *) * n_trp);
+    }
+
+    if (p_stream->p_trp_buffer == NULL) {
+        p_stream->p_trp_buffer = usb_lib_malloc(&__g_uvc_lib.lib, sizeof(void *) * n_trp);
+        if (p_stream->p_trp_buffer  == NULL) {
+            return -USB_ENOMEM;
+        }
+        memset(p_stream->p_trp_buffer, 0, sizeof(void *) * n_trp);
+    }
+    return USB_OK;
+}
+
 /**
  * \brief 初始化等时 USB 请求包并且分配传输缓存。最大包大小由端点提供
  */
@@ -1009,6 +1087,7 @@ static int __vc_video_isoc_init(struct usbh_vc_stream *p_stream,
     uint32_t              n_packets, i, j;
     uint16_t              psize;
     uint32_t              size;
+    int                   ret;
     struct usbh_vc       *p_vc     = p_stream->p_vc;
 
     /* 获取端点地址*/
@@ -1019,27 +1098,16 @@ static int __vc_video_isoc_init(struct usbh_vc_stream *p_stream,
     } else {
     	p_ep_tmp = p_ep->p_usb_dev->p_ep_out[ep_num];
     }
-    if (p_stream->p_trp == NULL) {
-    	p_stream->p_trp = usb_lib_malloc(&__g_uvc_lib.lib, sizeof(void *) * n_trp);
-        if (p_stream->p_trp == NULL) {
-            return -USB_ENOMEM;
-        }
-        memset(p_stream->p_trp, 0, sizeof(void *) * n_trp);
-    }
-
-    if (p_stream->p_trp_buffer == NULL) {
-    	p_stream->p_trp_buffer = usb_lib_malloc(&__g_uvc_lib.lib, sizeof(void *) * n_trp);
-        if (p_stream->p_trp_buffer  == NULL) {
-            return -USB_ENOMEM;
-        }
-        memset(p_stream->p_trp_buffer, 0, sizeof(void *) * n_trp);
+    ret = __vc_trp_array_alloc(p_stream, n_trp);
+    if (ret != USB_OK) {
+        return ret;
     }
 
     /* 获取端点最大包大小*/
     psize = __vc_endpoint_max_bpi(p_vc->p_ufun->p_usb_dev, p_ep);
     size = p_stream->ctrl.max_video_frame_size;
 
-    n_packets = __vc_trp_buffers_alloc(p_stream, size, psize, n_trp);
+    n_packets = __vc_trp_buffers_alloc(p_stream, size, psize, UVC_MAX_PACKETS, n_trp);
     if (n_packets == 0) {
         return -USB_ENOMEM;
     }
@@ -1076,11 +1144,65 @@ static int __vc_video_isoc_init(struct usbh_vc_stream *p_stream,
 }
 
 /**
- * \brief 初始化批量 USB 请求包
+ * \brief 初始化批量 USB 请求包并且分配传输缓存。请求包大小按 dwMaxPayloadTransferSize 分配，
+ *        一个负载尽量在一个请求包里完成，超出 UVC_MAX_BULK_PACKETS 的负载跨多个请求包传输
  */
 static int __vc_video_bulk_init(struct usbh_vc_stream *p_stream,
-                                struct usbh_endpoint  *p_ep){
-    return 0;
+                                struct usbh_endpoint  *p_ep,
+                                uint8_t                n_trp){
+    struct usbh_trp *p_trp = NULL;
+    uint32_t         n_packets, i;
+    uint16_t         psize;
+    uint32_t         size;
+    int              ret;
+
+    /* 批量端点没有带宽预留，多提交一些请求包保持端点上一直有请求*/
+    if (n_trp < UVC_BULK_TRP_NUM) {
+        n_trp = UVC_BULK_TRP_NUM;
+    }
+    ret = __vc_trp_array_alloc(p_stream, n_trp);
+    if (ret != USB_OK) {
+        return ret;
+    }
+
+    /* 获取端点最大包大小*/
+    psize = USBH_EP_MPS_GET(p_ep) & 0x07ff;
+    if (psize == 0) {
+        return -USB_EILLEGAL;
+    }
+    size = p_stream->ctrl.max_payload_transfer_size;
+    if (size == 0) {
+        size = p_stream->ctrl.max_video_frame_size;
+    }
+    p_stream->bulk.max_payload_size = size;
+
+    n_packets = __vc_trp_buffers_alloc(p_stream, size, psize, UVC_MAX_BULK_PACKETS, n_trp);
+    if (n_packets == 0) {
+        return -USB_ENOMEM;
+    }
+    /* 计算总大小*/
+    size = n_packets * psize;
+
+    for (i = 0; i < n_trp; ++i) {
+        p_trp = __vc_trp_alloc(0);
+        if (p_trp == NULL) {
+            return -USB_ENOMEM;
+        }
+        p_trp->p_usr_priv = p_stream;
+        p_trp->p_ep       = p_ep;
+        p_trp->flag       = 0;
+        /* 传输完成回调函数*/
+        p_trp->p_fn_done  = __vc_video_complete;
+        p_trp->p_arg      = p_trp;
+        p_trp->p_data     = p_stream->p_trp_buffer[i];
+        p_trp->len        = size;
+
+        p_stream->p_trp[i] = p_trp;
+    }
+
+    p_stream->n_trp = n_trp;
+
+    return USB_OK;
 }
 
 /**
@@ -1224,6 +1346,7 @@ static int __vc_video_start(struct usbh_vc_stream *p_stream, uint8_t n_trp){
             goto __failed;
         }
     } else {
+        ret = -USB_ENODEV;
         /* 遍历设备结构体视频流链表*/
         usb_list_for_each_node_safe(p_node,
                                     p_node_tmp,
@@ -1232,12 +1355,15 @@ static int __vc_video_start(struct usbh_vc_stream *p_stream, uint8_t n_trp){
 
             /* 批量端点，处理传输块初始化*/
             ret = usbh_intf_ep_get(p_alts, p_stream->header.endpoint_address, &p_ep);
+            if (ret == USB_OK) {
+                break;
+            }
         }
         if (ret != USB_OK) {
             return ret;
         }
         /* 初始化 USB 视频类视频批量传输*/
-        ret = __vc_video_bulk_init(p_stream, p_ep);
+        ret = __vc_video_bulk_init(p_stream, p_ep, n_trp);
         if (ret != USB_OK) {
             goto __failed;
         }
@@ -1555,76 +1681,101 @@ __done:
 }
 
 /**
- * \brief 获取视频缓存
+ * \brief 取出一帧视频
  *
- * \param[out] p_buf     返回的一帧视频缓存地址
- * \param[in]  p_stream  视频数据流
- * \param[in]  p_timeval 时间戳
+ * \param[in]  p_stream 视频数据流
+ * \param[out] p_frame  返回的视频帧
+ * \param[in]  timeout  等待超时时间(毫秒)
  *
  * \retval 成功返回 USB_OK
  */
-int usbh_vc_video_buf_get(uint32_t             **p_buf,
-                          struct usbh_vc_stream *p_stream,
-                          struct uvc_timeval    *p_timeval){
-    struct usb_list_node  *p_node     = NULL;
-    struct usb_list_node  *p_node_tmp = NULL;
-    struct usbh_vc_buffer *p_vc_buf   = NULL;
-#if USB_OS_EN
+int usbh_vc_video_frame_dequeue(struct usbh_vc_stream *p_stream,
+                                struct usbh_vc_frame  *p_frame,
+                                int                    timeout){
+    struct usbh_vc_buffer *p_vc_buf = NULL;
+    struct usbh_vc_queue  *p_queue  = NULL;
     int                    ret;
-#endif
-    struct usbh_vc_queue  *p_queue    = NULL;
 
-    if (p_stream == NULL) {
+    if ((p_stream == NULL) || (p_frame == NULL)) {
         return -USB_EINVAL;
     }
     p_queue = (struct usbh_vc_queue *)p_stream->p_queue;
     if (p_queue == NULL) {
         return -USB_EILLEGAL;
     }
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_queue->p_lock, UVC_LOCK_TIMEOUT);
+
+    ret = usbh_vc_queue_buf_dequeue(p_queue, &p_vc_buf, timeout);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
         return ret;
     }
-#endif
-    /* 遍历缓存队列，找出已完成的缓存*/
-    usb_list_for_each_node_safe(p_node,
-                                p_node_tmp,
-                               &p_queue->irqqueue){
-        p_vc_buf = usb_container_of(p_node, struct usbh_vc_buffer, node);
-
-        if (p_vc_buf->state == UVC_BUF_STATE_DONE) {
-            /* 设置缓存使用标志*/
-            p_vc_buf->is_used = 1;
-            /* 获取缓存的数据*/
-            *p_buf = (uint32_t *)(p_vc_buf->p_mem);
-            if (p_timeval != NULL) {
-                p_timeval->ts_sec  = p_vc_buf->timeval.ts_sec;
-                p_timeval->ts_usec = p_vc_buf->timeval.ts_usec;
-            }
-#if USB_OS_EN
-            ret = usb_mutex_unlock(p_queue->p_lock);
-            if (ret != USB_OK) {
-                __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-                return ret;
-            }
-#endif
-            /* 保存正在用的缓存地址*/
-            p_stream->p_buf_tmp = p_vc_buf;
-            return USB_OK;
-        }
+
+    p_frame->p_mem           = p_vc_buf->p_mem;
+    p_frame->bytes_used      = p_vc_buf->bytes_used;
+    p_frame->sequence        = p_vc_buf->sequence;
+    p_frame->n_dropped       = p_queue->n_dropped;
+    p_frame->timeval.ts_sec  = p_vc_buf->timeval.ts_sec;
+    p_frame->timeval.ts_usec = p_vc_buf->timeval.ts_usec;
+    p_frame->p_priv          = p_vc_buf;
+
+    return USB_OK;
+}
+
+/**
+ * \brief 交还一帧视频
+ *
+ * \param[in] p_stream 视频数据流
+ * \param[in] p_frame  之前取出的视频帧
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_vc_video_frame_queue(struct usbh_vc_stream *p_stream,
+                              struct usbh_vc_frame  *p_frame){
+    int ret;
+
+    if ((p_stream == NULL) || (p_frame == NULL) || (p_frame->p_priv == NULL)) {
+        return -USB_EINVAL;
     }
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_queue->p_lock);
+    if (p_stream->p_queue == NULL) {
+        return -USB_EILLEGAL;
+    }
+
+    ret = usbh_vc_queue_buf_queue(p_stream->p_queue, p_frame->p_priv);
+    if (ret == USB_OK) {
+        p_frame->p_priv = NULL;
+    }
+    return ret;
+}
+
+/**
+ * \brief 获取视频缓存
+ *
+ * \param[out] p_buf     返回的一帧视频缓存地址
+ * \param[in]  p_stream  视频数据流
+ * \param[in]  p_timeval 时间戳
+ *
+ * \retval 成功返回 USB_OK，没有已完成的帧返回 -USB_EPERM
+ */
+int usbh_vc_video_buf_get(uint32_t             **p_buf,
+                          struct usbh_vc_stream *p_stream,
+                          struct uvc_timeval    *p_timeval){
+    struct usbh_vc_frame frame;
+    int                  ret;
+
+    if ((p_stream == NULL) || (p_buf == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    ret = usbh_vc_video_frame_dequeue(p_stream, &frame, USB_NO_WAIT);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-        return ret;
+        return (ret == -USB_EAGAIN) ? -USB_EPERM : ret;
     }
-#endif
 
-    p_stream->p_buf_tmp = NULL;
-    return -USB_EPERM;
+    *p_buf = (uint32_t *)frame.p_mem;
+    if (p_timeval != NULL) {
+        p_timeval->ts_sec  = frame.timeval.ts_sec;
+        p_timeval->ts_usec = frame.timeval.ts_usec;
+    }
+    return USB_OK;
 }
 
 /**
@@ -1637,12 +1788,10 @@ int usbh_vc_video_buf_get(uint32_t             **p_buf,
  */
 int usbh_vc_video_buf_put(uint8_t               *p_buf,
                           struct usbh_vc_stream *p_stream){
-#if USB_OS_EN
-    int                   ret;
-#endif
-    struct usbh_vc_queue *p_queue = NULL;
+    struct usbh_vc_buffer *p_vc_buf = NULL;
+    struct usbh_vc_queue  *p_queue  = NULL;
 
-    if (p_stream == NULL) {
+    if ((p_stream == NULL) || (p_buf == NULL)) {
         return -USB_EINVAL;
     }
 
@@ -1650,31 +1799,10 @@ int usbh_vc_video_buf_put(uint8_t               *p_buf,
     if (p_queue == NULL) {
         return -USB_EILLEGAL;
     }
-
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_queue->p_lock, UVC_LOCK_TIMEOUT);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
-    }
-#endif
-
-    if (p_stream->p_buf_tmp) {
-        struct usbh_vc_buffer *p_buf = (struct usbh_vc_buffer *)p_stream->p_buf_tmp;
-        /* 重置缓存状态*/
-        p_buf->bytes_used   = 0;
-        p_buf->error_no     = 0;
-        p_buf->state        = UVC_BUF_STATE_QUEUED;
-        p_buf->is_used      = 0;
-        p_stream->p_buf_tmp = NULL;
-    }
-
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_queue->p_lock);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-        return ret;
+    /* 根据数据地址找到用户持有的缓存*/
+    p_vc_buf = usbh_vc_queue_user_buf_find(p_queue, p_buf);
+    if (p_vc_buf == NULL) {
+        return -USB_EILLEGAL;
     }
-#endif
-    return USB_OK;
+    return usbh_vc_queue_buf_queue(p_queue, p_vc_buf);
 }
@@ -56,6 +56,8 @@ extern int usbh_ehci_async_unlink(struct usbh_ehci    *p_ehci,
 extern void usbh_ehci_async_link(struct usbh_ehci     *p_ehci,
                                  struct usbh_ehci_qh  *p_qh,
                                  struct usb_list_head *p_qtds);
+extern void usbh_ehci_qtds_splice(struct usb_list_head *p_qtds,
+                                  struct usb_list_head *p_qtds_all);
 extern int usbh_ehci_qh_handle(struct usbh_ehci    *p_ehci,
                                struct usbh_ehci_qh *p_qh);
 extern int usbh_ehci_intr_req(struct usbh_ehci     *p_ehci,
@@ -118,7 +120,8 @@ static int __evt_take(struct usbh_ehci *p_ehci,
 #endif
 
 /**
- * \brief 初始化主机控制器私有数据域
+ * \brief 初始化主机控制器私有数据域(同步传输完成对象由 USB 主机设备库的对象池提供，
+ *        端点不再需要私有信号量)
  */
 int usbh_ep_hcpriv_init(struct usbh_endpoint *p_ep){
     if (p_ep == NULL) {
@@ -127,14 +130,6 @@ int usbh_ep_hcpriv_init(struct usbh_endpoint *p_ep){
     if (p_ep->p_hc_priv != NULL) {
         return -USB_EILLEGAL;
     }
-
-#if USB_OS_EN
-    p_ep->p_hc_priv = usb_lib_sem_create(&__g_usb_host_lib.lib);
-    if (p_ep->p_hc_priv == NULL) {
-        __USB_ERR_TRACE(SemTakeErr, "\r\n");
-        return -USB_EPERM;
-    }
-#endif
     return USB_OK;
 }
 
@@ -142,71 +137,111 @@ int usbh_ep_hcpriv_init(struct usbh_endpoint *p_ep){
  * \brief 反初始化主机控制器私有数据域
  */
 int usbh_ep_hcpriv_deinit(struct usbh_endpoint *p_ep){
-    int ret = USB_OK;
-
     if (p_ep == NULL) {
         return -USB_EINVAL;
     }
-
-    if (p_ep->p_hc_priv == NULL) {
-        return USB_OK;
-    }
-#if USB_OS_EN
-    ret = usb_lib_sem_destroy(&__g_usb_host_lib.lib, p_ep->p_hc_priv);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret);
-    }
-#endif
     p_ep->p_hc_priv = NULL;
 
-    return ret;
+    return USB_OK;
 }
 
 /**
- * \brief 同步传输完成函数
+ * \brief EHCI 传输请求包完成处理函数
  */
-void usbh_trp_sync_xfer_done(void *p_arg){
+static void __ehci_trp_done_handle(struct usbh_ehci *p_ehci){
 #if USB_OS_EN
     int                   ret;
 #endif
-    struct usbh_endpoint *p_ep = (struct usbh_endpoint *)p_arg;
+    struct usb_list_node *p_node     = NULL;
+    struct usb_list_node *p_node_tmp = NULL;
+    struct usbh_trp      *p_trp      = NULL;
+    uint32_t              n_done     = 0;
 
 #if USB_OS_EN
-    ret = usb_sem_give((usb_sem_handle_t)p_ep->p_hc_priv);
+    ret = usb_mutex_lock(p_ehci->p_trp_done_lock, USBH_EHCI_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return;
+    }
+#endif
+    usb_list_for_each_node_safe(p_node, p_node_tmp, &p_ehci->trp_done_list){
+        p_trp = usb_container_of(p_node, struct usbh_trp, node);
+
+        usb_list_node_del(&p_trp->node);
+        usbh_trp_done(p_trp);
+        n_done++;
+    }
+    /* 中断统计*/
+    p_ehci->done_cnt            += n_done;
+    p_ehci->irq_stat.done_total += n_done;
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_ehci->p_trp_done_lock);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(SemGiveErr, "(%d)\r\n", ret);
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
     }
 #endif
 }
 
 /**
- * \brief 同步传输等待函数
+ * \brief 把中断阈值限制在 1~64 微帧，并向下取整为 2 的幂
  */
-int usbh_trp_sync_xfer_wait(struct usbh_endpoint *p_ep, int time_out){
-    if (p_ep == NULL) {
-        return -USB_EINVAL;
+static uint32_t __ehci_itc_round(uint32_t itc){
+    uint32_t tmp = USBH_EHCI_ITC_MIN;
+
+    if (itc > USBH_EHCI_ITC_MAX) {
+        itc = USBH_EHCI_ITC_MAX;
     }
-    if ((p_ep->p_hc_priv == NULL) ||
-            ((time_out < 0) && (time_out != USB_WAIT_FOREVER))) {
-        return -USB_EILLEGAL;
+    while ((tmp << 1) <= itc) {
+        tmp <<= 1;
     }
+    return tmp;
+}
 
-#if USB_OS_EN
-    return usb_sem_take((usb_sem_handle_t)p_ep->p_hc_priv, time_out);
-#endif
+/**
+ * \brief 写 EHCI 中断阈值，调用者需持有 EHCI 互斥锁
+ */
+static void __ehci_itc_write(struct usbh_ehci *p_ehci, uint32_t itc){
+    uint32_t cmd;
+
+    if (itc == p_ehci->itc) {
+        return;
+    }
+    cmd  = USB_LE_REG_READ32(p_ehci->opt_reg + __OPT_REG_CMD);
+    cmd &= ~__REG_CMD_ITC_MASK;
+    cmd |= __REG_CMD_ITC(itc);
+    USB_LE_REG_WRITE32(cmd, p_ehci->opt_reg + __OPT_REG_CMD);
+
+    p_ehci->itc          = itc;
+    p_ehci->irq_stat.itc = itc;
 }
 
 /**
- * \brief EHCI 传输请求包完成处理函数
+ * \brief EHCI 中断统计窗口更新，自适应模式下根据负载调整中断阈值，调用者需持有 EHCI 互斥锁
  */
-static void __ehci_trp_done_handle(struct usbh_ehci *p_ehci){
+static void __ehci_itc_adapt(struct usbh_ehci *p_ehci){
 #if USB_OS_EN
-    int                   ret;
+    int                 ret;
 #endif
-    struct usb_list_node *p_node     = NULL;
-    struct usb_list_node *p_node_tmp = NULL;
-    struct usbh_trp      *p_trp      = NULL;
+    struct usb_timespec ts;
+    long                elapsed_ms;
+    uint32_t            irq_cnt, done_cnt, itc;
 
+    if (usb_timespec_get(&ts) != USB_OK) {
+        return;
+    }
+    /* 第一个统计窗口*/
+    if ((p_ehci->itc_ts.ts_sec == 0) && (p_ehci->itc_ts.ts_nsec == 0)) {
+        p_ehci->itc_ts = ts;
+        return;
+    }
+    elapsed_ms = (ts.ts_sec - p_ehci->itc_ts.ts_sec) * 1000 +
+                 (ts.ts_nsec - p_ehci->itc_ts.ts_nsec) / 1000000;
+    if ((elapsed_ms >= 0) && (elapsed_ms < USBH_EHCI_ITC_WINDOW_MS)) {
+        return;
+    }
+    if (elapsed_ms <= 0) {
+        elapsed_ms = USBH_EHCI_ITC_WINDOW_MS;
+    }
 #if USB_OS_EN
     ret = usb_mutex_lock(p_ehci->p_trp_done_lock, USBH_EHCI_MUTEX_TIMEOUT);
     if (ret != USB_OK) {
@@ -214,18 +249,44 @@ static void __ehci_trp_done_handle(struct usbh_ehci *p_ehci){
         return;
     }
 #endif
-    usb_list_for_each_node_safe(p_node, p_node_tmp, &p_ehci->trp_done_list){
-        p_trp = usb_container_of(p_node, struct usbh_trp, node);
-
-        usb_list_node_del(&p_trp->node);
-        usbh_trp_done(p_trp);
-    }
+    done_cnt         = p_ehci->done_cnt;
+    p_ehci->done_cnt = 0;
 #if USB_OS_EN
     ret = usb_mutex_unlock(p_ehci->p_trp_done_lock);
     if (ret != USB_OK) {
         __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
     }
 #endif
+    /* 中断次数在中断处理函数中累加，这里只做一次读取和清零*/
+    irq_cnt         = p_ehci->irq_cnt;
+    p_ehci->irq_cnt = 0;
+    p_ehci->itc_ts  = ts;
+
+    p_ehci->irq_stat.irq_per_sec  = (uint32_t)(((uint64_t)irq_cnt * 1000) / elapsed_ms);
+    p_ehci->irq_stat.done_per_sec = (uint32_t)(((uint64_t)done_cnt * 1000) / elapsed_ms);
+    p_ehci->irq_stat.done_per_irq = irq_cnt ? (done_cnt / irq_cnt) : 0;
+
+    if (p_ehci->itc_adaptive == USB_FALSE) {
+        return;
+    }
+
+    itc = p_ehci->itc;
+    if ((p_ehci->intr_count > 0) || (p_ehci->isoc_count > 0)) {
+        /* 有周期传输，对延迟敏感，使用最小阈值*/
+        itc = p_ehci->itc_min;
+    } else if (p_ehci->irq_stat.done_per_sec > USBH_EHCI_ITC_LOAD_HIGH) {
+        /* 持续批量负载，合并中断*/
+        itc <<= 1;
+    } else if (p_ehci->irq_stat.done_per_sec < USBH_EHCI_ITC_LOAD_LOW) {
+        itc >>= 1;
+    }
+    if (itc > p_ehci->itc_max) {
+        itc = p_ehci->itc_max;
+    }
+    if (itc < p_ehci->itc_min) {
+        itc = p_ehci->itc_min;
+    }
+    __ehci_itc_write(p_ehci, itc);
 }
 
 /**
@@ -571,36 +632,15 @@ __exit:
 }
 
 /**
- * \brief EHCI 请求传输函数
+ * \brief EHCI 链接一个传输请求包，调用者必须持有 EHCI 锁
  */
-static int __ehci_xfer_request(struct usb_hc   *p_hc,
-                               struct usbh_trp *p_trp){
+static int __ehci_trp_link(struct usbh_ehci *p_ehci,
+                           struct usbh_trp  *p_trp){
     struct usbh_ehci_qh         *p_qh     = NULL;
     struct usbh_ehci_iso_stream *p_stream = NULL;
     struct usb_list_head         td_list;
     int                          ret      = USB_OK;
-#if USB_OS_EN
-    int                          ret_tmp;
-#endif
-    struct usbh_ehci            *p_ehci   = USBH_GET_EHCI_FROM_HC(p_hc);
-
-    /* 端点是否有链接数据链表，没有则返回错误*/
-    /* 检查是否是控制/批量传输端点*/
-    if ((p_ehci == NULL) || (p_trp->p_ep->p_hw_priv == NULL) ||
-           ((USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_CTRL) &&
-            (USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_BULK) &&
-            (USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_INT) &&
-            (USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_ISO))) {
-        return -USB_EILLEGAL;
-    }
 
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_ehci->p_lock, USBH_EHCI_MUTEX_TIMEOUT);
-    if (ret != USB_OK) {
-    	__USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
-    }
-#endif
     /* 初始化传输描述符链表*/
     usb_list_head_init(&td_list);
     /* 清除传输请求包实际传输长度和状态*/
@@ -616,7 +656,7 @@ static int __ehci_xfer_request(struct usb_hc   *p_hc,
             ret = usbh_iso_sched_make(p_ehci, p_trp, p_stream);
             if (ret != USB_OK) {
                 __USB_ERR_INFO("USB host EHCI ISO schedule make failed(%d)", ret);
-                goto __exit;
+                return ret;
             }
             /* 等时传输请求*/
             ret = usbh_ehci_iso_req(p_ehci, p_trp, p_stream);
@@ -628,7 +668,7 @@ static int __ehci_xfer_request(struct usb_hc   *p_hc,
             ret = usbh_ehci_qtds_make(p_ehci, p_trp, &td_list);
             if (ret != USB_OK) {
                 __USB_ERR_INFO("USB host EHCI QTD list make failed(%d)", ret);
-                goto __exit;
+                return ret;
             }
 
             /* 周期中断请求*/
@@ -645,7 +685,7 @@ static int __ehci_xfer_request(struct usb_hc   *p_hc,
             ret = usbh_ehci_qtds_make(p_ehci, p_trp, &td_list);
             if (ret != USB_OK) {
                 __USB_ERR_INFO("USB host EHCI QTD list make failed(%d)\r\n", ret);
-                goto __exit;
+                return ret;
             }
 
             /* 异步调度请求*/
@@ -653,8 +693,131 @@ static int __ehci_xfer_request(struct usb_hc   *p_hc,
 
             break;
     }
+    return ret;
+}
+
+/**
+ * \brief EHCI 请求传输函数
+ */
+static int __ehci_xfer_request(struct usb_hc   *p_hc,
+                               struct usbh_trp *p_trp){
+    int               ret    = USB_OK;
+#if USB_OS_EN
+    int               ret_tmp;
+#endif
+    struct usbh_ehci *p_ehci = USBH_GET_EHCI_FROM_HC(p_hc);
+
+    /* 端点是否有链接数据链表，没有则返回错误*/
+    /* 检查是否是控制/批量传输端点*/
+    if ((p_ehci == NULL) || (p_trp->p_ep->p_hw_priv == NULL) ||
+           ((USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_CTRL) &&
+            (USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_BULK) &&
+            (USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_INT) &&
+            (USBH_EP_TYPE_GET(p_trp->p_ep) != USB_EP_TYPE_ISO))) {
+        return -USB_EILLEGAL;
+    }
 
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_ehci->p_lock, USBH_EHCI_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+    	__USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    ret = __ehci_trp_link(p_ehci, p_trp);
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_ehci->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief EHCI 批量请求传输函数
+ *
+ * 整个批次只获取一次 EHCI 锁。控制/批量端点的所有传输请求包的 qTD 链表先串成一个
+ * 链表，再一次链接到 QH 上；中断/等时端点在同一次持锁中逐个链接。中途失败时已经
+ * 链接的传输请求包保留，没有链接的由调用者取消映射并置为失败。
+ *
+ * \param[in] p_hc   USB 主机结构体
+ * \param[in] p_trps 传输请求包数组(属于同一个端点)
+ * \param[in] n_trps 传输请求包数量
+ *
+ * \retval 成功返回已提交的传输请求包数量，一个都没有提交返回错误码
+ */
+static int __ehci_xfer_request_batch(struct usb_hc    *p_hc,
+                                     struct usbh_trp **p_trps,
+                                     int               n_trps){
+    struct usbh_ehci_qh  *p_qh   = NULL;
+    struct usbh_endpoint *p_ep   = NULL;
+    struct usb_list_head  td_list, td_list_all;
+    int                   i, ret = USB_OK;
+#if USB_OS_EN
+    int                   ret_tmp;
+#endif
+    struct usbh_ehci     *p_ehci = USBH_GET_EHCI_FROM_HC(p_hc);
+
+    if ((p_ehci == NULL) || (n_trps <= 0)) {
+        return -USB_EILLEGAL;
+    }
+
+    p_ep = p_trps[0]->p_ep;
+    if ((p_ep->p_hw_priv == NULL) ||
+           ((USBH_EP_TYPE_GET(p_ep) != USB_EP_TYPE_CTRL) &&
+            (USBH_EP_TYPE_GET(p_ep) != USB_EP_TYPE_BULK) &&
+            (USBH_EP_TYPE_GET(p_ep) != USB_EP_TYPE_INT) &&
+            (USBH_EP_TYPE_GET(p_ep) != USB_EP_TYPE_ISO))) {
+        return -USB_EILLEGAL;
+    }
+
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_ehci->p_lock, USBH_EHCI_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    /* 中断/等时端点逐个链接*/
+    if ((USBH_EP_TYPE_GET(p_ep) != USB_EP_TYPE_CTRL) &&
+            (USBH_EP_TYPE_GET(p_ep) != USB_EP_TYPE_BULK)) {
+        for (i = 0; i < n_trps; i++) {
+            ret = __ehci_trp_link(p_ehci, p_trps[i]);
+            if (ret != USB_OK) {
+                break;
+            }
+        }
+        goto __exit;
+    }
+
+    p_qh = (struct usbh_ehci_qh *)p_ep->p_hw_priv;
+    usb_list_head_init(&td_list_all);
+
+    for (i = 0; i < n_trps; i++) {
+        usb_list_head_init(&td_list);
+        /* 清除传输请求包实际传输长度和状态*/
+        p_trps[i]->act_len = 0;
+        p_trps[i]->status  = 0;
+
+        ret = usbh_ehci_qtds_make(p_ehci, p_trps[i], &td_list);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("USB host EHCI QTD list make failed(%d)\r\n", ret);
+            break;
+        }
+        /* 接到整个批次的 qTD 链表后面*/
+        usbh_ehci_qtds_splice(&td_list, &td_list_all);
+    }
+
+    /* 整个批次只链接一次*/
+    if (i > 0) {
+        usbh_ehci_async_link(p_ehci, p_qh, &td_list_all);
+    }
 __exit:
+    if (i > 0) {
+        ret = i;
+    }
 #if USB_OS_EN
     ret_tmp = usb_mutex_unlock(p_ehci->p_lock);
     if (ret_tmp != USB_OK) {
@@ -793,13 +956,16 @@ static struct usb_hc_drv __g_ehci_drv = {
         .p_fn_ep_enable     = __ehci_ep_enable,
         .p_fn_ep_disable    = __ehci_ep_disable,
 
-        .p_fn_xfer_request  = __ehci_xfer_request,
-        .p_fn_xfer_cancel   = __ehci_xfer_cancel,
+        .p_fn_xfer_request       = __ehci_xfer_request,
+        .p_fn_xfer_request_batch = __ehci_xfer_request_batch,
+        .p_fn_xfer_cancel        = __ehci_xfer_cancel,
 
         .p_fn_frame_num_get = __ehci_frame_idx_get,
 #if USB_MEM_RECORD_EN
         .p_fn_controller_mem_get = usbh_ehci_mem_sta_get,
 #endif
+        /* 传输请求/取消都持有 EHCI 锁*/
+        .is_xfer_locked     = USB_TRUE,
 };
 
 /**
@@ -840,7 +1006,11 @@ static int __ehci_hw_init(struct usbh_ehci *p_ehci, struct usbh_ehci_mem_cfg mem
     }
 
     /* 设置中断间隔为 1 微帧*/
-    cmd = 1 << 16;
+    cmd = __REG_CMD_ITC(USBH_EHCI_ITC_MIN);
+    p_ehci->itc          = USBH_EHCI_ITC_MIN;
+    p_ehci->itc_min      = USBH_EHCI_ITC_MIN;
+    p_ehci->itc_max      = USBH_EHCI_ITC_MAX;
+    p_ehci->irq_stat.itc = USBH_EHCI_ITC_MIN;
 
     /* 禁用 “park” 模式*/
     cmd &= ~__REG_CMD_PARK;
@@ -969,6 +1139,8 @@ void usbh_ehci_work(struct usbh_ehci *p_ehci){
     if (p_ehci->isoc_count > 0) {
         usbh_ehci_isoc_scan(p_ehci);
     }
+    /* 更新中断统计和中断阈值*/
+    __ehci_itc_adapt(p_ehci);
 #if USB_OS_EN
     ret = usb_mutex_unlock(p_ehci->p_lock);
     if (ret != USB_OK) {
@@ -1093,6 +1265,10 @@ int usbh_ehci_irq_handle(struct usbh_ehci *p_ehci){
     tmp = USB_LE_REG_READ32(p_ehci->opt_reg + __OPT_REG_STS);
     p_ehci->status |= tmp;
     USB_LE_REG_WRITE32(tmp, p_ehci->opt_reg + __OPT_REG_STS);
+
+    /* 中断统计*/
+    p_ehci->irq_cnt++;
+    p_ehci->irq_stat.irq_total++;
 #if USB_OS_EN
     /* 释放 EHCI 信号量*/
     ret = __evt_give(p_ehci, __EHCI_EVT_IRQ);
@@ -1138,6 +1314,9 @@ int usbh_ehci_create(struct usb_hc           *p_hc,
     memset(p_ehci_tmp, 0, sizeof(struct usbh_ehci));
 
     usb_list_head_init(&p_ehci_tmp->intr_qh_list);
+    usb_list_head_init(&p_ehci_tmp->async_active_list);
+    usb_list_head_init(&p_ehci_tmp->intr_active_list);
+    usb_list_head_init(&p_ehci_tmp->trp_batch_list);
     usb_list_head_init(&p_ehci_tmp->trp_done_list);
 
     p_ehci_tmp->hc_head.controller_type = EHCI;
@@ -1320,7 +1499,136 @@ int usbh_ehci_destory(struct usb_hc *p_hc, struct usbh_ehci *p_ehci){
     return USB_OK;
 }
 
+/**
+ * \brief 设置 EHCI 中断阈值，会关闭自适应模式
+ *
+ * \param[in] p_ehci EHCI 结构体
+ * \param[in] itc    中断阈值(1~64 微帧)，不是 2 的幂时向下取整
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ehci_itc_set(struct usbh_ehci *p_ehci, uint32_t itc){
+    int ret = USB_OK;
+#if USB_OS_EN
+    int ret_tmp;
+#endif
 
+    if ((p_ehci == NULL) || (itc < USBH_EHCI_ITC_MIN) || (itc > USBH_EHCI_ITC_MAX)) {
+        return -USB_EINVAL;
+    }
+    if (p_ehci->hc_head.is_init == USB_FALSE) {
+        return -USB_ENOINIT;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_ehci->p_lock, USBH_EHCI_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    p_ehci->itc_adaptive         = USB_FALSE;
+    p_ehci->irq_stat.is_adaptive = USB_FALSE;
 
+    __ehci_itc_write(p_ehci, __ehci_itc_round(itc));
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_ehci->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 设置 EHCI 中断阈值自适应模式
+ *
+ * \param[in] p_ehci  EHCI 结构体
+ * \param[in] is_en   是否使能
+ * \param[in] itc_min 最小中断阈值(1~64 微帧)，有周期传输时使用
+ * \param[in] itc_max 最大中断阈值(1~64 微帧)，持续批量负载时的上限
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ehci_itc_adaptive_set(struct usbh_ehci *p_ehci,
+                               usb_bool_t        is_en,
+                               uint32_t          itc_min,
+                               uint32_t          itc_max){
+    int ret = USB_OK;
+#if USB_OS_EN
+    int ret_tmp;
+#endif
+
+    if (p_ehci == NULL) {
+        return -USB_EINVAL;
+    }
+    if ((is_en == USB_TRUE) &&
+            ((itc_min < USBH_EHCI_ITC_MIN) ||
+             (itc_max > USBH_EHCI_ITC_MAX) ||
+             (itc_min > itc_max))) {
+        return -USB_EINVAL;
+    }
+    if (p_ehci->hc_head.is_init == USB_FALSE) {
+        return -USB_ENOINIT;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_ehci->p_lock, USBH_EHCI_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    p_ehci->itc_adaptive         = is_en;
+    p_ehci->irq_stat.is_adaptive = is_en;
 
+    if (is_en == USB_TRUE) {
+        p_ehci->itc_min = __ehci_itc_round(itc_min);
+        p_ehci->itc_max = __ehci_itc_round(itc_max);
+        /* 从最小阈值开始，由统计窗口逐步调整*/
+        __ehci_itc_write(p_ehci, p_ehci->itc_min);
+    }
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_ehci->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
+
+/**
+ * \brief 获取 EHCI 中断统计信息
+ *
+ * \param[in]  p_ehci EHCI 结构体
+ * \param[out] p_stat 返回的中断统计信息
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ehci_irq_stat_get(struct usbh_ehci *p_ehci, struct usbh_ehci_irq_stat *p_stat){
+    int ret = USB_OK;
+#if USB_OS_EN
+    int ret_tmp;
+#endif
+
+    if ((p_ehci == NULL) || (p_stat == NULL)) {
+        return -USB_EINVAL;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_ehci->p_lock, USBH_EHCI_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    *p_stat = p_ehci->irq_stat;
+#if USB_OS_EN
+    ret_tmp = usb_mutex_unlock(p_ehci->p_lock);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
+        return ret_tmp;
+    }
+#endif
+    return ret;
+}
 
@@ -179,6 +179,16 @@ int usbh_ehci_mem_init(struct usbh_ehci *p_ehci,
 
     memset(p_ehci->p_shadow, 0, p_ehci->frame_list_size * sizeof(void *));
 
+    /* 申请微帧带宽表，链接/取消链接周期数据结构时更新*/
+    p_ehci->p_bw_table = usb_lib_malloc(&__g_usb_host_lib.lib, (p_ehci->frame_list_size << 3) * sizeof(uint16_t));
+    if (p_ehci->p_bw_table == NULL) {
+        usb_lib_mfree(&__g_usb_host_lib.lib, p_ehci->p_shadow);
+        p_ehci->p_shadow = NULL;
+        ret = -USB_ENOMEM;
+        goto __failed;
+    }
+    memset(p_ehci->p_bw_table, 0, (p_ehci->frame_list_size << 3) * sizeof(uint16_t));
+
     return USB_OK;
 __failed:
     if (p_mem) {
@@ -201,6 +211,8 @@ __failed:
  * \brief 反初始化 EHCI 内存
  */
 int usbh_ehci_mem_deinit(struct usbh_ehci *p_ehci){
+    usb_lib_mfree(&__g_usb_host_lib.lib, p_ehci->p_bw_table);
+
     usb_lib_mfree(&__g_usb_host_lib.lib, p_ehci->p_shadow);
 
     usb_lib_dma_mfree(&__g_usb_host_lib.lib, p_ehci->qh_pool.p_start, p_ehci->ds_size);
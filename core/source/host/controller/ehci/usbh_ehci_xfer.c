@@ -74,34 +74,73 @@ static union usbh_ehci_struct_ptr __ehci_next_struct(union usbh_ehci_struct_ptr
 }
 
 /**
- * \brief 传输完成函数
+ * \brief 传输完成函数，先放到批量完成链表，调用者需持有 EHCI 互斥锁
  */
 static void __ehci_trp_done(struct usbh_ehci *p_ehci, struct usbh_trp *p_trp, int status){
+    if ((status == -USB_EINPROGRESS) || (status == -USB_EPERM)) {
+        status = USB_OK;
+    }
+    p_trp->status = status;
+
+    usb_list_node_add_tail(&p_trp->node, &p_ehci->trp_batch_list);
+}
+
+/**
+ * \brief 把批量完成链表一次性移交到完成的请求包链表
+ */
+static void __ehci_trp_batch_flush(struct usbh_ehci *p_ehci){
 #if USB_OS_EN
     int ret;
 #endif
 
-    if ((status == -USB_EINPROGRESS) || (status == -USB_EPERM)) {
-        status = USB_OK;
+    if (usb_list_head_is_empty(&p_ehci->trp_batch_list)) {
+        return;
     }
 #if USB_OS_EN
     ret = usb_mutex_lock(p_ehci->p_trp_done_lock, USBH_EHCI_MUTEX_TIMEOUT);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
         return;
     }
 #endif
-    p_trp->status = status;
-
-    usb_list_node_add_tail(&p_trp->node, &p_ehci->trp_done_list);
+    usb_list_head_splice_tail(&p_ehci->trp_batch_list, &p_ehci->trp_done_list);
+    usb_list_head_init(&p_ehci->trp_batch_list);
 #if USB_OS_EN
     ret = usb_mutex_unlock(p_ehci->p_trp_done_lock);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
     }
 #endif
 }
 
+/**
+ * \brief QH 加入活跃 QH 集合
+ */
+static void __qh_active_add(struct usbh_ehci *p_ehci, struct usbh_ehci_qh *p_qh){
+    if ((p_qh->is_active == USB_TRUE) || (usb_list_head_is_empty(&p_qh->qtds))) {
+        return;
+    }
+    if (USBH_EP_TYPE_GET(p_qh->p_ep) == USB_EP_TYPE_INT) {
+        usb_list_node_add_tail(&p_qh->active_node, &p_ehci->intr_active_list);
+    } else {
+        usb_list_node_add_tail(&p_qh->active_node, &p_ehci->async_active_list);
+    }
+    p_qh->is_active = USB_TRUE;
+}
+
+/**
+ * \brief QH 没有未完成的 qTD 时移出活跃 QH 集合
+ */
+static void __qh_active_del(struct usbh_ehci_qh *p_qh, usb_bool_t is_force){
+    if (p_qh->is_active == USB_FALSE) {
+        return;
+    }
+    if ((is_force == USB_TRUE) || (usb_list_head_is_empty(&p_qh->qtds))) {
+        usb_list_node_del(&p_qh->active_node);
+        p_qh->is_active = USB_FALSE;
+    }
+}
+
 /**
  * \brief 使能周期调度
  *
@@ -212,6 +251,90 @@ static uint32_t __qtd_init(struct usbh_ehci_qtd *p_qtd,
     return count;
 }
 
+/**
+ * \brief 用分散/聚集段初始化 qTD，段直接映射到 qTD 的 5 个缓冲页指针
+ *
+ * 只有在前一段结束于 4K 边界且后一段起始于 4K 边界时，两段才能放进同一个 qTD；
+ * 非最后一个 qTD 的长度会对齐为端点最大包长度的整数倍，多出的部分留给下一个 qTD
+ *
+ * \retval 成功返回 qTD 的数据长度，段布局无法零拷贝映射返回 0
+ */
+static uint32_t __qtd_sg_init(struct usbh_ehci_qtd *p_qtd,
+                              struct usbh_trp_sg   *p_sg,
+                              int                   n_sg,
+                              int                  *p_idx,
+                              size_t               *p_off,
+                              size_t                remain,
+                              uint32_t              token,
+                              uint32_t              mps){
+    int      idx   = *p_idx;
+    size_t   off   = *p_off;
+    uint32_t count = 0, chunk, trim, i = 0;
+#ifdef __CPU_64BITS
+    uint64_t addr, end = 0;
+#else
+    uint32_t addr, end = 0;
+#endif
+
+    while ((idx < n_sg) && (i < 5)) {
+        if (off >= p_sg[idx].len) {
+            idx++;
+            off = 0;
+            continue;
+        }
+#ifdef __CPU_64BITS
+        addr = (uint64_t)p_sg[idx].p_dma + off;
+#else
+        addr = (uint32_t)p_sg[idx].p_dma + off;
+#endif
+        /* 除第一页外，每一页都必须从 4K 边界开始，且上一页必须用满*/
+        if ((i > 0) && (((addr & 0x0fff) != 0) || ((end & 0x0fff) != 0))) {
+            break;
+        }
+        USB_LE_REG_WRITE32((uint32_t)addr, &p_qtd->hw_buf[i]);
+#ifdef __CPU_64BITS
+        USB_LE_REG_WRITE32((addr >> 32), &p_qtd->hw_buf_high[i]);
+#endif
+        chunk = 0x1000 - (addr & 0x0fff);
+        if (chunk > (p_sg[idx].len - off)) {
+            chunk = p_sg[idx].len - off;
+        }
+        count += chunk;
+        off   += chunk;
+        end    = addr + chunk;
+        i++;
+    }
+
+    /* 不是最后一个 qTD，长度对齐为端点最大包长度的整数倍，否则会在中间产生短包*/
+    if ((count != remain) && (mps != 0)) {
+        trim   = count % mps;
+        count -= trim;
+        /* 回退多出的部分*/
+        while (trim > 0) {
+            if (off >= trim) {
+                off -= trim;
+                trim = 0;
+            } else {
+                trim -= off;
+                idx--;
+                off   = p_sg[idx].len;
+            }
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    USB_LE_REG_WRITE32(((count << 16) | token), &p_qtd->hw_token);
+
+    p_qtd->len = count;
+
+    *p_idx = idx;
+    *p_off = off;
+
+    return count;
+}
+
 /**
  * \brief QH（队列头）初始化
  *
@@ -392,6 +515,8 @@ int usbh_ehci_qh_deinit(struct usbh_ehci    *p_ehci,
                         struct usbh_ehci_qh *p_qh){
     int ret = USB_OK;
 
+    __qh_active_del(p_qh, USB_TRUE);
+
     ret = usbh_ehci_qh_free(p_ehci, p_qh);
     if (ret != USB_OK) {
         __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
@@ -418,7 +543,7 @@ int usbh_ehci_qtds_make(struct usbh_ehci     *p_ehci,
     usb_bool_t            is_in;
     uint8_t              *p_data = NULL;
     int                   tr_len;
-    int                   ret;
+    int                   ret, ret_tmp;
 
     /* 获取传输请求包的端点*/
     p_ep  = p_trp->p_ep;
@@ -453,8 +578,10 @@ int usbh_ehci_qtds_make(struct usbh_ehci     *p_ehci,
     }
 
     /* 数据包*/
-    if ((p_trp->len) && (p_trp->p_data)) {
+    if ((p_trp->len) && ((p_trp->p_data) || (p_trp->p_sg))) {
         uint32_t length;
+        int      sg_idx = 0;
+        size_t   sg_off = 0;
         /* 是否是输入传输*/
         if (is_in) {
             token |= (__QTD_PID_IN << 8);
@@ -487,7 +614,23 @@ int usbh_ehci_qtds_make(struct usbh_ehci     *p_ehci,
             usb_list_node_add_tail(&(p_qtd->node), p_qtds);
 
             /* 初始化 qTD*/
-            length  = __qtd_init(p_qtd, p_data, tr_len, token, USBH_EP_MPS_GET(p_ep));
+            if (p_trp->p_sg) {
+                /* 分散/聚集段直接映射到 qTD 缓冲页*/
+                length = __qtd_sg_init(p_qtd,
+                                       p_trp->p_sg,
+                                       p_trp->n_sg,
+                                      &sg_idx,
+                                      &sg_off,
+                                       tr_len,
+                                       token,
+                                       USBH_EP_MPS_GET(p_ep));
+                if (length == 0) {
+                    ret = -USB_EINVAL;
+                    goto __failed;
+                }
+            } else {
+                length = __qtd_init(p_qtd, p_data, tr_len, token, USBH_EP_MPS_GET(p_ep));
+            }
             /* 传输请求包数据长度减去qTD的数据长度*/
             tr_len -= length;
             p_data += length;
@@ -554,12 +697,12 @@ int usbh_ehci_qtds_make(struct usbh_ehci     *p_ehci,
     return USB_OK;
 
 __failed:
-    ret = usbh_ehci_qtds_free(p_ehci, p_qtds);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
+    ret_tmp = usbh_ehci_qtds_free(p_ehci, p_qtds);
+    if (ret_tmp != USB_OK) {
+        __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret_tmp);
     }
 
-    return -USB_ENOMEM;
+    return ret;
 }
 
 /**
@@ -584,6 +727,31 @@ int usbh_ehci_qtds_free(struct usbh_ehci     *p_ehci,
     return ret;
 }
 
+/**
+ * \brief 把一个 qTD 链表接到另一个 qTD 链表尾部，同时链接硬件 Next qTD 指针
+ *
+ * \param[in] p_qtds     要接上的 qTD 链表
+ * \param[in] p_qtds_all 目标 qTD 链表
+ */
+void usbh_ehci_qtds_splice(struct usb_list_head *p_qtds,
+                           struct usb_list_head *p_qtds_all){
+    struct usbh_ehci_qtd *p_qtd_last = NULL;
+    struct usbh_ehci_qtd *p_qtd_new  = NULL;
+
+    if (usb_list_head_is_empty(p_qtds)) {
+        return;
+    }
+
+    if (!usb_list_head_is_empty(p_qtds_all)) {
+        p_qtd_last = usb_container_of(p_qtds_all->p_prev, struct usbh_ehci_qtd, node);
+        p_qtd_new  = usb_container_of(p_qtds->p_next, struct usbh_ehci_qtd, node);
+        /* 前一个传输请求包的最后一个 qTD 指向新的 qTD 链表*/
+        USB_LE_REG_WRITE32((uint32_t)p_qtd_new, &p_qtd_last->hw_next);
+    }
+    usb_list_head_splice_tail(p_qtds, p_qtds_all);
+    usb_list_head_init(p_qtds);
+}
+
 /**
  * \brief qTD（队列传输描述符）链接
  */
@@ -653,6 +821,7 @@ void usbh_ehci_async_link(struct usbh_ehci     *p_ehci,
                           struct usbh_ehci_qh  *p_qh,
                           struct usb_list_head *p_qtds){
     __qtds_link(p_qh, p_qtds);
+    __qh_active_add(p_ehci, p_qh);
 
     if ((p_qh->state == __QH_ST_IDLE) ||
         (p_qh->state == __QH_ST_UNLINKED)) {
@@ -767,15 +936,10 @@ static int __qtd_copy_status(struct usbh_ehci *p_ehci,
 }
 
 /**
- * \brief QH 处理函数
- *
- * \param[in] p_ehci EHCI 结构体
- * \param[in] p_qh   要处理 QH 结构体
- *
- * \retval 成功返回 USB_OK
+ * \brief QH 处理函数，完成的请求包先放在批量完成链表中
  */
-int usbh_ehci_qh_handle(struct usbh_ehci    *p_ehci,
-                        struct usbh_ehci_qh *p_qh){
+static int __qh_handle(struct usbh_ehci    *p_ehci,
+                       struct usbh_ehci_qh *p_qh){
     struct usb_list_node *p_entry, *p_tmp;
     struct usbh_ehci_qtd *p_qtd      = NULL;
     struct usbh_ehci_qtd *p_qtd_prev = NULL;
@@ -899,8 +1063,8 @@ __retry_xacterr:
     return USB_OK;
 }
 #else
-int usbh_ehci_qh_handle(struct usbh_ehci    *p_ehci,
-                        struct usbh_ehci_qh *p_qh){
+static int __qh_handle(struct usbh_ehci    *p_ehci,
+                       struct usbh_ehci_qh *p_qh){
     struct usb_list_node *p_entry, *p_tmp;
     struct usbh_ehci_qtd *p_qtd = NULL;
     struct usbh_ehci_qtd *p_prev = NULL;
@@ -1071,24 +1235,48 @@ __rescan:
 #endif
 
 /**
- * \brief 扫描异步调度
+ * \brief QH 处理函数
+ *
+ * \param[in] p_ehci EHCI 结构体
+ * \param[in] p_qh   要处理 QH 结构体
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_ehci_qh_handle(struct usbh_ehci    *p_ehci,
+                        struct usbh_ehci_qh *p_qh){
+    int ret;
+
+    ret = __qh_handle(p_ehci, p_qh);
+    /* qTD 都处理完了，移出活跃 QH 集合*/
+    __qh_active_del(p_qh, USB_FALSE);
+    __ehci_trp_batch_flush(p_ehci);
+
+    return ret;
+}
+
+/**
+ * \brief 扫描异步调度，只访问有未完成 qTD 的 QH
  */
 void usbh_ehci_async_scan(struct usbh_ehci *p_ehci){
-    struct usbh_ehci_qh *p_qh_next, *p_qh;
-    int                  ret;
+    struct usb_list_node *p_node     = NULL;
+    struct usb_list_node *p_node_tmp = NULL;
+    struct usbh_ehci_qh  *p_qh       = NULL;
+    int                   ret;
 
-    p_qh_next = p_ehci->p_async->p_next.p_qh;
-    /* 处理每一个队列头*/
-    while (p_qh_next) {
-        p_qh      = p_qh_next;
-        p_qh_next = p_qh->p_next.p_qh;
+    /* 处理每一个活跃的队列头*/
+    usb_list_for_each_node_safe(p_node,
+                                p_node_tmp,
+                               &p_ehci->async_active_list) {
+        p_qh = usb_container_of(p_node, struct usbh_ehci_qh, active_node);
 
-        ret = usbh_ehci_qh_handle(p_ehci, p_qh);
+        ret = __qh_handle(p_ehci, p_qh);
         if (ret != USB_OK) {
             __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
         }
-        //todo
+        __qh_active_del(p_qh, USB_FALSE);
     }
+    /* 一次性移交这次扫描完成的请求包*/
+    __ehci_trp_batch_flush(p_ehci);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -1199,65 +1387,86 @@ void usbh_ehci_async_scan(struct usbh_ehci *p_ehci){
 //}
 
 /**
- * \brief 检查周期带宽
+ * \brief 获取微帧已分配的周期带宽
  */
 static uint16_t __periodic_usecs(struct usbh_ehci *p_ehci, uint32_t frame, uint32_t u_frame){
-    uint32_t                   *p_hw   = &p_ehci->p_periodic[frame];
-    union usbh_ehci_struct_ptr *q      = &p_ehci->p_shadow[frame];
-    uint32_t                    u_secs = 0;
-    struct usbh_ehci_qh        *p_qh   = NULL;
-
-    while (q->ptr) {
-        switch (USB_CPU_TO_LE32(Q_NEXT_TYPE(*p_hw))) {
-            /* 队列头*/
-            case __Q_TYPE_QH:
-                p_qh = q->p_qh;
-                /* 高速设备，微帧编号在 S-mask 寄存器里*/
-                if (p_qh->hw_info2 & USB_CPU_TO_LE32(1 << u_frame)) {
-                    u_secs += q->p_qh->usecs;
-                }
-                /* 全/低速设备，完成分割的微帧编号在 C-mask 寄存器里*/
-                if (p_qh->hw_info2 & USB_CPU_TO_LE32(1 << (8 + u_frame))) {
-                    u_secs += q->p_qh->c_usecs;
-                }
-                p_hw = &p_qh->hw_next;
-                q    = &q->p_qh->p_next;
-                break;
-            case __Q_TYPE_FSTN:
-                //todo
-                break;
-            default:
-                break;
-            /* 等时传输描述符*/
-            case __Q_TYPE_ITD:
-                if (q->p_itd->hw_transaction[u_frame]) {
-                    //uSecs += q->pItd->pStream->uSecs;
-                }
-                p_hw = &q->p_itd->hw_next;
-                q    = &q->p_itd->p_next;
-                break;
-            case __Q_TYPE_SITD:
-                /* is it in the S-mask?  (count SPLIT, DATA) */
-                if (q->p_sitd->hw_u_frame & USB_CPU_TO_LE32(1 << u_frame)) {
-                    if (q->p_sitd->hw_full_speed_ep & USB_CPU_TO_LE32(1 << 31)){
-                        //uSecs += q->pSitd->pStream->uSecs;
-                    } else {    /* worst case for OUT start-split */
-                        //uSecs += HS_USECS_ISO (188);
-                    }
-                }
+    return p_ehci->p_bw_table[(frame << 3) + u_frame];
+}
 
-                /* ... C-mask?  (count CSPLIT, DATA) */
-                if (q->p_sitd->hw_u_frame & USB_CPU_TO_LE32(1 << (8 + u_frame))) {
-                    /* worst case for IN complete-split */
-                    //uSecs += q->pSitd->pStream->c_usecs;
-                }
+/**
+ * \brief 增加/减少微帧的周期带宽
+ */
+static void __periodic_usecs_update(struct usbh_ehci *p_ehci,
+                                    uint32_t          uframe,
+                                    uint16_t          usecs,
+                                    usb_bool_t        is_add){
+    uint16_t *p_bw = &p_ehci->p_bw_table[uframe];
+
+    if (is_add) {
+        *p_bw += usecs;
+    } else {
+        *p_bw = (*p_bw > usecs) ? (*p_bw - usecs) : 0;
+    }
+}
 
-                p_hw = &q->p_sitd->hw_next;
-                q    = &q->p_sitd->p_next;
-                break;
+/**
+ * \brief 更新 QH(队列头)占用的周期带宽，按 S-mask 和 C-mask 计算每一个链接的帧
+ */
+static void __qh_bw_update(struct usbh_ehci    *p_ehci,
+                           struct usbh_ehci_qh *p_qh,
+                           usb_bool_t           is_add){
+    uint32_t info2  = USB_LE_REG_READ32(&p_qh->hw_info2);
+    uint32_t period = p_qh->frame_period ? p_qh->frame_period : 1;
+    uint32_t i, uf;
+
+    for (i = p_qh->frame_phase; i < p_ehci->frame_list_size; i += period) {
+        for (uf = 0; uf < 8; uf++) {
+            /* 高速设备，微帧编号在 S-mask 寄存器里*/
+            if (info2 & (1 << uf)) {
+                __periodic_usecs_update(p_ehci, (i << 3) + uf, p_qh->usecs, is_add);
+            }
+            /* 全/低速设备，完成分割的微帧编号在 C-mask 寄存器里*/
+            if (info2 & (1 << (8 + uf))) {
+                __periodic_usecs_update(p_ehci, (i << 3) + uf, p_qh->c_usecs, is_add);
+            }
+        }
+    }
+}
+
+/**
+ * \brief 更新等时传输描述符占用的周期带宽
+ */
+static void __itd_bw_update(struct usbh_ehci     *p_ehci,
+                            struct usbh_ehci_itd *p_itd,
+                            usb_bool_t            is_add){
+    uint32_t uf;
+
+    for (uf = 0; uf < 8; uf++) {
+        if (p_itd->index[uf] != (uint32_t)-1) {
+            __periodic_usecs_update(p_ehci, (p_itd->frame << 3) + uf, p_itd->p_stream->usecs, is_add);
+        }
+    }
+}
+
+/**
+ * \brief 更新分割等时传输描述符占用的周期带宽
+ */
+static void __sitd_bw_update(struct usbh_ehci      *p_ehci,
+                             struct usbh_ehci_sitd *p_sitd,
+                             usb_bool_t             is_add){
+    uint32_t mask = USB_CPU_TO_LE32(p_sitd->hw_u_frame);
+    uint32_t uf;
+
+    for (uf = 0; uf < 8; uf++) {
+        /* 起始分割(输出的数据也在起始分割里)*/
+        if (mask & (1 << uf)) {
+            __periodic_usecs_update(p_ehci, (p_sitd->frame << 3) + uf, p_sitd->p_stream->usecs, is_add);
+        }
+        /* 完成分割(输入的数据在完成分割里)*/
+        if (mask & (1 << (8 + uf))) {
+            __periodic_usecs_update(p_ehci, (p_sitd->frame << 3) + uf, p_sitd->p_stream->c_usecs, is_add);
         }
     }
-    return u_secs;
 }
 
 /**
@@ -1383,6 +1592,8 @@ static int __period_intr_link(struct usbh_ehci    *p_ehci,
             USB_LE_REG_WRITE32(((uint32_t)p_qh & ~0x01f) | __Q_TYPE_QH, p_hw_prev);
         }
     }
+    /* 记录 QH(队列头)占用的周期带宽*/
+    __qh_bw_update(p_ehci, p_qh, USB_TRUE);
     /* QH(队列头)状态设置为已链接*/
     p_qh->state     = __QH_ST_LINKED;
     p_qh->xact_errs = 0;
@@ -1492,8 +1703,8 @@ int usbh_ehci_intr_cancel(struct usbh_ehci    *p_ehci,
     usb_list_node_del(&p_qh->intr_node);
     /* 更新 QH 状态*/
     p_qh->state = __QH_ST_UNLINKED;
-    ///* 删除端点带宽*/
-    //__bdwidth_dec(p_ehci, p_qh);
+    /* 删除 QH 占用的周期带宽*/
+    __qh_bw_update(p_ehci, p_qh, USB_FALSE);
 
     return USB_OK;
 }
@@ -1577,6 +1788,8 @@ __got_phase:
     }
     /* 把 qtd 链表链接到端点结构体的 QH 中*/
     __qtds_link(p_qh, p_qtd_list);
+    /* 加入活跃 QH 集合*/
+    __qh_active_add(p_ehci, p_qh);
 
     /* QH 状态为空闲或未链接*/
     if ((p_qh->state == __QH_ST_IDLE) ||
@@ -1594,7 +1807,7 @@ __got_phase:
 }
 
 /**
- * \brief 扫描中断传输
+ * \brief 扫描中断传输，只访问有未完成 qTD 的 QH
  *
  * \param[in] p_ehci EHCI 结构体
  */
@@ -1604,20 +1817,22 @@ void usbh_ehci_intr_scan(struct usbh_ehci *p_ehci){
     struct usbh_ehci_qh   *p_qh       = NULL;
     int                    ret;
 
-    /* 遍历 EHCI 中断 QH(队列头) 链表*/
+    /* 遍历活跃的中断 QH(队列头) 集合*/
     usb_list_for_each_node_safe(p_node,
                                 p_node_tmp,
-                               &p_ehci->intr_qh_list) {
-        p_qh = usb_container_of(p_node, struct usbh_ehci_qh, intr_node);
+                               &p_ehci->intr_active_list) {
+        p_qh = usb_container_of(p_node, struct usbh_ehci_qh, active_node);
 
         /* 调用 QH(队列头) 处理函数*/
-        ret = usbh_ehci_qh_handle(p_ehci, p_qh);
+        ret = __qh_handle(p_ehci, p_qh);
         if (ret != USB_OK) {
             __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
-            return;
+            break;
         }
-        //todo
+        __qh_active_del(p_qh, USB_FALSE);
     }
+    /* 一次性移交这次扫描完成的请求包*/
+    __ehci_trp_batch_flush(p_ehci);
 }
 
 /**
@@ -2621,6 +2836,8 @@ static void __itd_link(struct usbh_ehci     *p_ehci,
     p_prev->p_itd  = p_itd;
     /* 设置当前等时传输描述符的帧索引*/
     p_itd->frame   = frame;
+    /* 记录等时传输描述符占用的周期带宽*/
+    __itd_bw_update(p_ehci, p_itd, USB_TRUE);
 
     /* 设置硬件数据地址*/
     *p_hw_p = USB_CPU_TO_LE32((uint32_t)p_itd | __Q_TYPE_ITD);
@@ -2767,6 +2984,8 @@ static void __sitd_link(struct usbh_ehci      *p_ehci,
     p_ehci->p_shadow[frame].p_sitd = p_sitd;
     p_sitd->frame   = frame;
     p_ehci->p_periodic[frame] = USB_CPU_TO_LE32((uint32_t)p_sitd | __Q_TYPE_SITD);
+    /* 记录分割等时传输描述符占用的周期带宽*/
+    __sitd_bw_update(p_ehci, p_sitd, USB_TRUE);
 }
 
 /**
@@ -3175,6 +3394,8 @@ __restart:
                     *p_q_p  = q.p_itd->p_next;
                     *p_hw_p = q.p_itd->hw_next;
                     type    = Q_NEXT_TYPE(q.p_itd->hw_next);
+                    /* 删除等时传输描述符占用的周期带宽*/
+                    __itd_bw_update(p_ehci, q.p_itd, USB_FALSE);
                     /* 当前等时传输描述符调用完成回调函数*/
                     modified = __itd_complete(p_ehci, q.p_itd);
                     q = *p_q_p;
@@ -3197,6 +3418,8 @@ __restart:
                     *p_q_p  = q.p_sitd->p_next;
                     *p_hw_p = q.p_sitd->hw_next;
                     type    = Q_NEXT_TYPE(q.p_sitd->hw_next);
+                    /* 删除分割等时传输描述符占用的周期带宽*/
+                    __sitd_bw_update(p_ehci, q.p_sitd, USB_FALSE);
                     /* 已经完成，调用完成回调函数*/
                     modified = __sitd_complete(p_ehci, q.p_sitd);
                     q = *p_q_p;
@@ -3219,5 +3442,7 @@ __restart:
         /* 扫描下一个帧*/
         frame = (frame + 1) & fmask;
     }
+    /* 一次性移交这次扫描完成的请求包*/
+    __ehci_trp_batch_flush(p_ehci);
 }
 
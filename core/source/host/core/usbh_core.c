@@ -17,6 +17,58 @@ struct usbh_core_lib __g_usb_host_lib;
 /*******************************************************************************
  * Code
  ******************************************************************************/
+/**
+ * \brief 取消分散/聚集段的 DMA 映射
+ */
+static void __trp_sg_unmap(struct usbh_trp *p_trp, int n_sg, uint8_t dir){
+    int i;
+
+    for (i = 0; i < n_sg; i++) {
+        if (p_trp->p_sg[i].p_dma) {
+            usb_dma_unmap(p_trp->p_sg[i].p_dma, p_trp->p_sg[i].len, dir);
+            p_trp->p_sg[i].p_dma = NULL;
+        }
+    }
+}
+
+/**
+ * \brief 分散/聚集段逐段 DMA 映射
+ */
+static int __trp_sg_map(struct usbh_trp *p_trp, uint8_t dir){
+    int    i;
+    size_t len = 0;
+
+    if ((p_trp->p_data != NULL) || (p_trp->n_sg <= 0)) {
+        return -USB_EILLEGAL;
+    }
+    /* 等时传输按包描述符划分缓存，不支持分散/聚集*/
+    if (USBH_EP_TYPE_GET(p_trp->p_ep) == USB_EP_TYPE_ISO) {
+        return -USB_ENOTSUP;
+    }
+    for (i = 0; i < p_trp->n_sg; i++) {
+        p_trp->p_sg[i].p_dma = NULL;
+    }
+    for (i = 0; i < p_trp->n_sg; i++) {
+        if ((p_trp->p_sg[i].p_buf == NULL) || (p_trp->p_sg[i].len == 0)) {
+            __trp_sg_unmap(p_trp, i, dir);
+            return -USB_EILLEGAL;
+        }
+        p_trp->p_sg[i].p_dma = usb_dma_map(p_trp->p_sg[i].p_buf,
+                                           p_trp->p_sg[i].len,
+                                           dir);
+        if (p_trp->p_sg[i].p_dma == NULL) {
+            __USB_ERR_INFO("sg %d dma map failed\r\n", i);
+            __trp_sg_unmap(p_trp, i, dir);
+            return -USB_EAGAIN;
+        }
+        len += p_trp->p_sg[i].len;
+    }
+    /* 传输长度为所有段的总长度*/
+    p_trp->len = len;
+
+    return USB_OK;
+}
+
 /**
  * \brief 缓存 DMA 映射
  */
@@ -54,6 +106,10 @@ static int __trp_buf_map(struct usbh_trp *p_trp){
             dir = USB_DMA_TO_DEVICE;
         }
     }
+    /* 分散/聚集传输请求包*/
+    if (p_trp->p_sg != NULL) {
+        return __trp_sg_map(p_trp, dir);
+    }
     /* 检查是否有异常*/
     if (((p_trp->p_data == NULL) && (p_trp->len)) ||
             ((p_trp->p_data != NULL) && (p_trp->len == 0))) {
@@ -78,7 +134,7 @@ static int __trp_buf_map(struct usbh_trp *p_trp){
  * \brief 取消 DMA 映射
  */
 static void __trp_buf_unmap(struct usbh_trp *p_trp){
-    uint8_t dir;
+    uint8_t dir = USB_DMA_TO_DEVICE;
 
     if (p_trp->p_ctrl) {
         if (p_trp->p_ctrl->request_type & USB_DIR_IN) {
@@ -107,6 +163,25 @@ static void __trp_buf_unmap(struct usbh_trp *p_trp){
                       p_trp->len,
                       dir);
     }
+    /* 取消映射分散/聚集段*/
+    if (p_trp->p_sg) {
+        __trp_sg_unmap(p_trp, p_trp->n_sg, dir);
+    }
+}
+
+/**
+ * \brief DMA 映射失败后取消映射，分散/聚集段映射失败时各段已经取消映射，只剩控制请求包
+ */
+static void __trp_buf_map_failed(struct usbh_trp *p_trp){
+    if (p_trp->p_sg != NULL) {
+        if (p_trp->p_ctrl_dma) {
+            usb_dma_unmap(p_trp->p_ctrl_dma,
+                          sizeof(struct usb_ctrlreq),
+                          USB_DMA_TO_DEVICE);
+        }
+    } else {
+        __trp_buf_unmap(p_trp);
+    }
 }
 
 /**
@@ -388,6 +463,12 @@ static int __hc_init(struct usb_hc *p_hc, uint8_t host_idx){
         __USB_ERR_TRACE(MutexCreateErr, "\r\n");
         return -USB_EPERM;
     }
+    p_hc->p_addr0_lock = usb_lib_mutex_create(&__g_usb_host_lib.lib);
+    if (p_hc->p_addr0_lock == NULL) {
+        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+        usb_lib_mutex_destroy(&__g_usb_host_lib.lib, p_hc->p_lock);
+        return -USB_EPERM;
+    }
 #endif
     /* 设置已初始化标志*/
     p_hc->is_init = USB_TRUE;
@@ -400,7 +481,12 @@ static int __hc_init(struct usb_hc *p_hc, uint8_t host_idx){
  */
 static int __hc_deinit(struct usb_hc *p_hc){
 #if USB_OS_EN
-    int ret = usb_lib_mutex_destroy(&__g_usb_host_lib.lib, p_hc->p_lock);
+    int ret = usb_lib_mutex_destroy(&__g_usb_host_lib.lib, p_hc->p_addr0_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
+        return ret;
+    }
+    ret = usb_lib_mutex_destroy(&__g_usb_host_lib.lib, p_hc->p_lock);
     if (ret != USB_OK) {
         __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
         return ret;
@@ -494,6 +580,12 @@ int usb_hc_destory(struct usb_hc *p_hc){
         return -USB_EINVAL;
     }
 
+    /* 等待根集线器端口上的后台枚举结束*/
+    ret = usbh_basic_hub_enum_wait(&p_hc->root_hub, USBH_DEV_ENUM_WAIT_TIMEOUT);
+    if (ret != USB_OK) {
+        return ret;
+    }
+
     ret = usb_lib_dev_del(&__g_usb_host_lib.lib, &p_hc->node);
     if (ret != USB_OK) {
         return ret;
@@ -887,6 +979,44 @@ int usb_hc_dev_addr_alloc(struct usb_hc *p_hc, uint8_t *p_addr){
     return ret;
 }
 
+/**
+ * \brief USB 主机默认地址上锁，同一主机上同一时间只允许一个设备处于默认地址(地址 0)
+ *
+ * \param[in] p_hc USB 主机
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_hc_addr0_lock(struct usb_hc *p_hc){
+#if USB_OS_EN
+    int ret = usb_mutex_lock(p_hc->p_addr0_lock, USB_HC_ADDR0_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief USB 主机默认地址解锁
+ *
+ * \param[in] p_hc USB 主机
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_hc_addr0_unlock(struct usb_hc *p_hc){
+#if USB_OS_EN
+    int ret = usb_mutex_unlock(p_hc->p_addr0_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
 /**
  * \brief USB 主机设备地址释放
  *
@@ -1015,6 +1145,46 @@ int usb_hc_ep_disable(struct usb_hc        *p_hc,
     return ret;
 }
 
+/**
+ * \brief USB 主机传输请求上锁，控制器驱动自己加锁时不持有主机锁
+ */
+static int __hc_xfer_lock(struct usb_hc *p_hc, struct usb_hc_head *p_hc_head){
+#if USB_OS_EN
+    int ret;
+
+    if (p_hc_head->p_controller_drv->is_xfer_locked == USB_TRUE) {
+        return USB_OK;
+    }
+    ret = usb_mutex_lock(p_hc->p_lock, USB_HC_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief USB 主机传输请求解锁
+ */
+static int __hc_xfer_unlock(struct usb_hc *p_hc, struct usb_hc_head *p_hc_head){
+#if USB_OS_EN
+    int ret;
+
+    if (p_hc_head->p_controller_drv->is_xfer_locked == USB_TRUE) {
+        return USB_OK;
+    }
+    ret = usb_mutex_unlock(p_hc->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
 /**
  * \brief USB 控制器传输请求
  *
@@ -1027,9 +1197,7 @@ int usb_hc_xfer_request(struct usb_hc   *p_hc,
                         struct usbh_trp *p_trp){
     int                 ret       = USB_OK;
     struct usb_hc_head *p_hc_head = NULL;
-#if USB_OS_EN
     int                 ret_tmp;
-#endif
 
     /* 获取主机控制器头*/
     ret = usb_host_controller_get(p_hc, (void **)&p_hc_head);
@@ -1046,24 +1214,102 @@ int usb_hc_xfer_request(struct usb_hc   *p_hc,
     ret = __trp_buf_map(p_trp);
     if (ret != USB_OK) {
         __USB_ERR_INFO("trp dma map failed(%d)", ret);
+        /* 分散/聚集段映射失败时各段已经取消映射，不能继续提交*/
+        if (p_trp->p_sg != NULL) {
+            __trp_buf_map_failed(p_trp);
+            return ret;
+        }
     }
 
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_hc->p_lock, USB_HC_MUTEX_TIMEOUT);
+    ret = __hc_xfer_lock(p_hc, p_hc_head);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
         return ret;
     }
-#endif
     ret = p_hc_head->p_controller_drv->p_fn_xfer_request(p_hc, p_trp);
 
-#if USB_OS_EN
-    ret_tmp = usb_mutex_unlock(p_hc->p_lock);
+    ret_tmp = __hc_xfer_unlock(p_hc, p_hc_head);
     if (ret_tmp != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
         return ret_tmp;
     }
-#endif
+    return ret;
+}
+
+/**
+ * \brief USB 主机批量请求传输函数，所有传输请求包必须属于同一个端点
+ *
+ * \param[in] p_hc   USB 主机结构体
+ * \param[in] p_trps 传输请求包数组
+ * \param[in] n_trps 传输请求包数量
+ *
+ * \retval 成功返回已提交的传输请求包数量(没有提交的传输请求包已取消映射，状态为错误码)，
+ *         一个都没有提交返回错误码。任意一个传输请求包 DMA 映射失败时整批都不提交，
+ *         直接返回错误码
+ */
+int usb_hc_xfer_request_batch(struct usb_hc    *p_hc,
+                              struct usbh_trp **p_trps,
+                              int               n_trps){
+    int                 i, ret    = USB_OK;
+    struct usb_hc_head *p_hc_head = NULL;
+    int                 ret_tmp;
+
+    /* 获取主机控制器头*/
+    ret = usb_host_controller_get(p_hc, (void **)&p_hc_head);
+    if (ret != USB_OK) {
+        return ret;
+    }
+
+    if ((p_hc_head->p_controller_drv == NULL) ||
+            (p_hc_head->p_controller_drv->p_fn_xfer_request == NULL)) {
+        return -USB_EILLEGAL;
+    }
+
+    /* 内存 DMA 映射*/
+    for (i = 0; i < n_trps; i++) {
+        ret = __trp_buf_map(p_trps[i]);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("trp dma map failed(%d)", ret);
+            goto __map_failed;
+        }
+    }
+
+    ret_tmp = USB_OK;
+    ret = __hc_xfer_lock(p_hc, p_hc_head);
+    if (ret != USB_OK) {
+        goto __unmap;
+    }
+    /* 控制器支持批量请求则一次提交，否则逐个提交*/
+    if (p_hc_head->p_controller_drv->p_fn_xfer_request_batch != NULL) {
+        ret = p_hc_head->p_controller_drv->p_fn_xfer_request_batch(p_hc, p_trps, n_trps);
+    } else {
+        for (i = 0; i < n_trps; i++) {
+            ret = p_hc_head->p_controller_drv->p_fn_xfer_request(p_hc, p_trps[i]);
+            if (ret != USB_OK) {
+                break;
+            }
+        }
+        if (i > 0) {
+            ret = i;
+        }
+    }
+
+    ret_tmp = __hc_xfer_unlock(p_hc, p_hc_head);
+__unmap:
+    /* 没有提交的传输请求包取消映射并置为失败，不会再有完成回调*/
+    for (i = (ret > 0) ? ret : 0; i < n_trps; i++) {
+        __trp_buf_unmap(p_trps[i]);
+        p_trps[i]->status = (ret < 0) ? ret : -USB_EAGAIN;
+    }
+    if (ret_tmp != USB_OK) {
+        return ret_tmp;
+    }
+    return ret;
+
+__map_failed:
+    __trp_buf_map_failed(p_trps[i]);
+    /* 已经映射的传输请求包取消映射，整批都不提交*/
+    while (--i >= 0) {
+        __trp_buf_unmap(p_trps[i]);
+    }
     return ret;
 }
 
@@ -1079,9 +1325,7 @@ int usb_hc_xfer_cancel(struct usb_hc   *p_hc,
                        struct usbh_trp *p_trp){
     int                 ret       = USB_OK;
     struct usb_hc_head *p_hc_head = NULL;
-#if USB_OS_EN
     int                 ret_tmp;
-#endif
 
     /* 获取主机控制器头*/
     ret = usb_host_controller_get(p_hc, (void **)&p_hc_head);
@@ -1094,23 +1338,17 @@ int usb_hc_xfer_cancel(struct usb_hc   *p_hc,
         return -USB_EILLEGAL;
     }
 
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_hc->p_lock, USB_HC_MUTEX_TIMEOUT);
+    ret = __hc_xfer_lock(p_hc, p_hc_head);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
         return ret;
     }
-#endif
     /* 调用控制器传输取消函数*/
     ret = p_hc_head->p_controller_drv->p_fn_xfer_cancel(p_hc, p_trp);
 
-#if USB_OS_EN
-    ret_tmp = usb_mutex_unlock(p_hc->p_lock);
+    ret_tmp = __hc_xfer_unlock(p_hc, p_hc_head);
     if (ret_tmp != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret_tmp);
         return ret_tmp;
     }
-#endif
     return ret;
 }
 
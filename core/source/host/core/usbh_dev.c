@@ -32,10 +32,11 @@ extern void usbh_dev_monitor_chk(uint16_t  vid,
                                  uint8_t   type);
 extern int usbh_ep_hcpriv_init(struct usbh_endpoint *p_ep);
 extern int usbh_ep_hcpriv_deinit(struct usbh_endpoint *p_ep);
-extern void usbh_trp_sync_xfer_done(void *p_arg);
-extern int usbh_trp_sync_xfer_wait(struct usbh_endpoint *p_ep, int time_out);
 extern int usb_hc_xfer_request(struct usb_hc     *p_hc,
                                struct usbh_trp   *p_trp);
+extern int usb_hc_xfer_request_batch(struct usb_hc    *p_hc,
+                                     struct usbh_trp **p_trps,
+                                     int               n_trps);
 extern int usb_hc_xfer_cancel(struct usb_hc   *p_hc,
                               struct usbh_trp *p_trp);
 
@@ -426,6 +427,70 @@ int usbh_intf_ep_get(struct usbh_interface *p_intf,
     return -USB_ENODEV;
 }
 
+/**
+ * \brief USB 主机设备端点锁初始化
+ */
+int usbh_dev_ep_lock_init(struct usbh_endpoint *p_ep){
+#if USB_OS_EN
+    p_ep->p_lock = usb_lib_mutex_create(&__g_usb_host_lib.lib);
+    if (p_ep->p_lock == NULL) {
+        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+        return -USB_EPERM;
+    }
+#endif
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机设备端点锁反初始化
+ */
+int usbh_dev_ep_lock_deinit(struct usbh_endpoint *p_ep){
+#if USB_OS_EN
+    int ret;
+
+    if (p_ep->p_lock == NULL) {
+        return USB_OK;
+    }
+    ret = usb_lib_mutex_destroy(&__g_usb_host_lib.lib, p_ep->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
+        return ret;
+    }
+    p_ep->p_lock = NULL;
+#endif
+    return USB_OK;
+}
+
+/**
+ * \brief USB 主机设备端点上锁
+ */
+int usbh_dev_ep_lock(struct usbh_endpoint *p_ep){
+#if USB_OS_EN
+    int ret = usb_mutex_lock(p_ep->p_lock, USBH_DEV_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "%d\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief USB 主机设备端点解锁
+ */
+int usbh_dev_ep_unlock(struct usbh_endpoint *p_ep){
+#if USB_OS_EN
+    int ret = usb_mutex_unlock(p_ep->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "%d\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
 /**
  * \brief USB 主机传输请求包提交
  *
@@ -434,10 +499,7 @@ int usbh_intf_ep_get(struct usbh_interface *p_intf,
  * \retval 成功返回 USB_OK
  */
 int usbh_trp_submit(struct usbh_trp *p_trp){
-    int ret;
-#if USB_OS_EN
-    int ret_tmp;
-#endif
+    int ret, ret_tmp;
 
     if (p_trp == NULL) {
         return -USB_EINVAL;
@@ -447,13 +509,12 @@ int usbh_trp_submit(struct usbh_trp *p_trp){
     }
 
     struct usbh_device *p_usb_dev = p_trp->p_ep->p_usb_dev;
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_usb_dev->p_lock, USBH_DEV_MUTEX_TIMEOUT);
+
+    /* 只持有端点锁，同一设备不同端点的提交互不阻塞，设备锁只用于插入/拔出和配置变化*/
+    ret = usbh_dev_ep_lock(p_trp->p_ep);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "%d\r\n", ret);
         return ret;
     }
-#endif
     /* 如果端点是控制端点且控制请求包是空的，返回错误*/
     if ((USBH_EP_TYPE_GET(p_trp->p_ep) == USB_EP_TYPE_CTRL) &&
             (p_trp->p_ctrl == NULL)) {
@@ -488,13 +549,91 @@ int usbh_trp_submit(struct usbh_trp *p_trp){
     ret = usb_hc_xfer_request(p_usb_dev->p_hc, p_trp);
 
 __exit:
-#if USB_OS_EN
-    ret_tmp = usb_mutex_unlock(p_usb_dev->p_lock);
+    ret_tmp = usbh_dev_ep_unlock(p_trp->p_ep);
+    if (ret_tmp != USB_OK) {
+        return ret_tmp;
+    }
+    return ret;
+}
+
+/**
+ * \brief USB 主机批量提交传输请求包
+ *
+ * 所有传输请求包必须属于同一个端点，设备锁、参数检查和端点使能在整个批次只做一次，
+ * 控制器支持的话所有传输请求包一次链接到端点的调度上。
+ *
+ * \param[in] p_trps 要提交的传输请求包数组
+ * \param[in] n_trps 传输请求包数量
+ *
+ * \retval 成功返回已提交的传输请求包数量，一个都没有提交返回错误码
+ */
+int usbh_trp_submit_batch(struct usbh_trp **p_trps, int n_trps){
+    struct usbh_endpoint *p_ep      = NULL;
+    struct usbh_device   *p_usb_dev = NULL;
+    int                   i, ret, ret_tmp;
+
+    if ((p_trps == NULL) || (n_trps <= 0) || (p_trps[0] == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    p_ep = p_trps[0]->p_ep;
+    if ((p_ep == NULL) || (p_ep->p_usb_dev == NULL)) {
+        return -USB_EILLEGAL;
+    }
+
+    for (i = 0; i < n_trps; i++) {
+        if (p_trps[i] == NULL) {
+            return -USB_EINVAL;
+        }
+        /* 只能是同一个端点*/
+        if (p_trps[i]->p_ep != p_ep) {
+            return -USB_EILLEGAL;
+        }
+        /* 如果端点是控制端点且控制请求包是空的，返回错误*/
+        if ((USBH_EP_TYPE_GET(p_ep) == USB_EP_TYPE_CTRL) &&
+                (p_trps[i]->p_ctrl == NULL)) {
+            return -USB_EILLEGAL;
+        }
+    }
+
+    /* 如果端点的最大包尺寸小于等于0，返回错误*/
+    if (USBH_EP_MPS_GET(p_ep) <= 0) {
+        __USB_ERR_INFO("endpoint max packet size illegal(%d)\r\n", USBH_EP_MPS_GET(p_ep));
+        return -USB_EILLEGAL;
+    }
+
+    p_usb_dev = p_ep->p_usb_dev;
+
+    ret = usbh_dev_ep_lock(p_ep);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    /* 如果是等时端点，填充等时传输包的特定的字段*/
+    if (USBH_EP_TYPE_GET(p_ep) == USB_EP_TYPE_ISO) {
+        for (i = 0; i < n_trps; i++) {
+            __iso_trp_fill(p_trps[i]);
+        }
+    }
+
+    /* 如果设备不在连接状态，解锁返回错误*/
+    if (!USBH_IS_DEV_INJECT(p_usb_dev)) {
+        ret = -USB_ENODEV;
+        goto __exit;
+    }
+
+    /* 使能端点*/
+    ret = usbh_dev_ep_enable(p_ep);
+    if (ret != USB_OK) {
+        goto __exit;
+    }
+
+    ret = usb_hc_xfer_request_batch(p_usb_dev->p_hc, p_trps, n_trps);
+
+__exit:
+    ret_tmp = usbh_dev_ep_unlock(p_ep);
     if (ret_tmp != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "%d\r\n", ret_tmp);
         return ret_tmp;
     }
-#endif
     return ret;
 }
 
@@ -506,11 +645,8 @@ __exit:
  * \retval 成功返回 USB_OK
  */
 int usbh_trp_xfer_cancel(struct usbh_trp *p_trp){
-    int                 ret;
+    int                 ret, ret_tmp;
     struct usbh_device *p_usb_dev = NULL;
-#if USB_OS_EN
-    int                 ret_tmp;
-#endif
 
     if (p_trp == NULL) {
         return -USB_EINVAL;
@@ -521,29 +657,150 @@ int usbh_trp_xfer_cancel(struct usbh_trp *p_trp){
 
     p_usb_dev = p_trp->p_ep->p_usb_dev;
 
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_usb_dev->p_lock, USBH_DEV_MUTEX_TIMEOUT);
+    ret = usbh_dev_ep_lock(p_trp->p_ep);
     if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "%d\r\n", ret);
         return ret;
     }
-#endif
     ret = usb_hc_xfer_cancel(p_usb_dev->p_hc, p_trp);
-#if USB_OS_EN
-    ret_tmp = usb_mutex_unlock(p_usb_dev->p_lock);
+
+    ret_tmp = usbh_dev_ep_unlock(p_trp->p_ep);
     if (ret_tmp != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "%d\r\n", ret_tmp);
         return ret_tmp;
     }
-#endif
     return ret;
 }
 
 /**
- * \brief USB 主机提交传输请求包
+ * \brief 销毁同步传输完成对象
+ */
+static void __trp_sync_destroy(struct usbh_trp_sync *p_sync){
+#if USB_OS_EN
+    int ret;
+
+    if (p_sync->p_sem) {
+        ret = usb_lib_sem_destroy(&__g_usb_host_lib.lib, p_sync->p_sem);
+        if (ret != USB_OK) {
+            __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret);
+        }
+    }
+#endif
+    usb_lib_mfree(&__g_usb_host_lib.lib, p_sync);
+}
+
+/**
+ * \brief 获取同步传输完成对象，池里没有空闲的则新建一个
+ */
+static struct usbh_trp_sync *__trp_sync_get(void){
+    struct usbh_trp_sync *p_sync = NULL;
+#if USB_OS_EN
+    int                   ret;
+
+    ret = usb_mutex_lock(__g_usbh_dev_lib.p_sync_lock, USBH_DEV_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return NULL;
+    }
+#endif
+    if (!usb_list_head_is_empty(&__g_usbh_dev_lib.sync_free)) {
+        p_sync = usb_container_of(__g_usbh_dev_lib.sync_free.p_next, struct usbh_trp_sync, node);
+        usb_list_node_del(&p_sync->node);
+        __g_usbh_dev_lib.n_sync_free--;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_unlock(__g_usbh_dev_lib.p_sync_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+    if (p_sync != NULL) {
+        return p_sync;
+    }
+
+    p_sync = usb_lib_malloc(&__g_usb_host_lib.lib, sizeof(struct usbh_trp_sync));
+    if (p_sync == NULL) {
+        return NULL;
+    }
+    memset(p_sync, 0, sizeof(struct usbh_trp_sync));
+#if USB_OS_EN
+    p_sync->p_sem = usb_lib_sem_create(&__g_usb_host_lib.lib);
+    if (p_sync->p_sem == NULL) {
+        __USB_ERR_TRACE(SemCreateErr, "\r\n");
+        usb_lib_mfree(&__g_usb_host_lib.lib, p_sync);
+        return NULL;
+    }
+#endif
+    return p_sync;
+}
+
+/**
+ * \brief 释放同步传输完成对象，池满则销毁
+ */
+static void __trp_sync_put(struct usbh_trp_sync *p_sync){
+    usb_bool_t is_free = USB_FALSE;
+#if USB_OS_EN
+    int        ret;
+
+    /* 清除超时后才到的完成信号*/
+    while (usb_sem_take(p_sync->p_sem, USB_NO_WAIT) == USB_OK);
+
+    ret = usb_mutex_lock(__g_usbh_dev_lib.p_sync_lock, USBH_DEV_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        __trp_sync_destroy(p_sync);
+        return;
+    }
+#endif
+    if (__g_usbh_dev_lib.n_sync_free < USBH_TRP_SYNC_POOL_MAX) {
+        usb_list_node_add_tail(&p_sync->node, &__g_usbh_dev_lib.sync_free);
+        __g_usbh_dev_lib.n_sync_free++;
+        is_free = USB_TRUE;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_unlock(__g_usbh_dev_lib.p_sync_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+    if (is_free == USB_FALSE) {
+        __trp_sync_destroy(p_sync);
+    }
+}
+
+/**
+ * \brief 同步传输完成函数
+ */
+static void __trp_sync_done(void *p_arg){
+#if USB_OS_EN
+    int                   ret;
+    struct usbh_trp_sync *p_sync = (struct usbh_trp_sync *)p_arg;
+
+    ret = usb_sem_give(p_sync->p_sem);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(SemGiveErr, "(%d)\r\n", ret);
+    }
+#endif
+}
+
+/**
+ * \brief 同步传输等待函数
+ */
+static int __trp_sync_wait(struct usbh_trp_sync *p_sync, int time_out){
+    if ((time_out < 0) && (time_out != USB_WAIT_FOREVER)) {
+        return -USB_EILLEGAL;
+    }
+#if USB_OS_EN
+    return usb_sem_take(p_sync->p_sem, time_out);
+#else
+    return -USB_ENOTSUP;
+#endif
+}
+
+/**
+ * \brief USB 主机提交传输请求包，每次传输使用独立的完成对象和 SETUP 包，
+ *        多个线程可以同时在同一个端点上做同步传输
  *
  * \param[in] p_ep     使用的端点
- * \param[in] p_ctrl   控制传输请求结构体
+ * \param[in] p_ctrl   控制传输请求结构体(会复制一份，调用者的可以放在栈上)
  * \param[in] p_data   要写/读的数据缓存
  * \param[in] len      要写/读的数据长度
  * \param[in] time_out 超时时间
@@ -557,8 +814,9 @@ int usbh_trp_sync_xfer(struct usbh_endpoint  *p_ep,
                        int                    len,
                        int                    time_out,
                        int                    flag){
-    int             ret, ret_tmp;
-    struct usbh_trp trp;
+    int                   ret, ret_tmp;
+    struct usbh_trp       trp;
+    struct usbh_trp_sync *p_sync = NULL;
 
     if ((p_ep == NULL) ||
             ((p_ctrl == NULL) && (p_data == NULL)) ||
@@ -566,25 +824,37 @@ int usbh_trp_sync_xfer(struct usbh_endpoint  *p_ep,
         return -USB_EINVAL;
     }
 
+    p_sync = __trp_sync_get();
+    if (p_sync == NULL) {
+        return -USB_ENOMEM;
+    }
+
     /* 填充传输请求包*/
     trp.p_ep      = p_ep;
-    trp.p_ctrl    = p_ctrl;
+    trp.p_ctrl    = NULL;
     trp.p_data    = p_data;
     trp.len       = len;
-    trp.p_fn_done = usbh_trp_sync_xfer_done;      /* 传输完成回调函数*/
-    trp.p_arg     = (void *)p_ep;                 /* 传输完成回调函数参数*/
+    trp.p_fn_done = __trp_sync_done;              /* 传输完成回调函数*/
+    trp.p_arg     = (void *)p_sync;               /* 传输完成回调函数参数*/
     trp.act_len   = 0;                            /* 传输请求包的实际传输长度*/
     trp.status    = -USB_EINPROGRESS;             /* 本次传输状态*/
     trp.flag      = flag;
+    trp.p_sg      = NULL;
+    trp.n_sg      = 0;
+
+    if (p_ctrl != NULL) {
+        p_sync->ctrl = *p_ctrl;
+        trp.p_ctrl   = &p_sync->ctrl;
+    }
 
     /* 提交传输请求包*/
     ret = usbh_trp_submit(&trp);
     if (ret != USB_OK) {
-        return ret;
+        goto __end;
     }
 
     /* 等待传输完成*/
-    ret = usbh_trp_sync_xfer_wait(p_ep, time_out);
+    ret = __trp_sync_wait(p_sync, time_out);
     if (ret != USB_OK) {
         goto __failed;
     }
@@ -594,17 +864,19 @@ int usbh_trp_sync_xfer(struct usbh_endpoint  *p_ep,
     } else {
         ret = trp.status;
     }
-
-    return ret;
+    goto __end;
 __failed:
     /* 取消传输请求包*/
     ret_tmp = usbh_trp_xfer_cancel(&trp);
     if (ret_tmp != USB_OK) {
         __USB_ERR_INFO("USB host TRP cancel failed(%d)\r\n", ret_tmp);
-        return ret_tmp;
+        ret = ret_tmp;
     }
-    /* 等待取消传输请求包完成*/
-    usbh_trp_sync_xfer_wait(p_ep, time_out);
+    /* 传输请求包在栈上，完成回调返回前不能返回，也不能回收完成对象
+     *(取消失败时传输可能刚好完成，完成回调一定会调用)*/
+    __trp_sync_wait(p_sync, USB_WAIT_FOREVER);
+__end:
+    __trp_sync_put(p_sync);
 
     return ret;
 }
@@ -633,6 +905,8 @@ int usbh_ctrl_trp_sync_xfer(struct usbh_endpoint *p_ep,
                             void                 *p_data,
                             int                   time_out,
                             int                   flag){
+    struct usb_ctrlreq ctrl;
+
     if (p_ep == NULL) {
         return -USB_EINVAL;
     }
@@ -640,15 +914,15 @@ int usbh_ctrl_trp_sync_xfer(struct usbh_endpoint *p_ep,
         return -USB_EILLEGAL;
     }
 
-    /* 填充设备的控制传输请求结构体*/
-    p_ep->p_usb_dev->p_ctrl->request      = req;                     /* 具体的USB请求*/
-    p_ep->p_usb_dev->p_ctrl->request_type = type;                    /* 数据方向，数据类型，请求目标*/
-    p_ep->p_usb_dev->p_ctrl->value        = USB_CPU_TO_LE16(val);    /* 参数*/
-    p_ep->p_usb_dev->p_ctrl->index        = USB_CPU_TO_LE16(idx);    /* 索引*/
-    p_ep->p_usb_dev->p_ctrl->length       = USB_CPU_TO_LE16(len);    /* 请求的数据长度*/
+    /* 填充控制传输请求结构体*/
+    ctrl.request      = req;                     /* 具体的USB请求*/
+    ctrl.request_type = type;                    /* 数据方向，数据类型，请求目标*/
+    ctrl.value        = USB_CPU_TO_LE16(val);    /* 参数*/
+    ctrl.index        = USB_CPU_TO_LE16(idx);    /* 索引*/
+    ctrl.length       = USB_CPU_TO_LE16(len);    /* 请求的数据长度*/
     /* 发送传输请求包*/
     return usbh_trp_sync_xfer(p_ep,
-                              p_ep->p_usb_dev->p_ctrl,
+                              &ctrl,
                               p_data,
                               len,
                               time_out,
@@ -862,11 +1136,6 @@ static int __dev_create(struct usb_hc         *p_hc,
     }
 #endif
 
-    p_usb_dev->p_ctrl = (struct usb_ctrlreq *)usb_lib_malloc(&__g_usb_host_lib.lib, sizeof(struct usb_ctrlreq));
-    if (p_usb_dev->p_ctrl == NULL) {
-        return -USB_ENOMEM;
-    }
-
     p_usb_dev->p_hc        = p_hc;                 /* 填充USB主机结构体*/
     p_usb_dev->p_hub_basic = p_hub_basic;          /* 填充集线器结构体*/
     p_usb_dev->port        = port;                 /* 填充所属集线器端口号*/
@@ -883,6 +1152,10 @@ static int __dev_create(struct usb_hc         *p_hc,
     p_usb_dev->ep0.p_hw_priv  = NULL;
     p_usb_dev->ep0.p_hc_priv  = NULL;
 
+    ret = usbh_dev_ep_lock_init(&p_usb_dev->ep0);
+    if (ret != USB_OK) {
+        return ret;
+    }
     /* 初始化私有数据域*/
     ret = usbh_ep_hcpriv_init(&p_usb_dev->ep0);
     if (ret != USB_OK) {
@@ -907,6 +1180,25 @@ static int __dev_create(struct usb_hc         *p_hc,
     return USB_OK;
 }
 
+/**
+ * \brief USB 主机设备端点加锁禁能，等待端点上正在进行的提交结束
+ */
+static int __dev_ep_disable(struct usbh_endpoint *p_ep){
+    int ret, ret_tmp;
+
+    ret = usbh_dev_ep_lock(p_ep);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    ret = usbh_dev_ep_disable(p_ep);
+
+    ret_tmp = usbh_dev_ep_unlock(p_ep);
+    if (ret_tmp != USB_OK) {
+        return ret_tmp;
+    }
+    return ret;
+}
+
 /**
  * \brief 销毁 USB 设备结构体
  *
@@ -923,7 +1215,7 @@ static int __dev_destroy(struct usbh_device *p_usb_dev){
     for (i = 0; i < 16; i++) {
         /* 禁用主机输入端点*/
         if (p_usb_dev->p_ep_in[i]) {
-            ret = usbh_dev_ep_disable(p_usb_dev->p_ep_in[i]);
+            ret = __dev_ep_disable(p_usb_dev->p_ep_in[i]);
             if (ret != USB_OK) {
                 return ret;
             }
@@ -932,7 +1224,7 @@ static int __dev_destroy(struct usbh_device *p_usb_dev){
         }
         /* 禁用主机输出端点*/
         if (p_usb_dev->p_ep_out[i]) {
-            ret = usbh_dev_ep_disable(p_usb_dev->p_ep_out[i]);
+            ret = __dev_ep_disable(p_usb_dev->p_ep_out[i]);
             if (ret != USB_OK) {
                 return ret;
             }
@@ -944,16 +1236,16 @@ static int __dev_destroy(struct usbh_device *p_usb_dev){
     p_usb_dev->p_ep_in[0]  = NULL;
     p_usb_dev->p_ep_out[0] = NULL;
 
-    if (p_usb_dev->p_ctrl) {
-        usb_lib_mfree(&__g_usb_host_lib.lib, p_usb_dev->p_ctrl);
-    }
-
     if (p_usb_dev->p_dev_desc) {
         usb_lib_mfree(&__g_usb_host_lib.lib, p_usb_dev->p_dev_desc);
     }
 
     usbh_ep_hcpriv_deinit(&p_usb_dev->ep0);
 
+    ret = usbh_dev_ep_lock_deinit(&p_usb_dev->ep0);
+    if (ret != USB_OK) {
+        return ret;
+    }
 #if USB_OS_EN
     if (p_usb_dev->p_lock) {
         ret = usb_lib_mutex_destroy(&__g_usb_host_lib.lib, p_usb_dev->p_lock);
@@ -976,6 +1268,19 @@ static int __dev_inject(struct usbh_device *p_usb_dev){
     int     ret;
     uint8_t i;
 
+    __USB_INFO("USB host new device (vid:%04x_pid:%04x)\r\n",
+                  USB_CPU_TO_LE16(p_usb_dev->p_dev_desc->id_vendor),
+                  USB_CPU_TO_LE16(p_usb_dev->p_dev_desc->id_product));
+
+    /* 字符串描述符在第一次使用时才获取，这里只打印已经有的(已知设备从缓存里得到)*/
+    if (p_usb_dev->p_mft) {
+        __USB_INFO("    manufacturer: %s\r\n", p_usb_dev->p_mft);
+    }
+
+    if (p_usb_dev->p_pdt) {
+        __USB_INFO("    product: %s\r\n", p_usb_dev->p_pdt);
+    }
+
     if (p_usb_dev->cfg.p_funs) {
         for (i = 0; i < p_usb_dev->cfg.n_funs; i++) {
             ret = usbh_dev_ref_get(p_usb_dev);
@@ -1072,24 +1377,58 @@ static int __dev_eject(struct usbh_device *p_usb_dev){
 
 
 /**
- * \brief USB 主机基础集线器端口设备连接
- *
- * \param[in] p_hub_basic 基本集线器
- * \param[in] port_num    集线器端口号
- *
- * \retval 成功返回 USB_OK
+ * \brief 后台枚举上锁
  */
-int usbh_basic_hub_dev_connect(struct usbh_hub_basic *p_hub_basic,
-                               uint8_t                port_num){
+static int __enum_lock(void){
+#if USB_OS_EN
+    int ret = usb_mutex_lock(__g_usbh_dev_lib.p_lock, USBH_DEV_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+    }
+    return ret;
+#else
+    return USB_OK;
+#endif
+}
+
+/**
+ * \brief 后台枚举解锁
+ */
+static void __enum_unlock(void){
+#if USB_OS_EN
+    int ret = usb_mutex_unlock(__g_usbh_dev_lib.p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+}
+
+/**
+ * \brief 获取集线器端口在枚举位图中的位，端口超出位图范围返回 0
+ */
+static uint32_t __hub_port_bit(struct usbh_hub_basic *p_hub_basic, uint8_t port_num){
+    int port_tmp = port_num;
+
+    /* 普通集线器设备的端口号是由 1 开始的，根集线器设备的端口号是由 0 开始的 */
+    if (p_hub_basic->p_usb_fun != NULL) {
+        port_tmp--;
+    }
+    if ((port_tmp < 0) || (port_tmp >= 32)) {
+        return 0;
+    }
+    return (1u << port_tmp);
+}
+
+/**
+ * \brief USB 主机基础集线器端口设备连接(同步枚举)
+ */
+static int __dev_connect(struct usbh_hub_basic *p_hub_basic,
+                         uint8_t                port_num){
     struct usbh_device *p_usb_dev = NULL;
     struct usb_hc      *p_hc      = NULL;
     int                 i, ret;
     usb_bool_t          is_port_connect;
 
-    if (p_hub_basic == NULL) {
-        return -USB_EINVAL;
-    }
-
     /* 获取 USB 主机*/
     if (p_hub_basic->p_usb_fun != NULL){
         p_hc = p_hub_basic->p_usb_fun->p_usb_dev->p_hc;
@@ -1121,7 +1460,7 @@ int usbh_basic_hub_dev_connect(struct usbh_hub_basic *p_hub_basic,
 
         usbh_dev_ep_reset(&p_usb_dev->ep0);
 
-        usb_mdelay(100);
+        usb_mdelay(p_usb_dev->retry_delay);
     }
 
     if (ret != USB_OK) {
@@ -1137,22 +1476,6 @@ int usbh_basic_hub_dev_connect(struct usbh_hub_basic *p_hub_basic,
     }
     __USB_INFO_NEW_LINE();
 
-    __USB_INFO("USB host new device (vid:%04x_pid:%04x)\r\n",
-                  USB_CPU_TO_LE16(p_usb_dev->p_dev_desc->id_vendor),
-                  USB_CPU_TO_LE16(p_usb_dev->p_dev_desc->id_product));
-
-    if (p_usb_dev->p_mft) {
-        __USB_INFO("    manufacturer: %s\r\n", p_usb_dev->p_mft);
-    }
-
-    if (p_usb_dev->p_pdt) {
-        __USB_INFO("    product: %s\r\n", p_usb_dev->p_pdt);
-    }
-
-    if (p_usb_dev->p_snum) {
-        __USB_INFO("    serial: %s\r\n", p_usb_dev->p_snum);
-    }
-
     ret = __dev_inject(p_usb_dev);
     if (ret != USB_OK) {
         __USB_ERR_INFO("USB host device inject failed(%d)\r\n", ret);
@@ -1170,22 +1493,13 @@ __failed:
 
 /**
  * \brief USB 主机基础集线器端口设备断开
- *
- * \param[in] p_hub_basic 基本集线器
- * \param[in] port_num    集线器端口号
- *
- * \retval 成功返回 USB_OK
  */
-int usbh_basic_hub_dev_disconnect(struct usbh_hub_basic *p_hub_basic,
-                                  uint8_t                port_num){
+static int __dev_disconnect(struct usbh_hub_basic *p_hub_basic,
+                            uint8_t                port_num){
     int                 ret       = USB_OK;
     int                 port_tmp;
     struct usbh_device *p_usb_dev = NULL;
 
-    if (p_hub_basic == NULL) {
-        return -USB_EINVAL;
-    }
-
     if (p_hub_basic->p_usb_fun != NULL){
         /* 普通集线器设备的端口号是由 1 开始的，获取结构体时需要减 1 */
         port_tmp = port_num - 1;
@@ -1213,6 +1527,231 @@ int usbh_basic_hub_dev_disconnect(struct usbh_hub_basic *p_hub_basic,
     return ret;
 }
 
+/**
+ * \brief USB 主机设备后台枚举工作函数
+ */
+static void __dev_enum_job(void *p_arg){
+    struct usbh_dev_enum_job *p_enum_job  = (struct usbh_dev_enum_job *)p_arg;
+    struct usbh_hub_basic    *p_hub_basic = p_enum_job->p_hub_basic;
+    uint8_t                   port_num    = p_enum_job->port_num;
+    uint32_t                  bit         = __hub_port_bit(p_hub_basic, port_num);
+    usb_bool_t                is_cancel;
+    int                       ret;
+
+    ret = __dev_connect(p_hub_basic, port_num);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("USB host hub port %d connect failed(%d)\r\n", port_num, ret);
+    }
+
+    while (__enum_lock() != USB_OK) {
+        usb_mdelay(1);
+    }
+    is_cancel = (p_hub_basic->cancel_map & bit) ? USB_TRUE : USB_FALSE;
+    p_hub_basic->cancel_map &= ~bit;
+    if (is_cancel == USB_TRUE) {
+        p_hub_basic->remove_map |= bit;
+    }
+    __enum_unlock();
+
+    /* 枚举过程中端口发生过断开，本次枚举的设备交给集线器线程移除。移除集线器设备时要等待
+     * 下级端口的枚举工作，在工作中等待其它工作在单线程的工作后端上会死锁*/
+    if (is_cancel == USB_TRUE) {
+        ret = usbh_hub_evt_add(&p_hub_basic->evt);
+        if (ret != USB_OK) {
+            __USB_ERR_INFO("hub event add failed(%d)\r\n", ret);
+        }
+    }
+
+    /* 工作结束后再清除端口枚举标志，集线器释放时以此判断是否还有工作引用集线器*/
+    while (__enum_lock() != USB_OK) {
+        usb_mdelay(1);
+    }
+    p_hub_basic->enum_map &= ~bit;
+    p_enum_job->is_busy    = USB_FALSE;
+    __enum_unlock();
+}
+
+/**
+ * \brief 在集线器线程中移除枚举被取消的端口上的设备，端口上又有设备则重新枚举
+ */
+static void __hub_port_remove(struct usbh_hub_basic *p_hub_basic){
+    uint32_t   remove_map;
+    uint8_t    port_num;
+    usb_bool_t is_port_connect;
+    int        i, ret;
+    int        timeout = USBH_DEV_ENUM_WAIT_TIMEOUT;
+
+    /* 枚举工作先请求移除再清除端口枚举标志，等待标志清除，否则重新连接会被当成重复枚举*/
+    for (;;) {
+        if (__enum_lock() != USB_OK) {
+            return;
+        }
+        remove_map = p_hub_basic->remove_map;
+        if (((remove_map & p_hub_basic->enum_map) == 0) || (timeout <= 0)) {
+            /* 超时的端口留到下一次集线器事件再处理*/
+            remove_map              &= ~p_hub_basic->enum_map;
+            p_hub_basic->remove_map &= ~remove_map;
+            __enum_unlock();
+            break;
+        }
+        __enum_unlock();
+
+        usb_mdelay(1);
+        timeout--;
+    }
+
+    for (i = 0; (i < 32) && (remove_map != 0); i++) {
+        if (!(remove_map & (1u << i))) {
+            continue;
+        }
+        remove_map &= ~(1u << i);
+        /* 普通集线器设备的端口号是由 1 开始的，根集线器设备的端口号是由 0 开始的 */
+        port_num = (p_hub_basic->p_usb_fun != NULL) ? (i + 1) : i;
+
+        __dev_disconnect(p_hub_basic, port_num);
+
+        ret = usbh_basic_hub_port_connect_chk(p_hub_basic, port_num, &is_port_connect);
+        if ((ret == USB_OK) && (is_port_connect == USB_TRUE)) {
+            usbh_basic_hub_dev_connect(p_hub_basic, port_num);
+        }
+    }
+}
+
+/**
+ * \brief USB 主机基础集线器端口设备连接
+ *
+ * \param[in] p_hub_basic 基本集线器
+ * \param[in] port_num    集线器端口号
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_basic_hub_dev_connect(struct usbh_hub_basic *p_hub_basic,
+                               uint8_t                port_num){
+    struct usbh_dev_enum_job *p_enum_job = NULL;
+    uint32_t                  bit;
+    int                       i, ret;
+
+    if (p_hub_basic == NULL) {
+        return -USB_EINVAL;
+    }
+
+    bit = __hub_port_bit(p_hub_basic, port_num);
+
+    ret = __enum_lock();
+    if (ret != USB_OK) {
+        return ret;
+    }
+    /* 端口正在后台枚举，重复的连接事件直接忽略*/
+    if (p_hub_basic->enum_map & bit) {
+        __enum_unlock();
+        return USB_OK;
+    }
+    /* 找一个空闲的枚举工作*/
+    if (bit != 0) {
+        for (i = 0; i < USBH_DEV_ENUM_JOB_MAX; i++) {
+            if ((__g_usbh_dev_lib.enum_jobs[i].p_job != NULL) &&
+                    (__g_usbh_dev_lib.enum_jobs[i].is_busy == USB_FALSE)) {
+                p_enum_job = &__g_usbh_dev_lib.enum_jobs[i];
+
+                p_enum_job->is_busy      = USB_TRUE;
+                p_enum_job->p_hub_basic  = p_hub_basic;
+                p_enum_job->port_num     = port_num;
+                p_hub_basic->enum_map   |= bit;
+                p_hub_basic->cancel_map &= ~bit;
+                break;
+            }
+        }
+    }
+    __enum_unlock();
+
+    if (p_enum_job != NULL) {
+        /* 各端口的枚举在工作中并行进行，只有默认地址阶段在主机上串行*/
+        ret = usb_job_start(p_enum_job->p_job);
+        if (ret == USB_OK) {
+            return USB_OK;
+        }
+        __USB_ERR_INFO("USB job start failed(%d)\r\n", ret);
+
+        if (__enum_lock() == USB_OK) {
+            p_hub_basic->enum_map &= ~bit;
+            p_enum_job->is_busy    = USB_FALSE;
+            __enum_unlock();
+        }
+    }
+    /* 不支持工作或者工作都忙，同步枚举*/
+    return __dev_connect(p_hub_basic, port_num);
+}
+
+/**
+ * \brief USB 主机基础集线器端口设备断开
+ *
+ * \param[in] p_hub_basic 基本集线器
+ * \param[in] port_num    集线器端口号
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_basic_hub_dev_disconnect(struct usbh_hub_basic *p_hub_basic,
+                                  uint8_t                port_num){
+    uint32_t bit;
+    int      ret;
+
+    if (p_hub_basic == NULL) {
+        return -USB_EINVAL;
+    }
+
+    bit = __hub_port_bit(p_hub_basic, port_num);
+
+    ret = __enum_lock();
+    if (ret != USB_OK) {
+        return ret;
+    }
+    /* 端口正在后台枚举，由枚举工作结束时移除设备*/
+    if (p_hub_basic->enum_map & bit) {
+        p_hub_basic->cancel_map |= bit;
+        __enum_unlock();
+        return USB_OK;
+    }
+    __enum_unlock();
+
+    return __dev_disconnect(p_hub_basic, port_num);
+}
+
+/**
+ * \brief USB 主机基础集线器等待端口后台枚举结束，集线器释放前调用，不能在枚举工作中调用
+ *
+ * \param[in] p_hub_basic 基本集线器
+ * \param[in] timeout     超时时间(毫秒)
+ *
+ * \retval 成功返回 USB_OK，超时返回 -USB_ETIME
+ */
+int usbh_basic_hub_enum_wait(struct usbh_hub_basic *p_hub_basic, int timeout){
+    uint32_t enum_map;
+    int      ret;
+
+    if (p_hub_basic == NULL) {
+        return -USB_EINVAL;
+    }
+
+    for (;;) {
+        ret = __enum_lock();
+        if (ret != USB_OK) {
+            return ret;
+        }
+        enum_map = p_hub_basic->enum_map;
+        __enum_unlock();
+
+        if (enum_map == 0) {
+            return USB_OK;
+        }
+        if (timeout <= 0) {
+            __USB_ERR_INFO("USB host hub enumeration wait timeout(0x%x)\r\n", enum_map);
+            return -USB_ETIME;
+        }
+        usb_mdelay(10);
+        timeout -= 10;
+    }
+}
+
 /**
  * \brief USB 主机基础集线器端口连接检查
  *
@@ -1393,6 +1932,8 @@ int usbh_hub_evt_process(void){
             return ret;
         }
 #endif
+        /* 先移除枚举被取消的端口上的设备*/
+        __hub_port_remove(p_hub_basic);
         /* 集线器处理函数*/
         if (p_hub_basic->p_fn_hub_handle != NULL){
             ret = p_hub_basic->p_fn_hub_handle(p_hub_basic, p_port_evt);
@@ -1517,8 +2058,23 @@ int usbh_dev_xfer_timeout_set(int time_out){
  * \brief USB 主机设备库释放函数
  */
 static void __dev_lib_release(int *p_ref){
+    struct usb_list_node *p_node     = NULL;
+    struct usb_list_node *p_node_tmp = NULL;
+    int                   i;
+#if USB_OS_EN
+    int                   ret;
+#endif
+
+    /* 释放描述符缓存*/
+    usbh_dev_desc_cache_flush();
+    /* 销毁后台枚举工作*/
+    for (i = 0; i < USBH_DEV_ENUM_JOB_MAX; i++) {
+        if (__g_usbh_dev_lib.enum_jobs[i].p_job != NULL) {
+            usb_job_destory(__g_usbh_dev_lib.enum_jobs[i].p_job);
+            __g_usbh_dev_lib.enum_jobs[i].p_job = NULL;
+        }
+    }
 #if USB_OS_EN
-    int ret;
 
     ret = usb_lib_sem_destroy(&__g_usb_host_lib.lib, __g_usbh_dev_lib.p_hub_evt_sem);
     if (ret != USB_OK) {
@@ -1534,7 +2090,21 @@ static void __dev_lib_release(int *p_ref){
     if (ret != USB_OK) {
         __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
     }
+
+    ret = usb_lib_mutex_destroy(&__g_usb_host_lib.lib, __g_usbh_dev_lib.p_sync_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret);
+    }
 #endif
+    /* 销毁同步传输完成对象池*/
+    usb_list_for_each_node_safe(p_node, p_node_tmp, &__g_usbh_dev_lib.sync_free){
+        struct usbh_trp_sync *p_sync = usb_container_of(p_node, struct usbh_trp_sync, node);
+
+        usb_list_node_del(&p_sync->node);
+        __trp_sync_destroy(p_sync);
+    }
+    __g_usbh_dev_lib.n_sync_free = 0;
+
     __g_usbh_dev_lib.is_lib_init = USB_FALSE;
 }
 
@@ -1569,6 +2139,7 @@ int usbh_dev_lib_ref_put(void){
  * \retval 成功返回 USB_OK
  */
 int usbh_dev_lib_init(void){
+    int i;
 #if USB_OS_EN
     int ret, ret_tmp;
 #endif
@@ -1602,6 +2173,13 @@ int usbh_dev_lib_init(void){
         goto __failed;
     }
 
+    /* 初始化同步传输完成对象池互斥锁*/
+    __g_usbh_dev_lib.p_sync_lock = usb_lib_mutex_create(&__g_usb_host_lib.lib);
+    if (__g_usbh_dev_lib.p_sync_lock == NULL) {
+        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
+        goto __failed;
+    }
+
 #endif
     /* 初始化 USB 设备链表*/
     usb_list_head_init(&__g_usbh_dev_lib.dev_list);
@@ -1609,10 +2187,16 @@ int usbh_dev_lib_init(void){
     usb_list_head_init(&__g_usbh_dev_lib.monitor_list);
     /* 初始化 USB 设备事件链表*/
     usb_list_head_init(&__g_usbh_dev_lib.hub_evt_list);
+    /* 初始化同步传输完成对象链表*/
+    usb_list_head_init(&__g_usbh_dev_lib.sync_free);
     /* 枚举超时时间*/
     __g_usbh_dev_lib.xfer_time_out = 5000;
     /* 初始化引用计数*/
     usb_refcnt_init(&__g_usbh_dev_lib.ref_cnt);
+    /* 创建后台枚举工作，不支持工作时句柄为空，在集线器事件线程中同步枚举*/
+    for (i = 0; i < USBH_DEV_ENUM_JOB_MAX; i++) {
+        __g_usbh_dev_lib.enum_jobs[i].p_job = usb_job_create(__dev_enum_job, &__g_usbh_dev_lib.enum_jobs[i]);
+    }
 
     __g_usbh_dev_lib.is_lib_init      = USB_TRUE;
     __g_usbh_dev_lib.is_lib_deiniting = USB_FALSE;
@@ -1638,6 +2222,12 @@ __failed:
             __USB_ERR_TRACE(SemDelErr, "(%d)\r\n", ret_tmp);
         }
     }
+    if (__g_usbh_dev_lib.p_sync_lock){
+        ret_tmp = usb_lib_mutex_destroy(&__g_usb_host_lib.lib, __g_usbh_dev_lib.p_sync_lock);
+        if (ret_tmp != USB_OK) {
+            __USB_ERR_TRACE(MutexDelErr, "(%d)\r\n", ret_tmp);
+        }
+    }
     return ret;
 #endif
 }
@@ -11,6 +11,12 @@ extern struct usbh_core_lib __g_usb_host_lib;
 
 extern int usb_hc_dev_addr_alloc(struct usb_hc *p_hc, uint8_t *p_addr);
 extern int usb_hc_dev_addr_free(struct usb_hc *p_hc, uint8_t addr);
+extern int usb_hc_addr0_lock(struct usb_hc *p_hc);
+extern int usb_hc_addr0_unlock(struct usb_hc *p_hc);
+extern int usbh_dev_ep_lock_init(struct usbh_endpoint *p_ep);
+extern int usbh_dev_ep_lock_deinit(struct usbh_endpoint *p_ep);
+extern int usbh_dev_ep_lock(struct usbh_endpoint *p_ep);
+extern int usbh_dev_ep_unlock(struct usbh_endpoint *p_ep);
 extern int usbh_ep_hcpriv_init(struct usbh_endpoint *p_ep);
 extern int usbh_ep_hcpriv_deinit(struct usbh_endpoint *p_ep);
 extern int usb_hc_ep_enable(struct usb_hc        *p_hc,
@@ -234,9 +240,14 @@ static int __dev_ep_init(struct usbh_device       *p_usb_dev,
     p_ep->band_width = USB_DIV_ROUND_UP(__bandwidth_calc(p_ep), 1000L);
     p_ep->p_hw_priv  = NULL;
 
+    ret = usbh_dev_ep_lock_init(p_ep);
+    if (ret != USB_OK) {
+        return ret;
+    }
     ret = usbh_ep_hcpriv_init(p_ep);
     if (ret != USB_OK) {
         __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
+        usbh_dev_ep_lock_deinit(p_ep);
         return ret;
     }
 
@@ -264,8 +275,9 @@ static int __dev_ep_deinit(struct usbh_endpoint *p_ep){
     int ret = usbh_ep_hcpriv_deinit(p_ep);
     if (ret != USB_OK) {
         __USB_ERR_TRACE(ErrorTrace, "(%d)\r\n", ret);
+        return ret;
     }
-    return ret;
+    return usbh_dev_ep_lock_deinit(p_ep);
 }
 
 /**
@@ -617,9 +629,10 @@ static int __dev_cfg_parse(struct usbh_device     *p_usb_dev,
 /**
  * \brief USB 主机设备配置初始化
  */
-static int __dev_cfg_init(struct usbh_device *p_usb_dev,
-                          struct usbh_config *p_cfg,
-                          uint8_t             config_num){
+static int __dev_cfg_init(struct usbh_device         *p_usb_dev,
+                          struct usbh_config         *p_cfg,
+                          uint8_t                     config_num,
+                          struct usbh_dev_desc_cache *p_cache){
     struct usb_config_desc *p_cfg_desc = NULL;
     uint16_t                len;
     int                     ret;
@@ -628,6 +641,13 @@ static int __dev_cfg_init(struct usbh_device *p_usb_dev,
 #endif
     memset(p_cfg, 0, sizeof(*p_cfg));
 
+    /* 描述符缓存命中，直接使用缓存的配置描述符，不再从设备读取*/
+    if ((p_cache != NULL) && (p_cache->p_cfg_desc != NULL)) {
+        p_cfg_desc          = (struct usb_config_desc *)p_cache->p_cfg_desc;
+        p_cache->p_cfg_desc = NULL;
+        goto __parse;
+    }
+
     p_cfg_desc = usb_lib_malloc(&__g_usb_host_lib.lib, sizeof(*p_cfg_desc));
     if (p_cfg_desc == NULL) {
         return -USB_ENOMEM;
@@ -677,7 +697,7 @@ static int __dev_cfg_init(struct usbh_device *p_usb_dev,
         __USB_ERR_INFO("USB host device config desc length illegal\r\n");
         return -USB_EDATA;
     }
-
+__parse:
 #if USB_OS_EN
     ret = usb_mutex_lock(p_usb_dev->p_lock, USBH_DEV_MUTEX_TIMEOUT);
     if (ret != USB_OK) {
@@ -746,8 +766,9 @@ static int __dev_cfg_deinit(struct usbh_device *p_usb_dev, struct usbh_config *p
 /**
  * \brief USB 主机设置设备配置设置
  */
-static int __dev_cfg_set(struct usbh_device *p_usb_dev,
-                         uint8_t             cfg_num){
+static int __dev_cfg_set(struct usbh_device         *p_usb_dev,
+                         uint8_t                     cfg_num,
+                         struct usbh_dev_desc_cache *p_cache){
     int ret;
 
     /* 设备已存在配置描述符*/
@@ -765,7 +786,7 @@ static int __dev_cfg_set(struct usbh_device *p_usb_dev,
     }
 
     /* 设备还没有配置，进行配置初始化*/
-    ret = __dev_cfg_init(p_usb_dev, &p_usb_dev->cfg, cfg_num);
+    ret = __dev_cfg_init(p_usb_dev, &p_usb_dev->cfg, cfg_num, p_cache);
     if (ret != USB_OK) {
         goto __failed;
     }
@@ -795,27 +816,300 @@ __failed:
     return ret;
 }
 
+/**
+ * \brief 设备库加锁
+ */
+static int __dev_lib_lock(void){
+#if USB_OS_EN
+    int ret;
+
+    ret = usb_mutex_lock(__g_usbh_dev_lib.p_lock, USBH_DEV_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
+        return ret;
+    }
+#endif
+    return USB_OK;
+}
+
+/**
+ * \brief 设备库解锁
+ */
+static void __dev_lib_unlock(void){
+#if USB_OS_EN
+    int ret;
+
+    ret = usb_mutex_unlock(__g_usbh_dev_lib.p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    }
+#endif
+}
+
+/**
+ * \brief 复制字符串
+ */
+static char *__str_dup(const char *p_str){
+    char   *p_new = NULL;
+    size_t  len;
+
+    if (p_str == NULL) {
+        return NULL;
+    }
+    len   = strlen(p_str) + 1;
+    p_new = usb_lib_malloc(&__g_usb_host_lib.lib, len);
+    if (p_new != NULL) {
+        memcpy(p_new, p_str, len);
+    }
+    return p_new;
+}
+
+/**
+ * \brief 查找设备兼容表项
+ */
+static int __dev_quirk_find(uint16_t vid, uint16_t pid, struct usbh_dev_quirk *p_quirk){
+    int i, ret;
+
+    ret = __dev_lib_lock();
+    if (ret != USB_OK) {
+        return ret;
+    }
+    ret = -USB_ENODEV;
+    for (i = 0; i < __g_usbh_dev_lib.n_quirks; i++) {
+        if ((__g_usbh_dev_lib.p_quirks[i].vid == vid) &&
+                (__g_usbh_dev_lib.p_quirks[i].pid == pid)) {
+            *p_quirk = __g_usbh_dev_lib.p_quirks[i];
+            ret      = USB_OK;
+            break;
+        }
+    }
+    __dev_lib_unlock();
+
+    return ret;
+}
+
+/**
+ * \brief 初始化设备枚举延时，已知设备使用快速延时，兼容表中有延时的使用兼容表的延时
+ */
+static void __dev_delay_init(struct usbh_device *p_usb_dev, struct usb_device_desc *p_desc){
+    struct usbh_dev_quirk quirk;
+
+    p_usb_dev->retry_delay = USBH_DEV_RETRY_DELAY;
+    if (p_desc != NULL) {
+        p_usb_dev->reset_delay = USBH_DEV_RESET_DELAY_FAST;
+        p_usb_dev->addr_delay  = USBH_DEV_ADDR_DELAY_FAST;
+
+        if ((__dev_quirk_find(USB_CPU_TO_LE16(p_desc->id_vendor),
+                              USB_CPU_TO_LE16(p_desc->id_product),
+                             &quirk) == USB_OK) &&
+                (quirk.flags & USBH_DEV_QUIRK_DELAY)) {
+            p_usb_dev->reset_delay = quirk.reset_delay;
+            p_usb_dev->addr_delay  = quirk.addr_delay;
+            p_usb_dev->retry_delay = quirk.retry_delay;
+        }
+    } else {
+        p_usb_dev->reset_delay = USBH_DEV_RESET_DELAY;
+        p_usb_dev->addr_delay  = USBH_DEV_ADDR_DELAY;
+    }
+}
+
 /**
  * \brief 检查设备兼容性
  */
 static int __dev_quirks_detect(struct usbh_device *p_usb_dev){
-    //todo
+    struct usbh_dev_quirk quirk;
+
+    if (__dev_quirk_find(USB_CPU_TO_LE16(p_usb_dev->p_dev_desc->id_vendor),
+                         USB_CPU_TO_LE16(p_usb_dev->p_dev_desc->id_product),
+                        &quirk) != USB_OK) {
+        return USB_OK;
+    }
+    p_usb_dev->quirks = quirk.flags;
+    /* 之后的重试使用兼容表的延时*/
+    if (quirk.flags & USBH_DEV_QUIRK_DELAY) {
+        p_usb_dev->reset_delay = quirk.reset_delay;
+        p_usb_dev->addr_delay  = quirk.addr_delay;
+        p_usb_dev->retry_delay = quirk.retry_delay;
+    }
     return USB_OK;
 }
 
 /**
- * \brief USB 主机设备枚举函数
- *
- * \param[in] p_usb_dev USB 主机设备
- * \param[in] scheme
- *
- * \retval 成功返回 USB_OK
+ * \brief 获取设备的端口路径，超过最大深度返回 0
  */
-int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
-                       int                 scheme) {
+static uint8_t __dev_port_path_get(struct usbh_device *p_usb_dev, uint8_t *p_path){
+    uint8_t depth = 0;
+
+    while (depth < USBH_DEV_PORT_PATH_MAX) {
+        p_path[depth++] = p_usb_dev->port;
+        /* 到达根集线器*/
+        if (p_usb_dev->p_hub_basic->p_usb_fun == NULL) {
+            return depth;
+        }
+        p_usb_dev = p_usb_dev->p_hub_basic->p_usb_fun->p_usb_dev;
+    }
+    return 0;
+}
+
+/**
+ * \brief 释放描述符缓存条目的内容
+ */
+static void __desc_cache_clr(struct usbh_dev_desc_cache *p_cache){
+    if (p_cache->p_cfg_desc) {
+        usb_lib_mfree(&__g_usb_host_lib.lib, p_cache->p_cfg_desc);
+    }
+    usbh_dev_string_put(p_cache->p_mft);
+    usbh_dev_string_put(p_cache->p_pdt);
+
+    memset(p_cache, 0, sizeof(struct usbh_dev_desc_cache));
+}
+
+/**
+ * \brief 根据端口路径查找描述符缓存条目，调用者需持有设备库锁
+ */
+static struct usbh_dev_desc_cache *__desc_cache_find(struct usbh_device *p_usb_dev,
+                                                     const uint8_t      *p_path,
+                                                     uint8_t             depth){
+    int                         i;
+    struct usbh_dev_desc_cache *p_cache = NULL;
+
+    for (i = 0; i < USBH_DEV_DESC_CACHE_MAX; i++) {
+        p_cache = &__g_usbh_dev_lib.desc_cache[i];
+
+        if ((p_cache->is_valid == USB_TRUE) &&
+                (p_cache->host_idx == p_usb_dev->p_hc->host_idx) &&
+                (p_cache->depth == depth) &&
+                (memcmp(p_cache->path, p_path, depth) == 0)) {
+            return p_cache;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief 取出设备所在端口的描述符缓存条目，条目的内容转交给调用者
+ */
+static usb_bool_t __desc_cache_take(struct usbh_device *p_usb_dev, struct usbh_dev_desc_cache *p_entry){
+    struct usbh_dev_desc_cache *p_cache = NULL;
+    uint8_t                     path[USBH_DEV_PORT_PATH_MAX];
+    uint8_t                     depth;
+
+    memset(p_entry, 0, sizeof(struct usbh_dev_desc_cache));
+
+    depth = __dev_port_path_get(p_usb_dev, path);
+    if (depth == 0) {
+        return USB_FALSE;
+    }
+    if (__dev_lib_lock() != USB_OK) {
+        return USB_FALSE;
+    }
+    p_cache = __desc_cache_find(p_usb_dev, path, depth);
+    if (p_cache != NULL) {
+        *p_entry = *p_cache;
+        /* 内容已经转交，条目直接置为无效*/
+        memset(p_cache, 0, sizeof(struct usbh_dev_desc_cache));
+    }
+    __dev_lib_unlock();
+
+    return (p_cache != NULL) ? USB_TRUE : USB_FALSE;
+}
+
+/**
+ * \brief 把枚举成功的设备的描述符放入缓存，缓存满了淘汰最近最少使用的条目
+ */
+static void __desc_cache_store(struct usbh_device *p_usb_dev){
+    struct usbh_dev_desc_cache *p_cache = NULL;
+    struct usbh_dev_desc_cache  entry;
+    uint8_t                     path[USBH_DEV_PORT_PATH_MAX];
+    int                         i;
+
+    if ((p_usb_dev->quirks & USBH_DEV_QUIRK_NO_CACHE) || (p_usb_dev->cfg.p_desc == NULL)) {
+        return;
+    }
+    memset(&entry, 0, sizeof(struct usbh_dev_desc_cache));
+
+    entry.depth = __dev_port_path_get(p_usb_dev, path);
+    if (entry.depth == 0) {
+        return;
+    }
+    memcpy(entry.path, path, entry.depth);
+
+    entry.cfg_len    = USB_CPU_TO_LE16(p_usb_dev->cfg.p_desc->total_length);
+    entry.p_cfg_desc = usb_lib_malloc(&__g_usb_host_lib.lib, entry.cfg_len);
+    if (entry.p_cfg_desc == NULL) {
+        return;
+    }
+    memcpy(entry.p_cfg_desc, p_usb_dev->cfg.p_desc, entry.cfg_len);
+
+    entry.is_valid = USB_TRUE;
+    entry.host_idx = p_usb_dev->p_hc->host_idx;
+    entry.dev_desc = *p_usb_dev->p_dev_desc;
+    entry.lang_id  = p_usb_dev->lang_id;
+    entry.p_mft    = __str_dup(p_usb_dev->p_mft);
+    entry.p_pdt    = __str_dup(p_usb_dev->p_pdt);
+
+    if (__dev_lib_lock() != USB_OK) {
+        __desc_cache_clr(&entry);
+        return;
+    }
+    /* 同一个端口只保留一个条目*/
+    p_cache = __desc_cache_find(p_usb_dev, path, entry.depth);
+    if (p_cache == NULL) {
+        for (i = 0; i < USBH_DEV_DESC_CACHE_MAX; i++) {
+            if (__g_usbh_dev_lib.desc_cache[i].is_valid == USB_FALSE) {
+                p_cache = &__g_usbh_dev_lib.desc_cache[i];
+                break;
+            }
+            if ((p_cache == NULL) || (__g_usbh_dev_lib.desc_cache[i].lru < p_cache->lru)) {
+                p_cache = &__g_usbh_dev_lib.desc_cache[i];
+            }
+        }
+    }
+    __desc_cache_clr(p_cache);
+
+    entry.lru = ++__g_usbh_dev_lib.desc_cache_lru;
+    *p_cache  = entry;
+
+    __dev_lib_unlock();
+}
+
+/**
+ * \brief 把第一次读取的字符串补充到设备对应的描述符缓存条目
+ */
+static void __desc_cache_str_update(struct usbh_device *p_usb_dev, uint8_t type, const char *p_str){
+    struct usbh_dev_desc_cache *p_cache = NULL;
+    uint8_t                     path[USBH_DEV_PORT_PATH_MAX];
+    uint8_t                     depth;
+
+    depth = __dev_port_path_get(p_usb_dev, path);
+    if (depth == 0) {
+        return;
+    }
+    if (__dev_lib_lock() != USB_OK) {
+        return;
+    }
+    p_cache = __desc_cache_find(p_usb_dev, path, depth);
+    if ((p_cache != NULL) &&
+            (memcmp(&p_cache->dev_desc, p_usb_dev->p_dev_desc, sizeof(struct usb_device_desc)) == 0)) {
+        if ((type == USBH_DEV_STR_MFT) && (p_cache->p_mft == NULL)) {
+            p_cache->p_mft = __str_dup(p_str);
+        } else if ((type == USBH_DEV_STR_PDT) && (p_cache->p_pdt == NULL)) {
+            p_cache->p_pdt = __str_dup(p_str);
+        }
+        p_cache->lang_id = p_usb_dev->lang_id;
+    }
+    __dev_lib_unlock();
+}
+
+/**
+ * \brief USB 主机设备默认地址阶段，从端口复位到设置地址成功，调用前需要持有主机的默认地址锁
+ */
+static int __dev_addr_assign(struct usbh_device         *p_usb_dev,
+                             int                         scheme,
+                             struct usbh_dev_desc_cache *p_cache) {
     struct usbh_device *p_hub_dev  = NULL;
     int                 ret;
-    uint8_t             i, cfg_num = 1;
+    uint8_t             i;
     usb_bool_t          is_port_connect;
 
    /* 设备上面不是根集线器*/
@@ -865,7 +1159,13 @@ int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
         p_usb_dev->tt_port = p_usb_dev->port;
     }
 
-    usb_mdelay(100);
+    usb_mdelay(p_usb_dev->reset_delay);
+
+    /* 已知设备，直接使用缓存的端点 0 最大包大小设置地址，跳过第一次获取设备描述符和第二次复位*/
+    if (p_cache != NULL) {
+        p_usb_dev->p_dev_desc->max_packet_size0 = p_cache->dev_desc.max_packet_size0;
+        goto __addr_set;
+    }
 
     /* 获取设备描述符*/
     for (i = 0; i < 3; i++) {
@@ -897,7 +1197,7 @@ int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
             if ((ret != USB_OK) && (ret != USB_ENOTSUP)) {
                 return ret;
             }
-            usb_mdelay(100);
+            usb_mdelay(p_usb_dev->reset_delay);
             continue;
         } else if (ret < 8) {
             __USB_ERR_INFO("USB host device desc length illegal(%d)\r\n", ret);
@@ -927,8 +1227,9 @@ int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
         return ret;
     }
 
-    usb_mdelay(100);
+    usb_mdelay(p_usb_dev->reset_delay);
 
+__addr_set:
     for (i = 0; i < 3; i++) {
         /* 设置设备地址*/
         ret = __dev_addr_alloc_set(p_usb_dev);
@@ -946,13 +1247,34 @@ int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
             }
         }
         /* 延时*/
-        usb_mdelay(100);
+        usb_mdelay(p_usb_dev->retry_delay);
     }
 
+    return ret;
+}
+
+/**
+ * \brief USB 主机设备枚举，p_cache 不为空时是描述符缓存命中的已知设备
+ */
+static int __dev_enumerate(struct usbh_device         *p_usb_dev,
+                           int                         scheme,
+                           struct usbh_dev_desc_cache *p_cache) {
+    int     ret;
+    uint8_t cfg_num = 1;
+
+    /* 同一主机上同时只能有一个设备处于默认地址，其余阶段各端口可以并行枚举*/
+    ret = usb_hc_addr0_lock(p_usb_dev->p_hc);
+    if (ret != USB_OK) {
+        return ret;
+    }
+    ret = __dev_addr_assign(p_usb_dev, scheme, p_cache);
+
+    usb_hc_addr0_unlock(p_usb_dev->p_hc);
+
     if (ret != USB_OK) {
         return ret;
     }
-    usb_mdelay(10);
+    usb_mdelay(p_usb_dev->addr_delay);
 
     /* 更新设备端点 0 的最大包大小*/
     p_usb_dev->ep0_desc.max_packet_size = p_usb_dev->p_dev_desc->max_packet_size0;
@@ -984,6 +1306,12 @@ int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
         return ret;
     }
 
+    /* 只用一次设备描述符读取验证已知设备，不一致则按新设备完整获取配置描述符*/
+    if ((p_cache != NULL) &&
+            (memcmp(&p_cache->dev_desc, p_usb_dev->p_dev_desc, sizeof(struct usb_device_desc)) != 0)) {
+        p_cache = NULL;
+    }
+
     /* USB规范版本号*/
     switch (USB_CPU_TO_LE16(p_usb_dev->p_dev_desc->bcdUSB)) {
         case 0x0100: ret = USB_SPEED_LOW;      break;  /* USB规范V1.00*/
@@ -1010,32 +1338,20 @@ int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
     }
 
     /* 设置配置描述符*/
-    ret = __dev_cfg_set(p_usb_dev, cfg_num);
+    ret = __dev_cfg_set(p_usb_dev, cfg_num, p_cache);
     if (ret != USB_OK) {
         return ret;
     }
 
-    /* 获取字符串描述符，这里失败暂不返回错误，因为有一些设备获取字符串描述符会失败，但不影响其他功能*/
-    /* 制造商*/
-    if (p_usb_dev->p_dev_desc->i_manufacturer) {
-        ret = usbh_dev_string_get(p_usb_dev, p_usb_dev->p_dev_desc->i_manufacturer, &p_usb_dev->p_mft);
-        if (ret != USB_OK) {
-            __USB_ERR_INFO("USB host device manufacturer string get failed(%d)\r\n", ret);
-        }
-    }
-    /* 产商*/
-    if (p_usb_dev->p_dev_desc->i_product) {
-        ret = usbh_dev_string_get(p_usb_dev, p_usb_dev->p_dev_desc->i_product, &p_usb_dev->p_pdt);
-        if (ret != USB_OK) {
-            __USB_ERR_INFO("USB host device product string get failed(%d)\r\n", ret);
-        }
-    }
-    /* 序列号*/
-    if (p_usb_dev->p_dev_desc->i_serial_number) {
-        ret = usbh_dev_string_get(p_usb_dev, p_usb_dev->p_dev_desc->i_serial_number, &p_usb_dev->p_snum);
-        if (ret != USB_OK) {
-            __USB_ERR_INFO("USB host device serial number string get failed(%d)\r\n", ret);
-        }
+    /* 字符串描述符在第一次使用时才获取(usbh_dev_str_get)，已知设备直接使用缓存的制造商和产品字符串*/
+    if (p_cache != NULL) {
+        p_usb_dev->lang_id = p_cache->lang_id;
+        p_usb_dev->p_mft   = p_cache->p_mft;
+        p_usb_dev->p_pdt   = p_cache->p_pdt;
+        p_cache->p_mft     = NULL;
+        p_cache->p_pdt     = NULL;
+
+        p_usb_dev->is_cached = USB_TRUE;
     }
 
     /* 填充 USB 设备名 --> usb000_001_0x2526_0x1245_012*/
@@ -1050,6 +1366,34 @@ int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
     return USB_OK;
 }
 
+/**
+ * \brief USB 主机设备枚举函数
+ *
+ * \param[in] p_usb_dev USB 主机设备
+ * \param[in] scheme
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_dev_enumerate(struct usbh_device *p_usb_dev,
+                       int                 scheme) {
+    struct usbh_dev_desc_cache cache;
+    usb_bool_t                 is_hit;
+    int                        ret;
+
+    /* 取出设备所在端口的描述符缓存，枚举失败时不再放回，下一次重试走完整枚举*/
+    is_hit = __desc_cache_take(p_usb_dev, &cache);
+
+    __dev_delay_init(p_usb_dev, is_hit ? &cache.dev_desc : NULL);
+
+    ret = __dev_enumerate(p_usb_dev, scheme, is_hit ? &cache : NULL);
+    if (ret == USB_OK) {
+        __desc_cache_store(p_usb_dev);
+    }
+    __desc_cache_clr(&cache);
+
+    return ret;
+}
+
 /**
  * \brief USB 主机设备取消枚举
  *
@@ -1159,7 +1503,129 @@ void usbh_dev_string_put(char *p_string){
 }
 
 /**
- * \brief USB 主机设备端点使能函数
+ * \brief 获取 USB 主机设备的制造商/产品/序列号字符串，第一次使用时才从设备读取
+ *
+ * \param[in] p_usb_dev USB 主机设备
+ * \param[in] type      字符串类型(USBH_DEV_STR_MFT/USBH_DEV_STR_PDT/USBH_DEV_STR_SNUM)
+ *
+ * \retval 成功返回字符串，设备没有这个字符串或者读取失败返回 NULL
+ */
+char *usbh_dev_str_get(struct usbh_device *p_usb_dev, uint8_t type){
+    char    **p_str_ptr = NULL;
+    char     *p_str     = NULL;
+    uint8_t   idx;
+    int       ret;
+
+    if ((p_usb_dev == NULL) || (p_usb_dev->p_dev_desc == NULL)) {
+        return NULL;
+    }
+
+    switch (type) {
+        case USBH_DEV_STR_MFT:
+            p_str_ptr = &p_usb_dev->p_mft;
+            idx       = p_usb_dev->p_dev_desc->i_manufacturer;
+            break;
+        case USBH_DEV_STR_PDT:
+            p_str_ptr = &p_usb_dev->p_pdt;
+            idx       = p_usb_dev->p_dev_desc->i_product;
+            break;
+        case USBH_DEV_STR_SNUM:
+            p_str_ptr = &p_usb_dev->p_snum;
+            idx       = p_usb_dev->p_dev_desc->i_serial_number;
+            break;
+        default:
+            return NULL;
+    }
+    if ((*p_str_ptr != NULL) || (idx == 0)) {
+        return *p_str_ptr;
+    }
+    if (!USBH_IS_DEV_INJECT(p_usb_dev)) {
+        return NULL;
+    }
+
+    /* 有一些设备获取字符串描述符会失败，但不影响其他功能*/
+    ret = usbh_dev_string_get(p_usb_dev, idx, &p_str);
+    if (ret != USB_OK) {
+        __USB_ERR_INFO("USB host device string %d get failed(%d)\r\n", idx, ret);
+        return NULL;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_lock(p_usb_dev->p_lock, USBH_DEV_MUTEX_TIMEOUT);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexLockErr, "%d\r\n", ret);
+        usbh_dev_string_put(p_str);
+        return NULL;
+    }
+#endif
+    /* 可能被其他调用者先读取了*/
+    if (*p_str_ptr == NULL) {
+        *p_str_ptr = p_str;
+        p_str      = NULL;
+    }
+#if USB_OS_EN
+    ret = usb_mutex_unlock(p_usb_dev->p_lock);
+    if (ret != USB_OK) {
+        __USB_ERR_TRACE(MutexUnLockErr, "%d\r\n", ret);
+    }
+#endif
+    usbh_dev_string_put(p_str);
+
+    /* 序列号区分同型号的不同设备，不放入缓存*/
+    if (type != USBH_DEV_STR_SNUM) {
+        __desc_cache_str_update(p_usb_dev, type, *p_str_ptr);
+    }
+    return *p_str_ptr;
+}
+
+/**
+ * \brief 设置 USB 主机设备兼容表
+ *
+ * \param[in] p_quirks 设备兼容表，调用者保证在使用期间有效
+ * \param[in] n_quirks 设备兼容表项数量
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usbh_dev_quirks_set(const struct usbh_dev_quirk *p_quirks, int n_quirks){
+    int ret;
+
+    if ((n_quirks < 0) || ((p_quirks == NULL) && (n_quirks > 0))) {
+        return -USB_EINVAL;
+    }
+    if (__g_usbh_dev_lib.is_lib_init == USB_FALSE) {
+        return -USB_ENOINIT;
+    }
+    ret = __dev_lib_lock();
+    if (ret != USB_OK) {
+        return ret;
+    }
+    __g_usbh_dev_lib.p_quirks = p_quirks;
+    __g_usbh_dev_lib.n_quirks = n_quirks;
+
+    __dev_lib_unlock();
+
+    return USB_OK;
+}
+
+/**
+ * \brief 清空 USB 主机设备描述符缓存
+ */
+void usbh_dev_desc_cache_flush(void){
+    int i;
+
+    if (__g_usbh_dev_lib.is_lib_init == USB_FALSE) {
+        return;
+    }
+    if (__dev_lib_lock() != USB_OK) {
+        return;
+    }
+    for (i = 0; i < USBH_DEV_DESC_CACHE_MAX; i++) {
+        __desc_cache_clr(&__g_usbh_dev_lib.desc_cache[i]);
+    }
+    __dev_lib_unlock();
+}
+
+/**
+ * \brief USB 主机设备端点使能函数，调用者持有端点锁
  */
 int usbh_dev_ep_enable(struct usbh_endpoint *p_ep){
     int ret = USB_OK;
@@ -1178,7 +1644,7 @@ int usbh_dev_ep_enable(struct usbh_endpoint *p_ep){
 }
 
 /**
- * \brief USB 主机设备端点禁能函数
+ * \brief USB 主机设备端点禁能函数，调用者持有端点锁
  */
 int usbh_dev_ep_disable(struct usbh_endpoint *p_ep){
     int ret = USB_OK;
@@ -1204,18 +1670,23 @@ int usbh_dev_ep_disable(struct usbh_endpoint *p_ep){
  */
 static int __ep_reset(struct usbh_endpoint *p_ep){
     usb_bool_t enable;
-    int        ret;
+    int        ret, ret_tmp;
 
-    enable = p_ep->is_enabled;
-
-    ret = usbh_dev_ep_disable(p_ep);
+    ret = usbh_dev_ep_lock(p_ep);
     if (ret != USB_OK) {
         return ret;
     }
+    enable = p_ep->is_enabled;
 
-    if (enable) {
+    ret = usbh_dev_ep_disable(p_ep);
+    if ((ret == USB_OK) && enable) {
         ret = usbh_dev_ep_enable(p_ep);
     }
+
+    ret_tmp = usbh_dev_ep_unlock(p_ep);
+    if (ret_tmp != USB_OK) {
+        return ret_tmp;
+    }
     return ret;
 }
 
@@ -1227,23 +1698,10 @@ static int __ep_reset(struct usbh_endpoint *p_ep){
  * \retval 成功返回 USB_OK
  */
 int usbh_dev_ep_reset(struct usbh_endpoint *p_ep){
-    int        ret = USB_OK;
-    usb_bool_t enable;
-
     if (p_ep == NULL) {
         return -USB_EINVAL;
     }
-    enable = p_ep->is_enabled;
-
-    ret = usbh_dev_ep_disable(p_ep);
-    if (ret != USB_OK) {
-        return ret;
-    }
-
-    if (enable) {
-        ret = usbh_dev_ep_enable(p_ep);
-    }
-    return ret;
+    return __ep_reset(p_ep);
 }
 
 /**
@@ -101,16 +101,65 @@ int usb_lib_dma_mfree(struct usb_lib_base *p_lib, void *p_mem, uint32_t size){
     return usb_cache_dma_free(p_mem, size);
 }
 
+/**
+ * \brief USB 库环形缓冲区大小向上取整到 2 的幂
+ *
+ * \param[in] size 缓存大小
+ *
+ * \retval 返回取整后的大小
+ */
+uint32_t usb_lib_rb_size_round(uint32_t size){
+    uint32_t n = 1;
+
+    while ((n < size) && (n < 0x80000000)) {
+        n <<= 1;
+    }
+    return n;
+}
+
+/**
+ * \brief USB 库环形缓冲区初始化函数(使用外部缓存)
+ *
+ * \param[in] p_rb     要初始化的环形缓冲区
+ * \param[in] p_buf    环形缓冲区缓存
+ * \param[in] buf_size 缓存大小，必须是 2 的幂
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_lib_rb_init(struct usb_ringbuf *p_rb, uint8_t *p_buf, uint32_t buf_size){
+    if ((p_rb == NULL) || (p_buf == NULL) || (buf_size == 0)) {
+        return -USB_EINVAL;
+    }
+    if ((buf_size & (buf_size - 1)) != 0) {
+        return -USB_EILLEGAL;
+    }
+
+    p_rb->p_buf        = p_buf;
+    p_rb->buf_size     = buf_size;
+    p_rb->mask         = buf_size - 1;
+    p_rb->wr_idx       = 0;
+    p_rb->rd_idx       = 0;
+    p_rb->is_buf_alloc = USB_FALSE;
+
+    return USB_OK;
+}
+
 /**
  * \brief USB 库环形缓冲区创建函数
  *
  * \param[in] p_lib    USB 基本库结构体
- * \param[in] buf_size 环形缓冲区缓存大小
+ * \param[in] buf_size 环形缓冲区缓存大小，向上取整到 2 的幂
  *
  * \retval 成功返回 USB 环形缓冲区结构体
  */
 struct usb_ringbuf *usb_lib_rb_create(struct usb_lib_base *p_lib, uint32_t buf_size){
     struct usb_ringbuf *p_rb = NULL;
+    uint8_t            *p_buf;
+
+    if (buf_size == 0) {
+        return NULL;
+    }
+    buf_size = usb_lib_rb_size_round(buf_size);
 
     p_rb = usb_lib_malloc(p_lib, sizeof(struct usb_ringbuf));
     if (p_rb == NULL) {
@@ -118,32 +167,16 @@ struct usb_ringbuf *usb_lib_rb_create(struct usb_lib_base *p_lib, uint32_t buf_s
     }
     memset(p_rb, 0, sizeof(struct usb_ringbuf));
 
-    p_rb->p_buf = usb_lib_malloc(p_lib, buf_size);
-    if (p_rb->p_buf == NULL) {
-        goto __failed;
-    }
-#if USB_OS_EN
-    /* 创建互斥锁*/
-    p_rb->p_lock = usb_lib_mutex_create(p_lib);
-    if (p_rb->p_lock == NULL) {
-        __USB_ERR_TRACE(MutexCreateErr, "\r\n");
-        goto __failed;
+    p_buf = usb_lib_malloc(p_lib, buf_size);
+    if (p_buf == NULL) {
+        usb_lib_mfree(p_lib, p_rb);
+        return NULL;
     }
-#endif
 
-    p_rb->buf_size = buf_size;
+    usb_lib_rb_init(p_rb, p_buf, buf_size);
+    p_rb->is_buf_alloc = USB_TRUE;
 
     return p_rb;
-__failed:
-#if USB_OS_EN
-    if (p_rb->p_lock) {
-        usb_lib_task_destroy(p_lib, p_rb->p_lock);
-    }
-#endif
-    if (p_rb->p_buf) {
-        usb_lib_mfree(p_lib, p_rb->p_buf);
-    }
-    return NULL;
 }
 
 /**
@@ -156,19 +189,49 @@ void usb_lib_rb_destroy(struct usb_lib_base *p_lib, struct usb_ringbuf *p_rb){
     if (p_rb == NULL) {
         return;
     }
-#if USB_OS_EN
-    if (p_rb->p_lock) {
-        usb_lib_task_destroy(p_lib, p_rb->p_lock);
-    }
-#endif
-    if (p_rb->p_buf) {
+    if ((p_rb->p_buf) && (p_rb->is_buf_alloc == USB_TRUE)) {
         usb_lib_mfree(p_lib, p_rb->p_buf);
     }
     usb_lib_mfree(p_lib, p_rb);
 }
 
 /**
- * \brief USB 库环形缓冲区数据放入函数
+ * \brief USB 库环形缓冲区复位函数，调用时生产者和消费者都必须停止
+ *
+ * \param[in] p_rb 环形缓冲区
+ */
+void usb_lib_rb_reset(struct usb_ringbuf *p_rb){
+    if (p_rb == NULL) {
+        return;
+    }
+    USB_STORE_RELEASE(&p_rb->rd_idx, 0);
+    USB_STORE_RELEASE(&p_rb->wr_idx, 0);
+}
+
+/**
+ * \brief USB 库环形缓冲区获取数据长度
+ *
+ * \param[in] p_rb 环形缓冲区
+ *
+ * \retval 返回可读的数据长度
+ */
+uint32_t usb_lib_rb_data_len_get(struct usb_ringbuf *p_rb){
+    return USB_LOAD_ACQUIRE(&p_rb->wr_idx) - USB_LOAD_ACQUIRE(&p_rb->rd_idx);
+}
+
+/**
+ * \brief USB 库环形缓冲区获取空闲长度
+ *
+ * \param[in] p_rb 环形缓冲区
+ *
+ * \retval 返回可写的空闲长度
+ */
+uint32_t usb_lib_rb_space_len_get(struct usb_ringbuf *p_rb){
+    return p_rb->buf_size - usb_lib_rb_data_len_get(p_rb);
+}
+
+/**
+ * \brief USB 库环形缓冲区数据放入函数(生产者)
  *
  * \param[in]  p_rb      环形缓冲区
  * \param[in]  p_buf     数据缓存
@@ -181,67 +244,37 @@ int usb_lib_rb_put(struct usb_ringbuf *p_rb,
                    uint8_t            *p_buf,
                    uint32_t            buf_len,
                    uint32_t           *p_act_len){
-    int      ret = USB_OK;
-    uint32_t len;
+    uint32_t wr_idx, rd_idx, len, len_tail, pos;
 
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_rb->p_lock, 5000);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
+    if ((p_rb == NULL) || (p_buf == NULL) || (p_act_len == NULL)) {
+        return -USB_EINVAL;
     }
-#endif
-    if (p_rb->rd_pos > p_rb->data_pos) {
-        if (buf_len > (p_rb->rd_pos - p_rb->data_pos - 1)) {
-            len = p_rb->rd_pos - p_rb->data_pos;
-        } else {
-            len = buf_len;
-        }
-        memcpy(p_rb->p_buf + p_rb->data_pos, p_buf, len);
 
-        *p_act_len = len;
-    } else {
-        /* 计算可以放入数据的总大小*/
-        len = p_rb->buf_size + p_rb->rd_pos - p_rb->data_pos - 1;
+    /* 写索引只有自己修改，读索引需要获取消费者的释放*/
+    wr_idx = p_rb->wr_idx;
+    rd_idx = USB_LOAD_ACQUIRE(&p_rb->rd_idx);
 
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        /* 回环*/
-        if ((len + p_rb->data_pos) > p_rb->buf_size) {
-            len = p_rb->buf_size - p_rb->data_pos;
-        }
-        memcpy(p_rb->p_buf + p_rb->data_pos, p_buf, len);
-        *p_act_len = len;
+    len = p_rb->buf_size - (wr_idx - rd_idx);
+    if (len > buf_len) {
+        len = buf_len;
+    }
+    pos = wr_idx & p_rb->mask;
+    /* 回环*/
+    len_tail = min(len, p_rb->buf_size - pos);
 
-        len = buf_len - *p_act_len;
+    memcpy(p_rb->p_buf + pos, p_buf, len_tail);
+    memcpy(p_rb->p_buf, p_buf + len_tail, len - len_tail);
 
-        if (p_rb->rd_pos != 0) {
-            if (len > (p_rb->rd_pos - 1)) {
-                len = p_rb->rd_pos - 1;
-            }
-            memcpy(p_rb->p_buf, p_buf + *p_act_len, len);
-            *p_act_len += len;
-        }
-    }
-    /* 重新设置写标记*/
-    p_rb->data_pos = (p_rb->data_pos + *p_act_len);
-    /* 到了环形末尾，回到环形头*/
-    if (p_rb->data_pos >= p_rb->buf_size) {
-        p_rb->data_pos -= p_rb->buf_size;
-    }
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_rb->p_lock);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
-    }
-#endif
+    /* 数据写完后再更新写索引*/
+    USB_STORE_RELEASE(&p_rb->wr_idx, wr_idx + len);
 
-    return ret;
+    *p_act_len = len;
+
+    return USB_OK;
 }
 
 /**
- * \brief USB 库环形缓冲区数据获取函数
+ * \brief USB 库环形缓冲区数据获取函数(消费者)
  *
  * \param[in]  p_rb      环形缓冲区
  * \param[in]  p_buf     数据缓存
@@ -254,55 +287,144 @@ int usb_lib_rb_get(struct usb_ringbuf *p_rb,
                    uint8_t            *p_buf,
                    uint32_t            buf_len,
                    uint32_t           *p_act_len){
-    int      ret = USB_OK;
-    uint32_t len;
+    uint32_t wr_idx, rd_idx, len, len_tail, pos;
 
-#if USB_OS_EN
-    ret = usb_mutex_lock(p_rb->p_lock, 5000);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexLockErr, "(%d)\r\n", ret);
-        return ret;
+    if ((p_rb == NULL) || (p_buf == NULL) || (p_act_len == NULL)) {
+        return -USB_EINVAL;
     }
-#endif
-    if (p_rb->rd_pos <= p_rb->data_pos) {
-        len = p_rb->data_pos - p_rb->rd_pos;
 
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        memcpy(p_buf, p_rb->p_buf + p_rb->rd_pos, len);
-        *p_act_len = len;
-    } else {
-        len = p_rb->buf_size - p_rb->rd_pos;
+    rd_idx = p_rb->rd_idx;
+    wr_idx = USB_LOAD_ACQUIRE(&p_rb->wr_idx);
 
-        if (len > buf_len) {
-            len = buf_len;
-        }
-        memcpy(p_buf, p_rb->p_buf + p_rb->rd_pos, len);
-        *p_act_len = len;
+    len = wr_idx - rd_idx;
+    if (len > buf_len) {
+        len = buf_len;
+    }
+    pos = rd_idx & p_rb->mask;
+    /* 回环*/
+    len_tail = min(len, p_rb->buf_size - pos);
 
-        len = p_rb->data_pos;
+    memcpy(p_buf, p_rb->p_buf + pos, len_tail);
+    memcpy(p_buf + len_tail, p_rb->p_buf, len - len_tail);
 
-        if (len > (buf_len - *p_act_len)) {
-            len = buf_len - *p_act_len;
-        }
-        if (len > 0) {
-            memcpy(p_buf + *p_act_len, p_rb->p_buf, len);
-        }
-        *p_act_len += len;
+    /* 数据读完后再释放空间给生产者*/
+    USB_STORE_RELEASE(&p_rb->rd_idx, rd_idx + len);
+
+    *p_act_len = len;
+
+    return USB_OK;
+}
+
+/**
+ * \brief USB 库环形缓冲区预留写空间(生产者)，不拷贝数据，
+ *        写完后调用 usb_lib_rb_commit() 提交
+ *
+ * \param[in]  p_rb   环形缓冲区
+ * \param[out] p_data 返回连续空闲空间的地址
+ * \param[out] p_len  返回连续空闲空间的长度
+ *
+ * \retval 成功返回 USB_OK，缓冲区满返回 -USB_EAGAIN
+ */
+int usb_lib_rb_reserve(struct usb_ringbuf *p_rb, uint8_t **p_data, uint32_t *p_len){
+    uint32_t wr_idx, rd_idx, len, pos;
+
+    if ((p_rb == NULL) || (p_data == NULL) || (p_len == NULL)) {
+        return -USB_EINVAL;
     }
-    p_rb->rd_pos = p_rb->rd_pos + *p_act_len;
-    if (p_rb->rd_pos >= p_rb->buf_size) {
-        p_rb->rd_pos -= p_rb->buf_size;
+
+    wr_idx = p_rb->wr_idx;
+    rd_idx = USB_LOAD_ACQUIRE(&p_rb->rd_idx);
+
+    len = p_rb->buf_size - (wr_idx - rd_idx);
+    if (len == 0) {
+        return -USB_EAGAIN;
     }
-#if USB_OS_EN
-    ret = usb_mutex_unlock(p_rb->p_lock);
-    if (ret != USB_OK) {
-        __USB_ERR_TRACE(MutexUnLockErr, "(%d)\r\n", ret);
+    pos = wr_idx & p_rb->mask;
+
+    *p_data = p_rb->p_buf + pos;
+    *p_len  = min(len, p_rb->buf_size - pos);
+
+    return USB_OK;
+}
+
+/**
+ * \brief USB 库环形缓冲区提交写入的数据(生产者)
+ *
+ * \param[in] p_rb 环形缓冲区
+ * \param[in] len  写入的长度
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_lib_rb_commit(struct usb_ringbuf *p_rb, uint32_t len){
+    uint32_t wr_idx;
+
+    if (p_rb == NULL) {
+        return -USB_EINVAL;
     }
-#endif
 
-    return ret;
+    wr_idx = p_rb->wr_idx;
+    if (len > (p_rb->buf_size - (wr_idx - USB_LOAD_ACQUIRE(&p_rb->rd_idx)))) {
+        return -USB_EILLEGAL;
+    }
+    USB_STORE_RELEASE(&p_rb->wr_idx, wr_idx + len);
+
+    return USB_OK;
+}
+
+/**
+ * \brief USB 库环形缓冲区查看数据(消费者)，不拷贝数据，
+ *        用完后调用 usb_lib_rb_consume() 释放
+ *
+ * \param[in]  p_rb   环形缓冲区
+ * \param[out] p_data 返回连续数据的地址
+ * \param[out] p_len  返回连续数据的长度
+ *
+ * \retval 成功返回 USB_OK，缓冲区空返回 -USB_EAGAIN
+ */
+int usb_lib_rb_peek(struct usb_ringbuf *p_rb, uint8_t **p_data, uint32_t *p_len){
+    uint32_t wr_idx, rd_idx, len, pos;
+
+    if ((p_rb == NULL) || (p_data == NULL) || (p_len == NULL)) {
+        return -USB_EINVAL;
+    }
+
+    rd_idx = p_rb->rd_idx;
+    wr_idx = USB_LOAD_ACQUIRE(&p_rb->wr_idx);
+
+    len = wr_idx - rd_idx;
+    if (len == 0) {
+        return -USB_EAGAIN;
+    }
+    pos = rd_idx & p_rb->mask;
+
+    *p_data = p_rb->p_buf + pos;
+    *p_len  = min(len, p_rb->buf_size - pos);
+
+    return USB_OK;
+}
+
+/**
+ * \brief USB 库环形缓冲区释放已读的数据(消费者)
+ *
+ * \param[in] p_rb 环形缓冲区
+ * \param[in] len  释放的长度
+ *
+ * \retval 成功返回 USB_OK
+ */
+int usb_lib_rb_consume(struct usb_ringbuf *p_rb, uint32_t len){
+    uint32_t rd_idx;
+
+    if (p_rb == NULL) {
+        return -USB_EINVAL;
+    }
+
+    rd_idx = p_rb->rd_idx;
+    if (len > (USB_LOAD_ACQUIRE(&p_rb->wr_idx) - rd_idx)) {
+        return -USB_EILLEGAL;
+    }
+    USB_STORE_RELEASE(&p_rb->rd_idx, rd_idx + len);
+
+    return USB_OK;
 }
 
 #if USB_OS_EN